@@ -22,6 +22,70 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 void CL_FinishTimeDemo (void);
 
+cvar_t	cl_demojitter = {"cl_demojitter","0"};	// max random delay added to demo messages, in seconds
+cvar_t	demo_speed = {"demo_speed","1"};		// playback rate, 0 pauses
+cvar_t	demo_keyframeinterval = {"demo_keyframeinterval","60"};	// demo seconds between seek keyframes, 0 disables
+cvar_t	demo_keyframemem = {"demo_keyframemem","1024"};	// kilobytes of cache keyframes may hold
+
+/*
+A keyframe is a copy of the parsed client state taken just before the
+message at filepos is read, so demo_seek can restore it and fast forward
+from there instead of replaying the demo from the start.  The copies live
+in the cache, so they are simply lost when memory gets tight.  Each one is
+a few hundred kilobytes, so to keep them from pushing sounds and models
+out of the cache they are held under demo_keyframemem: when the next one
+would not fit, every other keyframe is dropped and the spacing doubled.
+*/
+#define	MAX_DEMO_KEYFRAMES	128
+
+typedef struct
+{
+	double			demotime;
+	int				filepos;
+	int				level;
+	int				num_entities;
+	int				size;
+	cache_user_t	cache;
+} demokeyframe_t;
+
+static demokeyframe_t	demo_keyframes[MAX_DEMO_KEYFRAMES];
+static int				demo_numkeyframes;
+static int				demo_keyframespacing = 1;	// multiple of demo_keyframeinterval
+
+cvar_t	timedemo_norender = {"timedemo_norender","0"};	// skip SCR_UpdateScreen while timing
+cvar_t	timedemo_output = {"timedemo_output","timedemo.json"};	// results file in the game dir, "" for none
+cvar_t	timedemo_baseline = {"timedemo_baseline",""};	// earlier results file to compare against
+cvar_t	timedemo_tolerance = {"timedemo_tolerance","5"};	// percent slowdown reported as a regression
+
+/*
+Frame times for the percentiles.  A run longer than the buffer keeps every
+other sample and from then on stores only every td_framestep'th frame, so
+the percentiles still cover the whole run; the slowest frame is tracked
+separately since sampling could miss it.
+*/
+#define	MAX_TIMEDEMO_FRAMES	8192
+
+static float	td_frametimes[MAX_TIMEDEMO_FRAMES];
+static int		td_numframetimes;
+static int		td_framestep, td_framecount;
+static float	td_maxframetime;
+
+typedef struct
+{
+	char	name[MAX_DEMONAME];
+	int		frames;
+	float	seconds;
+	float	fps;
+	float	p50, p95, p99, max;				// frame times in ms
+	float	subsys[TDS_NUMSUBSYSTEMS];		// ms per frame
+} tdresult_t;
+
+static char			*td_subsysnames[TDS_NUMSUBSYSTEMS] = {"parse", "relink", "render", "sound", "host"};
+static tdresult_t	td_results[MAX_DEMOS];
+static int			td_numresults;
+static char			td_name[MAX_DEMONAME];
+static char			td_savedemos[MAX_DEMOS][MAX_DEMONAME];	// startdemos list while timedemos runs
+
 /*
 ==============================================================================
 
@@ -35,6 +99,181 @@ read from the demo file.
 ==============================================================================
 */
 
+/*
+==============
+CL_FreeDemoKeyframes
+==============
+*/
+static void CL_FreeDemoKeyframes (void)
+{
+	int		i;
+
+	for (i=0 ; i<demo_numkeyframes ; i++)
+		if (demo_keyframes[i].cache.data)
+			Cache_Free (&demo_keyframes[i].cache);
+	demo_numkeyframes = 0;
+	demo_keyframespacing = 1;
+}
+
+/*
+==============
+CL_ThinDemoKeyframes
+
+Drops every other keyframe, and those already flushed from the cache
+==============
+*/
+static void CL_ThinDemoKeyframes (void)
+{
+	int		i, j;
+
+	for (i=j=0 ; i<demo_numkeyframes ; i++)
+	{
+		if (demo_keyframes[i].cache.data && (i & 1))
+		{
+			if (i != j)
+			{
+				demo_keyframes[j] = demo_keyframes[i];
+				Cache_Reassign (&demo_keyframes[i].cache, &demo_keyframes[j].cache);
+			}
+			j++;
+		}
+		else if (demo_keyframes[i].cache.data)
+			Cache_Free (&demo_keyframes[i].cache);
+	}
+	demo_numkeyframes = j;
+	demo_keyframespacing *= 2;
+}
+
+/*
+==============
+CL_DemoKeyframeMemory
+
+Bytes held by keyframes still in the cache
+==============
+*/
+static int CL_DemoKeyframeMemory (void)
+{
+	int		i, total;
+
+	total = 0;
+	for (i=0 ; i<demo_numkeyframes ; i++)
+		if (demo_keyframes[i].cache.data)
+			total += demo_keyframes[i].size;
+	return total;
+}
+
+/*
+==============
+CL_DemoKeyframe
+
+Called before each demo message is read
+==============
+*/
+static void CL_DemoKeyframe (void)
+{
+	demokeyframe_t	*kf;
+	byte			*buf;
+	int				size, limit;
+
+// a timedemo should measure rendering, not snapshot copies
+	if (demo_keyframeinterval.value <= 0 || cls.signon != SIGNONS || cls.timedemo)
+		return;
+
+	if (demo_numkeyframes)
+	{
+		kf = &demo_keyframes[demo_numkeyframes-1];
+		if (cls.demopos <= kf->filepos)
+			return;		// seeked back, already have this part of the demo
+		if (kf->level == cls.demolevel
+		&& cls.demotime < kf->demotime + demo_keyframeinterval.value*demo_keyframespacing)
+			return;
+	}
+
+	size = sizeof(cl) + cl.maxclients*sizeof(scoreboard_t) + sizeof(cl_lightstyle)
+		+ cl.num_entities*sizeof(entity_t);
+	limit = (int)(demo_keyframemem.value * 1024);
+	if (size > limit)
+		return;
+	while (demo_numkeyframes
+	&& (demo_numkeyframes == MAX_DEMO_KEYFRAMES || CL_DemoKeyframeMemory () + size > limit))
+		CL_ThinDemoKeyframes ();
+
+	kf = &demo_keyframes[demo_numkeyframes];
+	buf = Cache_Alloc (&kf->cache, size, "keyframe");
+	if (!buf)
+		return;
+
+	memcpy (buf, &cl, sizeof(cl));
+	buf += sizeof(cl);
+	memcpy (buf, cl.scores, cl.maxclients*sizeof(scoreboard_t));
+	buf += cl.maxclients*sizeof(scoreboard_t);
+	memcpy (buf, cl_lightstyle, sizeof(cl_lightstyle));
+	buf += sizeof(cl_lightstyle);
+	memcpy (buf, cl_entities, cl.num_entities*sizeof(entity_t));
+
+	kf->demotime = cls.demotime;
+	kf->filepos = cls.demopos;
+	kf->level = cls.demolevel;
+	kf->num_entities = cl.num_entities;
+	kf->size = size;
+	demo_numkeyframes++;
+}
+
+/*
+==============
+CL_RestoreDemoKeyframe
+
+Returns false if the keyframe has been flushed from the cache
+==============
+*/
+static qboolean CL_RestoreDemoKeyframe (demokeyframe_t *kf)
+{
+	byte			*buf;
+	struct efrag_s	*free_efrags;
+	scoreboard_t	*scores, *oldscores;
+	entity_t		*ent;
+	int				i;
+
+	buf = Cache_Check (&kf->cache);
+	if (!buf)
+		return false;
+
+// entity efrags are not part of the copy, unlink everything first
+	for (i=1 ; i<cl.num_entities ; i++)
+		if (cl_entities[i].efrag)
+			R_RemoveEfrags (&cl_entities[i]);
+
+// the level may have been reloaded since, keep the current hunk pointers
+	free_efrags = cl.free_efrags;
+	scores = cl.scores;
+	memcpy (&cl, buf, sizeof(cl));
+	oldscores = cl.scores;
+	cl.free_efrags = free_efrags;
+	cl.scores = scores;
+	buf += sizeof(cl);
+	memcpy (cl.scores, buf, cl.maxclients*sizeof(scoreboard_t));
+	buf += cl.maxclients*sizeof(scoreboard_t);
+	memcpy (cl_lightstyle, buf, sizeof(cl_lightstyle));
+	buf += sizeof(cl_lightstyle);
+	memcpy (cl_entities, buf, kf->num_entities*sizeof(entity_t));
+	memset (cl_entities + kf->num_entities, 0, (MAX_EDICTS - kf->num_entities)*sizeof(entity_t));
+	memset (cl_snapshots, 0, sizeof(cl_snapshots));		// restart the lerp history
+
+	for (i=0, ent=cl_entities ; i<kf->num_entities ; i++, ent++)
+	{
+		ent->efrag = NULL;
+		ent->topnode = NULL;
+		ent->forcelink = true;
+		if (ent->colormap && ent->colormap != vid.colormap)
+			ent->colormap = cl.scores[((byte *)ent->colormap - (byte *)oldscores) / sizeof(scoreboard_t)].translations;
+	}
+
+	Sys_FileSeek (cls.demofile, kf->filepos);
+	cls.demopos = kf->filepos;
+	cls.demotime = kf->demotime;
+	return true;
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -48,6 +287,7 @@ void CL_StopPlayback (void)
 		return;
 
 	Sys_FileClose(cls.demofile);
+	CL_FreeDemoKeyframes ();
 	cls.demoplayback = false;
 	cls.demofile = -1;
 	cls.state = ca_disconnected;
@@ -79,6 +319,71 @@ void CL_WriteDemoMessage (void)
 	Sys_FileWrite(cls.demofile, net_message.data, net_message.cursize);
 }
 
+/*
+====================
+CL_ReadDemoMessage
+
+Reads the next message from the demo file into net_message
+====================
+*/
+static int CL_ReadDemoMessage (void)
+{
+	int		r, i;
+	float	f;
+
+	CL_DemoKeyframe ();
+
+	Sys_FileRead(cls.demofile, &net_message.cursize, 4);
+	VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
+	for (i=0 ; i<3 ; i++)
+	{
+		r = Sys_FileRead(cls.demofile, &f, 4) / 4;
+		cl.mviewangles[0][i] = LittleFloat (f);
+	}
+	
+	net_message.cursize = LittleLong (net_message.cursize);
+	if (net_message.cursize > MAX_MSGLEN)
+		Sys_Error ("Demo message (0x%08x) > MAX_MSGLEN (%d)", net_message.cursize, MAX_MSGLEN);
+	r = Sys_FileRead(cls.demofile, net_message.data, net_message.cursize) / net_message.cursize;
+	if (r != 1)
+	{
+		CL_StopPlayback ();
+		return 0;
+	}
+
+	cls.demopos += 16 + net_message.cursize;
+	return 1;
+}
+
+/*
+====================
+CL_TimeDemoFrame
+
+Records a frame time for the timedemo percentiles
+====================
+*/
+static void CL_TimeDemoFrame (float frametime)
+{
+	int		i, frame;
+
+	if (frametime > td_maxframetime)
+		td_maxframetime = frametime;
+	frame = td_framecount++;
+	if (frame % td_framestep)
+		return;
+
+	if (td_numframetimes == MAX_TIMEDEMO_FRAMES)
+	{
+		for (i=0 ; i<MAX_TIMEDEMO_FRAMES/2 ; i++)
+			td_frametimes[i] = td_frametimes[i*2];
+		td_numframetimes = MAX_TIMEDEMO_FRAMES/2;
+		td_framestep *= 2;
+		if (frame % td_framestep)
+			return;		// not on the coarser step
+	}
+	td_frametimes[td_numframetimes++] = frametime;
+}
+
 /*
 ====================
 CL_GetMessage
@@ -88,8 +393,7 @@ Handles recording and playback of demos, on top of NET_ code
 */
 int CL_GetMessage (void)
 {
-	int		r, i;
-	float	f;
+	int		r;
 	
 	if	(cls.demoplayback)
 	{
@@ -104,34 +408,31 @@ int CL_GetMessage (void)
 			// if this is the second frame, grab the real td_starttime
 			// so the bogus time on the first frame doesn't count
 				if (host_framecount == cls.td_startframe + 1)
+				{
 					cls.td_starttime = realtime;
+					memset (cls.td_subsystime, 0, sizeof(cls.td_subsystime));
+				}
+				else if (host_framecount > cls.td_startframe + 1)
+					CL_TimeDemoFrame (realtime - cls.td_lastframetime);
+				cls.td_lastframetime = realtime;
 			}
 			else if ( /* cl.time > 0 && */ cl.time <= cl.mtime[0])
 			{
 					return 0;		// don't need another message yet
 			}
+			else if (cl_demojitter.value > 0)
+			{
+			// simulate a bad connection by holding each message back
+				if (!cls.demoholduntil)
+					cls.demoholduntil = realtime + cl_demojitter.value * (rand() & 0x7fff) / 0x7fff;
+				if (realtime < cls.demoholduntil)
+					return 0;
+				cls.demoholduntil = 0;
+			}
 		}
 		
 	// get the next message
-		Sys_FileRead(cls.demofile, &net_message.cursize, 4);
-		VectorCopy (cl.mviewangles[0], cl.mviewangles[1]);
-		for (i=0 ; i<3 ; i++)
-		{
-			r = Sys_FileRead(cls.demofile, &f, 4) / 4;
-			cl.mviewangles[0][i] = LittleFloat (f);
-		}
-		
-		net_message.cursize = LittleLong (net_message.cursize);
-		if (net_message.cursize > MAX_MSGLEN)
-			Sys_Error ("Demo message (0x%08x) > MAX_MSGLEN (%d)", net_message.cursize, MAX_MSGLEN);
-		r = Sys_FileRead(cls.demofile, net_message.data, net_message.cursize) / net_message.cursize;
-		if (r != 1)
-		{
-			CL_StopPlayback ();
-			return 0;
-		}
-	
-		return 1;
+		return CL_ReadDemoMessage ();
 	}
 
 	while (1)
@@ -313,15 +614,25 @@ void CL_PlayDemo_f (void)
 		return;
 	}
 
+	CL_FreeDemoKeyframes ();
 	cls.demoplayback = true;
 	cls.state = ca_connected;
 	cls.forcetrack = 0;
+	cls.demostart = com_filestart;
+	cls.demotime = 0;
+	cls.demolevel = 0;
+	cls.demoseeking = false;
 
 	while ((c = CL_FileGetChar(cls.demofile)) != '\n')
+	{
+		cls.demostart++;
 		if (c == '-')
 			neg = true;
 		else
 			cls.forcetrack = cls.forcetrack * 10 + (c - '0');
+	}
+	cls.demostart++;
+	cls.demopos = cls.demostart;
 
 	if (neg)
 		cls.forcetrack = -cls.forcetrack;
@@ -329,6 +640,151 @@ void CL_PlayDemo_f (void)
 //	fscanf (cls.demofile, "%i\n", &cls.forcetrack);
 }
 
+/*
+====================
+CL_TimeDemoPercentile
+
+frame time in ms below which the given fraction of frames fall,
+td_frametimes must be sorted
+====================
+*/
+static float CL_TimeDemoPercentile (float fraction)
+{
+	if (!td_numframetimes)
+		return 0;
+	return td_frametimes[(int)(fraction * (td_numframetimes - 1))] * 1000;
+}
+
+static int CL_CompareFrameTimes (const void *a, const void *b)
+{
+	float	fa = *(float *)a, fb = *(float *)b;
+
+	return fa < fb ? -1 : fa > fb;
+}
+
+/*
+====================
+CL_JSONString
+
+Returns s quoted and escaped for a JSON file
+====================
+*/
+static char *CL_JSONString (char *s)
+{
+	static char	buf[MAX_DEMONAME * 6 + 3];
+	char		*p;
+
+	p = buf;
+	*p++ = '"';
+	for ( ; *s ; s++)
+	{
+		if (*s == '"' || *s == '\\')
+		{
+			*p++ = '\\';
+			*p++ = *s;
+		}
+		else if ((unsigned char)*s < ' ')
+			p += sprintf (p, "\\u%04x", (unsigned char)*s);
+		else
+			*p++ = *s;
+	}
+	*p++ = '"';
+	*p = 0;
+	return buf;
+}
+
+/*
+====================
+CL_WriteTimeDemoResults
+
+Writes all results of this run to timedemo_output as JSON
+====================
+*/
+static void CL_WriteTimeDemoResults (void)
+{
+	static char	buf[MAX_DEMOS * 512 + 64];
+	tdresult_t	*r;
+	char		*p;
+	int			i, j;
+
+	if (!timedemo_output.string[0])
+		return;
+
+	p = buf;
+	p += sprintf (p, "{\n\t\"results\": [\n");
+	for (i=0, r=td_results ; i<td_numresults ; i++, r++)
+	{
+		p += sprintf (p, "\t\t{\"name\": %s, \"frames\": %i, \"seconds\": %.3f, \"fps\": %.2f, "
+			"\"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f",
+			CL_JSONString (r->name), r->frames, r->seconds, r->fps, r->p50, r->p95, r->p99, r->max);
+		for (j=0 ; j<TDS_NUMSUBSYSTEMS ; j++)
+			p += sprintf (p, ", \"%s\": %.3f", td_subsysnames[j], r->subsys[j]);
+		p += sprintf (p, "}%s\n", i < td_numresults-1 ? "," : "");
+	}
+	p += sprintf (p, "\t]\n}\n");
+
+	COM_WriteFile (timedemo_output.string, buf, p - buf);
+}
+
+/*
+====================
+CL_BaselineValue
+
+Finds "key": <number> in the result named name of a file written by
+CL_WriteTimeDemoResults, returns false if it isn't there
+====================
+*/
+static qboolean CL_BaselineValue (char *data, char *name, char *key, float *value)
+{
+	char	*entry, *end, *field;
+
+	entry = strstr (data, va("\"name\": %s", CL_JSONString (name)));
+	if (!entry)
+		return false;
+	end = strchr (entry, '}');
+	field = strstr (entry, va("\"%s\":", key));
+	if (!field || (end && field > end))
+		return false;
+	*value = Q_atof (field + strlen(key) + 3);
+	return true;
+}
+
+/*
+====================
+CL_CompareTimeDemoBaseline
+
+Prints how the result compares to the same demo in timedemo_baseline
+====================
+*/
+static void CL_CompareTimeDemoBaseline (tdresult_t *r)
+{
+	char	*data;
+	float	fps, p95, tolerance;
+	int		mark;
+
+	if (!timedemo_baseline.string[0])
+		return;
+
+	mark = Hunk_LowMark ();
+	data = (char *)COM_LoadHunkFile (timedemo_baseline.string);
+	if (!data)
+	{
+		Con_Printf ("couldn't load timedemo baseline %s\n", timedemo_baseline.string);
+		return;
+	}
+
+	if (!CL_BaselineValue (data, r->name, "fps", &fps) || !CL_BaselineValue (data, r->name, "p95", &p95))
+		Con_Printf ("%s: not in baseline\n", r->name);
+	else
+	{
+		tolerance = timedemo_tolerance.value / 100;
+		Con_Printf ("%s: fps %5.1f -> %5.1f, p95 %6.2f -> %6.2f ms%s\n", r->name, fps, r->fps, p95, r->p95,
+			(r->fps < fps * (1 - tolerance) || r->p95 > p95 * (1 + tolerance)) ? "  REGRESSION" : "");
+	}
+
+	Hunk_FreeToLowMark (mark);
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -337,8 +793,9 @@ CL_FinishTimeDemo
 */
 void CL_FinishTimeDemo (void)
 {
-	int		frames;
-	double	time;
+	int			frames, i;
+	double		time;
+	tdresult_t	*r;
 	
 	cls.timedemo = false; 
 	
@@ -348,6 +805,53 @@ void CL_FinishTimeDemo (void)
 	if (time < 1)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames/time);
+
+	if (td_numresults == MAX_DEMOS)
+		td_numresults = 0;
+	r = &td_results[td_numresults++];
+	memset (r, 0, sizeof(*r));
+	strcpy (r->name, td_name);
+	r->frames = frames;
+	r->seconds = time;
+	r->fps = frames/time;
+
+	qsort (td_frametimes, td_numframetimes, sizeof(float), CL_CompareFrameTimes);
+	r->p50 = CL_TimeDemoPercentile (0.5);
+	r->p95 = CL_TimeDemoPercentile (0.95);
+	r->p99 = CL_TimeDemoPercentile (0.99);
+	r->max = td_maxframetime * 1000;
+	Con_Printf ("frame ms: p50 %.2f p95 %.2f p99 %.2f max %.2f\n", r->p50, r->p95, r->p99, r->max);
+	if (td_framestep > 1)
+		Con_Printf ("percentiles sampled from every %i frames\n", td_framestep);
+
+	if (frames > 0)
+	{
+		for (i=0 ; i<TDS_NUMSUBSYSTEMS ; i++)
+		{
+			r->subsys[i] = cls.td_subsystime[i] * 1000 / frames;
+			Con_Printf ("%s %.2f ", td_subsysnames[i], r->subsys[i]);
+		}
+		Con_Printf ("ms/frame\n");
+	}
+
+	CL_PrintEntityStats ();
+	CL_WriteTimeDemoResults ();
+	S_StatsFinishTimeDemo ();
+	CL_CompareTimeDemoBaseline (r);
+}
+
+/*
+====================
+CL_EndTimeDemoBatch
+
+Stops the timedemos loop and gives back the startdemos list
+====================
+*/
+static void CL_EndTimeDemoBatch (void)
+{
+	cls.td_batch = false;
+	cls.demonum = -1;
+	memcpy (cls.demos, td_savedemos, sizeof(cls.demos));
 }
 
 /*
@@ -369,12 +873,167 @@ void CL_TimeDemo_f (void)
 	}
 
 	CL_PlayDemo_f ();
+	if (!cls.demoplayback)
+	{
+		if (cls.td_batch)
+			CL_EndTimeDemoBatch ();
+		return;
+	}
 	
 // cls.td_starttime will be grabbed at the second frame of the demo, so
 // all the loading time doesn't get counted
 	
+	if (!cls.td_batch)
+		td_numresults = 0;
+	Q_strncpyz (td_name, Cmd_Argv(1), sizeof(td_name));
+	S_StatsStartTimeDemo (td_name);
+	td_numframetimes = 0;
+	td_framestep = 1;
+	td_framecount = 0;
+	td_maxframetime = 0;
 	cls.timedemo = true;
 	cls.td_startframe = host_framecount;
+	cls.entityupdates = 0;
+	cls.entityupdatebytes = 0;
 	cls.td_lastframe = -1;		// get a new message this frame
 }
 
+/*
+====================
+CL_TimeDemos_f
+
+timedemos <demo1> [demo2 ...]
+====================
+*/
+void CL_TimeDemos_f (void)
+{
+	int		i, c;
+
+	if (cmd_source != src_command)
+		return;
+
+	c = Cmd_Argc() - 1;
+	if (c < 1)
+	{
+		Con_Printf ("timedemos <demo1> [demo2 ...] : times each demo and writes %s\n", timedemo_output.string);
+		return;
+	}
+	if (c > MAX_DEMOS)
+	{
+		Con_Printf ("Max %i demos in a batch\n", MAX_DEMOS);
+		c = MAX_DEMOS;
+	}
+
+	if (!cls.td_batch)
+		memcpy (td_savedemos, cls.demos, sizeof(td_savedemos));
+	memset (cls.demos, 0, sizeof(cls.demos));
+	for (i=1 ; i<c+1 ; i++)
+		strncpy (cls.demos[i-1], Cmd_Argv(i), sizeof(cls.demos[0])-1);
+
+	td_numresults = 0;
+	cls.td_batch = true;
+	cls.demonum = 0;
+	CL_NextDemo ();
+}
+
+/*
+====================
+CL_FinishTimeDemoBatch
+
+Called by CL_NextDemo when the last demo of timedemos has ended
+====================
+*/
+void CL_FinishTimeDemoBatch (void)
+{
+	tdresult_t	*r;
+	int			i;
+
+	CL_Disconnect ();		// finishes the last timedemo
+	CL_EndTimeDemoBatch ();
+
+	Con_Printf ("\n%-16s %6s %7s %7s %7s\n", "demo", "fps", "p50", "p95", "p99");
+	for (i=0, r=td_results ; i<td_numresults ; i++, r++)
+		Con_Printf ("%-16s %6.1f %7.2f %7.2f %7.2f\n", r->name, r->fps, r->p50, r->p95, r->p99);
+	if (timedemo_output.string[0])
+		Con_Printf ("results written to %s\n", timedemo_output.string);
+}
+
+/*
+====================
+CL_DemoSeek_f
+
+demo_seek <seconds>
+====================
+*/
+void CL_DemoSeek_f (void)
+{
+	double			target, start;
+	demokeyframe_t	*kf, *best;
+	int				i, messages;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (Cmd_Argc() != 2)
+	{
+		Con_Printf ("demo_seek <seconds> : jump to a time in the playing demo\n");
+		return;
+	}
+	if (!cls.demoplayback || cls.timedemo)
+	{
+		Con_Printf ("Not playing a demo.\n");
+		return;
+	}
+
+	target = Q_atof (Cmd_Argv(1));
+	if (target < 0)
+		target = 0;
+	start = Sys_FloatTime ();
+
+// latest keyframe of this level at or before the target that is still cached
+	best = NULL;
+	if (cls.signon == SIGNONS)
+	{
+		for (i=0, kf=demo_keyframes ; i<demo_numkeyframes ; i++, kf++)
+		{
+			if (kf->level != cls.demolevel || kf->demotime > target)
+				continue;
+			if (target >= cls.demotime && kf->demotime <= cls.demotime)
+				continue;	// playing on from here is cheaper
+			if (!Cache_Check (&kf->cache))
+				continue;
+			if (!best || kf->demotime > best->demotime)
+				best = kf;
+		}
+	}
+
+	if (best)
+		CL_RestoreDemoKeyframe (best);
+	else if (target < cls.demotime)
+	{
+	// nothing to restore, replay from the first message
+		S_StopAllSounds (true);
+		Sys_FileSeek (cls.demofile, cls.demostart);
+		cls.demopos = cls.demostart;
+		cls.demotime = 0;
+		cls.demolevel = 0;
+		cls.signon = 0;
+	}
+
+	messages = 0;
+	cls.demoseeking = true;
+	while (cls.demotime < target && cls.demoplayback)
+	{
+		if (!CL_ReadDemoMessage ())
+			break;
+		CL_ParseServerMessage ();
+		messages++;
+	}
+	cls.demoseeking = false;
+
+	cl.time = cl.oldtime = cl.mtime[1] = cl.mtime[0];
+	cls.demoholduntil = 0;
+
+	Con_Printf ("seek to %.1f: %i messages in %.3f seconds%s\n", cls.demotime, messages,
+		Sys_FloatTime () - start, best ? " from keyframe" : "");
+}
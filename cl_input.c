@@ -391,6 +391,9 @@ void CL_SendMove (usercmd_t *cmd)
     MSG_WriteByte (&buf, in_impulse);
 	in_impulse = 0;
 
+	if (cl.protocol == PROTOCOL_COMPACT)
+		MSG_WriteByte (&buf, cl.movesequence & 255);
+
 #ifdef QUAKE2
 //
 // light level
@@ -410,6 +413,10 @@ void CL_SendMove (usercmd_t *cmd)
 //
 	if (++cl.movemessages <= 2)
 		return;
+
+// only moves the server will see are replayed by prediction
+	if (cl.protocol == PROTOCOL_COMPACT)
+		CL_SaveMove (cmd);
 	
 	if (NET_SendUnreliableMessage (cls.netcon, &buf) == -1)
 	{
@@ -30,6 +30,11 @@ cvar_t	cl_color = {"_cl_color", "0", true};
 
 cvar_t	cl_shownet = {"cl_shownet","0"};	// can be 0, 1, or 2
 cvar_t	cl_nolerp  = {"cl_nolerp","0"};
+cvar_t	cl_lerpbuffer = {"cl_lerpbuffer","1"};			// draw entities from a snapshot history
+cvar_t	cl_lerpdelay_min = {"cl_lerpdelay_min","0.03"};
+cvar_t	cl_lerpdelay_max = {"cl_lerpdelay_max","0.25"};
+cvar_t	cl_lerpjitterscale = {"cl_lerpjitterscale","2"};	// jitter multiples added to the delay
+cvar_t	cl_lerpextrapolate = {"cl_lerpextrapolate","0.1"};	// max seconds past the newest snapshot
 
 cvar_t	lookspring      = {"lookspring","0", true};
 cvar_t	lookstrafe      = {"lookstrafe","0", true};
@@ -54,6 +59,7 @@ client_state_t	cl;
 // FIXME: put these on hunk?
 efrag_t			cl_efrags[MAX_EFRAGS];
 entity_t		cl_entities[MAX_EDICTS];
+entsnapshots_t	cl_snapshots[MAX_EDICTS];
 entity_t		cl_static_entities[MAX_STATIC_ENTITIES];
 lightstyle_t	cl_lightstyle[MAX_LIGHTSTYLES];
 dlight_t		cl_dlights[MAX_DLIGHTS];
@@ -82,6 +88,7 @@ void CL_ClearState (void)
 // clear other arrays	
 	memset (cl_efrags, 0, sizeof(cl_efrags));
 	memset (cl_entities, 0, sizeof(cl_entities));
+	memset (cl_snapshots, 0, sizeof(cl_snapshots));
 	memset (cl_dlights, 0, sizeof(cl_dlights));
 	memset (cl_lightstyle, 0, sizeof(cl_lightstyle));
 	memset (cl_temp_entities, 0, sizeof(cl_temp_entities));
@@ -235,6 +242,11 @@ void CL_NextDemo (void)
 
 	if (!cls.demos[cls.demonum][0] || cls.demonum == MAX_DEMOS)
 	{
+		if (cls.td_batch)
+		{
+			CL_FinishTimeDemoBatch ();
+			return;
+		}
 		cls.demonum = 0;
 		if (!cls.demos[cls.demonum][0])
 		{
@@ -244,7 +256,7 @@ void CL_NextDemo (void)
 		}
 	}
 
-	sprintf (str,"playdemo %s\n", cls.demos[cls.demonum]);
+	sprintf (str,"%s %s\n", cls.td_batch ? "timedemo" : "playdemo", cls.demos[cls.demonum]);
 	Cbuf_InsertText (str);
 	cls.demonum++;
 }
@@ -272,6 +284,38 @@ void CL_PrintEntities_f (void)
 	}
 }
 
+/*
+==============
+CL_PrintEntityStats
+
+Average size of the entity updates parsed since the last reset, used to
+compare sv_protocol settings on the same demo
+==============
+*/
+void CL_PrintEntityStats (void)
+{
+	Con_Printf ("protocol %i: %i entity updates, %i bytes, %4.2f bytes/update\n",
+		cl.protocol, cls.entityupdates, cls.entityupdatebytes,
+		cls.entityupdates ? (float)cls.entityupdatebytes / cls.entityupdates : 0);
+}
+
+/*
+==============
+CL_EntityStats_f
+==============
+*/
+void CL_EntityStats_f (void)
+{
+	if (Cmd_Argc() == 2 && !Q_strcmp (Cmd_Argv(1), "reset"))
+	{
+		cls.entityupdates = 0;
+		cls.entityupdatebytes = 0;
+		return;
+	}
+
+	CL_PrintEntityStats ();
+}
+
 
 /*
 ===============
@@ -391,6 +435,201 @@ void CL_DecayLights (void)
 }
 
 
+/*
+===============
+CL_LerpBufferActive
+
+The snapshot buffer is only used where CL_LerpPoint would interpolate
+===============
+*/
+qboolean CL_LerpBufferActive (void)
+{
+	return cl_lerpbuffer.value && !cl_nolerp.value && !cls.timedemo && !sv.active;
+}
+
+/*
+===============
+CL_UpdateLerpDelay
+
+Called for every svc_time.  Tracks how far packet arrival drifts from the
+server frame spacing and sizes the playout delay to cover it.
+===============
+*/
+void CL_UpdateLerpDelay (void)
+{
+	float	servergap, arrivalgap, target;
+
+	servergap = cl.mtime[0] - cl.mtime[1];
+	arrivalgap = realtime - cl.lastmsgrealtime;
+	cl.lastmsgrealtime = realtime;
+
+	if (cls.demoseeking)
+		return;		// fast forwarding, messages arrive all at once
+
+	if (servergap <= 0 || servergap > 1 || arrivalgap > 1)
+		return;		// level start or a long stall, don't poison the averages
+
+	cl.msginterval += (servergap - cl.msginterval) * (1.0/16);
+	cl.jitter += (fabs(arrivalgap - servergap) - cl.jitter) * (1.0/16);
+
+	target = cl.msginterval + cl.jitter * cl_lerpjitterscale.value;
+	target = bound(cl_lerpdelay_min.value, target, cl_lerpdelay_max.value);
+
+// ease towards the target so the render time doesn't jump
+	cl.lerpdelay += (target - cl.lerpdelay) * 0.1;
+}
+
+/*
+===============
+CL_PushSnapshot
+
+Records the state just parsed into msg_origins[0] / msg_angles[0] of
+cl_entities[num]
+===============
+*/
+void CL_PushSnapshot (int num, qboolean reset)
+{
+	entity_t		*ent;
+	entsnapshots_t	*hist;
+	entsnapshot_t	*snap;
+
+	ent = &cl_entities[num];
+	hist = &cl_snapshots[num];
+	if (reset)
+		hist->count = 0;
+
+	hist->head = (hist->head + 1) & (MAX_ENTITY_SNAPSHOTS-1);
+	if (hist->count < MAX_ENTITY_SNAPSHOTS)
+		hist->count++;
+
+	snap = &hist->snapshots[hist->head];
+	snap->time = cl.mtime[0];
+	VectorCopy (ent->msg_origins[0], snap->origin);
+	VectorCopy (ent->msg_angles[0], snap->angles);
+}
+
+/*
+===============
+CL_LerpSnapshots
+
+Places cl_entities[num] at rendertime from its snapshot history.  Entities
+flagged forcelink step to the newest snapshot at or before rendertime.
+===============
+*/
+void CL_LerpSnapshots (int num, double rendertime)
+{
+	entity_t		*ent;
+	entsnapshots_t	*hist;
+	entsnapshot_t	*from, *to;
+	int				i, j;
+	float			f, d;
+
+	ent = &cl_entities[num];
+	hist = &cl_snapshots[num];
+	if (!hist->count)
+		return;
+
+// find the newest snapshot at or before rendertime
+	from = NULL;
+	for (i=0 ; i<hist->count ; i++)
+	{
+		from = &hist->snapshots[(hist->head - i) & (MAX_ENTITY_SNAPSHOTS-1)];
+		if (from->time <= rendertime)
+			break;
+	}
+
+	cl.bufferdepth += i;
+	cl.bufferdepthsamples++;
+
+	if (i == hist->count)
+	{	// rendertime is older than the whole history, hold the oldest
+		VectorCopy (from->origin, ent->origin);
+		VectorCopy (from->angles, ent->angles);
+		return;
+	}
+
+	if (i == 0)
+	{	// ran out of snapshots, extrapolate along the last step for a while
+		if (ent->forcelink || hist->count < 2
+		|| rendertime - from->time >= cl_lerpextrapolate.value)
+		{
+			VectorCopy (from->origin, ent->origin);
+			VectorCopy (from->angles, ent->angles);
+			return;
+		}
+		to = from;
+		from = &hist->snapshots[(hist->head - 1) & (MAX_ENTITY_SNAPSHOTS-1)];
+		cl.extrapolations++;
+	}
+	else
+	{
+		if (ent->forcelink)
+		{	// step animation, no lerp
+			VectorCopy (from->origin, ent->origin);
+			VectorCopy (from->angles, ent->angles);
+			return;
+		}
+		to = &hist->snapshots[(hist->head - i + 1) & (MAX_ENTITY_SNAPSHOTS-1)];
+	}
+
+	if (to->time <= from->time)
+	{
+		VectorCopy (to->origin, ent->origin);
+		VectorCopy (to->angles, ent->angles);
+		return;
+	}
+
+	f = (rendertime - from->time) / (to->time - from->time);
+
+	for (j=0 ; j<3 ; j++)
+	{
+		d = to->origin[j] - from->origin[j];
+		if (d > 100 || d < -100)
+		{	// assume a teleportation, not a motion
+			f = f < 0.5 ? 0 : 1;
+			ent->frame_start_time     = 0;
+			ent->translate_start_time = 0;
+			ent->rotate_start_time    = 0;
+			break;
+		}
+	}
+
+	for (j=0 ; j<3 ; j++)
+	{
+		ent->origin[j] = from->origin[j] + f*(to->origin[j] - from->origin[j]);
+
+		d = to->angles[j] - from->angles[j];
+		if (d > 180)
+			d -= 360;
+		else if (d < -180)
+			d += 360;
+		ent->angles[j] = from->angles[j] + f*d;
+	}
+}
+
+/*
+===============
+CL_InterpStats_f
+===============
+*/
+void CL_InterpStats_f (void)
+{
+	if (Cmd_Argc() == 2 && !Q_strcmp (Cmd_Argv(1), "reset"))
+	{
+		cl.extrapolations = 0;
+		cl.bufferdepth = 0;
+		cl.bufferdepthsamples = 0;
+		return;
+	}
+
+	Con_Printf ("interval %4.1fms jitter %4.1fms delay %4.1fms\n",
+		cl.msginterval*1000, cl.jitter*1000, cl.lerpdelay*1000);
+	Con_Printf ("buffer depth %4.2f, %i extrapolations\n",
+		cl.bufferdepthsamples ? (float)cl.bufferdepth / cl.bufferdepthsamples : 0,
+		cl.extrapolations);
+}
+
+
 /*
 ===============
 CL_LerpPoint
@@ -430,7 +669,8 @@ SetPal(1);
 	}
 	else if (frac > 1)
 	{
-		if (frac > 1.01)
+	// with the snapshot buffer the clock may run on while a packet is late
+		if (frac > 1.01 && !(CL_LerpBufferActive () && cl.time < cl.mtime[0] + cl.lerpdelay))
 		{
 SetPal(2);
 			cl.time = cl.mtime[0];
@@ -459,10 +699,15 @@ void CL_RelinkEntities (void)
 	float		bobjrotate;
 	vec3_t		oldorg;
 	dlight_t	*dl;
+	qboolean	buffered;
+	double		rendertime;
 
 // determine partial update time	
 	frac = CL_LerpPoint ();
 
+	buffered = CL_LerpBufferActive ();
+	rendertime = cl.time - cl.lerpdelay;
+
 	cl_numvisedicts = 0;
 
 //
@@ -512,7 +757,9 @@ void CL_RelinkEntities (void)
 
 		VectorCopy (ent->origin, oldorg);
 
-		if (ent->forcelink)
+		if (buffered && i != cl.viewentity)
+			CL_LerpSnapshots (i, rendertime);	// not the view, it would lag the camera
+		else if (ent->forcelink)
 		{	// the entity was not updated in the last message
 			// so move to the final spot
 			VectorCopy (ent->msg_origins[0], ent->origin);
@@ -658,10 +905,17 @@ Read all incoming data from the server
 int CL_ReadFromServer (void)
 {
 	int		ret;
+	double	time1 = 0, time2 = 0;
 
 	cl.oldtime = cl.time;
-	cl.time += host_frametime;
+	if (cls.demoplayback && !cls.timedemo)
+		cl.time += host_frametime * demo_speed.value;
+	else
+		cl.time += host_frametime;
 	
+	if (cls.timedemo)
+		time1 = Sys_FloatTime ();
+
 	do
 	{
 		ret = CL_GetMessage ();
@@ -677,9 +931,19 @@ int CL_ReadFromServer (void)
 	if (cl_shownet.value)
 		Con_Printf ("\n");
 
+	if (cls.timedemo)
+		time2 = Sys_FloatTime ();
+
 	CL_RelinkEntities ();
+	CL_PredictMove ();
 	CL_UpdateTEnts ();
 
+	if (cls.timedemo)
+	{
+		cls.td_subsystime[tds_parse] += time2 - time1;
+		cls.td_subsystime[tds_relink] += Sys_FloatTime () - time2;
+	}
+
 //
 // bring the links up to date
 //
@@ -761,6 +1025,19 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_anglespeedkey);
 	Cvar_RegisterVariable (&cl_shownet);
 	Cvar_RegisterVariable (&cl_nolerp);
+	Cvar_RegisterVariable (&cl_lerpbuffer);
+	Cvar_RegisterVariable (&cl_lerpdelay_min);
+	Cvar_RegisterVariable (&cl_lerpdelay_max);
+	Cvar_RegisterVariable (&cl_lerpjitterscale);
+	Cvar_RegisterVariable (&cl_lerpextrapolate);
+	Cvar_RegisterVariable (&cl_demojitter);
+	Cvar_RegisterVariable (&demo_speed);
+	Cvar_RegisterVariable (&demo_keyframeinterval);
+	Cvar_RegisterVariable (&demo_keyframemem);
+	Cvar_RegisterVariable (&timedemo_norender);
+	Cvar_RegisterVariable (&timedemo_output);
+	Cvar_RegisterVariable (&timedemo_baseline);
+	Cvar_RegisterVariable (&timedemo_tolerance);
 	Cvar_RegisterVariable (&lookspring);
 	Cvar_RegisterVariable (&lookstrafe);
 	
@@ -782,10 +1059,16 @@ void CL_Init (void)
 //	Cvar_RegisterVariable (&cl_autofire);
 	
 	Cmd_AddCommand ("entities", CL_PrintEntities_f);
+	Cmd_AddCommand ("entitystats", CL_EntityStats_f);
+	Cmd_AddCommand ("interpstats", CL_InterpStats_f);
+
+	CL_InitPrediction ();
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f);
 	Cmd_AddCommand ("record", CL_Record_f);
 	Cmd_AddCommand ("stop", CL_Stop_f);
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f);
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f);
+	Cmd_AddCommand ("timedemos", CL_TimeDemos_f);
+	Cmd_AddCommand ("demo_seek", CL_DemoSeek_f);
 }
 
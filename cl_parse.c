@@ -318,6 +318,20 @@ void CL_ParseRoomType( void )
 	Cvar_SetValue("room_type", (float)MSG_ReadShort());
 }
 
+/*
+==================
+CL_ReadCoord
+
+Positions outside the entity updates, see SV_WriteCoord
+==================
+*/
+float CL_ReadCoord (void)
+{
+	if (cl.protocol == PROTOCOL_COMPACT)
+		return MSG_ReadLongCoord ();
+	return MSG_ReadCoord ();
+}
+
 /*
 ==================
 CL_ParseBSPDecal
@@ -334,9 +348,9 @@ void CL_ParseBSPDecal (void)
 
     texname     = MSG_ReadString ();
     //entindex    = MSG_ReadShort  ();
-	pos[0]      = MSG_ReadCoord  ();
-    pos[1]      = MSG_ReadCoord  ();
-    pos[2]      = MSG_ReadCoord  ();
+	pos[0]      = CL_ReadCoord  ();
+    pos[1]      = CL_ReadCoord  ();
+    pos[2]      = CL_ReadCoord  ();
 
 	if(!texname)
 		return;
@@ -420,8 +434,10 @@ void CL_ParseStartSoundPacket(void)
 		Host_Error ("CL_ParseStartSoundPacket: ent = %i", ent);
 	
 	for (i=0 ; i<3 ; i++)
-		pos[i] = MSG_ReadCoord ();
+		pos[i] = CL_ReadCoord ();
  
+	if (cls.demoseeking)
+		return;
     S_StartSound (ent, channel, cl.sound_precache[sound_num], pos, volume/255.0, attenuation);
 }       
 
@@ -504,14 +520,17 @@ void CL_ParseServerInfo (void)
 // wipe the client_state_t struct
 //
 	CL_ClearState ();
+	if (cls.demoplayback)
+		cls.demolevel++;
 
 // parse protocol version number
 	i = MSG_ReadLong ();
-	if (i != PROTOCOL_VERSION)
+	if (i != PROTOCOL_VERSION && i != PROTOCOL_COMPACT)
 	{
-		Con_Printf ("Server returned version %i, not %i", i, PROTOCOL_VERSION);
+		Con_Printf ("Server returned version %i, not %i or %i", i, PROTOCOL_VERSION, PROTOCOL_COMPACT);
 		return;
 	}
+	cl.protocol = i;
 
 // parse maxclients
 	cl.maxclients = MSG_ReadByte ();
@@ -606,6 +625,49 @@ void CL_ParseServerInfo (void)
 }
 
 
+/*
+==================
+CL_ReadUpdateField
+
+Reads one entity field, from the bit stream under PROTOCOL_COMPACT
+==================
+*/
+float CL_ReadUpdateField (int field)
+{
+	if (cl.protocol == PROTOCOL_COMPACT)
+		return MSG_ReadQuant (field);
+
+	switch (field)
+	{
+	case NQ_RENDERCOLOR:
+		return MSG_ReadCoord ();
+	case NQ_ANGLE:
+		return MSG_ReadAngle ();
+	default:
+		return MSG_ReadByte ();
+	}
+}
+
+/*
+==================
+CL_ReadUpdateOrigin
+==================
+*/
+float CL_ReadUpdateOrigin (float base)
+{
+	int		delta;
+
+	if (cl.protocol != PROTOCOL_COMPACT)
+		return MSG_ReadCoord ();
+
+	if (MSG_ReadBits (1))
+		delta = MSG_ReadSignedBits (net_quant[NQ_ORIGIN_LONG].bits);
+	else
+		delta = MSG_ReadSignedBits (net_quant[NQ_ORIGIN].bits);
+
+	return ((int)(base*8) + delta) * (1.0/8);
+}
+
 /*
 ==================
 CL_ParseUpdate
@@ -625,6 +687,7 @@ void CL_ParseUpdate (int bits)
 	qboolean	forcelink;
 	entity_t	*ent;
 	int			num;
+	int			start;
 
 	if (cls.signon == SIGNONS - 1)
 	{	// first update is the final signon stage
@@ -632,23 +695,36 @@ void CL_ParseUpdate (int bits)
 		CL_SignonReply ();
 	}
 
-	if (bits & U_MOREBITS)
-	{
-		i = MSG_ReadByte ();
-		bits |= (i<<8);
-	}
+	start = msg_readcount - 1;		// include the command byte
 
-	//Tomaz
-	if (bits & U_EXTEND1)
+	if (cl.protocol == PROTOCOL_COMPACT)
 	{
-		i = MSG_ReadByte ();
-		bits |= (i<<16);
+		MSG_BeginReadingBits ();
+		if (bits & U_MOREBITS)
+			bits |= MSG_ReadBits (U_COMPACT_MOREBITS) << 8;
+		num = cl.lastupdatenum + MSG_ReadVarBits ();
+		cl.lastupdatenum = num;
 	}
-
-	if (bits & U_LONGENTITY)	
-		num = MSG_ReadShort ();
 	else
-		num = MSG_ReadByte ();
+	{
+		if (bits & U_MOREBITS)
+		{
+			i = MSG_ReadByte ();
+			bits |= (i<<8);
+		}
+
+		//Tomaz
+		if (bits & U_EXTEND1)
+		{
+			i = MSG_ReadByte ();
+			bits |= (i<<16);
+		}
+
+		if (bits & U_LONGENTITY)	
+			num = MSG_ReadShort ();
+		else
+			num = MSG_ReadByte ();
+	}
 
 	ent = CL_EntityNum (num);
 
@@ -665,7 +741,7 @@ if (bits&(1<<i))
 	
 	if (bits & U_MODEL)
 	{
-		modnum = MSG_ReadByte ();
+		modnum = CL_ReadUpdateField (NQ_MODEL);
 		if (modnum >= MAX_MODELS)
 			Host_Error ("CL_ParseModel: bad modnum");
 	}
@@ -694,12 +770,12 @@ if (bits&(1<<i))
 	}
 	
 	if (bits & U_FRAME)
-		ent->frame = MSG_ReadByte ();
+		ent->frame = CL_ReadUpdateField (NQ_FRAME);
 	else
 		ent->frame = ent->baseline.frame;
 
 	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
+		i = CL_ReadUpdateField (NQ_COLORMAP);
 	else
 		i = ent->baseline.colormap;
 	if (!i)
@@ -713,7 +789,7 @@ if (bits&(1<<i))
 
 #if defined(GLQUAKE) //|| defined(PSP_HARDWARE_VIDEO)
 	if (bits & U_SKIN)
-		skin = MSG_ReadByte();
+		skin = CL_ReadUpdateField (NQ_SKIN);
 	else
 		skin = ent->baseline.skin;
 	if (skin != ent->skinnum) {
@@ -725,48 +801,48 @@ if (bits&(1<<i))
 #else
 
 	if (bits & U_SKIN)
-		ent->skinnum = MSG_ReadByte();
+		ent->skinnum = CL_ReadUpdateField (NQ_SKIN);
 	else
 		ent->skinnum = ent->baseline.skin;
 #endif
 
 	if (bits & U_EFFECTS)
-		ent->effects = MSG_ReadByte();
+		ent->effects = CL_ReadUpdateField (NQ_EFFECTS);
 	else
 		ent->effects = ent->baseline.effects;
 #ifdef ADQ_CUSTOM
 //New vars
 	if (bits & U_RENDERAMT)
-		ent->renderamt = MSG_ReadByte();
+		ent->renderamt = CL_ReadUpdateField (NQ_RENDERAMT);
 	else
 		ent->renderamt = ent->baseline.renderamt;
 
 	if (bits & U_RENDERMODE)
-		ent->rendermode = MSG_ReadByte();
+		ent->rendermode = CL_ReadUpdateField (NQ_RENDERMODE);
 	else
 		ent->rendermode = ent->baseline.rendermode;
 
 	if (bits & U_RENDERCOLOR1)
-		ent->rendercolor[0] = MSG_ReadCoord();
+		ent->rendercolor[0] = CL_ReadUpdateField (NQ_RENDERCOLOR);
 	else
 		ent->rendercolor[0] = ent->baseline.rendercolor[0];
 
 	if (bits & U_RENDERCOLOR2)
-		ent->rendercolor[1] = MSG_ReadCoord();
+		ent->rendercolor[1] = CL_ReadUpdateField (NQ_RENDERCOLOR);
 	else
 		ent->rendercolor[1] = ent->baseline.rendercolor[1];
 
 	if (bits & U_RENDERCOLOR3)
-		ent->rendercolor[2] = MSG_ReadCoord();
+		ent->rendercolor[2] = CL_ReadUpdateField (NQ_RENDERCOLOR);
 	else
 		ent->rendercolor[2] = ent->baseline.rendercolor[2];
 //New vars
 	if (bits & U_SEQUENCE) // 0
-		ent->sequence = MSG_ReadByte ();
+		ent->sequence = CL_ReadUpdateField (NQ_SEQUENCE);
 	else
 		ent->sequence = ent->baseline.sequence;
 	if (bits & U_BODYGROUP) 
-		ent->bodygroup = MSG_ReadByte ();
+		ent->bodygroup = CL_ReadUpdateField (NQ_BODYGROUP);
 	else
 		ent->bodygroup = ent->baseline.bodygroup;
 #endif
@@ -775,32 +851,40 @@ if (bits&(1<<i))
 	VectorCopy (ent->msg_angles[0], ent->msg_angles[1]);
 
 	if (bits & U_ORIGIN1)
-		ent->msg_origins[0][0] = MSG_ReadCoord ();
+		ent->msg_origins[0][0] = CL_ReadUpdateOrigin (ent->baseline.origin[0]);
 	else
 		ent->msg_origins[0][0] = ent->baseline.origin[0];
 	if (bits & U_ANGLE1)
-		ent->msg_angles[0][0] = MSG_ReadAngle();
+		ent->msg_angles[0][0] = CL_ReadUpdateField (NQ_ANGLE);
 	else
 		ent->msg_angles[0][0] = ent->baseline.angles[0];
 
 	if (bits & U_ORIGIN2)
-		ent->msg_origins[0][1] = MSG_ReadCoord ();
+		ent->msg_origins[0][1] = CL_ReadUpdateOrigin (ent->baseline.origin[1]);
 	else
 		ent->msg_origins[0][1] = ent->baseline.origin[1];
 	if (bits & U_ANGLE2)
-		ent->msg_angles[0][1] = MSG_ReadAngle();
+		ent->msg_angles[0][1] = CL_ReadUpdateField (NQ_ANGLE);
 	else
 		ent->msg_angles[0][1] = ent->baseline.angles[1];
 
 	if (bits & U_ORIGIN3)
-		ent->msg_origins[0][2] = MSG_ReadCoord ();
+		ent->msg_origins[0][2] = CL_ReadUpdateOrigin (ent->baseline.origin[2]);
 	else
 		ent->msg_origins[0][2] = ent->baseline.origin[2];
 	if (bits & U_ANGLE3)
-		ent->msg_angles[0][2] = MSG_ReadAngle();
+		ent->msg_angles[0][2] = CL_ReadUpdateField (NQ_ANGLE);
 	else
 		ent->msg_angles[0][2] = ent->baseline.angles[2];
 
+	if (cl.protocol == PROTOCOL_COMPACT)
+		MSG_EndReadingBits ();
+
+	CL_PushSnapshot (num, forcelink);
+
+	cls.entityupdates++;
+	cls.entityupdatebytes += msg_readcount - start;
+
 	if ( bits & U_NOLERP )
 		ent->forcelink = true;
 
@@ -843,7 +927,7 @@ void CL_ParseBaseline (entity_t *ent)
         ent->baseline.rendercolor[i] = MSG_ReadCoord ();
 //New vars
 #endif
-		ent->baseline.origin[i]      = MSG_ReadCoord ();
+		ent->baseline.origin[i]      = CL_ReadCoord ();
 		ent->baseline.angles[i]      = MSG_ReadAngle ();
 	}
 }
@@ -878,7 +962,12 @@ void CL_ParseClientdata (int bits)
 		else
 			cl.punchangle[i] = 0;
 		if (bits & (SU_VELOCITY1<<i) )
-			cl.mvelocity[0][i] = MSG_ReadChar()*16;
+		{
+			if (cl.protocol == PROTOCOL_COMPACT)
+				cl.mvelocity[0][i] = MSG_ReadShort();
+			else
+				cl.mvelocity[0][i] = MSG_ReadChar()*16;
+		}
 		else
 			cl.mvelocity[0][i] = 0;
 	}
@@ -928,6 +1017,9 @@ void CL_ParseClientdata (int bits)
 	else
 		cl.stats[STAT_SEQUENCE] = 0;
 #endif
+
+	if (bits & SU_MOVESEQUENCE)
+		CL_AcknowledgeMove (MSG_ReadByte ());
 	i = MSG_ReadShort ();
 	if (cl.stats[STAT_HEALTH] != i)
 	{
@@ -1062,7 +1154,7 @@ void CL_ParseStaticSound (void)
 	int			i;
 	
 	for (i=0 ; i<3 ; i++)
-		org[i] = MSG_ReadCoord ();
+		org[i] = CL_ReadCoord ();
 	sound_num = MSG_ReadByte ();
 	vol = MSG_ReadByte ();
 	atten = MSG_ReadByte ();
@@ -1134,6 +1226,10 @@ void CL_ParseServerMessage (void)
 		case svc_time:
 			cl.mtime[1] = cl.mtime[0];
 			cl.mtime[0] = MSG_ReadFloat ();			
+			cl.lastupdatenum = 0;
+			if (cls.demoplayback && cl.mtime[1] > 0 && cl.mtime[0] > cl.mtime[1] && cl.mtime[0] - cl.mtime[1] < 1)
+				cls.demotime += cl.mtime[0] - cl.mtime[1];
+			CL_UpdateLerpDelay ();
 			break;
 			
 		case svc_clientdata:
@@ -1143,8 +1239,8 @@ void CL_ParseServerMessage (void)
 		
 		case svc_version:
 			i = MSG_ReadLong ();
-			if (i != PROTOCOL_VERSION)
-				Host_Error ("CL_ParseServerMessage: Server is protocol %i instead of %i\n", i, PROTOCOL_VERSION);
+			if (i != PROTOCOL_VERSION && i != PROTOCOL_COMPACT)
+				Host_Error ("CL_ParseServerMessage: Server is protocol %i instead of %i or %i\n", i, PROTOCOL_VERSION, PROTOCOL_COMPACT);
 			break;
 			
 		case svc_disconnect:
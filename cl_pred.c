@@ -0,0 +1,265 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_pred.c -- client side movement prediction
+//
+// Every clc_move is kept in a ring.  Under PROTOCOL_COMPACT the server
+// echoes the sequence of the last move it ran in svc_clientdata, so each
+// frame the view entity is put where the server position plus all the
+// moves it hasn't seen yet would take it.  Jumps and anything else the
+// progs do to the player are left to the server and corrected next update.
+
+#include "quakedef.h"
+
+cvar_t	cl_predict = {"cl_predict","1"};
+
+extern	cvar_t	sv_gravity;
+
+#define	CL_PREDICT_BACKUP	64		// must be a power of two
+
+typedef struct
+{
+	usercmd_t	cmd;
+	vec3_t		viewangles;
+	float		frametime;
+	vec3_t		origin;			// predicted position after this move
+	qboolean	predicted;
+} predmove_t;
+
+static predmove_t	cl_predmoves[CL_PREDICT_BACKUP];
+
+/*
+==================
+CL_PredictTrace
+
+Box trace against the world hull the player uses
+==================
+*/
+static trace_t CL_PredictTrace (pmove_t *pm, vec3_t start, vec3_t end)
+{
+	trace_t	trace;
+	hull_t	*hull;
+
+	memset (&trace, 0, sizeof(trace));
+	VectorCopy (end, trace.endpos);
+	trace.fraction = 1;
+	trace.allsolid = true;
+
+	hull = &cl.worldmodel->hulls[1];
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start, end, &trace);
+
+	if (trace.fraction != 1)
+		VectorLerp (start, trace.fraction, end, trace.endpos);
+
+	return trace;
+}
+
+static trace_t CL_PredictPush (pmove_t *pm, vec3_t push)
+{
+	trace_t	trace;
+	vec3_t	end;
+
+	VectorAdd (pm->origin, push, end);
+	trace = CL_PredictTrace (pm, pm->origin, end);
+	if (trace.fraction != 0)
+		VectorCopy (trace.endpos, pm->origin);
+
+	return trace;
+}
+
+static qboolean CL_PredictDropoff (vec3_t start, vec3_t stop)
+{
+	trace_t	trace;
+	hull_t	*hull;
+
+	memset (&trace, 0, sizeof(trace));
+	trace.fraction = 1;
+	trace.allsolid = true;
+
+	hull = &cl.worldmodel->hulls[0];
+	SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start, stop, &trace);
+
+	return trace.fraction == 1;
+}
+
+/*
+==================
+CL_PredictionActive
+==================
+*/
+qboolean CL_PredictionActive (void)
+{
+	return cl_predict.value && cl.protocol == PROTOCOL_COMPACT
+		&& !cls.demoplayback && !sv.active && cl.worldmodel
+		&& cls.signon == SIGNONS && !cl.intermission;
+}
+
+/*
+==================
+CL_SaveMove
+
+Called by CL_SendMove for each move it sends, after the sequence is written
+==================
+*/
+void CL_SaveMove (usercmd_t *cmd)
+{
+	predmove_t	*move;
+
+	move = &cl_predmoves[cl.movesequence & (CL_PREDICT_BACKUP-1)];
+	move->cmd = *cmd;
+	VectorCopy (cl.viewangles, move->viewangles);
+	move->frametime = host_frametime;
+	move->predicted = false;
+
+	cl.movesequence++;
+}
+
+/*
+==================
+CL_AcknowledgeMove
+
+The server only echoes the low byte of the sequence
+==================
+*/
+void CL_AcknowledgeMove (int seqbyte)
+{
+	int		last;
+
+	last = cl.movesequence - 1;
+	cl.ackmovesequence = last - ((last - seqbyte) & 255);
+}
+
+/*
+==================
+CL_PredictMove
+
+Replays the unacknowledged moves on top of the last server state and
+places the view entity there.
+
+Each move is replayed for the client frame it was sent in.  The server
+instead runs whichever move arrived last for each of its own frames, so
+both integrate the same total time but split it differently: the first
+and last server frames of a key change run the old move for part of
+their length.  The error is about one server frame of the change in
+velocity, under 8 units starting or stopping at the default sys_ticrate
+and sv_maxspeed, and is most of what predstats reports on a steady
+connection.
+==================
+*/
+void CL_PredictMove (void)
+{
+	entity_t	*ent;
+	predmove_t	*move;
+	pmove_t		pm;
+	int			seq;
+	float		err;
+
+	if (!CL_PredictionActive ())
+		return;
+
+	ent = &cl_entities[cl.viewentity];
+	if (!ent->model)
+		return;
+
+	if (cl.movesequence - cl.ackmovesequence >= CL_PREDICT_BACKUP)
+		return;		// too far behind, just show the server position
+
+// measure how far off the prediction for the newly acknowledged move was
+	if (cl.ackmovesequence != cl.lastpredack)
+	{
+		cl.lastpredack = cl.ackmovesequence;
+		move = &cl_predmoves[cl.ackmovesequence & (CL_PREDICT_BACKUP-1)];
+		if (move->predicted)
+		{
+			err = sqrtf((move->origin[0]-ent->msg_origins[0][0])*(move->origin[0]-ent->msg_origins[0][0])
+				+ (move->origin[1]-ent->msg_origins[0][1])*(move->origin[1]-ent->msg_origins[0][1])
+				+ (move->origin[2]-ent->msg_origins[0][2])*(move->origin[2]-ent->msg_origins[0][2]));
+			cl.prederror += err;
+			if (err > cl.prederrormax)
+				cl.prederrormax = err;
+			cl.prederrorsamples++;
+		}
+	}
+
+	memset (&pm, 0, sizeof(pm));
+	VectorCopy (ent->msg_origins[0], pm.origin);
+	VectorCopy (cl.mvelocity[0], pm.velocity);
+	VectorCopy (cl.worldmodel->hulls[1].clip_mins, pm.mins);
+	VectorCopy (cl.worldmodel->hulls[1].clip_maxs, pm.maxs);
+	pm.movetype = MOVETYPE_WALK;
+	pm.waterlevel = cl.inwater ? 2 : 0;
+	pm.onground = cl.onground;
+	pm.dropoff = CL_PredictDropoff;
+	pm.trace = CL_PredictTrace;
+	pm.push = CL_PredictPush;
+
+	for (seq = cl.ackmovesequence + 1 ; seq < cl.movesequence ; seq++)
+	{
+		move = &cl_predmoves[seq & (CL_PREDICT_BACKUP-1)];
+
+		pm.cmd = move->cmd;
+		pm.frametime = move->frametime;
+		VectorCopy (move->viewangles, pm.v_angle);
+		pm.angles[PITCH] = -move->viewangles[PITCH]/3;
+		pm.angles[YAW] = move->viewangles[YAW];
+		pm.angles[ROLL] = 0;
+
+		PM_PlayerMove (&pm);
+		if (pm.waterlevel <= 1)
+			pm.velocity[2] -= sv_gravity.value * pm.frametime;
+		PM_WalkMove (&pm);
+
+		VectorCopy (pm.origin, move->origin);
+		move->predicted = true;
+	}
+
+	VectorCopy (pm.origin, ent->origin);
+}
+
+/*
+==================
+CL_PredStats_f
+==================
+*/
+void CL_PredStats_f (void)
+{
+	if (Cmd_Argc() == 2 && !Q_strcmp (Cmd_Argv(1), "reset"))
+	{
+		cl.prederror = 0;
+		cl.prederrormax = 0;
+		cl.prederrorsamples = 0;
+		return;
+	}
+
+	Con_Printf ("%i unacknowledged moves\n", cl.movesequence - 1 - cl.ackmovesequence);
+	Con_Printf ("prediction error: %4.2f avg %4.2f max over %i updates\n",
+		cl.prederrorsamples ? cl.prederror / cl.prederrorsamples : 0,
+		cl.prederrormax, cl.prederrorsamples);
+}
+
+/*
+==================
+CL_InitPrediction
+==================
+*/
+void CL_InitPrediction (void)
+{
+	Cvar_RegisterVariable (&cl_predict);
+	Cmd_AddCommand ("predstats", CL_PredStats_f);
+}
@@ -49,13 +49,13 @@ void CL_ParseBeam (model_t *m)
 	
 	ent = MSG_ReadShort ();
 	
-	start[0] = MSG_ReadCoord ();
-	start[1] = MSG_ReadCoord ();
-	start[2] = MSG_ReadCoord ();
+	start[0] = CL_ReadCoord ();
+	start[1] = CL_ReadCoord ();
+	start[2] = CL_ReadCoord ();
 	
-	end[0] = MSG_ReadCoord ();
-	end[1] = MSG_ReadCoord ();
-	end[2] = MSG_ReadCoord ();
+	end[0] = CL_ReadCoord ();
+	end[1] = CL_ReadCoord ();
+	end[2] = CL_ReadCoord ();
 
 // override any beam with the same entity
 	for (i=0, b=cl_beams ; i< MAX_BEAMS ; i++, b++)
@@ -107,9 +107,11 @@ void CL_ParseTEnt (void)
 	switch (type)
 	{
 	case TE_WIZSPIKE:			// spike hitting wall
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_RunParticleEffect (pos, vec3_origin, 20, 30);
 #ifdef ADQ_CUSTOM
 		//Crow_bar Decals
@@ -118,9 +120,11 @@ void CL_ParseTEnt (void)
 		break;
 		
 	case TE_KNIGHTSPIKE:			// spike hitting wall
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_RunParticleEffect (pos, vec3_origin, 226, 20);
 #ifdef ADQ_CUSTOM
 		//Crow_bar Decals
@@ -129,9 +133,11 @@ void CL_ParseTEnt (void)
 		break;
 		
 	case TE_SPIKE:			// spike hitting wall
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 #ifdef GLTEST
 		Test_Spawn (pos);
 #else
@@ -143,9 +149,11 @@ void CL_ParseTEnt (void)
 #endif
 		break;
 	case TE_SUPERSPIKE:			// super spike hitting wall
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_RunParticleEffect (pos, vec3_origin, 0, 20);
 #ifdef ADQ_CUSTOM
 		//Crow_bar Decals
@@ -154,12 +162,14 @@ void CL_ParseTEnt (void)
 		break;
 		
 	case TE_GUNSHOT:			// bullet hitting wall
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
 #ifdef ADQ_CUSTOM
 		entindex = MSG_ReadShort ();
 #endif
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_RunParticleEffect (pos, vec3_origin, 0, 20);
 #ifdef ADQ_CUSTOM
 		//Crow_bar Decals
@@ -168,9 +178,11 @@ void CL_ParseTEnt (void)
 		break;
 		
 	case TE_EXPLOSION:			// rocket explosion
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_ParticleExplosion (pos);
 		dl = CL_AllocDlight (0);
 		VectorCopy (pos, dl->origin);
@@ -184,9 +196,11 @@ void CL_ParseTEnt (void)
 		break;
 		
 	case TE_TAREXPLOSION:			// tarbaby explosion
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_BlobExplosion (pos);
 #ifdef ADQ_CUSTOM
         //Crow_bar Decals
@@ -213,25 +227,31 @@ void CL_ParseTEnt (void)
 // PGM 01/21/97
 
 	case TE_LAVASPLASH:	
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_LavaSplash (pos);
 		break;
 	
 	case TE_TELEPORT:
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_TeleportSplash (pos);
 		break;
 		
 	case TE_EXPLOSION2:				// color mapped explosion
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
 		colorStart = MSG_ReadByte ();
 		colorLength = MSG_ReadByte ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_ParticleExplosion2 (pos, colorStart, colorLength);
 		dl = CL_AllocDlight (0);
 		VectorCopy (pos, dl->origin);
@@ -242,18 +262,20 @@ void CL_ParseTEnt (void)
 		
 #ifdef QUAKE2
 	case TE_IMPLOSION:
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
 		break;
 
 	case TE_RAILTRAIL:
-		pos[0] = MSG_ReadCoord ();
-		pos[1] = MSG_ReadCoord ();
-		pos[2] = MSG_ReadCoord ();
-		endpos[0] = MSG_ReadCoord ();
-		endpos[1] = MSG_ReadCoord ();
-		endpos[2] = MSG_ReadCoord ();
+		pos[0] = CL_ReadCoord ();
+		pos[1] = CL_ReadCoord ();
+		pos[2] = CL_ReadCoord ();
+		endpos[0] = CL_ReadCoord ();
+		endpos[1] = CL_ReadCoord ();
+		endpos[2] = CL_ReadCoord ();
+		if (cls.demoseeking)
+			break;		// fast forwarding, no effects
 		R_RocketTrail (pos, endpos, 0+128);
 		R_ParticleExplosion (endpos);
 		dl = CL_AllocDlight (-1);
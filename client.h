@@ -99,6 +99,17 @@ typedef struct
 #define	MAX_DEMOS		8
 #define	MAX_DEMONAME	16
 
+// timedemo frame time breakdown
+typedef enum
+{
+	tds_parse,
+	tds_relink,
+	tds_render,
+	tds_sound,
+	tds_host,			// everything before the demo is read
+	TDS_NUMSUBSYSTEMS
+} tdsubsystem_t;
+
 typedef enum {
 ca_dedicated, 		// a dedicated server with no ability to start a client
 ca_disconnected, 	// full screen console with no connection
@@ -131,6 +142,19 @@ typedef struct
 	int			td_lastframe;		// to meter out one message a frame
 	int			td_startframe;		// host_framecount at start
 	float		td_starttime;		// realtime at second frame of timedemo
+	double		td_lastframetime;	// realtime of the previous counted frame
+	double		td_subsystime[TDS_NUMSUBSYSTEMS];	// seconds spent in each part of the frame
+	qboolean	td_batch;			// demos[] are being timedemoed by timedemos
+	double		demoholduntil;		// cl_demojitter delivery time of the next message
+	int			demostart;			// file offset of the first message
+	int			demopos;			// file offset of the next message
+	double		demotime;			// server time played since the demo started
+	int			demolevel;			// serverinfos parsed, keyframes are per level
+	qboolean	demoseeking;		// fast forwarding, skip sounds
+
+// entity update size accounting, printed by entitystats and timedemo
+	int			entityupdates;
+	int			entityupdatebytes;
 
 
 // connection information
@@ -204,6 +228,23 @@ typedef struct
 
 	float		last_received_message;	// (realtime) for net trouble icon
 
+// interpolation buffer state, see CL_UpdateLerpDelay
+	double		lastmsgrealtime;	// realtime the last svc_time arrived
+	float		msginterval;		// smoothed mtime[0] - mtime[1]
+	float		jitter;				// smoothed arrival deviation from msginterval
+	float		lerpdelay;			// entities are drawn this far behind cl.time
+	int			extrapolations;		// entities drawn past their newest snapshot
+	int			bufferdepth;		// snapshots ahead of the render time, summed
+	int			bufferdepthsamples;
+
+// movement prediction, see cl_pred.c
+	int			movesequence;		// of the next clc_move
+	int			ackmovesequence;	// last move the server has run
+	int			lastpredack;
+	float		prederror;			// summed distance from the server position
+	float		prederrormax;
+	int			prederrorsamples;
+
 //
 // information that is static for the entire time connected to a server
 //
@@ -214,6 +255,8 @@ typedef struct
 	int			viewentity;		// cl_entitites[cl.viewentity] = player
 	int			maxclients;
 	int			gametype;
+	int			protocol;		// PROTOCOL_VERSION or PROTOCOL_COMPACT
+	int			lastupdatenum;	// PROTOCOL_COMPACT entity number base, reset by svc_time
 
 // refresh related state
 	struct model_s	*worldmodel;	// cl_entitites[0].model
@@ -258,6 +301,15 @@ extern	cvar_t	cl_autofire;
 
 extern	cvar_t	cl_shownet;
 extern	cvar_t	cl_nolerp;
+extern	cvar_t	cl_lerpbuffer;
+extern	cvar_t	cl_demojitter;
+extern	cvar_t	demo_speed;
+extern	cvar_t	demo_keyframeinterval;
+extern	cvar_t	demo_keyframemem;
+extern	cvar_t	timedemo_norender;
+extern	cvar_t	timedemo_output;
+extern	cvar_t	timedemo_baseline;
+extern	cvar_t	timedemo_tolerance;
 
 extern	cvar_t	cl_pitchdriftspeed;
 extern	cvar_t	lookspring;
@@ -276,11 +328,30 @@ extern	cvar_t	m_side;
 #define	MAX_TEMP_ENTITIES	64			// lightning bolts, etc
 #define	MAX_STATIC_ENTITIES	128			// torches, etc
 
+#define	MAX_ENTITY_SNAPSHOTS	8			// must be a power of two
+
+typedef struct
+{
+	double		time;			// cl.mtime[0] of the update
+	vec3_t		origin;
+	vec3_t		angles;
+} entsnapshot_t;
+
+// cl_lerpbuffer history of a cl_entities entry, kept out of entity_t so
+// the static and temp entity arrays don't carry it
+typedef struct
+{
+	entsnapshot_t	snapshots[MAX_ENTITY_SNAPSHOTS];
+	int				head;		// newest entry in snapshots
+	int				count;
+} entsnapshots_t;
+
 extern	client_state_t	cl;
 
 // FIXME, allocate dynamically
 extern	efrag_t			cl_efrags[MAX_EFRAGS];
 extern	entity_t		cl_entities[MAX_EDICTS];
+extern	entsnapshots_t	cl_snapshots[MAX_EDICTS];
 extern	entity_t		cl_static_entities[MAX_STATIC_ENTITIES];
 extern	lightstyle_t	cl_lightstyle[MAX_LIGHTSTYLES];
 extern	dlight_t		cl_dlights[MAX_DLIGHTS];
@@ -306,6 +377,11 @@ void CL_Signon4 (void);
 void CL_Disconnect (void);
 void CL_Disconnect_f (void);
 void CL_NextDemo (void);
+void CL_PrintEntityStats (void);
+void CL_UpdateLerpDelay (void);
+void CL_PushSnapshot (int num, qboolean reset);
+float CL_ReadCoord (void);
+void CL_EntityStats_f (void);
 
 #define			MAX_VISEDICTS	256
 extern	int				cl_numvisedicts;
@@ -328,6 +404,17 @@ void CL_InitInput (void);
 void CL_SendCmd (void);
 void CL_SendMove (usercmd_t *cmd);
 
+//
+// cl_pred
+//
+extern	cvar_t	cl_predict;
+
+void CL_InitPrediction (void);
+qboolean CL_PredictionActive (void);
+void CL_SaveMove (usercmd_t *cmd);
+void CL_AcknowledgeMove (int seqbyte);
+void CL_PredictMove (void);
+
 void CL_ParseTEnt (void);
 void CL_UpdateTEnts (void);
 
@@ -352,6 +439,9 @@ void CL_Stop_f (void);
 void CL_Record_f (void);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
+void CL_DemoSeek_f (void);
+void CL_TimeDemos_f (void);
+void CL_FinishTimeDemoBatch (void);
 
 //
 // cl_parse.c
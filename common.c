@@ -603,6 +603,16 @@ void MSG_WriteCoord (sizebuf_t *sb, float f)
 	MSG_WriteShort (sb, (int)(f*8));
 }
 
+// 1/8 unit in 24 bits, +-1048576 like NQ_ORIGIN_LONG
+void MSG_WriteLongCoord (sizebuf_t *sb, float f)
+{
+	int		c;
+
+	c = (int)(f*8);
+	MSG_WriteByte (sb, c & 255);
+	MSG_WriteShort (sb, c >> 8);
+}
+
 void MSG_WriteAngle (sizebuf_t *sb, float f)
 {
 	MSG_WriteByte (sb, ((int)f*256/360) & 255);
@@ -736,11 +746,168 @@ float MSG_ReadCoord (void)
 	return MSG_ReadShort() * (1.0/8);
 }
 
+float MSG_ReadLongCoord (void)
+{
+	int		c;
+
+	c = MSG_ReadByte ();
+	c += MSG_ReadShort () * 256;
+	return c * (1.0/8);
+}
+
 float MSG_ReadAngle (void)
 {
 	return MSG_ReadChar() * (360.0/256);
 }
 
+/*
+==============================================================================
+
+			BIT-PACKED MESSAGE IO
+
+Fields are packed lsb first and the stream is padded to a byte boundary by
+MSG_EndBits, so bit-packed blocks can sit between ordinary svc messages.
+Widths and scales of the quantised entity fields come from net_quant.
+==============================================================================
+*/
+
+netquant_t	net_quant[NQ_NUMFIELDS] =
+{
+	{8,		1},					// NQ_MODEL
+	{8,		1},					// NQ_FRAME
+	{5,		1},					// NQ_COLORMAP		0 - MAX_SCOREBOARD
+	{8,		1},					// NQ_SKIN
+	{8,		1},					// NQ_EFFECTS
+	{8,		1},					// NQ_RENDERAMT
+	{3,		1},					// NQ_RENDERMODE	RENDER_NORMAL - RENDER_LMPOINT
+	{8,		1},					// NQ_RENDERCOLOR
+	{8,		1},					// NQ_SEQUENCE
+	{8,		1},					// NQ_BODYGROUP
+	{8,		256.0/360},			// NQ_ANGLE
+	{12,	8},					// NQ_ORIGIN		signed delta from baseline
+	{24,	8}					// NQ_ORIGIN_LONG	+-1048576 units
+};
+
+void MSG_BeginBits (bitwriter_t *bw, sizebuf_t *sb)
+{
+	bw->sb = sb;
+	bw->accum = 0;
+	bw->numbits = 0;
+}
+
+void MSG_WriteBits (bitwriter_t *bw, int value, int numbits)
+{
+#ifdef PARANOID
+	if (numbits < 1 || numbits > 24)
+		Sys_Error ("MSG_WriteBits: bad width %i", numbits);
+#endif
+
+	bw->accum |= ((unsigned int)value & ((1u << numbits) - 1)) << bw->numbits;
+	bw->numbits += numbits;
+
+	while (bw->numbits >= 8)
+	{
+		MSG_WriteByte (bw->sb, bw->accum & 255);
+		bw->accum >>= 8;
+		bw->numbits -= 8;
+	}
+}
+
+void MSG_WriteSignedBits (bitwriter_t *bw, int value, int numbits)
+{
+	MSG_WriteBits (bw, value, numbits);		// two's complement, truncated
+}
+
+// 2 bit width selector followed by 4, 8, 12 or 16 bits of value
+void MSG_WriteVarBits (bitwriter_t *bw, int value)
+{
+	int		sel;
+
+	for (sel=0 ; sel<3 ; sel++)
+		if (value < (1 << ((sel+1)*4)))
+			break;
+
+	MSG_WriteBits (bw, sel, 2);
+	MSG_WriteBits (bw, value, (sel+1)*4);
+}
+
+void MSG_WriteQuant (bitwriter_t *bw, int field, float f)
+{
+	netquant_t	*q;
+
+	q = &net_quant[field];
+	MSG_WriteBits (bw, (int)(f * q->scale), q->bits);
+}
+
+void MSG_EndBits (bitwriter_t *bw)
+{
+	if (bw->numbits)
+		MSG_WriteByte (bw->sb, bw->accum & 255);
+	bw->accum = 0;
+	bw->numbits = 0;
+}
+
+static unsigned int	msg_bitaccum;
+static int			msg_bitcount;
+
+void MSG_BeginReadingBits (void)
+{
+	msg_bitaccum = 0;
+	msg_bitcount = 0;
+}
+
+int MSG_ReadBits (int numbits)
+{
+	int		c;
+	int		value;
+
+	while (msg_bitcount < numbits)
+	{
+		c = MSG_ReadByte ();
+		if (c == -1)
+			c = 0;		// msg_badread is already set
+		msg_bitaccum |= (unsigned int)c << msg_bitcount;
+		msg_bitcount += 8;
+	}
+
+	value = msg_bitaccum & ((1u << numbits) - 1);
+	msg_bitaccum >>= numbits;
+	msg_bitcount -= numbits;
+
+	return value;
+}
+
+int MSG_ReadSignedBits (int numbits)
+{
+	int		value;
+
+	value = MSG_ReadBits (numbits);
+	if (value & (1 << (numbits-1)))
+		value -= 1 << numbits;
+
+	return value;
+}
+
+int MSG_ReadVarBits (void)
+{
+	return MSG_ReadBits ((MSG_ReadBits (2) + 1) * 4);
+}
+
+float MSG_ReadQuant (int field)
+{
+	netquant_t	*q;
+
+	q = &net_quant[field];
+	return MSG_ReadBits (q->bits) / q->scale;
+}
+
+// the remaining bits of the last byte are padding
+void MSG_EndReadingBits (void)
+{
+	msg_bitaccum = 0;
+	msg_bitcount = 0;
+}
+
 
 
 //===========================================================================
@@ -1195,6 +1362,7 @@ QUAKE FILESYSTEM
 */
 char	com_netpath[MAX_OSPATH];
 int     com_filesize;
+int     com_filestart;
 
 
 //
@@ -1405,6 +1573,7 @@ int COM_FindFile (char *filename, int *handle, int *file)
 							Sys_FileSeek(*file, pak->files[i].filepos);
 					}
 					com_filesize = pak->files[i].filelen;
+					com_filestart = pak->files[i].filepos;
 					return com_filesize;
 				}
 		}
@@ -1446,6 +1615,7 @@ int COM_FindFile (char *filename, int *handle, int *file)
 
 			Sys_Printf ("FindFile: %s\n",netpath);
 			com_filesize = Sys_FileOpenRead (netpath, &i);
+			com_filestart = 0;
 			if (handle)
 				*handle = i;
 			else
@@ -119,6 +119,7 @@ void MSG_WriteLong (sizebuf_t *sb, int c);
 void MSG_WriteFloat (sizebuf_t *sb, float f);
 void MSG_WriteString (sizebuf_t *sb, char *s);
 void MSG_WriteCoord (sizebuf_t *sb, float f);
+void MSG_WriteLongCoord (sizebuf_t *sb, float f);
 void MSG_WriteAngle (sizebuf_t *sb, float f);
 
 extern	int			msg_readcount;
@@ -133,8 +134,33 @@ float MSG_ReadFloat (void);
 char *MSG_ReadString (void);
 
 float MSG_ReadCoord (void);
+float MSG_ReadLongCoord (void);
 float MSG_ReadAngle (void);
 
+//
+// bit-packed fields, used by PROTOCOL_COMPACT entity updates
+//
+typedef struct
+{
+	sizebuf_t		*sb;
+	unsigned int	accum;		// pending bits, lsb first
+	int				numbits;
+} bitwriter_t;
+
+void MSG_BeginBits (bitwriter_t *bw, sizebuf_t *sb);
+void MSG_WriteBits (bitwriter_t *bw, int value, int numbits);
+void MSG_WriteSignedBits (bitwriter_t *bw, int value, int numbits);
+void MSG_WriteVarBits (bitwriter_t *bw, int value);
+void MSG_WriteQuant (bitwriter_t *bw, int field, float f);
+void MSG_EndBits (bitwriter_t *bw);		// pads to a byte boundary
+
+void MSG_BeginReadingBits (void);
+int MSG_ReadBits (int numbits);
+int MSG_ReadSignedBits (int numbits);
+int MSG_ReadVarBits (void);
+float MSG_ReadQuant (int field);
+void MSG_EndReadingBits (void);
+
 //============================================================================
 
 void Q_strncpyz (char *dest, char *src, size_t size);
@@ -180,12 +206,14 @@ char	*va(char *format, ...);
 
 //============================================================================
 
+void SeedRandomNumberGenerator( long lSeed );
 float RandomFloat( float flLow, float flHigh );
 long RandomLong( long lLow, long lHigh );
 
 //============================================================================
 
 extern int com_filesize;
+extern int com_filestart;		// offset of the last COM_FindFile result in its handle
 struct cache_user_s;
 
 extern	char	com_gamedir[MAX_OSPATH];
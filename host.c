@@ -486,10 +486,14 @@ not reinitialize anything.
 void Host_ClearMemory (void)
 {
 	Con_DPrintf ("Clearing memory\n");
+// drain the sound thread, then keep it out of the way of the map going
+	S_StopAllSounds (true);
+	S_BlockSoundThread ();
 	D_FlushCaches ();
 	Mod_ClearAll ();
 	if (host_hunklevel)
 		Hunk_FreeToLowMark (host_hunklevel);
+	S_UnblockSoundThread ();
 
 	cls.signon = 0;
 	memset (&sv, 0, sizeof(sv));
@@ -644,6 +648,7 @@ void _Host_Frame (float time)
 	static double		time2 = 0;
 	static double		time3 = 0;
 	int			pass1, pass2, pass3;
+	double		tdtime = 0;
 
 	if (setjmp (host_abortserver) )
 		return;			// something bad happened, or the server disconnected
@@ -655,6 +660,9 @@ void _Host_Frame (float time)
     if (!Host_FilterTime (time))
 		return;			// don't run too fast, or packets will flood out
 		
+	if (cls.timedemo)
+		tdtime = Sys_FloatTime ();
+
 // get new key events
 	Sys_SendKeyEvents ();
 
@@ -693,6 +701,11 @@ void _Host_Frame (float time)
 	if (!sv.active)
 		CL_SendCmd ();
 
+// no QuakeC runs in demo playback, so this is input, commands and the
+// network poll, plus a local server's frame if one is still up
+	if (cls.timedemo)
+		cls.td_subsystime[tds_host] += Sys_FloatTime () - tdtime;
+
 	host_time += host_frametime;
 
 // fetch results from server
@@ -704,11 +717,20 @@ void _Host_Frame (float time)
 // update video
 	if (host_speeds.value)
 		time1 = Sys_FloatTime ();
-		
-	SCR_UpdateScreen ();
+	if (cls.timedemo)
+		tdtime = Sys_FloatTime ();
+
+// timedemo_norender leaves only the client side to be timed
+	if (!cls.timedemo || !timedemo_norender.value)
+		SCR_UpdateScreen ();
 
 	if (host_speeds.value)
 		time2 = Sys_FloatTime ();
+	if (cls.timedemo)
+	{
+		cls.td_subsystime[tds_render] += Sys_FloatTime () - tdtime;
+		tdtime = Sys_FloatTime ();
+	}
 		
 // update audio
 	if (cls.signon == SIGNONS)
@@ -729,6 +751,9 @@ void _Host_Frame (float time)
     CDAudio_Update();
 #endif
 
+	if (cls.timedemo)
+		cls.td_subsystime[tds_sound] += Sys_FloatTime () - tdtime;
+
 	if (host_speeds.value)
 	{
 		pass1 = (time1 - time3)*1000;
@@ -0,0 +1,576 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pmove.c -- player movement shared by the server and client prediction
+//
+// The velocity code is what SV_ClientThink always ran; the server copies
+// sv_player into a pmove_t and back.  PM_FlyMove and PM_WalkMove are the
+// slide and step moves SV_FlyMove and SV_WalkMove run on an edict, the
+// client runs them against the world hull only through its own callbacks.
+
+#include "quakedef.h"
+
+extern	cvar_t	sv_friction;
+extern	cvar_t	sv_edgefriction;
+extern	cvar_t	sv_stopspeed;
+extern	cvar_t	sv_maxspeed;
+extern	cvar_t	sv_accelerate;
+extern	cvar_t	sv_nostep;
+
+int ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce);
+
+/*
+==================
+PM_UserFriction
+
+==================
+*/
+void PM_UserFriction (pmove_t *pm)
+{
+	float	*vel;
+	float	speed, newspeed, control;
+	vec3_t	start, stop;
+	float	friction;
+	
+	vel = pm->velocity;
+	
+	speed = sqrtf(vel[0]*vel[0] +vel[1]*vel[1]);
+	if (!speed)
+		return;
+
+// if the leading edge is over a dropoff, increase friction
+	start[0] = stop[0] = pm->origin[0] + vel[0]/speed*16;
+	start[1] = stop[1] = pm->origin[1] + vel[1]/speed*16;
+	start[2] = pm->origin[2] + pm->mins[2];
+	stop[2] = start[2] - 34;
+
+	if (pm->dropoff (start, stop))
+		friction = sv_friction.value*sv_edgefriction.value;
+	else
+		friction = sv_friction.value;
+
+// apply friction	
+	control = speed < sv_stopspeed.value ? sv_stopspeed.value : speed;
+	newspeed = speed - pm->frametime*control*friction;
+	
+	if (newspeed < 0)
+		newspeed = 0;
+	newspeed /= speed;
+
+	vel[0] = vel[0] * newspeed;
+	vel[1] = vel[1] * newspeed;
+	vel[2] = vel[2] * newspeed;
+}
+
+/*
+==============
+PM_Accelerate
+==============
+*/
+void PM_Accelerate (pmove_t *pm)
+{
+	int			i;
+	float		addspeed, accelspeed, currentspeed;
+
+	currentspeed = DotProduct (pm->velocity, pm->wishdir);
+	addspeed = pm->wishspeed - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = sv_accelerate.value*pm->frametime*pm->wishspeed;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+	
+	for (i=0 ; i<3 ; i++)
+		pm->velocity[i] += accelspeed*pm->wishdir[i];	
+}
+
+void PM_AirAccelerate (pmove_t *pm, vec3_t wishveloc)
+{
+	int			i;
+	float		addspeed, wishspd, accelspeed, currentspeed;
+		
+	wishspd = VectorNormalize (wishveloc);
+	if (wishspd > 30)
+		wishspd = 30;
+	currentspeed = DotProduct (pm->velocity, wishveloc);
+	addspeed = wishspd - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = sv_accelerate.value*pm->wishspeed * pm->frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+	
+	for (i=0 ; i<3 ; i++)
+		pm->velocity[i] += accelspeed*wishveloc[i];	
+}
+
+/*
+===================
+PM_WaterMove
+
+===================
+*/
+void PM_WaterMove (pmove_t *pm)
+{
+	int		i;
+	vec3_t	wishvel;
+	vec3_t	forward, right, up;
+	float	speed, newspeed, wishspeed, addspeed, accelspeed;
+
+//
+// user intentions
+//
+	AngleVectors (pm->v_angle, forward, right, up);
+
+	for (i=0 ; i<3 ; i++)
+		wishvel[i] = forward[i]*pm->cmd.forwardmove + right[i]*pm->cmd.sidemove;
+
+	if (!pm->cmd.forwardmove && !pm->cmd.sidemove && !pm->cmd.upmove)
+		wishvel[2] -= 60;		// drift towards bottom
+	else
+		wishvel[2] += pm->cmd.upmove;
+
+	wishspeed = Length(wishvel);
+	if (wishspeed > sv_maxspeed.value)
+	{
+		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
+		wishspeed = sv_maxspeed.value;
+	}
+	wishspeed *= 0.7;
+
+//
+// water friction
+//
+	speed = Length (pm->velocity);
+	if (speed)
+	{
+		newspeed = speed - pm->frametime * speed * sv_friction.value;
+		if (newspeed < 0)
+			newspeed = 0;	
+		VectorScale (pm->velocity, newspeed/speed, pm->velocity);
+	}
+	else
+		newspeed = 0;
+	
+//
+// water acceleration
+//
+	if (!wishspeed)
+		return;
+
+	addspeed = wishspeed - newspeed;
+	if (addspeed <= 0)
+		return;
+
+	VectorNormalize (wishvel);
+	accelspeed = sv_accelerate.value * wishspeed * pm->frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i=0 ; i<3 ; i++)
+		pm->velocity[i] += accelspeed * wishvel[i];
+}
+
+/*
+===================
+PM_AirMove
+
+===================
+*/
+void PM_AirMove (pmove_t *pm)
+{
+	int			i;
+	vec3_t		wishvel;
+	vec3_t		forward, right, up;
+	float		fmove, smove;
+
+	AngleVectors (pm->angles, forward, right, up);
+
+	fmove = pm->cmd.forwardmove;
+	smove = pm->cmd.sidemove;
+	
+// hack to not let you back into teleporter
+	if (pm->noback && fmove < 0)
+		fmove = 0;
+		
+	for (i=0 ; i<3 ; i++)
+		wishvel[i] = forward[i]*fmove + right[i]*smove;
+
+	if (pm->movetype != MOVETYPE_WALK)
+		wishvel[2] = pm->cmd.upmove;
+	else
+		wishvel[2] = 0;
+
+	VectorCopy (wishvel, pm->wishdir);
+	pm->wishspeed = VectorNormalize(pm->wishdir);
+	if (pm->wishspeed > sv_maxspeed.value)
+	{
+		VectorScale (wishvel, sv_maxspeed.value/pm->wishspeed, wishvel);
+		pm->wishspeed = sv_maxspeed.value;
+	}
+	
+	if (pm->movetype == MOVETYPE_NOCLIP)
+	{	// noclip
+		VectorCopy (wishvel, pm->velocity);
+	}
+	else if (pm->onground)
+	{
+		PM_UserFriction (pm);
+		PM_Accelerate (pm);
+	}
+	else
+	{	// not on ground, so little effect on velocity
+		PM_AirAccelerate (pm, wishvel);
+	}		
+}
+
+/*
+===================
+PM_PlayerMove
+
+Velocity update for one command, the part of SV_ClientThink after angles
+===================
+*/
+void PM_PlayerMove (pmove_t *pm)
+{
+	if (pm->waterlevel >= 2 && pm->movetype != MOVETYPE_NOCLIP)
+		PM_WaterMove (pm);
+	else
+		PM_AirMove (pm);
+}
+
+/*
+============
+PM_FlyMove
+
+The basic solid body movement clip that slides along multiple planes,
+for SV_FlyMove and client prediction.
+Returns the clipflags if the velocity was modified (hit something solid)
+1 = floor
+2 = wall / step
+4 = dead stop
+If steptrace is not NULL, the trace of any vertical wall hit will be stored
+============
+*/
+#define	MAX_CLIP_PLANES	5
+int PM_FlyMove (pmove_t *pm, float time, trace_t *steptrace)
+{
+	int			bumpcount, numbumps;
+	vec3_t		dir;
+	float		d;
+	int			numplanes;
+	vec3_t		planes[MAX_CLIP_PLANES];
+	vec3_t		primal_velocity, original_velocity, new_velocity;
+	int			i, j;
+	trace_t		trace;
+	vec3_t		end;
+	float		time_left;
+	int			blocked;
+	
+	numbumps = 4;
+	
+	blocked = 0;
+	VectorCopy (pm->velocity, original_velocity);
+	VectorCopy (pm->velocity, primal_velocity);
+	numplanes = 0;
+	
+	time_left = time;
+
+	for (bumpcount=0 ; bumpcount<numbumps ; bumpcount++)
+	{
+		if (!pm->velocity[0] && !pm->velocity[1] && !pm->velocity[2])
+			break;
+
+		for (i=0 ; i<3 ; i++)
+			end[i] = pm->origin[i] + time_left * pm->velocity[i];
+
+		trace = pm->trace (pm, pm->origin, end);
+
+		if (trace.allsolid)
+		{	// entity is trapped in another solid
+			VectorCopy (vec3_origin, pm->velocity);
+			return 3;
+		}
+
+		if (trace.fraction > 0)
+		{	// actually covered some distance
+			VectorCopy (trace.endpos, pm->origin);
+			VectorCopy (pm->velocity, original_velocity);
+			numplanes = 0;
+		}
+
+		if (trace.fraction == 1)
+			 break;		// moved the entire distance
+
+		if (trace.plane.normal[2] > 0.7)
+		{
+			blocked |= 1;		// floor
+			pm->onground = true;
+		}
+		if (!trace.plane.normal[2])
+		{
+			blocked |= 2;		// step
+			if (steptrace)
+				*steptrace = trace;	// save for player extrafriction
+		}
+
+//
+// run the impact function
+//
+		if (pm->impact && !pm->impact (pm, &trace))
+			break;		// removed by the impact function
+
+		time_left -= time_left * trace.fraction;
+		
+	// cliped to another plane
+		if (numplanes >= MAX_CLIP_PLANES)
+		{	// this shouldn't really happen
+			VectorCopy (vec3_origin, pm->velocity);
+			return 3;
+		}
+
+		VectorCopy (trace.plane.normal, planes[numplanes]);
+		numplanes++;
+
+//
+// modify original_velocity so it parallels all of the clip planes
+//
+		for (i=0 ; i<numplanes ; i++)
+		{
+			ClipVelocity (original_velocity, planes[i], new_velocity, 1);
+			for (j=0 ; j<numplanes ; j++)
+				if (j != i)
+				{
+					if (DotProduct (new_velocity, planes[j]) < 0)
+						break;	// not ok
+				}
+			if (j == numplanes)
+				break;
+		}
+		
+		if (i != numplanes)
+		{	// go along this plane
+			VectorCopy (new_velocity, pm->velocity);
+		}
+		else
+		{	// go along the crease
+			if (numplanes != 2)
+			{
+				VectorCopy (vec3_origin, pm->velocity);
+				return 7;
+			}
+			CrossProduct (planes[0], planes[1], dir);
+			d = DotProduct (dir, pm->velocity);
+			VectorScale (dir, d, pm->velocity);
+		}
+
+//
+// if original velocity is against the original velocity, stop dead
+// to avoid tiny occilations in sloping corners
+//
+		if (DotProduct (pm->velocity, primal_velocity) <= 0)
+		{
+			VectorCopy (vec3_origin, pm->velocity);
+			return blocked;
+		}
+	}
+
+	return blocked;
+}
+
+/*
+============
+PM_WallFriction
+
+============
+*/
+void PM_WallFriction (pmove_t *pm, trace_t *trace)
+{
+	vec3_t		forward, right, up;
+	float		d, i;
+	vec3_t		into, side;
+	
+	AngleVectors (pm->v_angle, forward, right, up);
+	d = DotProduct (trace->plane.normal, forward);
+	
+	d += 0.5;
+	if (d >= 0)
+		return;
+		
+// cut the tangential velocity
+	i = DotProduct (trace->plane.normal, pm->velocity);
+	VectorScale (trace->plane.normal, i, into);
+	VectorSubtract (pm->velocity, into, side);
+	
+	pm->velocity[0] = side[0] * (1 + d);
+	pm->velocity[1] = side[1] * (1 + d);
+}
+
+/*
+=====================
+PM_TryUnstick
+
+Player has come to a dead stop, possibly due to the problem with limited
+float precision at some angle joins in the BSP hull.
+
+Try fixing by pushing one pixel in each direction.
+
+This is a hack, but in the interest of good gameplay...
+======================
+*/
+int PM_TryUnstick (pmove_t *pm, vec3_t oldvel)
+{
+	int		i;
+	vec3_t	oldorg;
+	vec3_t	dir;
+	int		clip;
+	trace_t	steptrace;
+	
+	VectorCopy (pm->origin, oldorg);
+	VectorCopy (vec3_origin, dir);
+
+	for (i=0 ; i<8 ; i++)
+	{
+// try pushing a little in an axial direction
+		switch (i)
+		{
+			case 0:	dir[0] = 2; dir[1] = 0; break;
+			case 1:	dir[0] = 0; dir[1] = 2; break;
+			case 2:	dir[0] = -2; dir[1] = 0; break;
+			case 3:	dir[0] = 0; dir[1] = -2; break;
+			case 4:	dir[0] = 2; dir[1] = 2; break;
+			case 5:	dir[0] = -2; dir[1] = 2; break;
+			case 6:	dir[0] = 2; dir[1] = -2; break;
+			case 7:	dir[0] = -2; dir[1] = -2; break;
+		}
+		
+		pm->push (pm, dir);
+
+// retry the original move
+		pm->velocity[0] = oldvel[0];
+		pm->velocity[1] = oldvel[1];
+		pm->velocity[2] = 0;
+		clip = PM_FlyMove (pm, 0.1, &steptrace);
+
+		if ( fabsf(oldorg[1] - pm->origin[1]) > 4
+		|| fabsf(oldorg[0] - pm->origin[0]) > 4 )
+			return clip;
+			
+// go back to the original pos and try again
+		VectorCopy (oldorg, pm->origin);
+	}
+	
+	VectorCopy (vec3_origin, pm->velocity);
+	return 7;		// still not moving
+}
+
+/*
+=====================
+PM_WalkMove
+
+Slide move and step up for MOVETYPE_WALK, after gravity has been added
+======================
+*/
+#define	STEPSIZE	18
+void PM_WalkMove (pmove_t *pm)
+{
+	vec3_t		upmove, downmove;
+	vec3_t		oldorg, oldvel;
+	vec3_t		nosteporg, nostepvel;
+	int			clip;
+	qboolean	oldonground;
+	trace_t		steptrace, downtrace;
+	
+//
+// do a regular slide move unless it looks like you ran into a step
+//
+	oldonground = pm->onground;
+	pm->onground = false;
+	
+	VectorCopy (pm->origin, oldorg);
+	VectorCopy (pm->velocity, oldvel);
+	
+	clip = PM_FlyMove (pm, pm->frametime, &steptrace);
+
+	if ( !(clip & 2) )
+		return;		// move didn't block on a step
+
+	if (!oldonground && pm->waterlevel == 0)
+		return;		// don't stair up while jumping
+	
+	if (pm->movetype != MOVETYPE_WALK)
+		return;		// gibbed by a trigger
+	
+	if (sv_nostep.value)
+		return;
+	
+	if (pm->waterjump)
+		return;
+
+	VectorCopy (pm->origin, nosteporg);
+	VectorCopy (pm->velocity, nostepvel);
+
+//
+// try moving up and forward to go up a step
+//
+	VectorCopy (oldorg, pm->origin);	// back to start pos
+
+	VectorCopy (vec3_origin, upmove);
+	VectorCopy (vec3_origin, downmove);
+	upmove[2] = STEPSIZE;
+	downmove[2] = -STEPSIZE + oldvel[2]*pm->frametime;
+
+// move up
+	pm->push (pm, upmove);
+
+// move forward
+	pm->velocity[0] = oldvel[0];
+	pm->velocity[1] = oldvel[1];
+	pm->velocity[2] = 0;
+	clip = PM_FlyMove (pm, pm->frametime, &steptrace);
+
+// check for stuckness, possibly due to the limited precision of floats
+// in the clipping hulls
+	if (clip)
+	{
+		if ( fabsf(oldorg[1] - pm->origin[1]) < 0.03125
+		&& fabsf(oldorg[0] - pm->origin[0]) < 0.03125 )
+		{	// stepping up didn't make any progress
+			clip = PM_TryUnstick (pm, oldvel);
+		}
+	}
+	
+// extra friction based on view angle
+	if ( clip & 2 )
+		PM_WallFriction (pm, &steptrace);
+
+// move down
+	downtrace = pm->push (pm, downmove);
+
+// the ground left by the step only counts for SOLID_BSP movers, which
+// players never are, so onground stays as the slide moves left it
+	if (downtrace.plane.normal[2] <= 0.7)
+	{
+// if the push down didn't end up on good ground, use the move without
+// the step up.  This happens near wall / slope combinations, and can
+// cause the player to hop up higher on a slope too steep to climb	
+		VectorCopy (nosteporg, pm->origin);
+		VectorCopy (nostepvel, pm->velocity);
+	}
+}
@@ -0,0 +1,61 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pmove.h -- player movement shared by the server and client prediction
+
+typedef struct pmove_s
+{
+	vec3_t		origin;
+	vec3_t		velocity;
+	vec3_t		angles;			// entity angles, pitch is -v_angle/3
+	vec3_t		v_angle;		// view angles, used for swimming and wall friction
+	vec3_t		mins, maxs;
+	usercmd_t	cmd;
+	float		frametime;
+	int			movetype;
+	int			waterlevel;
+	qboolean	onground;
+	qboolean	noback;			// just teleported, don't walk back in
+	qboolean	waterjump;		// FL_WATERJUMP, no stepping up
+
+// true if a point trace from start to stop hits nothing
+	qboolean	(*dropoff) (vec3_t start, vec3_t stop);
+
+// used by PM_FlyMove and PM_WalkMove only
+	trace_t		(*trace) (struct pmove_s *pm, vec3_t start, vec3_t end);	// box trace of the mover
+	trace_t		(*push) (struct pmove_s *pm, vec3_t push);	// SV_PushEntity
+	qboolean	(*impact) (struct pmove_s *pm, trace_t *trace);	// may be NULL, false if the mover was removed
+	void		*mover;			// the server's edict
+
+// set by PM_AirMove
+	vec3_t		wishdir;
+	float		wishspeed;
+} pmove_t;
+
+void PM_UserFriction (pmove_t *pm);
+void PM_Accelerate (pmove_t *pm);
+void PM_AirAccelerate (pmove_t *pm, vec3_t wishveloc);
+void PM_WaterMove (pmove_t *pm);
+void PM_AirMove (pmove_t *pm);
+void PM_PlayerMove (pmove_t *pm);
+
+int PM_FlyMove (pmove_t *pm, float time, trace_t *steptrace);
+void PM_WallFriction (pmove_t *pm, trace_t *trace);
+int PM_TryUnstick (pmove_t *pm, vec3_t oldvel);
+void PM_WalkMove (pmove_t *pm);
@@ -376,7 +376,7 @@ void PF2_ambientsound( byte * base, unsigned int mask, pr2val_t * stack, pr2val_
 	// add an svc_spawnambient command to the level signon packet
 	MSG_WriteByte( &sv.signon, svc_spawnstaticsound );
 	for ( i = 0; i < 3; i++ )
-		MSG_WriteCoord( &sv.signon, pos[i] );
+		SV_WriteCoord( &sv.signon, pos[i] );
 
 	MSG_WriteByte( &sv.signon, soundnum );
 
@@ -1372,12 +1372,12 @@ void PF2_WriteCoord( byte * base, unsigned int mask, pr2val_t * stack, pr2val_t
 		if ( sv.demorecording )
 		{
 			DemoWrite_Begin( dem_single, cl - svs.clients, 2 );
-			MSG_WriteCoord( ( sizebuf_t * ) demo.dbuf, data );
+			SV_WriteCoord( ( sizebuf_t * ) demo.dbuf, data );
 		}
 		
 	} else
 	*/
-		MSG_WriteCoord( WriteDest2( to ), data );
+		SV_WriteCoord( WriteDest2( to ), data );
 }
 
 void PF2_WriteString( byte * base, unsigned int mask, pr2val_t * stack, pr2val_t * retval )
@@ -1453,7 +1453,7 @@ void PF2_makestatic( byte * base, unsigned int mask, pr2val_t * stack, pr2val_t
 	MSG_WriteByte( &sv.signon, ent->v.skin );
 	for ( i = 0; i < 3; i++ )
 	{
-		MSG_WriteCoord( &sv.signon, ent->v.origin[i] );
+		SV_WriteCoord( &sv.signon, ent->v.origin[i] );
 		MSG_WriteAngle( &sv.signon, ent->v.angles[i] );
 	}
 
@@ -678,7 +678,7 @@ void PF_ambientsound (void)
 
 	MSG_WriteByte (&sv.signon,svc_spawnstaticsound);
 	for (i=0 ; i<3 ; i++)
-		MSG_WriteCoord(&sv.signon, pos[i]);
+		SV_WriteCoord(&sv.signon, pos[i]);
 
 	MSG_WriteByte (&sv.signon, soundnum);
 
@@ -1841,7 +1841,7 @@ void PF_WriteAngle (void)
 
 void PF_WriteCoord (void)
 {
-	MSG_WriteCoord (WriteDest(), G_FLOAT(OFS_PARM1));
+	SV_WriteCoord (WriteDest(), G_FLOAT(OFS_PARM1));
 }
 
 void PF_WriteString (void)
@@ -1888,7 +1888,7 @@ void PF_makestatic (void)
         MSG_WriteCoord(&sv.signon, ent->v.rendercolor[i]);
 //New vars
 #endif
-		MSG_WriteCoord(&sv.signon, ent->v.origin[i]);
+		SV_WriteCoord(&sv.signon, ent->v.origin[i]);
 		MSG_WriteAngle(&sv.signon, ent->v.angles[i]);
 	}
 
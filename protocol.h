@@ -20,6 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // protocol.h -- communications protocols
 
 #define	PROTOCOL_VERSION	15
+#define	PROTOCOL_COMPACT	16		// bit-packed entity updates, selected by sv_protocol
 
 // if the high bit of the servercmd is set, the low bits are fast update flags:
 #define	U_MOREBITS	(1<<0)
@@ -48,6 +49,41 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	U_SEQUENCE		(1<<21)
 #define	U_BODYGROUP		(1<<22)
 
+// PROTOCOL_COMPACT entity updates keep the first byte above, so the high
+// bit still marks a fast update, then switch to a bit stream:
+//	[15 bits]	U_ANGLE1 - U_BODYGROUP, only if U_MOREBITS
+//	[varbits]	entity number delta from the previous update in this message
+//	fields in the same order as PROTOCOL_VERSION, widths from net_quant
+// origins are sent as a 1/8 unit delta from the baseline, with a leading
+// bit selecting NQ_ORIGIN_LONG.  U_LONGENTITY and U_EXTEND1 are unused.
+#define	U_COMPACT_MOREBITS	15
+
+typedef enum
+{
+	NQ_MODEL,
+	NQ_FRAME,
+	NQ_COLORMAP,
+	NQ_SKIN,
+	NQ_EFFECTS,
+	NQ_RENDERAMT,
+	NQ_RENDERMODE,
+	NQ_RENDERCOLOR,
+	NQ_SEQUENCE,
+	NQ_BODYGROUP,
+	NQ_ANGLE,
+	NQ_ORIGIN,
+	NQ_ORIGIN_LONG,
+	NQ_NUMFIELDS
+} netquantfield_t;
+
+typedef struct
+{
+	int		bits;
+	float	scale;		// value is sent as (int)(value * scale)
+} netquant_t;
+
+extern	netquant_t	net_quant[NQ_NUMFIELDS];
+
 
 #define	SU_VIEWHEIGHT	(1<<0)
 #define	SU_IDEALPITCH	(1<<1)
@@ -57,7 +93,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	SU_VELOCITY1	(1<<5)
 #define	SU_VELOCITY2	(1<<6)
 #define	SU_VELOCITY3	(1<<7)
-//define	SU_AIMENT		(1<<8)  AVAILABLE BIT
+#define	SU_MOVESEQUENCE	(1<<8)		// PROTOCOL_COMPACT, last clc_move sequence run
 #define	SU_ITEMS		(1<<9)
 #define	SU_ONGROUND		(1<<10)		// no data follows, the bit is it
 #define	SU_INWATER		(1<<11)		// no data follows, the bit is it
@@ -156,7 +192,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	clc_bad			0
 #define	clc_nop 		1
 #define	clc_disconnect	2
-#define	clc_move		3			// [usercmd_t]
+#define	clc_move		3			// [usercmd_t] + [byte] sequence under PROTOCOL_COMPACT
 #define	clc_stringcmd	4		// [string] message
 
 
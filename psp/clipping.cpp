@@ -81,6 +81,15 @@ namespace quake
 		static const std::size_t	max_clipped_vertices	= 32;
 		static glvert_t				work_buffer[2][max_clipped_vertices] __attribute__((aligned(16)));
 
+		// Frustum ids, see frustum_id().
+		static int					current_frustum_id;
+		static int					world_frustum_id;
+		static int					last_frustum_id;
+
+		static void begin_capture_frame();
+		static void capture_polygon(const glvert_t* vertices, std::size_t vertex_count);
+		static bool					capturing;
+
 		static inline void calculate_frustum(const ScePspFMatrix4& clip, frustum_t* frustum)
 		{
 			__asm__ (
@@ -207,6 +216,11 @@ namespace quake
 			// Calculate and cache the clipping frustum.
 			calculate_frustum(projection_view_matrix, &projection_view_frustum);
 
+			// A new frustum for the world.
+			world_frustum_id	= ++last_frustum_id;
+			current_frustum_id	= world_frustum_id;
+			begin_capture_frame();
+
 			__asm__ volatile (
 				"ulv.q		C700, %4\n"				// Load plane into register
 				"ulv.q		C710, %5\n"				// Load plane into register
@@ -239,6 +253,7 @@ namespace quake
 
 			// Calculate the clipping frustum.
 			calculate_frustum(projection_view_model_matrix, &clipping_frustum);
+			current_frustum_id = ++last_frustum_id;
 
 			__asm__ volatile (
 				"ulv.q	C700, %0\n"	// Load plane into register
@@ -254,6 +269,9 @@ namespace quake
 
 		void end_brush_model()
 		{
+			// Back to the world's frustum, and what was kept for it.
+			current_frustum_id = world_frustum_id;
+
 			// Restore the clipping frustum.
 			__asm__ volatile (
 				"ulv.q		C700, %4\n"				// Load plane into register
@@ -275,8 +293,13 @@ namespace quake
 			);
 		}
 
+		int frustum_id()
+		{
+			return current_frustum_id;
+		}
+
 		// Is clipping required?
-		bool is_clipping_required(const struct glvert_s* vertices, std::size_t vertex_count)
+		static inline bool is_clipping_required_vfpu(const struct glvert_s* vertices, std::size_t vertex_count)
 		{
 			int res;
 			__asm__ (
@@ -310,6 +333,15 @@ namespace quake
 			return (res == 1) ? true : false;
 		}
 
+		bool is_clipping_required(const struct glvert_s* vertices, std::size_t vertex_count)
+		{
+			if (capturing)
+			{
+				capture_polygon(vertices, vertex_count);
+			}
+			return is_clipping_required_vfpu(vertices, vertex_count);
+		}
+
 		// Clips a polygon against a plane.
 		// http://hpcc.engin.umich.edu/CFD/users/charlton/Thesis/html/node90.html
 		static void clip_to_plane(
@@ -470,5 +502,260 @@ namespace quake
 			*clipped_vertices		= src;
 			*clipped_vertex_count	= vertex_count;
 		}
+
+		// Capture and replay of the polygons tested for clipping.
+		//
+		// r_clipcapture [file] keeps every polygon passed to is_clipping_required
+		// in the next frame, with the frustum it was tested against, and writes
+		// them to the game directory.  r_clipbench [file] [passes] replays such a
+		// stream through the clipper, so a change to it can be timed on the
+		// polygons of a real frame, and shows what testing each polygon once
+		// rather than for every pass saves.
+		//
+		// The file is a capture_header, then records that each start with an
+		// int: 0 for a frustum, whose plane_count planes follow, otherwise the
+		// vertex count of a polygon, whose glvert_ts follow.
+		struct capture_header
+		{
+			int	magic;
+			int	version;
+			int	plane_count;
+			int	vertex_size;
+		};
+
+		static const int			capture_magic	= ('P' << 24) | ('L' << 16) | ('C' << 8) | 'Q';
+		static const int			capture_version	= 1;
+		static const std::size_t	capture_size	= 1024 * 1024;
+
+		static bool					capture_armed;
+		static byte*				capture_buffer;
+		static std::size_t			capture_used;
+		static int					capture_frustum_id;
+		static int					capture_polygons;
+		static int					capture_dropped;
+		static char					capture_name[MAX_QPATH];
+
+		static bool capture_fits(std::size_t size)
+		{
+			return capture_used + size <= capture_size;
+		}
+
+		static void capture_append(const void* data, std::size_t size)
+		{
+			memcpy(capture_buffer + capture_used, data, size);
+			capture_used += size;
+		}
+
+		static void capture_polygon(const glvert_t* vertices, std::size_t vertex_count)
+		{
+			const int	count		= vertex_count;
+			const int	no_vertices	= 0;
+
+			// A frustum record when it changed since the last polygon.
+			const std::size_t frustum_size = (capture_frustum_id != current_frustum_id) ? sizeof(int) + sizeof(frustum_t) : 0;
+			if (!capture_fits(frustum_size + sizeof(int) + vertex_count * sizeof(glvert_t)))
+			{
+				++capture_dropped;
+				return;
+			}
+			if (frustum_size)
+			{
+				capture_append(&no_vertices, sizeof(int));
+				capture_append(clipping_frustum, sizeof(frustum_t));
+				capture_frustum_id = current_frustum_id;
+			}
+			capture_append(&count, sizeof(int));
+			capture_append(vertices, vertex_count * sizeof(glvert_t));
+			++capture_polygons;
+		}
+
+		// Called by begin_frame, ends the frame being captured and starts one
+		// that was asked for.
+		static void begin_capture_frame()
+		{
+			if (capturing)
+			{
+				capturing = false;
+
+				char path[MAX_OSPATH];
+				sprintf(path, "%s/%s", com_gamedir, capture_name);
+				COM_CreatePath(path);
+				const int file = Sys_FileOpenWrite(path);
+				if (file < 0)
+				{
+					Con_Printf("couldn't write %s\n", path);
+				}
+				else
+				{
+					Sys_FileWrite(file, capture_buffer, capture_used);
+					Sys_FileClose(file);
+					Con_Printf("%i polygons written to %s", capture_polygons, capture_name);
+					if (capture_dropped)
+					{
+						Con_Printf(", %i that didn't fit dropped", capture_dropped);
+					}
+					Con_Printf("\n");
+				}
+
+				free(capture_buffer);
+				capture_buffer = NULL;
+			}
+
+			if (capture_armed)
+			{
+				capture_armed = false;
+
+				capture_buffer = static_cast<byte*>(malloc(capture_size));
+				if (!capture_buffer)
+				{
+					Con_Printf("couldn't allocate the capture\n");
+					return;
+				}
+
+				capture_header header;
+				header.magic		= capture_magic;
+				header.version		= capture_version;
+				header.plane_count	= plane_count;
+				header.vertex_size	= sizeof(glvert_t);
+				capture_used		= 0;
+				capture_append(&header, sizeof(header));
+
+				capture_frustum_id	= 0;
+				capture_polygons	= 0;
+				capture_dropped		= 0;
+				capturing			= true;
+			}
+		}
+
+		static void capture_f()
+		{
+			const char* const name = (Cmd_Argc() > 1) ? Cmd_Argv(1) : "clipcapture.dat";
+			Q_strncpyz(capture_name, const_cast<char*>(name), sizeof(capture_name));
+			capture_armed = true;
+		}
+
+		// Makes planes the clipping frustum, as begin_brush_model does.
+		static void load_frustum(const plane_type* planes)
+		{
+			memcpy(clipping_frustum, planes, sizeof(frustum_t));
+
+			__asm__ volatile (
+				"ulv.q	C700, %0\n"	// Load plane into register
+				"ulv.q	C710, %1\n"	// Load plane into register
+				"ulv.q	C720, %2\n"	// Load plane into register
+				"ulv.q	C730, %3\n"	// Load plane into register
+				:: "m"(clipping_frustum[plane_index_bottom]),
+					"m"(clipping_frustum[plane_index_left]),
+					"m"(clipping_frustum[plane_index_right]), 
+					"m"(clipping_frustum[plane_index_top])
+			);
+		}
+
+		static void bench_f()
+		{
+			const char* const	name	= (Cmd_Argc() > 1) ? Cmd_Argv(1) : "clipcapture.dat";
+			int					passes	= (Cmd_Argc() > 2) ? Q_atoi(Cmd_Argv(2)) : 20;
+			if (passes < 1)
+			{
+				passes = 1;
+			}
+
+			const int		mark	= Hunk_LowMark();
+			const byte*		data	= COM_LoadHunkFile(const_cast<char*>(name));
+			if (!data)
+			{
+				Con_Printf("couldn't load %s, r_clipcapture makes one\n", name);
+				return;
+			}
+
+			const capture_header* const header = reinterpret_cast<const capture_header*>(data);
+			if (com_filesize < static_cast<int>(sizeof(capture_header))
+				|| header->magic != capture_magic || header->version != capture_version
+				|| header->plane_count != plane_count || header->vertex_size != sizeof(glvert_t))
+			{
+				Con_Printf("%s is not a capture of this build\n", name);
+				Hunk_FreeToLowMark(mark);
+				return;
+			}
+			const byte* const	start	= data + sizeof(capture_header);
+			const byte* const	end		= data + com_filesize;
+
+			// Mode 0 tests a polygon for each of its passes, as every draw did,
+			// mode 1 once for both.
+			double	time[2];
+			int		polygons = 0, frustums = 0, required = 0, clipped_vertices = 0;
+			for (int mode = 0; mode < 2; ++mode)
+			{
+				const double start_time = Sys_FloatTime();
+				for (int pass = 0; pass < passes; ++pass)
+				{
+					polygons = frustums = required = clipped_vertices = 0;
+					for (const byte* p = start; p + sizeof(int) <= end; )
+					{
+						int count;
+						memcpy(&count, p, sizeof(int));
+						p += sizeof(int);
+
+						if (!count)
+						{
+							if (p + sizeof(frustum_t) > end)
+							{
+								break;
+							}
+							load_frustum(reinterpret_cast<const plane_type*>(p));
+							p += sizeof(frustum_t);
+							++frustums;
+							continue;
+						}
+						if (count < 0 || count > static_cast<int>(max_clipped_vertices - plane_count)
+							|| p + count * sizeof(glvert_t) > end)
+						{
+							break;
+						}
+
+						const glvert_t* const vertices = reinterpret_cast<const glvert_t*>(p);
+						p += count * sizeof(glvert_t);
+						++polygons;
+
+						bool needs_clip = is_clipping_required_vfpu(vertices, count);
+						if (mode == 0)
+						{
+							needs_clip = is_clipping_required_vfpu(vertices, count);
+						}
+						if (!needs_clip)
+						{
+							continue;
+						}
+						++required;
+
+						// Both passes clip.
+						for (int draw = 0; draw < 2; ++draw)
+						{
+							const glvert_t*	clipped;
+							std::size_t		clipped_count;
+							clip(vertices, count, &clipped, &clipped_count);
+							clipped_vertices += clipped_count;
+						}
+					}
+				}
+				time[mode] = Sys_FloatTime() - start_time;
+			}
+
+			// Back to the frustum of the view.
+			end_brush_model();
+
+			Con_Printf("%i polygons, %i frustums, %i need clipping (%.0f%%), %i vertices out\n",
+				polygons, frustums, required, polygons ? 100.0f * required / polygons : 0.0f, clipped_vertices);
+			Con_Printf("tested every pass %7.3f ms a frame\n", time[0] * 1000 / passes);
+			Con_Printf("tested once       %7.3f ms a frame\n", time[1] * 1000 / passes);
+
+			Hunk_FreeToLowMark(mark);
+		}
+
+		void init()
+		{
+			Cmd_AddCommand("r_clipcapture", capture_f);
+			Cmd_AddCommand("r_clipbench", bench_f);
+		}
 	}
 }
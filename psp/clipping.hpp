@@ -29,6 +29,9 @@ namespace quake
 {
 	namespace clipping
 	{
+		// Registers r_clipcapture and r_clipbench.
+		void init();
+
 		// Calculates clipping planes from the GU view and projection matrices.
 		void begin_frame();
 
@@ -38,6 +41,10 @@ namespace quake
 		// Resets the frustum to camera space.
 		void end_brush_model();
 
+		// Changes whenever the clipping frustum does, so what is_clipping_required
+		// said about a polygon can be kept until then.
+		int frustum_id();
+
 		// Is clipping required?
 		bool is_clipping_required(const struct glvert_s* vertices, std::size_t vertex_count);
 
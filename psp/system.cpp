@@ -422,6 +422,40 @@ double Sys_FloatTime (void)
 	return ticks * 0.000001;
 }
 
+struct sys_thread
+{
+	void	(*func) (void *);
+	void	*arg;
+};
+
+static int Sys_ThreadEntry (SceSize args, void *argp)
+{
+	sys_thread* const thread = static_cast<sys_thread*>(argp);
+
+	thread->func (thread->arg);
+	return 0;
+}
+
+int Sys_CreateThread (char *name, void (*func) (void *), void *arg)
+{
+	sys_thread	thread = {func, arg};
+
+	// Just above the game thread, which runs at 0x20.
+	const SceUID thid = sceKernelCreateThread(name, Sys_ThreadEntry, 0x1f, 64 * 1024,
+		PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU, 0);
+	if (thid < 0)
+		return 0;
+
+	// The arguments are copied onto the new thread's stack.
+	sceKernelStartThread(thid, sizeof(thread), &thread);
+	return 1;
+}
+
+void Sys_Delay (int msec)
+{
+	sceKernelDelayThread(msec * 1000);
+}
+
 char *Sys_ConsoleInput (void)
 {
 	return 0;
@@ -346,20 +346,20 @@ void D_DeleteBuffer (psp_particle* vertices)
 		
 }
 
-int D_DrawParticleBuffered (psp_particle* vertices, particle_t *pparticle, vec3_t up, vec3_t right, float scale) {
-	unsigned int color = d_8to24table[static_cast<int>(pparticle->color)];
+int D_DrawParticleBuffered (psp_particle* vertices, vec3_t org, int pcolor, vec3_t up, vec3_t right, float scale) {
+	unsigned int color = d_8to24table[pcolor];
 	int i = BufIdx;
 	
-	vertices[i].first.x = pparticle->org[0];
-	vertices[i].first.y = pparticle->org[1];
-	vertices[i].first.z = pparticle->org[2];
+	vertices[i].first.x = org[0];
+	vertices[i].first.y = org[1];
+	vertices[i].first.z = org[2];
 	vertices[i].first.s = 0.0;              
 	vertices[i].first.t = 0.0;              
 	vertices[i].first.color = color;        
 			
-	vertices[i].second.x = pparticle->org[0] + scale*(up[0] + right[0]);        
-	vertices[i].second.y = pparticle->org[1] + scale*(up[1] + right[1]);        
-	vertices[i].second.z = pparticle->org[2] + scale*(up[2] + right[2]);        
+	vertices[i].second.x = org[0] + scale*(up[0] + right[0]);        
+	vertices[i].second.y = org[1] + scale*(up[1] + right[1]);        
+	vertices[i].second.z = org[2] + scale*(up[2] + right[2]);        
 	vertices[i].second.s = 1.0;                                                 
 	vertices[i].second.t = 1.0;                                                 
 	vertices[i].second.color = color;                                           
@@ -29,6 +29,7 @@ void GL_Upload16(int texture_index, const byte *data, int width, int height);
 int GL_LoadTexture (const char *identifier, int width, int height, const byte *data, int bpp, qboolean stretch_to_power_of_two, int filter, int mipmap_level);
 int GL_LoadPaletteTexture (const char *identifier, int width, int height, const byte *data, byte *palette, int paltype, qboolean stretch_to_power_of_two, int filter, int mipmap_level);
 int  GL_LoadTextureLM (const char *identifier, int width, int height, const byte *data,int bpp, int filter, qboolean update);
+void GL_UpdateTextureLM (int texture_index, const byte *data, int x, int y, int w, int h, int bpp);
 void GL_UnloadTexture (const int texture_index);
 void GL_GetTexfSize (int *w, int *h, int index);
 
@@ -75,6 +76,10 @@ extern	int glx, gly, glwidth, glheight;
 
 
 void R_TimeRefresh_f (void);
+void R_LightmapBench_f (void);
+void R_Lightstyles_f (void);
+void R_AliasBench_f (void);
+void R_StudioBench_f (void);
 void R_ReadPointFile_f (void);
 texture_t *R_TextureAnimation (texture_t *base);
 
@@ -137,6 +142,12 @@ extern	int			r_visframecount;	// ??? what difs?
 extern	int			r_framecount;
 extern	mplane_t	frustum[4];
 extern	int		c_brush_polys, c_alias_polys;
+extern	int		c_lightmap_surfaces, c_lightmap_texels, c_lightmap_deferred, c_lightmap_bytes;
+extern	int		c_clip_tested, c_clip_kept;
+extern	int		c_brush_draws, c_binds, c_texstate;
+extern	int		c_alias_built, c_alias_shared;
+extern	int		c_alias_lods[ALIAS_MAXLODS];
+extern	int		c_studio_built, c_studio_shared;
 
 
 //
@@ -180,6 +191,14 @@ extern	cvar_t	r_shadows;
 extern	cvar_t	r_mirroralpha;
 extern	cvar_t	r_wateralpha;
 extern	cvar_t	r_dynamic;
+extern	cvar_t	r_lightmapdirty;
+extern	cvar_t	r_lightmapbudget;
+extern	cvar_t	r_lightmapnear;
+extern	cvar_t	r_worldbatch;
+extern	cvar_t	r_sortentities;
+extern	cvar_t	r_aliascache;
+extern	cvar_t	r_studiocache;
+extern	cvar_t	r_lodsize;
 extern	cvar_t	r_novis;
 extern	cvar_t	r_nocull;
 extern	cvar_t	r_tex_scale_down;
@@ -215,6 +234,7 @@ extern	ScePspFMatrix4	r_world_matrix;
 void R_TranslatePlayerSkin (int playernum);
 void GL_Bind (int texture_index);
 void GL_BindLM (int texture_index);
+void GL_InvalidateTextureState (void);
 
 // Added by PM
 int R_LightPoint (vec3_t p);
@@ -271,4 +291,4 @@ typedef struct
 
 psp_particle* D_CreateBuffer (int size);
 void 	  	  D_DeleteBuffer (psp_particle* vertices);
-int 	      D_DrawParticleBuffered (psp_particle* vertices, particle_t *pparticle, vec3_t up, vec3_t right, float scale);
+int 	      D_DrawParticleBuffered (psp_particle* vertices, vec3_t org, int pcolor, vec3_t up, vec3_t right, float scale);
@@ -175,6 +175,72 @@ void GL_GetTexfSize (int *w, int *h, int index)
 
 void VID_SetPaletteTX();
 
+// What GL_Bind and GL_BindLM last gave the GE, so a bind only sends what
+// differs.  Nothing else sets texture state except VID_SetPalette*, which
+// sets reloaded_pallete, and then the next texture palette goes up again.
+static int			tex_format = -1, tex_mipmaps, tex_swizzle;
+static int			tex_filter = -1;
+static float		tex_slope = -1;
+static int			tex_levelmode = -1;
+static float		tex_levelbias;
+static const void	*clut_palette;
+
+int		c_texstate;
+
+/*
+================
+GL_InvalidateTextureState
+
+Forgets what is bound, the next bind sends all of it
+================
+*/
+void GL_InvalidateTextureState (void)
+{
+	currenttexture = -1;
+	tex_format = -1;
+	tex_filter = -1;
+	tex_slope = -1;
+	tex_levelmode = -1;
+	clut_palette = NULL;
+}
+
+static inline void GL_SetTexMode (int format, int mipmaps, int swizzle)
+{
+	if (format == tex_format && mipmaps == tex_mipmaps && swizzle == tex_swizzle)
+		return;
+	tex_format = format;
+	tex_mipmaps = mipmaps;
+	tex_swizzle = swizzle;
+	sceGuTexMode(format, mipmaps, 0, swizzle);
+	c_texstate++;
+}
+
+static inline void GL_SetTexFilter (int filter)
+{
+	if (filter == tex_filter)
+		return;
+	tex_filter = filter;
+	sceGuTexFilter(filter, filter);
+	c_texstate++;
+}
+
+static inline void GL_SetTexLevel (float slope, int mode, float bias)
+{
+	if (slope != tex_slope)
+	{
+		tex_slope = slope;
+		sceGuTexSlope(slope);
+		c_texstate++;
+	}
+	if (mode != tex_levelmode || bias != tex_levelbias)
+	{
+		tex_levelmode = mode;
+		tex_levelbias = bias;
+		sceGuTexLevelMode(mode, bias);
+		c_texstate++;
+	}
+}
+
 void GL_Bind (int texture_index)
 {
 	// Binding the currently bound texture?
@@ -186,6 +252,7 @@ void GL_Bind (int texture_index)
 
 	// Remember the current texture.
 	currenttexture = texture_index;
+	c_binds++;
 
 	// Which texture is it?
 	const gltexture_t& texture = gltextures[texture_index];
@@ -195,39 +262,44 @@ void GL_Bind (int texture_index)
 	{
 		if(texture.palette_active == qtrue)
 		{
-	       // Upload the palette.
-		   sceGuClutMode(GU_PSM_8888, 0, 255, 0);
-           sceKernelDcacheWritebackRange(texture.palette, 256);
-		   sceGuClutLoad(256 /8 , texture.palette);
-		   reloaded_pallete = qfalse;
+			// Upload the palette, unless it is the one in the clut.
+			if (reloaded_pallete == qtrue || clut_palette != texture.palette)
+			{
+				sceGuClutMode(GU_PSM_8888, 0, 255, 0);
+				sceKernelDcacheWritebackRange(texture.palette, 256);
+				sceGuClutLoad(256 /8 , texture.palette);
+				reloaded_pallete = qfalse;
+				clut_palette = texture.palette;
+				c_texstate++;
+			}
 		}
 		else
 		{
 	       if(reloaded_pallete == qfalse)
 	       {
 		      VID_SetPaletteTX(); //Restore old palette
+		      c_texstate++;
 		   }
 		}
 	}
 
 	// Set the texture mode.
-	sceGuTexMode(texture.format, texture.mipmaps , 0, texture.swizzle);
+	GL_SetTexMode(texture.format, texture.mipmaps, texture.swizzle);
 	
 	if (texture.mipmaps > 0 && r_mipmaps.value > 0)
 	{
-		sceGuTexSlope(0.4f); // the near from 0 slope is the lower (=best detailed) mipmap it uses
-		sceGuTexFilter(GU_LINEAR_MIPMAP_LINEAR, GU_LINEAR_MIPMAP_LINEAR);
-		sceGuTexLevelMode(int(r_mipmaps_func.value), r_mipmaps_bias.value); // manual slope setting
+		GL_SetTexLevel(0.4f, int(r_mipmaps_func.value), r_mipmaps_bias.value); // the near from 0 slope is the lower (=best detailed) mipmap it uses
+		GL_SetTexFilter(GU_LINEAR_MIPMAP_LINEAR);
 	}
 	else
 	{
-		sceGuTexFilter(texture.filter, texture.filter);
+		GL_SetTexFilter(texture.filter);
 	}
 	
 	// Set the texture image.
 	const void* const texture_memory = texture.vram ? texture.vram : texture.ram;
 	sceGuTexImage(0, texture.width, texture.height, texture.width, texture_memory);
-	
+	c_texstate++;
 	
 	if (texture.mipmaps > 0 && r_mipmaps.value > 0)
 	{
@@ -238,6 +310,7 @@ void GL_Bind (int texture_index)
 		for (int i = 1; i <= texture.mipmaps; i++) {
 			void* const texture_memory2 = ((byte*) texture_memory)+offset;
 			sceGuTexImage(i, texture.width/div, texture.height/div, texture.width/div, texture_memory2);
+			c_texstate++;
 			offset += size/(div*div);
 			div *=2;
 		}
@@ -256,17 +329,19 @@ void GL_BindLM (int texture_index)
 
 	// Remember the current texture.
 	currenttexture = texture_index;
+	c_binds++;
 
 	// Which texture is it?
 	const gltexture_t& texture = gltextures[texture_index];
 
 	// Set the texture mode.
-	sceGuTexMode(texture.format, 0, 0, GU_FALSE);
-	sceGuTexFilter(texture.filter, texture.filter);
+	GL_SetTexMode(texture.format, 0, GU_FALSE);
+	GL_SetTexFilter(texture.filter);
 
 	// Set the texture image.
 	const void* const texture_memory = texture.vram ? texture.vram : texture.ram;
 	sceGuTexImage(0, texture.width, texture.height, texture.width, texture_memory);
+	c_texstate++;
 }
 
 
@@ -1505,6 +1580,8 @@ void GL_UnloadTexture(int texture_index)
 		// Buffers.
 		if (texture.palette != NULL)
 		{
+			if (clut_palette == texture.palette)
+				clut_palette = NULL;	// the address may come back with other colours
             free(texture.palette);
             texture.palette = NULL;
         }
@@ -2040,6 +2117,42 @@ int GL_LoadTextureLM (const char *identifier, int width, int height, const byte
 	// Done.
 	return texture_index;
 }
+
+// Copies the w*h texels at x,y of a lightmap that changed into the texture
+// the GE reads, rather than the whole of it as GL_LoadTextureLM does.
+void GL_UpdateTextureLM (int texture_index, const byte *data, int x, int y, int w, int h, int bpp)
+{
+	if ((texture_index < 0) || (texture_index >= MAX_GLTEXTURES) || gltextures_used[texture_index] == false)
+	{
+		Sys_Error("Invalid texture index %d", texture_index);
+	}
+
+	const gltexture_t& texture = gltextures[texture_index];
+
+	if (w <= 0 || h <= 0)
+	{
+		return;
+	}
+
+	// Which memory is it in?
+	byte* const dest = static_cast<byte*>(texture.vram ? texture.vram : texture.ram);
+	if (!dest)
+	{
+		return;
+	}
+
+	const int src_pitch = texture.original_width * bpp;
+	const int dest_pitch = texture.width * bpp;
+	for (int row = y; row < y + h; ++row)
+	{
+		memcpy(dest + row * dest_pitch + x * bpp, data + row * src_pitch + x * bpp, w * bpp);
+	}
+
+	// Flush the data cache of the rows written, and the GE's texture cache.
+	sceKernelDcacheWritebackRange(dest + y * dest_pitch, h * dest_pitch);
+	sceGuTexFlush();
+}
+
 void showimgpart (int x, int y, int px, int py, int w, int h, int texnum, int mode,unsigned int c)
 {
     sceGuEnable(GU_BLEND);
@@ -497,10 +497,10 @@ void HL_CalcBoneAdj(hlmodel_t *model)
 
 /*
 =======================================================================================================================
-    HL_SetupBones - determine where vertex should be using bone movements
+    HL_CalcBones - evaluate the animation of every bone into transform_matrix
 =======================================================================================================================
  */
-void HL_SetupBones(hlmodel_t *model)
+static void HL_CalcBones(hlmodel_t *model)
 {
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
     int						i;
@@ -516,8 +516,6 @@ void HL_SetupBones(hlmodel_t *model)
                                 ((byte *) model->header + sequencedata->data + sequence->index);
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
-    HL_CalcBoneAdj(model);	/* Deal with programmable controllers */
-
     if(sequence->motiontype & STUDIO_X)
 	 positions[sequence->motionbone][0] = 0.0;
     if(sequence->motiontype & STUDIO_Y)
@@ -555,6 +553,119 @@ void HL_SetupBones(hlmodel_t *model)
     }
 }
 
+/*
+=======================================================================================================================
+    BONE CACHE
+
+    A pose only depends on the model, the sequence, the frame and the controllers, so entities in the same pose get
+    the same bones.  With r_studiocache 1 the transforms of the last poses evaluated are kept, and an entity that
+    finds its pose there copies them instead of walking the animation again.  The key has the model_t as well as
+    the header, so a model moved or flushed out of the cache can't be mistaken for another.
+=======================================================================================================================
+ */
+#define BONECACHE_SIZE	16	/* poses, power of two */
+
+typedef struct
+{
+    model_t				*mod;
+    hlmdl_header_t		*header;
+    int					sequence;
+    int					frame;
+    float				adjust[4];
+    matrix3x4			transforms[MAXSTUDIOBONES];
+} hlbonecache_t;
+
+static hlbonecache_t	bone_cache[BONECACHE_SIZE];
+
+int		c_studio_built, c_studio_shared;
+
+/*
+=======================================================================================================================
+    HL_SetupBones - determine where vertex should be using bone movements
+=======================================================================================================================
+ */
+void HL_SetupBones(hlmodel_t *model, model_t *mod)
+{
+    /*~~~~~~~~~~~~~~~~~~~~~~~*/
+    int				i, numadjust, numbones;
+    unsigned int	hash;
+    hlbonecache_t	*c;
+    /*~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    HL_CalcBoneAdj(model);	/* Deal with programmable controllers */
+
+    numbones = model->header->numbones;
+    if(!r_studiocache.value || numbones > MAXSTUDIOBONES)
+    {
+        HL_CalcBones(model);
+        c_studio_built++;
+        return;
+    }
+
+    /* adjust only holds what HL_CalcBoneAdj filled in */
+    numadjust = model->header->numcontrollers < 4 ? model->header->numcontrollers : 4;
+
+    hash = ((unsigned int)(size_t)mod >> 4) + model->sequence * 17 + model->frame * 5;
+    c = &bone_cache[hash & (BONECACHE_SIZE - 1)];
+
+    if(c->mod == mod && c->header == model->header && c->sequence == model->sequence && c->frame == model->frame)
+    {
+        for(i = 0; i < numadjust; i++)
+            if(c->adjust[i] != model->adjust[i])
+                break;
+
+        if(i == numadjust)
+        {
+            memcpy_vfpu(transform_matrix, c->transforms, numbones * sizeof(matrix3x4));
+            c_studio_shared++;
+            return;
+        }
+    }
+
+    HL_CalcBones(model);
+    c_studio_built++;
+
+    c->mod = mod;
+    c->header = model->header;
+    c->sequence = model->sequence;
+    c->frame = model->frame;
+    for(i = 0; i < numadjust; i++)
+        c->adjust[i] = model->adjust[i];
+    memcpy_vfpu(c->transforms, transform_matrix, numbones * sizeof(matrix3x4));
+}
+
+/*
+=======================================================================================================================
+    HL_BenchInfo - verts drawn for the first body of each part, and frames in the first sequence, for r_aliasbench
+=======================================================================================================================
+ */
+void HL_BenchInfo(model_t *mod, int *numverts, int *numframes)
+{
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    hlmodelcache_t			*modelc = static_cast<hlmodelcache_t*>(Mod_Extradata(mod));
+    hlmdl_header_t			*header = (hlmdl_header_t *) ((char *)modelc + modelc->header);
+    hlmdl_sequencelist_t	*sequence = (hlmdl_sequencelist_t *) ((byte *) header + header->seqindex);
+    int						b, m, count;
+    short					*order;
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    *numframes = header->numseq ? sequence->numframes : 0;
+    *numverts = 0;
+    for(b = 0; b < header->numbodyparts; b++)
+    {
+        hlmdl_bodypart_t	*bodypart = (hlmdl_bodypart_t *) ((byte *) header + header->bodypartindex) + b;
+        hlmdl_model_t		*amodel = (hlmdl_model_t *) ((byte *) header + bodypart->modelindex);
+
+        for(m = 0; m < amodel->nummesh; m++)
+        {
+            hlmdl_mesh_t	*mesh = (hlmdl_mesh_t *) ((byte *) header + amodel->meshindex) + m;
+
+            for(order = (short *) ((byte *) header + mesh->index); (count = *order++) != 0; order += 4 * abs(count))
+                *numverts += abs(count);
+        }
+    }
+}
+
 /*
 =======================================================================================================================
     Chrome
@@ -663,6 +774,169 @@ void Chrome (int *pchrome, int bone, vec3_t normal)
 	pchrome[1] = (n + 1.0) * 32; // FIX: make this a float
 }
 
+/*
+=======================================================================================================================
+    HL_TransformVerts - transform verts by their bones
+
+    studiomdl writes the verts of a mesh grouped by bone, so they are taken a run of the same bone at a time and
+    the matrix is loaded once for the run.  With the VFPU the rows stay in C100-C120 and each vert is three dots.
+=======================================================================================================================
+*/
+void HL_TransformVerts(vec3_t *in, byte *bone, int numverts, vec3_t *out)
+{
+    /*~~~~~~~~~~~~~~~~~~~~~~*/
+    int		v, end;
+    float	*m;
+    /*~~~~~~~~~~~~~~~~~~~~~~*/
+
+    for(v = 0; v < numverts; v = end)
+    {
+        for(end = v + 1; end < numverts && bone[end] == bone[v]; end++)
+            ;
+
+        m = (float *)transform_matrix[bone[v]];
+#ifdef PSP_VFPU
+        __asm__ volatile (
+            "ulv.q	C100, %0\n"		// C100 = row 0
+            "ulv.q	C110, %1\n"		// C110 = row 1
+            "ulv.q	C120, %2\n"		// C120 = row 2
+            "vone.s	S003\n"			// the vert is (x, y, z, 1)
+            :: "m"(m[0]), "m"(m[4]), "m"(m[8])
+        );
+        for( ; v < end; v++)
+        {
+            __asm__ volatile (
+                "lv.s	S000, %3\n"
+                "lv.s	S001, %4\n"
+                "lv.s	S002, %5\n"
+                "vdot.q	S010, C100, C000\n"
+                "vdot.q	S011, C110, C000\n"
+                "vdot.q	S012, C120, C000\n"
+                "sv.s	S010, %0\n"
+                "sv.s	S011, %1\n"
+                "sv.s	S012, %2\n"
+                :	"=m"(out[v][0]), "=m"(out[v][1]), "=m"(out[v][2])
+                :	"m"(in[v][0]), "m"(in[v][1]), "m"(in[v][2])
+            );
+        }
+#else
+        {
+            /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+            float	m00 = m[0], m01 = m[1], m02 = m[2], m03 = m[3];
+            float	m10 = m[4], m11 = m[5], m12 = m[6], m13 = m[7];
+            float	m20 = m[8], m21 = m[9], m22 = m[10], m23 = m[11];
+            /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+            for( ; v < end; v++)
+            {
+                out[v][0] = in[v][0] * m00 + in[v][1] * m01 + in[v][2] * m02 + m03;
+                out[v][1] = in[v][0] * m10 + in[v][1] * m11 + in[v][2] * m12 + m13;
+                out[v][2] = in[v][0] * m20 + in[v][1] * m21 + in[v][2] * m22 + m23;
+            }
+        }
+#endif
+    }
+}
+
+/*
+=======================================================================================================================
+    R_StudioBench_f
+
+    r_studiobench <model> [passes] : poses a Half-Life model in the first frame of its first sequence and transforms
+    the verts of every body with VectorTransform a vert at a time and with HL_TransformVerts, and prints the time of
+    both and how far apart they came out
+=======================================================================================================================
+*/
+static vec3_t	studiobench_out[2][MAXSTUDIOVERTS];
+
+void R_StudioBench_f(void)
+{
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+    model_t				*mod;
+    hlmodelcache_t		*modelc;
+    hlmodel_t			model;
+    hlmdl_bodypart_t	*bodypart;
+    hlmdl_model_t		*amodel;
+    vec3_t				*verts;
+    byte				*bone;
+    int					passes, pass, b, n, v, i, total;
+    float				d, maxdiff;
+    double				start, time[2];
+    /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
+
+    if(Cmd_Argc() < 2)
+    {
+        Con_Printf("r_studiobench <model> [passes] : times the vert transform of a Half-Life model\n");
+        return;
+    }
+
+    mod = Mod_ForName(Cmd_Argv(1), qfalse);
+    if(!mod || mod->type != mod_halflife)
+    {
+        Con_Printf("%s is not a Half-Life model\n", Cmd_Argv(1));
+        return;
+    }
+    passes = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 100;
+    if(passes < 1)
+        passes = 1;
+
+    modelc = static_cast<hlmodelcache_t*>(Mod_Extradata(mod));
+    memset(&model, 0, sizeof(model));
+    model.header	= (hlmdl_header_t *)			((char *)modelc + modelc->header);
+    model.textures	= (hlmdl_tex_t *)				((char *)modelc + modelc->textures);
+    model.bones		= (hlmdl_bone_t *)				((char *)modelc + modelc->bones);
+    model.bonectls	= (hlmdl_bonecontroller_t *)	((char *)modelc + modelc->bonectls);
+    if(!model.header->numseq || model.header->numbones > MAXSTUDIOBONES)
+    {
+        Con_Printf("%s can't be posed\n", mod->name);
+        return;
+    }
+    HL_SetupBones(&model, mod);
+
+    time[0] = time[1] = 0;
+    maxdiff = 0;
+    total = 0;
+    for(b = 0; b < model.header->numbodyparts; b++)
+    {
+        bodypart = (hlmdl_bodypart_t *) ((byte *) model.header + model.header->bodypartindex) + b;
+        for(n = 0; n < bodypart->nummodels; n++)
+        {
+            amodel = (hlmdl_model_t *) ((byte *) model.header + bodypart->modelindex) + n;
+            if(amodel->numverts > MAXSTUDIOVERTS)
+                continue;
+            bone = (byte *) model.header + amodel->vertinfoindex;
+            verts = (vec3_t *) ((byte *) model.header + amodel->vertindex);
+            total += amodel->numverts;
+
+            start = Sys_FloatTime();
+            for(pass = 0; pass < passes; pass++)
+                for(v = 0; v < amodel->numverts; v++)
+                    VectorTransform(verts[v], transform_matrix[bone[v]], studiobench_out[0][v]);
+            time[0] += Sys_FloatTime() - start;
+
+            start = Sys_FloatTime();
+            for(pass = 0; pass < passes; pass++)
+                HL_TransformVerts(verts, bone, amodel->numverts, studiobench_out[1]);
+            time[1] += Sys_FloatTime() - start;
+
+            for(v = 0; v < amodel->numverts; v++)
+            {
+                for(i = 0; i < 3; i++)
+                {
+                    d = fabs(studiobench_out[0][v][i] - studiobench_out[1][v][i]);
+                    if(d > maxdiff)
+                        maxdiff = d;
+                }
+            }
+        }
+    }
+
+    Con_Printf("%s: %i verts, %i passes\n", mod->name, total, passes);
+    Con_Printf("a vert at a time %7.3f ms a pass\n", time[0] * 1000 / passes);
+    Con_Printf("bone runs        %7.3f ms a pass\n", time[1] * 1000 / passes);
+    Con_Printf("largest difference %g\n", maxdiff);
+}
+
 /*
 =======================================================================================================================
     R_Draw_HL_AliasModel - main drawing function
@@ -772,23 +1046,17 @@ void R_DrawHLModel(entity_t	*curent)
 	VectorNormalize (shadevector);
 
 	R_BlendedRotateForEntity(curent, 0);
-	//lod
-	int	origin;
-	vec3_t	pl_origin;
-	entity_t *player;
-	player = &cl_entities[cl.viewentity];
-	int pl_origi = curent->origin -  player->origin;
-	int lodDist_x = (curent->origin[0] - player->origin[0]); //дистанция между игроком и моделью?
-	int lodDist_y = (curent->origin[1] - player->origin[1]); //дистанция между игроком и моделью?
-	origin =lodDist_x * lodDist_x + lodDist_y * lodDist_y;
-	#ifdef PSP_VFPU
-	int lodDist = vfpu_sqrtf(origin);
-	#else
-	int lodDist = sqrtf(origin);
-	#endif
-	int numLods;
-	//lod
-    HL_SetupBones(&model);	/* Setup the bones */
+	//lod: with studioLOD bodies a step further each r_loddist from the view
+	int	numLods = StudioCheckLOD(&model);
+	int	lod = 0;
+	if(numLods > 1 && r_loddist.value > 0)
+	{
+		VectorSubtract(curent->origin, r_origin, dist);
+		lod = (int)(Length(dist) / r_loddist.value);
+		if(lod >= numLods)
+			lod = numLods - 1;
+	}
+    HL_SetupBones(&model, curent->model);	/* Setup the bones */
     SetupLighting(&model);	/* Setup the light */
 
     g_smodels_total++; // render data cache cookie
@@ -803,15 +1071,12 @@ void R_DrawHLModel(entity_t	*curent)
                                      b;
         int					bodyindex = (0 / bodypart->base) % bodypart->nummodels;
 		bodyindex = curent->bodygroup;
-		if(( numLods = StudioCheckLOD(&model)) != 0 )
-		{
-			// set derived LOD
-			//Con_Printf("Dist %i \n",lodDist);
-			if(lodDist >= r_loddist.value)
-				bodyindex = 1;
-			else
-				bodyindex = 0;
-		}
+		if(numLods && !strncmp(bodypart->name, "studioLOD", 9))
+			bodyindex = lod;	// set derived LOD
+		if(bodyindex >= bodypart->nummodels)
+			bodyindex = bodypart->nummodels - 1;
+		if(bodyindex < 0)
+			bodyindex = 0;
         hlmdl_model_t		*amodel = (hlmdl_model_t *) ((byte *) model.header + bodypart->modelindex) + bodyindex;
         byte				*bone = ((byte *) model.header + amodel->vertinfoindex);
         byte				*nbone = ((byte *) model.header + amodel->norminfoindex);
@@ -822,10 +1087,7 @@ void R_DrawHLModel(entity_t	*curent)
 
 
 		
-        for(v = 0; v < amodel->numverts; v++)			// Transform per the matrix 
-		{
-            VectorTransform(verts[v], transform_matrix[bone[v]], transformed[v]);
-		}
+        HL_TransformVerts(verts, bone, amodel->numverts, transformed);	// Transform per the matrix
 		
  		lv = (float *)g_pvlightvalues;
         for(m = 0; m < amodel->nummesh; m++)
@@ -883,6 +1145,8 @@ void GL_Draw_HL_AliasFrame(short *order, vec3_t *transformed, float tex_w, float
 		g = 1;
 	 if(b > 1)
 		b = 1;
+	// one light for the whole model, so the color is packed once
+	const unsigned int color = GU_COLOR(r, g, b, 1.0f);
     while (1)
 	{
         count = *order++;
@@ -925,7 +1189,7 @@ void GL_Draw_HL_AliasFrame(short *order, vec3_t *transformed, float tex_w, float
 			out[vertex_index].x = verts[0];
             out[vertex_index].y = verts[1];
             out[vertex_index].z = verts[2];
-            out[vertex_index].color = GU_COLOR(r, g, b, 1.0f);
+            out[vertex_index].color = color;
 			
 			
 		}
@@ -934,6 +1198,7 @@ void GL_Draw_HL_AliasFrame(short *order, vec3_t *transformed, float tex_w, float
 		   sceGuDisable(GU_TEXTURE_2D);
 		}
 		sceGuDrawArray(r_showtris.value ? GU_LINE_STRIP : prim, GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, out);
+		c_alias_polys += count - 2;
         if(r_showtris.value)
 		{
 		   sceGuEnable(GU_TEXTURE_2D);
@@ -1003,6 +1268,7 @@ void GL_Draw_HL_AliasChrome(short *order, vec3_t *transformed, float tex_w, floa
 		   sceGuDisable(GU_TEXTURE_2D);
 		}
 		sceGuDrawArray(r_showtris.value ? GU_LINE_STRIP : prim, GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, out);
+		c_alias_polys += count - 2;
         if(r_showtris.value)
 		{
 		   sceGuEnable(GU_TEXTURE_2D);
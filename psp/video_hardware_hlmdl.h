@@ -354,3 +354,4 @@ int	HL_CurSequence(hlmodel_t model);
 int	HL_NewSequence(hlmodel_t * model, int _inew);
 void	HL_SetController(hlmodel_t *model, int num, float value);
 void R_DrawHLModel(entity_t	*curent);
+void HL_BenchInfo(model_t *mod, int *numverts, int *numframes);
@@ -102,6 +102,14 @@ cvar_t	r_mipmaps          = {"r_mipmaps",          "0",   qtrue};
 cvar_t	r_mipmaps_func     = {"r_mipmaps_func",     "0",   qtrue};
 cvar_t	r_mipmaps_bias     = {"r_mipmaps_bias",     "0",   qtrue};
 cvar_t	r_dynamic          = {"r_dynamic",          "1"         };
+cvar_t	r_lightmapdirty    = {"r_lightmapdirty",    "1"         };
+cvar_t	r_lightmapbudget   = {"r_lightmapbudget",   "4096"      };	// texels of far lightstyle rebuilds a frame, 0 for no limit
+cvar_t	r_lightmapnear     = {"r_lightmapnear",     "512"       };
+cvar_t	r_worldbatch       = {"r_worldbatch",       "1"         };	// one draw per texture or lightmap chain
+cvar_t	r_sortentities     = {"r_sortentities",     "1"         };	// draw entities grouped by model and skin
+cvar_t	r_aliascache       = {"r_aliascache",       "1"         };	// share alias verts between entities in a frame
+cvar_t	r_studiocache      = {"r_studiocache",      "1"         };	// share studio model bones between entities in the same pose
+cvar_t	r_lodsize          = {"r_lodsize",          "16"        };	// pixels of radius under which alias models get a simpler mesh, 0 for never
 cvar_t	r_novis            = {"r_novis",            "0"         };
 cvar_t	r_nocull           = {"r_nocull",            "0"         };
 cvar_t	r_tex_scale_down   = {"r_tex_scale_down",   "1",   qtrue};
@@ -680,297 +688,277 @@ float old_i_model_transform;
 //
 
 /*
-=============
-GL_DrawAliasFrame
-=============
+=============================================================================
+
+  ALIAS VERTEX CACHE
+
+The verts an alias model is drawn with depend on its mesh, the two
+poses, the blend between them, shadedots and lightcolor.  With
+r_aliascache 1 the blend is taken in ALIASCACHE_BLENDS steps and
+lightcolor in 1/64ths, and
+the verts for each combination are built once a frame in the display
+list and drawn from there by every entity that comes to the same ones,
+like a room of monsters running the same animation.
+
+=============================================================================
 */
+
 extern vec3_t lightcolor; // LordHavoc: .lit support
-void GL_DrawAliasFrame (aliashdr_t *paliashdr, int posenum, float apitch, float ayaw)
+
+#define	ALIASCACHE_SIZE		64		// entries, power of two
+#define	ALIASCACHE_BLENDS	16		// steps between two poses
+#define	ALIASCACHE_LIGHT	64		// steps of lightcolor to 1
+
+typedef struct
 {
-	float 	l;
-	trivertx_t	*verts;
-	int		*order;
-	int		count;
+	float			u, v;
+	unsigned int	color;
+	float			x, y, z;
+} aliasvert_t;
 
-lastposenum = posenum;
+typedef struct
+{
+	aliashdr_t			*paliashdr;
+	int					pose1, pose2;
+	int					blend;			// in ALIASCACHE_BLENDS steps
+	qboolean			shadeblend;
+	const float			*shadedots;
+	int					lod;
+	unsigned			light;			// lightcolor steps, 8 bits each
+	int					framecount;		// r_framecount the verts were built in
+	const aliasvert_t	*verts;
+} aliascache_t;
 
-	verts = (trivertx_t *)((byte *)paliashdr + paliashdr->posedata);
-	verts += posenum * paliashdr->poseverts;
-	order = (int *)((byte *)paliashdr + paliashdr->commands);
+static aliascache_t	alias_cache[ALIASCACHE_SIZE];
 
-	while (1)
+static int	alias_lod;		// the mesh of the model being drawn
+
+int		c_alias_built, c_alias_shared;
+int		c_alias_lods[ALIAS_MAXLODS];
+
+/*
+=============
+GL_BuildAliasVerts
+
+Fills out in command order with the verts between pose1 and pose2.
+shadeblend blends the shade too, else it is pose2's.
+=============
+*/
+static void GL_BuildAliasVerts (aliashdr_t *paliashdr, int pose1, int pose2, float blend,
+	qboolean shadeblend, const float *light, aliasvert_t *out)
+{
+	const maliaslod_t	*lod;
+	const trivertx_t	*verts1, *verts2;
+	const int			*order;
+	int					count;
+	float				l, l1, r, g, b;
+
+	lod = &paliashdr->lods[alias_lod];
+	verts1 = (trivertx_t *)((byte *)paliashdr + lod->posedata);
+	verts2 = verts1 + pose2 * lod->poseverts;
+	verts1 += pose1 * lod->poseverts;
+	order = (int *)((byte *)paliashdr + lod->commands);
+
+	while ((count = *order++))
 	{
-		// get the vertex count and primitive type
-		count = *order++;
-		if (!count)
-			break;		// done
-		int prim;
 		if (count < 0)
-		{
 			count = -count;
-			prim = GU_TRIANGLE_FAN;
-		}
-		else
-		{
-			prim = GU_TRIANGLE_STRIP;
-		}
 
-		// Allocate the vertices.
-		struct vertex
-		{
-			float u, v;
-			unsigned int color; 
-			float x, y, z;
-		};
-
-		vertex* const out = static_cast<vertex*>(sceGuGetMemory(sizeof(vertex) * count));
-
-		for (int vertex_index = 0; vertex_index < count; ++vertex_index)
+		for ( ; count ; count--, order += 2, verts1++, verts2++, out++)
 		{
 			// texture coordinates come from the draw list
-			out[vertex_index].u = ((float *)order)[0];
-			out[vertex_index].v = ((float *)order)[1];
-			order += 2;
+			out->u = ((float *)order)[0];
+			out->v = ((float *)order)[1];
 
 			// normals and vertexes come from the frame list
-            l = shadedots[verts->lightnormalindex];
-            float       r,g,b;
-
-			r = l * lightcolor[0];
-            g = l * lightcolor[1];
-            b = l * lightcolor[2];
+			l = shadedots[verts2->lightnormalindex];
+			if (shadeblend)
+			{
+				l1 = shadedots[verts1->lightnormalindex];
+				l = l1 + blend * (l - l1);
+			}
 
-			 if(r > 1)
+			r = l * light[0];
+			g = l * light[1];
+			b = l * light[2];
+			if (r > 1)
 				r = 1;
-			 if(g > 1)
+			if (g > 1)
 				g = 1;
-			 if(b > 1)
+			if (b > 1)
 				b = 1;
+			out->color = GU_COLOR(r, g, b, 1.0f);
 
-			out[vertex_index].x = verts->v[0];
-			out[vertex_index].y = verts->v[1];
-			out[vertex_index].z = verts->v[2];
-			out[vertex_index].color = GU_COLOR(r, g, b, 1.0f);
-			++verts;
+			out->x = verts1->v[0] + blend * (verts2->v[0] - verts1->v[0]);
+			out->y = verts1->v[1] + blend * (verts2->v[1] - verts1->v[1]);
+			out->z = verts1->v[2] + blend * (verts2->v[2] - verts1->v[2]);
 		}
-		sceGuDrawArray(prim, GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, out);
 	}
-	sceGuColor(0xffffffff);
 }
 
-
 /*
 =============
-GL_DrawAliasBlendedFrame
+GL_AliasVerts
 
-fenix@io.com: model animation interpolation
+The verts of paliashdr between pose1 and pose2 with the current
+shadedots and lightcolor, from the cache when they were built this
+frame
 =============
 */
-void GL_DrawAliasBlendedFrame (aliashdr_t *paliashdr, int pose1, int pose2, float blend, float apitch, float ayaw)
+static const aliasvert_t *GL_AliasVerts (aliashdr_t *paliashdr, int pose1, int pose2, float blend, qboolean shadeblend)
 {
-	float       l;
-    trivertx_t* verts1;
-	trivertx_t* verts2;
-	int*        order;
-	int         count, brightness;
-	vec3_t      d;
-	vec3_t       point;
-
-	lastposenum0 = pose1;
-	lastposenum  = pose2;
-
-	verts1 = (trivertx_t *)((byte *)paliashdr + paliashdr->posedata);
-	verts2 = verts1;
-
-	verts1 += pose1 * paliashdr->poseverts;
-	verts2 += pose2 * paliashdr->poseverts;
+	aliascache_t	*c;
+	aliasvert_t		*out;
+	int				i, step, q[3];
+	unsigned		light, hash;
+	float			qlight[3];
 
-	order = (int *)((byte *)paliashdr + paliashdr->commands);
-	
-	while (1)
+	if (!r_aliascache.value)
 	{
-       // get the vertex count and primitive type
-		int prim;
-		count = *order++;
+		out = static_cast<aliasvert_t*>(sceGuGetMemory(sizeof(aliasvert_t) * paliashdr->lods[alias_lod].poseverts));
+		GL_BuildAliasVerts (paliashdr, pose1, pose2, blend, shadeblend, lightcolor, out);
+		c_alias_built++;
+		return out;
+	}
 
-		if (!count) break;
+	// the same blend can be asked for more than one way
+	step = (int)(blend * ALIASCACHE_BLENDS + 0.5f);
+	if (step < 0)
+		step = 0;
+	if (step >= ALIASCACHE_BLENDS || pose1 == pose2)
+	{
+		if (step >= ALIASCACHE_BLENDS || shadeblend)
+			pose1 = pose2;
+		step = 0;
+		if (pose1 == pose2)
+			shadeblend = qtrue;
+	}
+	else if (step == 0 && shadeblend)
+		pose2 = pose1;
 
-		if (count < 0)
-        {
-			count = -count;
-            prim = GU_TRIANGLE_FAN;
-		}
-		else
-		{
-		    prim = GU_TRIANGLE_STRIP;;
-		}
+	for (i=0 ; i<3 ; i++)
+	{
+		q[i] = (int)(lightcolor[i] * ALIASCACHE_LIGHT + 0.5f);
+		if (q[i] > 255)
+			q[i] = 255;
+		else if (q[i] < 0)
+			q[i] = 0;
+		qlight[i] = (float)q[i] / ALIASCACHE_LIGHT;
+	}
+	light = q[0] | (q[1] << 8) | (q[2] << 16);
 
-		// Allocate the vertices.
-		struct vertex
-		{
-			float u, v;
-			unsigned int color;
-			float x, y, z;
-		};
+	hash = ((unsigned)(size_t)paliashdr >> 4) + pose1 * 73 + pose2 * 151 + step * 31
+		+ light * 7 + (unsigned)(shadedots - r_avertexnormal_dots[0]) / 256 * 13 + alias_lod * 5;
+	c = &alias_cache[(hash ^ (hash >> 11)) & (ALIASCACHE_SIZE-1)];
 
-		vertex* const out = static_cast<vertex*>(sceGuGetMemory(sizeof(vertex) * count));
+	if (c->framecount == r_framecount && c->paliashdr == paliashdr
+		&& c->pose1 == pose1 && c->pose2 == pose2 && c->blend == step
+		&& c->shadeblend == shadeblend && c->shadedots == shadedots && c->lod == alias_lod
+		&& c->light == light)
+	{
+		c_alias_shared++;
+		return c->verts;
+	}
 
-		for (int vertex_index = 0; vertex_index < count; ++vertex_index)
-		{
-            
-			// texture coordinates come from the draw list
-			out[vertex_index].u = ((float *)order)[0];
-			out[vertex_index].v = ((float *)order)[1];
+	out = static_cast<aliasvert_t*>(sceGuGetMemory(sizeof(aliasvert_t) * paliashdr->lods[alias_lod].poseverts));
+	GL_BuildAliasVerts (paliashdr, pose1, pose2, (float)step / ALIASCACHE_BLENDS, shadeblend, qlight, out);
+	c_alias_built++;
+
+	c->paliashdr = paliashdr;
+	c->pose1 = pose1;
+	c->pose2 = pose2;
+	c->blend = step;
+	c->shadeblend = shadeblend;
+	c->shadedots = shadedots;
+	c->lod = alias_lod;
+	c->light = light;
+	c->framecount = r_framecount;
+	c->verts = out;
+	return out;
+}
 
-			order += 2;
-			d[0] = shadedots[verts2->lightnormalindex] - shadedots[verts1->lightnormalindex];
-            l = shadedots[verts1->lightnormalindex] + (blend * d[0]);
+/*
+=============
+GL_DrawAliasVerts
 
-            float       r,g,b;
+Draws the command list of paliashdr over verts
+=============
+*/
+static void GL_DrawAliasVerts (aliashdr_t *paliashdr, const aliasvert_t *verts)
+{
+	int		*order;
+	int		count, prim;
 
-			r = l * lightcolor[0];
-            g = l * lightcolor[1];
-            b = l * lightcolor[2];
+	order = (int *)((byte *)paliashdr + paliashdr->lods[alias_lod].commands);
 
-             if(r > 1)
-				r = 1;
-			 if(g > 1)
-				g = 1;
-			 if(b > 1)
-				b = 1;
+	if (r_showtris.value)
+		sceGuDisable(GU_TEXTURE_2D);
 
-			VectorSubtract(verts2->v, verts1->v, d);
-
-			// blend the vertex positions from each frame together
-			point[0] = verts1->v[0] + (blend * d[0]);
-			point[1] = verts1->v[1] + (blend * d[1]);
-			point[2] = verts1->v[2] + (blend * d[2]);
-			
-		    out[vertex_index].x = point[0];
-            out[vertex_index].y = point[1];
-            out[vertex_index].z = point[2];
-            out[vertex_index].color = GU_COLOR(r, g, b, 1.0f);
-            
-            verts1++;
-            verts2++;
-		}
-		
-        if(r_showtris.value)
+	while ((count = *order++))
+	{
+		// get the vertex count and primitive type
+		if (count < 0)
 		{
-		   sceGuDisable(GU_TEXTURE_2D);
+			count = -count;
+			prim = GU_TRIANGLE_FAN;
 		}
-		sceGuDrawArray(r_showtris.value ? GU_LINE_STRIP : prim, GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, out);
-        if(r_showtris.value)
+		else
 		{
-		   sceGuEnable(GU_TEXTURE_2D);
+			prim = GU_TRIANGLE_STRIP;
 		}
-		
+
+		sceGuDrawArray(r_showtris.value ? GU_LINE_STRIP : prim,
+			GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, verts);
+		verts += count;
+		order += count * 2;
 	}
+
+	if (r_showtris.value)
+		sceGuEnable(GU_TEXTURE_2D);
+
 	sceGuColor(0xffffffff);
 }
 
 /*
 =============
-GL_DrawAliasInterpolatedFrame
+GL_DrawAliasFrame
 =============
 */
-void GL_DrawAliasInterpolatedFrame (aliashdr_t *paliashdr, int posenum, int oldposenum, int interp)
+void GL_DrawAliasFrame (aliashdr_t *paliashdr, int posenum, float apitch, float ayaw)
 {
-   float s, t;
-   float  l;
-   float interpolations;
-   int  i, j;
-   int  index;
-   trivertx_t *v, *verts, *oldverts;
-   int  list;
-   int  *order;
-   vec3_t point;
-   float *normal;
-   int  count;
-
-   lastposenum = posenum;
-   interpolations = interp/r_ipolations.value;
-   verts = (trivertx_t *)((byte *)paliashdr + paliashdr->posedata);
-   oldverts = verts;
-   verts += posenum * paliashdr->poseverts;
-   if (oldposenum >= 0)
-      oldverts += oldposenum * paliashdr->poseverts;
-   else
-      oldverts += posenum * paliashdr->poseverts;
-
-   order = (int *)((byte *)paliashdr + paliashdr->commands);
-
-   while (1)
-      {
-        // get the vertex count and primitive type
-        int prim;
-		count = *order++;
+	lastposenum = posenum;
 
-		if (!count)
-		break;
+	GL_DrawAliasVerts (paliashdr, GL_AliasVerts (paliashdr, posenum, posenum, 0, qtrue));
+}
 
-		if (count < 0)
-        {
-			count = -count;
-            prim = GU_TRIANGLE_FAN;
-		}
-		else
-		{
-		    prim = GU_TRIANGLE_STRIP;;
-		}
 
-		// Allocate the vertices.
-		struct vertex
-		{
-			float u, v;
-			unsigned int color;
-			float x, y, z;
-		};
-
-		vertex* const out = static_cast<vertex*>(sceGuGetMemory(sizeof(vertex) * count));
+/*
+=============
+GL_DrawAliasBlendedFrame
 
-		for (int vertex_index = 0; vertex_index < count; ++vertex_index)
-        {
-         // texture coordinates come from the draw list
-     	 out[vertex_index].u = ((float *)order)[0];
-		 out[vertex_index].v = ((float *)order)[1];
-         order += 2;
-         // normals and vertexes come from the frame list
-         l = shadedots[verts->lightnormalindex];
-         float       r,g,b;
-
-			r = l * lightcolor[0];
-            g = l * lightcolor[1];
-            b = l * lightcolor[2];
-             if(r > 1)
-				r = 1;
-			 if(g > 1)
-				g = 1;
-			 if(b > 1)
-				b = 1;
+fenix@io.com: model animation interpolation
+=============
+*/
+void GL_DrawAliasBlendedFrame (aliashdr_t *paliashdr, int pose1, int pose2, float blend, float apitch, float ayaw)
+{
+	lastposenum0 = pose1;
+	lastposenum  = pose2;
 
-		 out[vertex_index].x = oldverts->v[0] + ((verts->v[0] - oldverts->v[0])*interpolations);
-         out[vertex_index].y = oldverts->v[1] + ((verts->v[1] - oldverts->v[1])*interpolations);
-         out[vertex_index].z = oldverts->v[2] + ((verts->v[2] - oldverts->v[2])*interpolations);
+	GL_DrawAliasVerts (paliashdr, GL_AliasVerts (paliashdr, pose1, pose2, blend, qtrue));
+}
 
-         out[vertex_index].color = GU_COLOR(r, g, b, 1.0f);
+/*
+=============
+GL_DrawAliasInterpolatedFrame
+=============
+*/
+void GL_DrawAliasInterpolatedFrame (aliashdr_t *paliashdr, int posenum, int oldposenum, int interp)
+{
+	lastposenum = posenum;
 
-		 verts++;
-         oldverts++;
-		 }
-		 
-         if(r_showtris.value)
-		 {
-		   sceGuDisable(GU_TEXTURE_2D);
-		 }
-		 sceGuDrawArray(r_showtris.value ? GU_LINE_STRIP : prim, GU_TEXTURE_32BITF | GU_VERTEX_32BITF | GU_COLOR_8888, count, 0, out);
-         if(r_showtris.value)
-		 {
-		   sceGuEnable(GU_TEXTURE_2D);
-		 }
-		 
-	  }
-	  sceGuColor(0xffffffff);
+	// the shade is the new pose's all the way
+	GL_DrawAliasVerts (paliashdr, GL_AliasVerts (paliashdr, oldposenum >= 0 ? oldposenum : posenum,
+		posenum, interp / r_ipolations.value, qfalse));
 }
 /*
 =============
@@ -1299,6 +1287,41 @@ void R_SetupAliasInterpolatedFrame (int frame, int lastframe, float interp, alia
    GL_DrawAliasInterpolatedFrame (paliashdr, pose, oldpose, interp);
 }
 
+/*
+=================
+R_AliasLod
+
+The mesh of paliashdr to draw e with, by the radius it has on screen.
+Under r_lodsize pixels it gets the first simpler mesh, under half that
+the next.
+=================
+*/
+static int R_AliasLod (entity_t *e, aliashdr_t *paliashdr)
+{
+	vec3_t	delta;
+	float	dist, size;
+	int		lod;
+
+	if (r_lodsize.value <= 0 || paliashdr->numlods < 2 || e == &cl.viewent)
+		return 0;
+
+	VectorSubtract (e->origin, r_origin, delta);
+	dist = Length (delta);
+	if (dist < 1)
+		return 0;
+
+	// r_refdef.vrect.height / 2 pixels are tan (fov_y / 2) of the distance
+	size = paliashdr->boundingradius * r_refdef.vrect.height * 0.5f
+		/ (dist * tanf (r_refdef.fov_y * (M_PI / 360.0f)));
+
+	lod = 0;
+	if (size < r_lodsize.value)
+		lod = size < r_lodsize.value * 0.5f ? 2 : 1;
+	if (lod >= paliashdr->numlods)
+		lod = paliashdr->numlods - 1;
+	return lod;
+}
+
 /*
 =================
 R_DrawAliasModel
@@ -1449,7 +1472,9 @@ void R_DrawAliasModel (entity_t *e)
 	//
 	paliashdr = (aliashdr_t *)Mod_Extradata (currententity->model);
 
-	c_alias_polys += paliashdr->numtris;
+	alias_lod = R_AliasLod (e, paliashdr);
+	c_alias_polys += paliashdr->lods[alias_lod].numtris;
+	c_alias_lods[alias_lod]++;
 
 	//
 	// draw all the triangles
@@ -1625,6 +1650,256 @@ void R_DrawNullModel(void)
 }
 //==================================================================================
 
+/*
+=============================================================================
+
+  ENTITY ORDER
+
+The visible entities are drawn sorted, brush models first, then alias
+and half-life models grouped by model and skin so each group binds its
+texture once, then the blended ones in the order the client sent them.
+r_sortentities 0 draws them as they come, to compare binds in r_speeds.
+
+=============================================================================
+*/
+
+enum
+{
+	ESORT_BRUSH,
+	ESORT_ALIAS,
+	ESORT_HALFLIFE,
+	ESORT_BLENDED		// and models of no known type, drawn in order
+};
+
+typedef struct
+{
+	entity_t	*entity;
+	int			pass;
+	int			order;
+} entitysort_t;
+
+static entitysort_t	r_entitysort[MAX_VISEDICTS];
+
+/*
+=============
+R_EntitySortCompare
+=============
+*/
+static int R_EntitySortCompare (const void *a, const void *b)
+{
+	const entitysort_t	*ea = static_cast<const entitysort_t*>(a);
+	const entitysort_t	*eb = static_cast<const entitysort_t*>(b);
+
+	if (ea->pass != eb->pass)
+		return ea->pass - eb->pass;
+	if (ea->pass != ESORT_BLENDED)
+	{
+		if (ea->entity->model != eb->entity->model)
+			return ea->entity->model < eb->entity->model ? -1 : 1;
+		if (ea->entity->skinnum != eb->entity->skinnum)
+			return ea->entity->skinnum - eb->entity->skinnum;
+	}
+	return ea->order - eb->order;
+}
+
+/*
+=============
+R_SortEntities
+
+Fills r_entitysort with the entities to draw, in the order to draw them
+=============
+*/
+static void R_SortEntities (void)
+{
+	int				i;
+	entity_t		*e;
+	entitysort_t	*s;
+
+	for (i=0, s=r_entitysort ; i<cl_numvisedicts ; i++, s++)
+	{
+		e = cl_visedicts[i];
+		s->entity = e;
+		s->order = i;
+		if (!e->model || ISADDITIVE(e) || ISGLOW(e) || ISTEXTURE(e))
+			s->pass = ESORT_BLENDED;
+		else if (e->model->type == mod_brush)
+			s->pass = ESORT_BRUSH;
+		else if (e->model->type == mod_alias)
+			s->pass = ESORT_ALIAS;
+		else if (e->model->type == mod_halflife)
+			s->pass = ESORT_HALFLIFE;
+		else
+			s->pass = ESORT_BLENDED;
+	}
+
+	if (r_sortentities.value)
+		qsort (r_entitysort, cl_numvisedicts, sizeof(r_entitysort[0]), R_EntitySortCompare);
+}
+
+/*
+=============================================================================
+
+  ALIAS BENCHMARK
+
+r_aliasbench <model> [count] [frames] draws count copies of an alias
+model in rows in front of the view, eight frames of its animation
+between them, for frames frames with r_aliascache 1 and as many with 0,
+and prints the time R_DrawAliasModel took a frame each way, how many
+vert arrays were built and shared and how many triangles r_lodsize left.  A Half-Life model is drawn with
+R_DrawHLModel in the first sequence, and r_studiocache is switched and
+the bones counted instead.
+
+=============================================================================
+*/
+
+#define	ALIASBENCH_MAX		256
+#define	ALIASBENCH_ROW		20
+#define	ALIASBENCH_LIST		(512*1024)	// display list bytes the uncached verts may take
+
+static entity_t		aliasbench_ents[ALIASBENCH_MAX];
+static model_t		*aliasbench_model;
+static int			aliasbench_count, aliasbench_frames, aliasbench_frame, aliasbench_numframes;
+static double		aliasbench_time[2];
+static int			aliasbench_built[2], aliasbench_shared[2], aliasbench_tris;
+
+/*
+=============
+R_AliasBench_f
+=============
+*/
+void R_AliasBench_f (void)
+{
+	model_t		*m;
+	aliashdr_t	*paliashdr;
+	int			max, numverts;
+
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("r_aliasbench <model> [count] [frames] : draws count of an alias or Half-Life model\n");
+		return;
+	}
+	if (!cl.worldmodel || cls.state != ca_connected)
+	{
+		Con_Printf ("r_aliasbench needs a map\n");
+		return;
+	}
+
+	m = Mod_ForName (Cmd_Argv(1), qfalse);
+	if (!m || (m->type != mod_alias && m->type != mod_halflife))
+	{
+		Con_Printf ("%s is not an alias model\n", Cmd_Argv(1));
+		return;
+	}
+	if (m->type == mod_halflife)
+		HL_BenchInfo (m, &numverts, &aliasbench_numframes);
+	else
+	{
+		paliashdr = (aliashdr_t *)Mod_Extradata (m);
+		numverts = paliashdr->poseverts;
+		aliasbench_numframes = paliashdr->numframes;
+	}
+	if (numverts < 1 || aliasbench_numframes < 1)
+	{
+		Con_Printf ("%s has nothing to draw\n", m->name);
+		return;
+	}
+
+	aliasbench_count = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 200;
+	aliasbench_frames = Cmd_Argc() > 3 ? Q_atoi(Cmd_Argv(3)) : 100;
+	if (aliasbench_frames < 1)
+		aliasbench_frames = 1;
+	max = ALIASBENCH_LIST / (numverts * sizeof(aliasvert_t));
+	if (max > ALIASBENCH_MAX)
+		max = ALIASBENCH_MAX;
+	if (aliasbench_count > max)
+	{
+		Con_Printf ("%i of %s fit the display list\n", max, m->name);
+		aliasbench_count = max;
+	}
+	if (aliasbench_count < 1)
+		return;
+
+	memset (aliasbench_ents, 0, sizeof(aliasbench_ents));
+	aliasbench_time[0] = aliasbench_time[1] = 0;
+	aliasbench_built[0] = aliasbench_built[1] = 0;
+	aliasbench_shared[0] = aliasbench_shared[1] = 0;
+	aliasbench_tris = 0;
+	aliasbench_frame = 0;
+	aliasbench_model = m;
+}
+
+/*
+=============
+R_DrawAliasBench
+=============
+*/
+static void R_DrawAliasBench (void)
+{
+	entity_t	*e;
+	cvar_t		*cache;
+	int			*c_built, *c_shared;
+	float		oldcache;
+	double		start;
+	int			i, cached, built, shared, tris;
+
+	if (!aliasbench_model)
+		return;
+
+	if (aliasbench_model->type == mod_halflife)
+	{
+		cache = &r_studiocache;
+		c_built = &c_studio_built;
+		c_shared = &c_studio_shared;
+	}
+	else
+	{
+		cache = &r_aliascache;
+		c_built = &c_alias_built;
+		c_shared = &c_alias_shared;
+	}
+	cached = aliasbench_frame < aliasbench_frames;
+	oldcache = cache->value;
+	cache->value = cached;
+	built = *c_built;
+	shared = *c_shared;
+	tris = c_alias_polys;
+
+	start = Sys_FloatTime ();
+	for (i=0, e=aliasbench_ents ; i<aliasbench_count ; i++, e++)
+	{
+		e->model = aliasbench_model;
+		e->colormap = vid.colormap;
+		e->frame = (i & 7) % aliasbench_numframes;
+		VectorMA (r_refdef.vieworg, 96 + (i / ALIASBENCH_ROW) * 48, vpn, e->origin);
+		VectorMA (e->origin, (i % ALIASBENCH_ROW - ALIASBENCH_ROW/2) * 40, vright, e->origin);
+		e->origin[2] = r_refdef.vieworg[2] - 16;
+		e->angles[1] = r_refdef.viewangles[1] + 180;
+
+		currententity = e;
+		if (aliasbench_model->type == mod_halflife)
+			R_DrawHLModel (e);
+		else
+			R_DrawAliasModel (e);
+	}
+	aliasbench_time[!cached] += Sys_FloatTime () - start;
+	aliasbench_built[!cached] += *c_built - built;
+	aliasbench_shared[!cached] += *c_shared - shared;
+	aliasbench_tris += c_alias_polys - tris;
+
+	cache->value = oldcache;
+
+	if (++aliasbench_frame < aliasbench_frames * 2)
+		return;
+
+	Con_Printf ("%i %s, %i frames each way\n", aliasbench_count, aliasbench_model->name, aliasbench_frames);
+	Con_Printf ("%i triangles a frame\n", aliasbench_tris / (aliasbench_frames * 2));
+	for (i=0 ; i<2 ; i++)
+		Con_Printf ("%s %i: %6.3f ms a frame, %i built %i shared\n", cache->name, !i,
+			aliasbench_time[i] * 1000 / aliasbench_frames,
+			aliasbench_built[i] / aliasbench_frames, aliasbench_shared[i] / aliasbench_frames);
+	aliasbench_model = NULL;
+}
+
 /*
 =============
 R_DrawEntitiesOnList
@@ -1637,10 +1912,12 @@ void R_DrawEntitiesOnList (void)
 	if (!r_drawentities.value)
 		return;
 
+	R_SortEntities ();
+
 	// draw sprites seperately, because of alpha blending
 	for (i=0 ; i<cl_numvisedicts ; i++)
 	{
-		currententity = cl_visedicts[i];
+		currententity = r_entitysort[i].entity;
 
 		if (currententity == &cl_entities[cl.viewentity])
 	       currententity->angles[0] *= 0.3;
@@ -1670,6 +1947,8 @@ void R_DrawEntitiesOnList (void)
 		}
 	}
 
+	R_DrawAliasBench ();
+
 	for (i=0 ; i<cl_numvisedicts ; i++)
 	{
 		currententity = cl_visedicts[i];
@@ -2296,6 +2575,14 @@ void R_RenderView (void)
 		time1 = Sys_FloatTime ();
 		c_brush_polys = 0;
 		c_alias_polys = 0;
+		c_brush_draws = 0;
+		c_binds = 0;
+		c_texstate = 0;
+		c_alias_built = 0;
+		c_alias_shared = 0;
+		c_studio_built = 0;
+		c_studio_shared = 0;
+		memset (c_alias_lods, 0, sizeof(c_alias_lods));
 	}
 
 	mirror = qfalse;
@@ -2342,5 +2629,11 @@ void R_RenderView (void)
 	{
 		time2 = Sys_FloatTime ();
 		Con_Printf ("%3i ms  %4i wpoly %4i epoly\n", (int)((time2-time1)*1000), c_brush_polys, c_alias_polys); 
+		Con_Printf ("%3i lightmaps %5i texels %3i put off %6i bytes up\n", c_lightmap_surfaces, c_lightmap_texels, c_lightmap_deferred, c_lightmap_bytes);
+		Con_Printf ("%4i clip tests %4i kept\n", c_clip_tested, c_clip_kept);
+		Con_Printf ("%4i brush draws %4i binds %4i texture states\n", c_brush_draws, c_binds, c_texstate);
+		Con_Printf ("%4i alias verts built %4i shared\n", c_alias_built, c_alias_shared);
+		Con_Printf ("%4i studio bones built %4i shared\n", c_studio_built, c_studio_shared);
+		Con_Printf ("%4i alias models full %4i at lod 1 %4i at lod 2\n", c_alias_lods[0], c_alias_lods[1], c_alias_lods[2]);
 	}
 }
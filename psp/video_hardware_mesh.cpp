@@ -282,6 +282,229 @@ static void BuildTris (void)
 }
 
 
+/*
+=================================================================
+
+ALIAS MODEL LEVELS OF DETAIL
+
+An alias model small on screen is drawn with a simplified mesh.  Each
+one is made from the last by collapsing the shortest edges of the first
+pose, one end onto the other, so the verts that are left keep their
+poses and s/t as the model has them.  Verts on the skin seam stay, and
+so does any edge whose collapse would turn a triangle away from the way
+it faced in the full mesh.
+
+=================================================================
+*/
+
+#define	ALIAS_LODMINTRIS	64		// fewer and the model only has the full mesh
+
+static const float	alias_lodtris[ALIAS_MAXLODS] = {1, 0.5, 0.25};	// of the full mesh
+
+typedef struct
+{
+	int		v[2];
+	float	length;
+} lodedge_t;
+
+static mtriangle_t	lodtris[MAXALIASTRIS];
+static vec3_t		lodnormals[MAXALIASTRIS];	// of each in the full mesh
+static int			numlodtris;
+static lodedge_t	lodedges[MAXALIASTRIS*3];
+static byte			lodtouched[MAXALIASVERTS];
+
+/*
+================
+LodVertex
+================
+*/
+static void LodVertex (int v, vec3_t out)
+{
+	out[0] = poseverts[0][v].v[0] * pheader->scale[0];
+	out[1] = poseverts[0][v].v[1] * pheader->scale[1];
+	out[2] = poseverts[0][v].v[2] * pheader->scale[2];
+}
+
+/*
+================
+LodTriNormal
+
+The normal of t in the first pose with vert from moved onto to
+================
+*/
+static void LodTriNormal (mtriangle_t *t, int from, int to, vec3_t normal)
+{
+	vec3_t	p[3], d1, d2;
+	int		k;
+
+	for (k=0 ; k<3 ; k++)
+		LodVertex (t->vertindex[k] == from ? to : t->vertindex[k], p[k]);
+	VectorSubtract (p[1], p[0], d1);
+	VectorSubtract (p[2], p[0], d2);
+	CrossProduct (d1, d2, normal);
+}
+
+/*
+================
+LodCanCollapse
+
+Whether a can go onto b without turning over a triangle that stays
+================
+*/
+static qboolean LodCanCollapse (int a, int b)
+{
+	mtriangle_t	*t;
+	vec3_t		normal;
+	int			i;
+
+	for (i=0, t=lodtris ; i<numlodtris ; i++, t++)
+	{
+		if (t->vertindex[0] != a && t->vertindex[1] != a && t->vertindex[2] != a)
+			continue;
+		if (t->vertindex[0] == b || t->vertindex[1] == b || t->vertindex[2] == b)
+			continue;		// goes away
+
+		LodTriNormal (t, a, b, normal);
+		if (DotProduct (normal, lodnormals[i]) <= 0)
+			return qfalse;
+	}
+	return qtrue;
+}
+
+/*
+================
+LodCollapse
+
+Moves a onto b and drops the triangles that are left without area
+================
+*/
+static void LodCollapse (int a, int b)
+{
+	mtriangle_t	*t;
+	int			i, k;
+
+	for (i=0 ; i<numlodtris ; )
+	{
+		t = &lodtris[i];
+		for (k=0 ; k<3 ; k++)
+			if (t->vertindex[k] == a)
+				t->vertindex[k] = b;
+
+		if (t->vertindex[0] == t->vertindex[1] || t->vertindex[1] == t->vertindex[2]
+			|| t->vertindex[2] == t->vertindex[0])
+		{
+			numlodtris--;
+			*t = lodtris[numlodtris];
+			VectorCopy (lodnormals[numlodtris], lodnormals[i]);
+			continue;
+		}
+		i++;
+	}
+}
+
+/*
+================
+LodEdgeCompare
+================
+*/
+static int LodEdgeCompare (const void *a, const void *b)
+{
+	float	d;
+
+	d = ((const lodedge_t *)a)->length - ((const lodedge_t *)b)->length;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+/*
+================
+SimplifyTris
+
+Collapses edges of lodtris, shortest first, until there are target
+triangles or no edge can go.  An edge is taken at most once a pass,
+when neither of its verts has moved in it.
+================
+*/
+static void SimplifyTris (int target)
+{
+	mtriangle_t	*t;
+	lodedge_t	*e;
+	vec3_t		p1, p2, d;
+	int			i, k, a, b, numedges, collapsed;
+
+	while (numlodtris > target)
+	{
+		numedges = 0;
+		for (i=0, t=lodtris ; i<numlodtris ; i++, t++)
+		{
+			for (k=0 ; k<3 ; k++)
+			{
+				a = t->vertindex[k];
+				b = t->vertindex[(k+1)%3];
+				if (stverts[a].onseam || stverts[b].onseam)
+					continue;
+				LodVertex (a, p1);
+				LodVertex (b, p2);
+				VectorSubtract (p2, p1, d);
+				e = &lodedges[numedges++];
+				e->v[0] = a;
+				e->v[1] = b;
+				e->length = DotProduct (d, d);
+			}
+		}
+		qsort (lodedges, numedges, sizeof(lodedge_t), LodEdgeCompare);
+
+		memset (lodtouched, 0, sizeof(lodtouched));
+		collapsed = 0;
+		for (i=0, e=lodedges ; i<numedges && numlodtris > target ; i++, e++)
+		{
+			a = e->v[0];
+			b = e->v[1];
+			if (lodtouched[a] || lodtouched[b])
+				continue;
+			if (!LodCanCollapse (a, b))
+			{
+				if (!LodCanCollapse (b, a))
+					continue;
+				a = e->v[1];
+				b = e->v[0];
+			}
+			LodCollapse (a, b);
+			lodtouched[a] = lodtouched[b] = 1;
+			collapsed++;
+		}
+
+		if (!collapsed)
+			break;
+	}
+}
+
+/*
+================
+SaveLod
+
+Saves the command list and the reordered poses BuildTris made
+================
+*/
+static void SaveLod (maliaslod_t *lod)
+{
+	int			*cmds;
+	trivertx_t	*verts;
+	int			i, j;
+
+	lod->numtris = pheader->numtris;
+	lod->poseverts = numorder;
+
+	cmds = static_cast<int*>(Hunk_Alloc (numcommands * 4));
+	lod->commands = (byte *)cmds - (byte *)paliashdr;
+	memcpy (cmds, commands, numcommands * 4);
+
+	verts = static_cast<trivertx_t*>(Hunk_Alloc (paliashdr->numposes * numorder * sizeof(trivertx_t)));
+	lod->posedata = (byte *)verts - (byte *)paliashdr;
+	for (i=0 ; i<paliashdr->numposes ; i++)
+		for (j=0 ; j<numorder ; j++)
+			*verts++ = poseverts[i][vertexorder[j]];
+}
+
 /*
 ================
 GL_MakeAliasModelDisplayLists
@@ -289,23 +512,40 @@ GL_MakeAliasModelDisplayLists
 */
 void GL_MakeAliasModelDisplayLists (model_t *m, aliashdr_t *hdr)
 {
+	int		i, numtris;
+
 	aliasmodel = m;
 	paliashdr = hdr;	// (aliashdr_t *)Mod_Extradata (m);
 
 	BuildTris ();		// trifans or lists
 
 	// save the data out
-
-	paliashdr->poseverts = numorder;
-
-	int* cmds = static_cast<int*>(Hunk_Alloc (numcommands * 4));
-	paliashdr->commands = (byte *)cmds - (byte *)paliashdr;
-	memcpy (cmds, commands, numcommands * 4);
-
-	trivertx_t* verts = static_cast<trivertx_t*>(Hunk_Alloc (paliashdr->numposes * paliashdr->poseverts 
-		* sizeof(trivertx_t) ));
-	paliashdr->posedata = (byte *)verts - (byte *)paliashdr;
-	for (int i=0 ; i<paliashdr->numposes ; i++)
-		for (int j=0 ; j<numorder ; j++)
-			*verts++ = poseverts[i][vertexorder[j]];
+	SaveLod (&paliashdr->lods[0]);
+	paliashdr->numlods = 1;
+	paliashdr->poseverts = paliashdr->lods[0].poseverts;
+	paliashdr->posedata = paliashdr->lods[0].posedata;
+	paliashdr->commands = paliashdr->lods[0].commands;
+
+	numtris = pheader->numtris;
+	if (numtris < ALIAS_LODMINTRIS)
+		return;
+
+	// each lod goes on from the last, BuildTris takes them from triangles
+	memcpy (lodtris, triangles, numtris * sizeof(mtriangle_t));
+	numlodtris = numtris;
+	for (i=0 ; i<numtris ; i++)
+		LodTriNormal (&lodtris[i], -1, -1, lodnormals[i]);
+	for (i=1 ; i<ALIAS_MAXLODS ; i++)
+	{
+		SimplifyTris ((int)(numtris * alias_lodtris[i]));
+		if (numlodtris >= paliashdr->lods[i-1].numtris)
+			break;		// nothing more would go
+
+		memcpy (triangles, lodtris, numlodtris * sizeof(mtriangle_t));
+		pheader->numtris = numlodtris;
+		BuildTris ();
+		SaveLod (&paliashdr->lods[i]);
+		paliashdr->numlods++;
+	}
+	pheader->numtris = numtris;
 }
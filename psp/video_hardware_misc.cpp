@@ -27,6 +27,7 @@ extern "C"
 {
 #include "../quakedef.h"
 }
+#include "clipping.hpp"
 
 void GL_InitTextureUsage ();
 
@@ -202,6 +203,11 @@ void R_Init (void)
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);	
 	Cmd_AddCommand ("envmap", R_Envmap_f);	
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);	
+	Cmd_AddCommand ("r_lightmapbench", R_LightmapBench_f);
+	Cmd_AddCommand ("r_lightstyles", R_Lightstyles_f);
+	Cmd_AddCommand ("r_aliasbench", R_AliasBench_f);
+	Cmd_AddCommand ("r_studiobench", R_StudioBench_f);
+	quake::clipping::init ();
 
 	Cvar_RegisterVariable (&r_norefresh);
 	Cvar_RegisterVariable (&r_lightmap);
@@ -212,6 +218,14 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_mirroralpha);
 	Cvar_RegisterVariable (&r_wateralpha);
 	Cvar_RegisterVariable (&r_dynamic);
+	Cvar_RegisterVariable (&r_lightmapdirty);
+	Cvar_RegisterVariable (&r_lightmapbudget);
+	Cvar_RegisterVariable (&r_lightmapnear);
+	Cvar_RegisterVariable (&r_worldbatch);
+	Cvar_RegisterVariable (&r_sortentities);
+	Cvar_RegisterVariable (&r_aliascache);
+	Cvar_RegisterVariable (&r_studiocache);
+	Cvar_RegisterVariable (&r_lodsize);
 	Cvar_RegisterVariable (&r_novis);
 	Cvar_RegisterVariable (&r_nocull);
 	Cvar_RegisterVariable (&r_speeds);
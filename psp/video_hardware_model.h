@@ -127,15 +127,19 @@ typedef struct glpoly_s
 	struct		glpoly_s	*chain;
 	int			numverts;
 	int			flags;		// for SURF_UNDERWATER
+	int			clipframe;	// clipping::frustum_id() needsclip was found for
+	qboolean	needsclip;
 
-	// This is a variable sized array, and hence must be the last element in
-	// this structure.
+	// For lit surfaces the array is (numverts * 2) in size. The first half
+	// are regular vertices, and the second half have copies of the first
+	// half's XYZs but keep the light map texture coordinates. This makes the
+	// vertices easier to render on the PSP.
 	//
-	// The array is (numverts * 2) in size. The first half are regular
-	// vertices, and the second half have copies of the first half's XYZs but
-	// keep the light map texture coordinates. This makes the vertices easier
-	// to render on the PSP.
-	glvert_t	verts[1];
+	// They live in a world vertex chunk starting at vertbase, so polys can
+	// be drawn together by index, or right after the poly when vertbase is
+	// NULL (warped surfaces).
+	glvert_t		*verts;
+	const glvert_t	*vertbase;
 } glpoly_t;
 
 typedef struct decal_s	decal_t;
@@ -168,6 +172,8 @@ typedef struct msurface_s
 	byte		styles[MAXLIGHTMAPS];
 	int			cached_light[MAXLIGHTMAPS];	// values currently used in lightmap
 	qboolean	cached_dlight;				// true if dynamic light in cache
+	byte		dlightrect[4];				// texels s0 t0 s1 t1 dynamic light reached in cache
+	int			lightdeferframe;			// frame a lightstyle rebuild was first put off, 0 for none
 	byte		*samples;		// [numstyles*surfsize]
 	decal_t		*pdecals;
 } msurface_t;
@@ -322,6 +328,16 @@ typedef struct mtriangle_s {
 } mtriangle_t;
 
 
+#define	ALIAS_MAXLODS	3		// the full mesh and two simplified ones
+
+// a mesh of the model, lods[0] is the full one
+typedef struct {
+	int			numtris;
+	int			poseverts;
+	int			posedata;	// numposes*poseverts trivert_t
+	int			commands;	// gl command list with embedded s/t
+} maliaslod_t;
+
 #define	MAX_SKINS	32
 typedef struct {
 	int			ident;
@@ -344,6 +360,8 @@ typedef struct {
 	int					poseverts;
 	int					posedata;	// numposes*poseverts trivert_t
 	int					commands;	// gl command list with embedded s/t
+	int					numlods;
+	maliaslod_t			lods[ALIAS_MAXLODS];
 	int					gl_texturenum[MAX_SKINS][4];
 	int					texels[MAX_SKINS];	// only for player skins
 	maliasframedesc_t	frames[1];	// variable sized
@@ -851,6 +851,7 @@ void SCR_UpdateScreen (void)
 			Draw_Character (scr_vrect.x + scr_vrect.width/2 - 4, scr_vrect.y + scr_vrect.height/2 - 4, '+');
 	
 		SCR_DrawFPS ();
+		S_StatsDraw ();
 		SCR_DrawPause ();
 		SCR_CheckDrawCenterString ();
 		Hud_Draw ();
@@ -66,7 +66,8 @@ int			allocated[MAX_LIGHTMAPS][BLOCK_WIDTH];
 
 // the lightmap texture data needs to be kept in
 // main memory so texsubimage can update properly
-byte		lightmaps[LIGHTMAP_BYTES*MAX_LIGHTMAPS*BLOCK_WIDTH*BLOCK_HEIGHT];
+// (word aligned, R_LightmapStore writes whole texels)
+byte		lightmaps[LIGHTMAP_BYTES*MAX_LIGHTMAPS*BLOCK_WIDTH*BLOCK_HEIGHT] __attribute__((aligned(16)));
 
 int 		lightmap_index[MAX_LIGHTMAPS];
 
@@ -85,84 +86,233 @@ void 	VID_SetPaletteTX();
 
 /*
 ===============
-R_AddDynamicLights
+R_LightmapScale, R_LightmapAccumulate, R_LightmapStore
+
+The inner loops of R_BuildLightMap.  They only see blocklights and the
+lightmap bytes, so r_lightmapbench can time them and check them against
+the plain loops.  count is in components, three a texel.  The first style
+is scaled straight into blocklights, which saves clearing it first.
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+static void R_LightmapScale (unsigned * __restrict bl, const byte * __restrict lm, int count, unsigned scale)
 {
-	int			lnum;
-	int			sd, td;
-	float		dist, rad, minlight;
-	vec3_t		impact, local;
-	int			s, t;
-	int			i;
-	int			smax, tmax;
+	for ( ; count >= 4 ; count -= 4, bl += 4, lm += 4)
+	{
+		bl[0] = lm[0] * scale;
+		bl[1] = lm[1] * scale;
+		bl[2] = lm[2] * scale;
+		bl[3] = lm[3] * scale;
+	}
+	for ( ; count ; count--)
+		*bl++ = *lm++ * scale;
+}
+
+static void R_LightmapAccumulate (unsigned * __restrict bl, const byte * __restrict lm, int count, unsigned scale)
+{
+	for ( ; count >= 4 ; count -= 4, bl += 4, lm += 4)
+	{
+		bl[0] += lm[0] * scale;
+		bl[1] += lm[1] * scale;
+		bl[2] += lm[2] * scale;
+		bl[3] += lm[3] * scale;
+	}
+	for ( ; count ; count--)
+		*bl++ += *lm++ * scale;
+}
+
+// bound and shift texels of 8.8 light into RGBA, a word at a time (little endian)
+static void R_LightmapStore (byte * __restrict dest, const unsigned * __restrict bl, int texels)
+{
+	unsigned	*out;
+	int			r, g, b;
+
+	out = (unsigned *)dest;
+	for ( ; texels ; texels--, bl += 3)
+	{
+		r = bl[0] >> 7;
+		g = bl[1] >> 7;
+		b = bl[2] >> 7;
+		r |= (255 - r) >> 31;		// all ones past 255
+		g |= (255 - g) >> 31;
+		b |= (255 - b) >> 31;
+		*out++ = (r & 255) | ((g & 255) << 8) | ((b & 255) << 16) | 0xff000000;
+	}
+}
+
+
+/*
+===============
+R_SetupDlight
+
+Where dl lands on surf and the texels s0 t0 s1 t1 (ends exclusive) it
+can reach.  A texel further than minlight along s or t is never lit, as
+the distance R_AddDynamicLights uses is at least the larger of the two.
+Returns false when the light misses the surface.
+===============
+*/
+typedef struct
+{
+	float	rad, minlight;
+	int		s, t;				// impact in lightmap units, 16 a texel
+	int		rect[4];
+} dlightsurf_t;
+
+static qboolean R_SetupDlight (msurface_t *surf, dlight_t *dl, dlightsurf_t *ds)
+{
+	float		dist;
+	vec3_t		impact;
+	float		local[2];
+	int			i, smax, tmax;
 	mtexinfo_t	*tex;
-	// LordHavoc: .lit support begin
-	float		cred, cgreen, cblue, brightness;
-	unsigned	*bl;
-    // LordHavoc: .lit support end
 
 	smax = (surf->extents[0]>>4)+1;
 	tmax = (surf->extents[1]>>4)+1;
 	tex = surf->texinfo;
 
+	ds->rad = dl->radius;
+	dist = DotProduct (dl->origin, surf->plane->normal) - surf->plane->dist;
+	#ifdef PSP_VFPU
+	ds->rad -= vfpu_fabsf(dist);
+	#else
+	ds->rad -= fabsf(dist);
+	#endif
+	ds->minlight = dl->minlight;
+	if (ds->rad < ds->minlight)
+		return qfalse;
+	ds->minlight = ds->rad - ds->minlight;
+
+	for (i=0 ; i<3 ; i++)
+		impact[i] = dl->origin[i] - surf->plane->normal[i]*dist;
+
+	local[0] = DotProduct (impact, tex->vecs[0]) + tex->vecs[0][3];
+	local[1] = DotProduct (impact, tex->vecs[1]) + tex->vecs[1][3];
+
+	local[0] -= surf->texturemins[0];
+	local[1] -= surf->texturemins[1];
+
+	ds->s = (int)local[0];
+	ds->t = (int)local[1];
+
+	ds->rect[0] = (int)floorf((ds->s - ds->minlight) / 16);
+	ds->rect[1] = (int)floorf((ds->t - ds->minlight) / 16);
+	ds->rect[2] = (int)floorf((ds->s + ds->minlight) / 16) + 1;
+	ds->rect[3] = (int)floorf((ds->t + ds->minlight) / 16) + 1;
+	if (ds->rect[0] < 0)
+		ds->rect[0] = 0;
+	if (ds->rect[1] < 0)
+		ds->rect[1] = 0;
+	if (ds->rect[2] > smax)
+		ds->rect[2] = smax;
+	if (ds->rect[3] > tmax)
+		ds->rect[3] = tmax;
+
+	return (ds->rect[0] < ds->rect[2] && ds->rect[1] < ds->rect[3]) ? qtrue : qfalse;
+}
+
+/*
+===============
+R_DynamicLightRect
+
+The texels of surf the dynamic lights of this frame can reach, empty
+when there are none
+===============
+*/
+static void R_DynamicLightRect (msurface_t *surf, int *rect)
+{
+	int				lnum;
+	dlightsurf_t	ds;
+
+	rect[0] = rect[1] = rect[2] = rect[3] = 0;
+	if (surf->dlightframe != r_framecount)
+		return;
+
 	for (lnum=0 ; lnum<MAX_DLIGHTS ; lnum++)
 	{
 		if ( !(surf->dlightbits & (1<<lnum) ) )
 			continue;		// not lit by this light
-
-		rad = cl_dlights[lnum].radius;
-		dist = DotProduct (cl_dlights[lnum].origin, surf->plane->normal) -
-				surf->plane->dist;
-		#ifdef PSP_VFPU
-		rad -= vfpu_fabsf(dist);
-		#else
-		rad -= fabsf(dist);
-		#endif
-		minlight = cl_dlights[lnum].minlight;
-		if (rad < minlight)
+		if (!R_SetupDlight (surf, &cl_dlights[lnum], &ds))
 			continue;
-		minlight = rad - minlight;
-
-		for (i=0 ; i<3 ; i++)
+		if (rect[0] >= rect[2])
 		{
-			impact[i] = cl_dlights[lnum].origin[i] -
-					surf->plane->normal[i]*dist;
+			rect[0] = ds.rect[0];
+			rect[1] = ds.rect[1];
+			rect[2] = ds.rect[2];
+			rect[3] = ds.rect[3];
+			continue;
 		}
+		if (ds.rect[0] < rect[0])
+			rect[0] = ds.rect[0];
+		if (ds.rect[1] < rect[1])
+			rect[1] = ds.rect[1];
+		if (ds.rect[2] > rect[2])
+			rect[2] = ds.rect[2];
+		if (ds.rect[3] > rect[3])
+			rect[3] = ds.rect[3];
+	}
+}
 
-		local[0] = DotProduct (impact, tex->vecs[0]) + tex->vecs[0][3];
-		local[1] = DotProduct (impact, tex->vecs[1]) + tex->vecs[1][3];
+/*
+===============
+R_AddDynamicLights
 
-		local[0] -= surf->texturemins[0];
-		local[1] -= surf->texturemins[1];
+Adds the dynamic lights to the texels of region in blocklights, which
+holds region alone, row after row
+===============
+*/
+void R_AddDynamicLights (msurface_t *surf, int *region)
+{
+	int				lnum;
+	int				sd, td;
+	float			dist;
+	int				s, t, s0, t0, s1, t1, w;
+	dlightsurf_t	ds;
+	// LordHavoc: .lit support begin
+	float		cred, cgreen, cblue, brightness;
+	unsigned	*bl;
+    // LordHavoc: .lit support end
+
+	w = region[2] - region[0];
+
+	for (lnum=0 ; lnum<MAX_DLIGHTS ; lnum++)
+	{
+		if ( !(surf->dlightbits & (1<<lnum) ) )
+			continue;		// not lit by this light
+		if (!R_SetupDlight (surf, &cl_dlights[lnum], &ds))
+			continue;
+
+		s0 = ds.rect[0] > region[0] ? ds.rect[0] : region[0];
+		t0 = ds.rect[1] > region[1] ? ds.rect[1] : region[1];
+		s1 = ds.rect[2] < region[2] ? ds.rect[2] : region[2];
+		t1 = ds.rect[3] < region[3] ? ds.rect[3] : region[3];
+		if (s0 >= s1 || t0 >= t1)
+			continue;
 
 		// LordHavoc: .lit support begin
-		bl = blocklights;
 		cred = cl_dlights[lnum].color[0] * 256.0f;
 		cgreen = cl_dlights[lnum].color[1] * 256.0f;
 		cblue = cl_dlights[lnum].color[2] * 256.0f;
         // LordHavoc: .lit support end
-		
-		for (t = 0 ; t<tmax ; t++)
+
+		for (t = t0 ; t<t1 ; t++)
 		{
-			td = ((int)local[1]) - t*16;
+			td = ds.t - t*16;
 			if (td < 0)
 				td = -td;
-			for (s=0 ; s<smax ; s++)
+			bl = blocklights + ((t - region[1])*w + s0 - region[0])*3;
+			for (s=s0 ; s<s1 ; s++)
 			{
-				sd = ((int)local[0]) - s*16;
+				sd = ds.s - s*16;
 				if (sd < 0)
 					sd = -sd;
 				if (sd > td)
 					dist = sd + (td>>1);
 				else
 					dist = td + (sd>>1);
-				if (dist < minlight)
+				if (dist < ds.minlight)
 				// LordHavoc: .lit support begin
 				//	blocklights[t*smax + s] += (rad - dist)*256; // LordHavoc: original code
 			    {
-					brightness = rad - dist;
+					brightness = ds.rad - dist;
 					bl[0] += (int) (brightness * cred);
 					bl[1] += (int) (brightness * cgreen);
 					bl[2] += (int) (brightness * cblue);
@@ -177,159 +327,660 @@ void R_AddDynamicLights (msurface_t *surf)
 
 /*
 ===============
-R_BuildLightMap
+R_BuildLightMapRegion
 
-Combine and scale multiple lightmaps into the 8.8 format in blocklights
+Combine and scale multiple lightmaps into the 8.8 format in blocklights,
+for the texels s0 t0 s1 t1 of region only.  dest is the first texel of
+the surface.
 ===============
 */
-void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+static void R_BuildLightMapRegion (msurface_t *surf, byte *dest, int stride, int *region)
 {
 	int			smax, tmax;
 	int			t;
-	int			i, j, size;
+	int			i, j, size, w, h, count;
 	byte		*lightmap;
 	unsigned	scale;
 	int			maps;
 	unsigned	*bl;
 
-	surf->cached_dlight = (surf->dlightframe == r_framecount) ? qtrue : qfalse;
-
 	smax = (surf->extents[0]>>4)+1;
 	tmax = (surf->extents[1]>>4)+1;
 	size = smax*tmax;
 	lightmap = surf->samples;
+	w = region[2] - region[0];
+	h = region[3] - region[1];
+	count = w*h;
 
 // set to full bright if no light data
 	if (r_fullbright.value || !cl.worldmodel->lightdata)
 	{
-		for (i=0 ; i<size ; i++)
-		{
-			blocklights[i*3+0] =
-			blocklights[i*3+1] =
-			blocklights[i*3+2] = 65280;
-        }
+		for (i=0 ; i<count*3 ; i++)
+			blocklights[i] = 65280;
 		goto store;
 	}
 
-// clear to no light
-	for (i=0 ; i<size ; i++)
-	{
-		blocklights[i*3+0] =
-		blocklights[i*3+1] =
-		blocklights[i*3+2] = 0;
-	}
-
-// add all the lightmaps
-	if (lightmap)
+// add all the lightmaps, the first one over no light
+	if (!lightmap || surf->styles[0] == 255)
+		memset (blocklights, 0, count*3*sizeof(*blocklights));
+	else
 	{
-		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++, lightmap += size*3)
 		{
 			scale = d_lightstylevalue[surf->styles[maps]];
 			surf->cached_light[maps] = scale;	// 8.8 fraction
 
-			bl = blocklights;
-			for (i=0 ; i<size ; i++) // LordHavoc: original code
+			if (w == smax)		// whole rows are one run
+			{
+				if (maps)
+					R_LightmapAccumulate (blocklights, lightmap + region[1]*smax*3, count*3, scale);
+				else
+					R_LightmapScale (blocklights, lightmap + region[1]*smax*3, count*3, scale);
+				continue;
+			}
+			for (t=0 ; t<h ; t++)
 			{
-				*bl++ += *lightmap++ * scale;
-				*bl++ += *lightmap++ * scale;
-				*bl++ += *lightmap++ * scale;
+				if (maps)
+					R_LightmapAccumulate (blocklights + t*w*3, lightmap + ((region[1] + t)*smax + region[0])*3, w*3, scale);
+				else
+					R_LightmapScale (blocklights + t*w*3, lightmap + ((region[1] + t)*smax + region[0])*3, w*3, scale);
 			}
 		}
-    }
+	}
 
 // add all the dynamic lights
 	if (surf->dlightframe == r_framecount)
-		R_AddDynamicLights (surf);
+		R_AddDynamicLights (surf, region);
 
 // bound, invert, and shift
 store:
+	dest += region[1]*stride + region[0]*LIGHTMAP_BYTES;
 	switch (LIGHTMAP_BYTES)
 	{
 	case 4:
-		stride -= (smax<<2);
+	case 3:
 		bl = blocklights;
-		for (i=0 ; i<tmax ; i++, dest += stride)
+		for (i=0 ; i<h ; i++, dest += stride, bl += w*3)
+			R_LightmapStore (dest, bl, w);
+		break;
+	case 2:
+	case 1:
+		bl = blocklights;
+		for (i=0 ; i<h ; i++ ,dest += stride)
 		{
-			for (j=0 ; j<smax ; j++)
+			for (j=0 ; j<w ; j++)
 			{
-				t = *bl++ >> 7;
-				if (t > 255)
-				    t = 255;
-				*dest++ = t;
-
-				t = *bl++ >> 7;
-				if (t > 255)
-				    t = 255;
-				*dest++ = t;
+				t = ((bl[0] + bl[1] + bl[2]) * 85) >> 15;
+				bl += 3;
 
-				t = *bl++ >> 7;
 				if (t > 255)
-				    t = 255;
-				*dest++ = t;
-
-				*dest++ = 255;
+					t = 255;
+				dest[j] = t;
 			}
 		}
 		break;
-	case 3:
-		stride -= (smax<<2);
-		bl = blocklights;
-		for (i=0 ; i<tmax ; i++, dest += stride)
+	default:
+		Sys_Error ("Bad lightmap format");
+	}
+}
+
+/*
+===============
+R_BuildLightMap
+
+Builds all of the surface's lightmap
+===============
+*/
+void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
+{
+	int		region[4], lit[4];
+	int		i;
+
+	surf->cached_dlight = (surf->dlightframe == r_framecount) ? qtrue : qfalse;
+	R_DynamicLightRect (surf, lit);
+	for (i=0 ; i<4 ; i++)
+		surf->dlightrect[i] = lit[i];
+
+	region[0] = region[1] = 0;
+	region[2] = (surf->extents[0]>>4)+1;
+	region[3] = (surf->extents[1]>>4)+1;
+	R_BuildLightMapRegion (surf, dest, stride, region);
+}
+
+
+/*
+===============
+R_MarkLightmapRect
+
+Grows the part of lightmap texture num that R_BlendLightmaps uploads
+===============
+*/
+static void R_MarkLightmapRect (int num, int l, int t, int w, int h)
+{
+	glRect_t	*theRect;
+	int			r, b;
+
+	lightmap_modified[num] = qtrue;
+	theRect = &lightmap_rectchange[num];
+	if (!theRect->w)
+	{
+		theRect->l = l;
+		theRect->t = t;
+		theRect->w = w;
+		theRect->h = h;
+		return;
+	}
+
+	r = theRect->l + theRect->w;
+	b = theRect->t + theRect->h;
+	if (l + w > r)
+		r = l + w;
+	if (t + h > b)
+		b = t + h;
+	if (l < theRect->l)
+		theRect->l = l;
+	if (t < theRect->t)
+		theRect->t = t;
+	theRect->w = r - theRect->l;
+	theRect->h = b - theRect->t;
+}
+
+/*
+===============
+R_LightmapStylesMoved
+
+True when one of fa's lightstyles is not what its lightmap was built with
+===============
+*/
+static qboolean R_LightmapStylesMoved (msurface_t *fa)
+{
+	int		maps;
+
+	for (maps = 0 ; maps < MAXLIGHTMAPS && fa->styles[maps] != 255 ;
+		 maps++)
+		if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
+			return qtrue;
+	return qfalse;
+}
+
+/*
+===============
+R_RebuildLightmap
+
+Rebuilds what changed in fa's lightmap since it was built: all of it
+when one of its lightstyles moved, otherwise only the texels under the
+dynamic lights of this frame and those lit the last time, which go back
+to the static light.  r_lightmapdirty 0 always rebuilds all of it.
+===============
+*/
+static void R_RebuildLightmap (msurface_t *fa, qboolean styles)
+{
+	int		i;
+	int		region[4], lit[4];
+	byte	*base;
+
+	R_DynamicLightRect (fa, lit);
+	if (styles || !r_lightmapdirty.value)
+	{
+		region[0] = region[1] = 0;
+		region[2] = (fa->extents[0]>>4)+1;
+		region[3] = (fa->extents[1]>>4)+1;
+	}
+	else if (fa->dlightrect[0] >= fa->dlightrect[2])
+	{
+		for (i=0 ; i<4 ; i++)
+			region[i] = lit[i];
+	}
+	else
+	{
+		for (i=0 ; i<4 ; i++)
+			region[i] = fa->dlightrect[i];
+		if (lit[0] < lit[2])
+		{
+			if (lit[0] < region[0])
+				region[0] = lit[0];
+			if (lit[1] < region[1])
+				region[1] = lit[1];
+			if (lit[2] > region[2])
+				region[2] = lit[2];
+			if (lit[3] > region[3])
+				region[3] = lit[3];
+		}
+	}
+
+	fa->cached_dlight = (fa->dlightframe == r_framecount) ? qtrue : qfalse;
+	fa->lightdeferframe = 0;
+	for (i=0 ; i<4 ; i++)
+		fa->dlightrect[i] = lit[i];
+	if (region[0] >= region[2] || region[1] >= region[3])
+		return;		// the lights never reached a texel
+
+	c_lightmap_surfaces++;
+	c_lightmap_texels += (region[2] - region[0]) * (region[3] - region[1]);
+
+	R_MarkLightmapRect (fa->lightmaptexturenum, fa->light_s + region[0], fa->light_t + region[1],
+		region[2] - region[0], region[3] - region[1]);
+	base = lightmaps + fa->lightmaptexturenum*LIGHTMAP_BYTES*BLOCK_WIDTH*BLOCK_HEIGHT;
+	base += fa->light_t * BLOCK_WIDTH * LIGHTMAP_BYTES + fa->light_s * LIGHTMAP_BYTES;
+	R_BuildLightMapRegion (fa, base, BLOCK_WIDTH*LIGHTMAP_BYTES, region);
+}
+
+
+/*
+=============================================================================
+
+LIGHTSTYLE SCHEDULING
+
+A surface whose lightstyles moved is rebuilt when it is drawn.  Past
+r_lightmapnear units from the view those rebuilds share r_lightmapbudget
+texels a frame, and a surface that doesn't fit keeps its old light for up
+to LIGHTMAP_MAXDEFER frames.  Surfaces under a dynamic light are never
+put off.  GL_BuildLightmaps lists the surfaces of every style, and what
+is left of the budget goes to the offscreen surfaces of styles that were
+switched and then hold, like a light on a button, so they don't all come
+due in the frame they are seen.
+
+=============================================================================
+*/
+
+#define	LIGHTMAP_MAXDEFER	4		// frames
+
+typedef struct
+{
+	msurface_t	**surfaces;
+	int			numsurfaces;
+	int			texels;
+	int			cursor;			// next surface to refresh, numsurfaces when done
+	int			value;			// d_lightstylevalue the refresh is for
+} lightstylesurfs_t;
+
+static lightstylesurfs_t	lightstyle_surfs[MAX_LIGHTSTYLES];
+static int		lightmap_budget;		// far texels left this frame
+
+int		c_lightmap_surfaces, c_lightmap_texels, c_lightmap_deferred, c_lightmap_bytes;
+
+/*
+===============
+R_LightmapDue
+
+Whether a lightstyle rebuild of fa goes ahead this frame
+===============
+*/
+static qboolean R_LightmapDue (msurface_t *fa)
+{
+	int		texels;
+	vec3_t	delta;
+
+	if (!r_lightmapbudget.value)
+		return qtrue;
+
+// verts of brush entities are in model space, and so is modelorg
+	VectorSubtract (fa->polys->verts[0].xyz, modelorg, delta);
+	if (DotProduct (delta, delta) < r_lightmapnear.value * r_lightmapnear.value)
+		return qtrue;
+
+	texels = ((fa->extents[0]>>4)+1) * ((fa->extents[1]>>4)+1);
+	if (texels <= lightmap_budget
+		|| (fa->lightdeferframe && r_framecount - fa->lightdeferframe >= LIGHTMAP_MAXDEFER))
+	{
+		lightmap_budget -= texels;
+		return qtrue;
+	}
+
+	if (!fa->lightdeferframe)
+		fa->lightdeferframe = r_framecount;
+	return qfalse;
+}
+
+/*
+===============
+R_UpdateLightmap
+
+Called for every lightmapped surface drawn
+===============
+*/
+static void R_UpdateLightmap (msurface_t *fa)
+{
+	qboolean	styles;
+
+	styles = R_LightmapStylesMoved (fa);
+	if (!styles)
+		fa->lightdeferframe = 0;	// the style came back to what was built
+	if (!styles && fa->dlightframe != r_framecount	// not dynamic this frame
+		&& !fa->cached_dlight)			// nor previously
+		return;
+	if (!r_dynamic.value)
+		return;
+
+	if (styles && fa->dlightframe != r_framecount && !fa->cached_dlight
+		&& !R_LightmapDue (fa))
+	{
+		c_lightmap_deferred++;
+		return;
+	}
+
+	R_RebuildLightmap (fa, styles);
+}
+
+/*
+===============
+R_StartLightmaps
+
+Clears the counters and fills the budget for a frame
+===============
+*/
+static void R_StartLightmaps (void)
+{
+	c_lightmap_surfaces = c_lightmap_texels = c_lightmap_deferred = c_lightmap_bytes = 0;
+	lightmap_budget = r_lightmapbudget.value;
+}
+
+/*
+===============
+R_RefreshLightstyles
+
+Spends what is left of the budget on surfaces out of view whose style
+was switched, after the drawn ones have had theirs.  Styles that animate
+are left alone, they would have moved again before the surface is seen.
+===============
+*/
+static void R_RefreshLightstyles (void)
+{
+	int					j;
+	msurface_t			*fa;
+	lightstylesurfs_t	*ls;
+
+	if (!r_lightmapbudget.value || !r_dynamic.value)
+		return;
+
+	for (j=0, ls=lightstyle_surfs ; j<MAX_LIGHTSTYLES ; j++, ls++)
+	{
+		if (ls->value != d_lightstylevalue[j])
+		{
+			ls->value = d_lightstylevalue[j];
+			ls->cursor = cl_lightstyle[j].length > 1 ? ls->numsurfaces : 0;
+		}
+
+		for ( ; ls->cursor < ls->numsurfaces && lightmap_budget > 0 ; ls->cursor++)
 		{
-			for (j=0 ; j<smax ; j++)
+			fa = ls->surfaces[ls->cursor];
+			if (fa->visframe == r_framecount)
+				continue;		// drawn, R_UpdateLightmap had it
+			if (!R_LightmapStylesMoved (fa))
 			{
-				t = *bl++ >> 7;
-				if (t > 255)
-				    t = 255;
-				*dest++ = t;
-				
-				t = *bl++ >> 7;
-				if (t > 255)
-				    t = 255;
-				*dest++ = t;
-				
-				t = *bl++ >> 7;
-				if (t > 255)
-				    t = 255;
-				*dest++ = t;
+				fa->lightdeferframe = 0;
+				continue;
+			}
+			lightmap_budget -= ((fa->extents[0]>>4)+1) * ((fa->extents[1]>>4)+1);
+			R_RebuildLightmap (fa, qtrue);
+		}
+	}
+}
 
-				*dest++ = 255;
+/*
+===============
+R_BuildLightstyleLists
+
+Lists the lightmapped surfaces of every lightstyle, for
+R_RefreshLightstyles and r_lightstyles
+===============
+*/
+static void R_BuildLightstyleLists (void)
+{
+	int					i, j, k, maps, total;
+	model_t				*m;
+	msurface_t			*surf, **list;
+	lightstylesurfs_t	*ls;
+
+	memset (lightstyle_surfs, 0, sizeof(lightstyle_surfs));
+
+	// count, then fill
+	for (k=0 ; k<2 ; k++)
+	{
+		if (k)
+		{
+			for (i=0, total=0 ; i<MAX_LIGHTSTYLES ; i++)
+				total += lightstyle_surfs[i].numsurfaces;
+			list = (msurface_t **)Hunk_AllocName (total * sizeof(*list), "lightstyles");
+			for (i=0, ls=lightstyle_surfs ; i<MAX_LIGHTSTYLES ; i++, ls++)
+			{
+				ls->surfaces = list;
+				list += ls->numsurfaces;
+				ls->cursor = ls->numsurfaces;
+				ls->value = d_lightstylevalue[i];
+				ls->numsurfaces = ls->texels = 0;
 			}
 		}
-		break;
-	case 2:
-		bl = blocklights;
-		for (i=0 ; i<tmax ; i++ ,dest += stride)
+
+		for (j=1 ; j<MAX_MODELS ; j++)
 		{
-			for (j=0 ; j<smax ; j++)
+			m = cl.model_precache[j];
+			if (!m)
+				break;
+			if (m->name[0] == '*')
+				continue;
+			for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
 			{
-				t = ((bl[0] + bl[1] + bl[2]) * 85) >> 15; 
-				bl += 3;
-				
-				if (t > 255)
-					t = 255;
-				dest[j] = t;
+				if ((surf->flags & SURF_DRAWTILED) || !surf->samples)
+					continue;
+				for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
+				{
+					if (surf->styles[maps] >= MAX_LIGHTSTYLES)
+						continue;
+					ls = &lightstyle_surfs[surf->styles[maps]];
+					if (k)
+					{
+						ls->surfaces[ls->numsurfaces] = surf;
+						ls->texels += ((surf->extents[0]>>4)+1) * ((surf->extents[1]>>4)+1);
+					}
+					ls->numsurfaces++;
+				}
 			}
 		}
-		break;
-	case 1:
-		bl = blocklights;
-		for (i=0 ; i<tmax ; i++ ,dest += stride)
+	}
+}
+
+/*
+===============
+R_Lightstyles_f
+
+r_lightstyles : the surfaces and texels each lightstyle of the map
+drives, and what the last frame rebuilt
+===============
+*/
+void R_Lightstyles_f (void)
+{
+	int					j;
+	lightstylesurfs_t	*ls;
+
+	for (j=0, ls=lightstyle_surfs ; j<MAX_LIGHTSTYLES ; j++, ls++)
+	{
+		if (!ls->numsurfaces)
+			continue;
+		Con_Printf ("%2i: %5i surfaces %7i texels %s\n", j, ls->numsurfaces, ls->texels,
+			cl_lightstyle[j].length > 1 ? "animated" : "");
+	}
+	Con_Printf ("last frame: %i lightmaps rebuilt, %i texels, %i put off, %i bytes uploaded\n",
+		c_lightmap_surfaces, c_lightmap_texels, c_lightmap_deferred, c_lightmap_bytes);
+}
+
+
+/*
+===============
+R_LightmapBench_f
+
+r_lightmapbench [passes] : builds the lightmap of every world surface
+with the plain loops R_BuildLightMap used to have and with the kernels,
+checks they agree, and times both along with rebuilding only the texels
+a 200 unit light 48 units in front of each surface would reach.  The
+dynamic lights of the frame are left out.
+===============
+*/
+void R_LightmapBench_f (void)
+{
+	msurface_t		*surf;
+	byte			*ref, *out, *dest, *lightmap;
+	unsigned		*bl;
+	unsigned		scale;
+	int				passes, pass, i, j, k, t, smax, tmax, size, maps;
+	int				surfaces, texels, dirtytexels, mismatches, offset;
+	int				region[4];
+	double			start, time[3];
+	vec3_t			center;
+	dlight_t		dl;
+	dlightsurf_t	ds;
+	glpoly_t		*p;
+
+	if (!cl.worldmodel || !cl.worldmodel->lightdata || r_fullbright.value)
+	{
+		Con_Printf ("r_lightmapbench needs a lit map and r_fullbright 0\n");
+		return;
+	}
+	passes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10;
+	if (passes < 1)
+		passes = 1;
+
+	surfaces = texels = 0;
+	for (i=0, surf=cl.worldmodel->surfaces ; i<cl.worldmodel->numsurfaces ; i++, surf++)
+	{
+		if ((surf->flags & SURF_DRAWTILED) || !surf->samples || !surf->polys)
+			continue;
+		surfaces++;
+		texels += ((surf->extents[0]>>4)+1) * ((surf->extents[1]>>4)+1);
+	}
+
+	ref = (byte *)malloc (texels*4);
+	out = (byte *)malloc (texels*4);
+	if (!ref || !out)
+	{
+		Con_Printf ("couldn't allocate %i texels\n", texels*2);
+		free (ref);
+		free (out);
+		return;
+	}
+
+	r_framecount++;		// no surface has dynamic lights this frame
+
+	// the plain loops
+	start = Sys_FloatTime ();
+	for (pass=0 ; pass<passes ; pass++)
+	{
+		offset = 0;
+		for (i=0, surf=cl.worldmodel->surfaces ; i<cl.worldmodel->numsurfaces ; i++, surf++)
 		{
-			for (j=0 ; j<smax ; j++)
+			if ((surf->flags & SURF_DRAWTILED) || !surf->samples || !surf->polys)
+				continue;
+			smax = (surf->extents[0]>>4)+1;
+			tmax = (surf->extents[1]>>4)+1;
+			size = smax*tmax;
+
+			for (j=0 ; j<size*3 ; j++)
+				blocklights[j] = 0;
+			lightmap = surf->samples;
+			for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ; maps++)
 			{
-				t = ((bl[0] + bl[1] + bl[2]) * 85) >> 15; 
-				bl += 3;
-				
-				if (t > 255)
-					t = 255;
-				dest[j] = t;
+				scale = d_lightstylevalue[surf->styles[maps]];
+				bl = blocklights;
+				for (j=0 ; j<size ; j++)
+				{
+					*bl++ += *lightmap++ * scale;
+					*bl++ += *lightmap++ * scale;
+					*bl++ += *lightmap++ * scale;
+				}
+			}
+
+			dest = ref + offset*4;
+			bl = blocklights;
+			for (j=0 ; j<size ; j++)
+			{
+				for (k=0 ; k<3 ; k++)
+				{
+					t = *bl++ >> 7;
+					if (t > 255)
+						t = 255;
+					*dest++ = t;
+				}
+				*dest++ = 255;
 			}
+			offset += size;
 		}
-		break;
-	default:
-		Sys_Error ("Bad lightmap format");
 	}
+	time[0] = Sys_FloatTime () - start;
+
+	// the kernels, all of each surface
+	start = Sys_FloatTime ();
+	for (pass=0 ; pass<passes ; pass++)
+	{
+		offset = 0;
+		for (i=0, surf=cl.worldmodel->surfaces ; i<cl.worldmodel->numsurfaces ; i++, surf++)
+		{
+			if ((surf->flags & SURF_DRAWTILED) || !surf->samples || !surf->polys)
+				continue;
+			region[0] = region[1] = 0;
+			region[2] = (surf->extents[0]>>4)+1;
+			region[3] = (surf->extents[1]>>4)+1;
+			R_BuildLightMapRegion (surf, out + offset*4, region[2]*4, region);
+			offset += region[2]*region[3];
+		}
+	}
+	time[1] = Sys_FloatTime () - start;
+
+	mismatches = 0;
+	for (i=0 ; i<texels*4 ; i++)
+		if (ref[i] != out[i])
+			mismatches++;
+
+	// only what a light in front of the surface reaches
+	memset (&dl, 0, sizeof(dl));
+	dl.radius = 200;
+	dl.color[0] = dl.color[1] = dl.color[2] = 1;
+	dirtytexels = 0;
+	time[2] = 0;
+	offset = 0;
+	for (i=0, surf=cl.worldmodel->surfaces ; i<cl.worldmodel->numsurfaces ; i++, surf++)
+	{
+		if ((surf->flags & SURF_DRAWTILED) || !surf->samples || !surf->polys)
+			continue;
+		smax = (surf->extents[0]>>4)+1;
+		tmax = (surf->extents[1]>>4)+1;
+
+		p = surf->polys;
+		center[0] = center[1] = center[2] = 0;
+		for (j=0 ; j<p->numverts ; j++)
+			VectorAdd (center, p->verts[j].xyz, center);
+		VectorScale (center, 1.0f / p->numverts, center);
+		VectorMA (center, (surf->flags & SURF_PLANEBACK) ? -48 : 48, surf->plane->normal, dl.origin);
+
+		if (R_SetupDlight (surf, &dl, &ds))
+		{
+			dirtytexels += (ds.rect[2] - ds.rect[0]) * (ds.rect[3] - ds.rect[1]);
+			start = Sys_FloatTime ();
+			for (pass=0 ; pass<passes ; pass++)
+				R_BuildLightMapRegion (surf, out + offset*4, smax*4, ds.rect);
+			time[2] += Sys_FloatTime () - start;
+		}
+		offset += smax*tmax;
+	}
+
+	r_framecount--;
+
+	// the lightmaps were built with the styles of now, not what is in the
+	// textures, so have every surface rebuilt when it is next drawn
+	for (i=0, surf=cl.worldmodel->surfaces ; i<cl.worldmodel->numsurfaces ; i++, surf++)
+		surf->cached_light[0] = -1;
+
+	Con_Printf ("%i surfaces, %i texels, %i passes\n", surfaces, texels, passes);
+	Con_Printf ("plain loops %7.3f ms a pass\n", time[0] * 1000 / passes);
+	Con_Printf ("kernels     %7.3f ms a pass\n", time[1] * 1000 / passes);
+	Con_Printf ("under light %7.3f ms a pass, %i texels (%.0f%%)\n", time[2] * 1000 / passes,
+		dirtytexels, texels ? 100.0f * dirtytexels / texels : 0);
+	if (mismatches)
+		Con_Printf ("MISMATCH: %i of %i bytes differ from the plain loops\n", mismatches, texels*4);
+	else
+		Con_Printf ("kernels match the plain loops\n");
+
+	free (ref);
+	free (out);
 }
 
 
@@ -384,6 +1035,153 @@ extern	int		alphaskytexture;
 extern	float	speedscale;		// for top sky and bottom sky
 
 
+int		c_clip_tested, c_clip_kept;
+
+/*
+================
+R_PolyNeedsClipping
+
+Tests p against the clipping frustum once for all the passes that draw
+it, and not at all when R_PolyInsideFrustum knew it was inside
+================
+*/
+static inline qboolean R_PolyNeedsClipping (glpoly_t *p, const glvert_t *vertices)
+{
+	const int id = clipping::frustum_id();
+
+	if (p->clipframe != id)
+	{
+		p->clipframe = id;
+		p->needsclip = clipping::is_clipping_required(vertices, p->numverts) ? qtrue : qfalse;
+		c_clip_tested++;
+	}
+	else
+		c_clip_kept++;
+	return p->needsclip;
+}
+
+/*
+================
+R_PolyInsideFrustum
+
+For polys whose node or model box is inside the frustum
+================
+*/
+static inline void R_PolyInsideFrustum (glpoly_t *p)
+{
+	if (!p)
+		return;
+	p->clipframe = clipping::frustum_id();
+	p->needsclip = qfalse;
+}
+
+/*
+=============================================================================
+
+  WORLD BATCHES
+
+GL_BuildLightmaps lays the verts of the polys of every unwarped surface
+out model by model and texture by texture, in chunks a 16 bit index can
+reach.  Drawn polys that need no clipping are added to the batch as
+triangles indexing their chunk, and a batch goes to the GE as one draw
+when the texture or chunk changes or it is ended, so a texture chain or
+a lightmap chain is mostly a single draw.  Polys that need clipping are
+drawn on their own as before.  r_worldbatch 0 draws every poly on its
+own, to compare.
+
+=============================================================================
+*/
+
+#define	CHUNK_VERTS			65536		// what a 16 bit index reaches
+#define	BATCH_MAXINDICES	12288
+
+static const glvert_t	*batch_base;		// chunk the indices are into
+static int				batch_numindices;
+static unsigned short	batch_indices[BATCH_MAXINDICES];
+static qboolean			batching;
+
+int		c_brush_draws, c_binds;
+
+/*
+================
+R_FlushBatch
+
+Draws what has been batched with the texture that is bound
+================
+*/
+static void R_FlushBatch (void)
+{
+	unsigned short	*indices;
+
+	if (!batch_numindices)
+		return;
+
+	indices = static_cast<unsigned short*>(sceGuGetMemory (batch_numindices * sizeof(unsigned short)));
+	memcpy (indices, batch_indices, batch_numindices * sizeof(unsigned short));
+	sceGuDrawArray (GU_TRIANGLES, GU_INDEX_16BIT | GU_TEXTURE_32BITF | GU_VERTEX_32BITF,
+		batch_numindices, indices, batch_base);
+	c_brush_draws++;
+	batch_numindices = 0;
+}
+
+/*
+================
+R_BeginBatch
+
+Until R_EndBatch the polys R_DrawWorldPoly and R_DrawWorldPolyLM are
+given may be put off, so the caller mustn't change the GE state in
+between without flushing
+================
+*/
+static void R_BeginBatch (void)
+{
+	batching = r_worldbatch.value ? qtrue : qfalse;
+}
+
+/*
+================
+R_EndBatch
+================
+*/
+static void R_EndBatch (void)
+{
+	R_FlushBatch ();
+	batching = qfalse;
+}
+
+/*
+================
+R_BatchPoly
+
+Adds the fan of p starting first verts into its chunk as triangles
+================
+*/
+static void R_BatchPoly (glpoly_t *p, int first)
+{
+	int				i, index, count;
+	unsigned short	*out;
+
+	if (p->numverts < 3)
+		return;
+
+	count = (p->numverts - 2) * 3;
+	if (p->vertbase != batch_base || batch_numindices + count > BATCH_MAXINDICES)
+	{
+		R_FlushBatch ();
+		batch_base = p->vertbase;
+	}
+
+	index = (p->verts - p->vertbase) + first;
+	out = batch_indices + batch_numindices;
+	for (i=2 ; i<p->numverts ; i++)
+	{
+		*out++ = index;
+		*out++ = index + i - 1;
+		*out++ = index + i;
+	}
+	batch_numindices += count;
+}
+
 static inline void DrawGLPolyLM (glpoly_t *p)
 {
 	// Does this poly need clipped?
@@ -392,9 +1190,7 @@ static inline void DrawGLPolyLM (glpoly_t *p)
 	const int				unclipped_vertex_count	= p->numverts;
 	const glvert_t* const	unclipped_vertices		= &(p->verts[p->numverts]);
 	
-	if (clipping::is_clipping_required(
-		unclipped_vertices,
-		unclipped_vertex_count))
+	if (R_PolyNeedsClipping (p, unclipped_vertices))
 	{
 		// Clip the polygon.
 		const glvert_t*	clipped_vertices;
@@ -418,6 +1214,7 @@ static inline void DrawGLPolyLM (glpoly_t *p)
 				GU_TRIANGLE_FAN,
 				GU_TEXTURE_32BITF | GU_VERTEX_32BITF ,
 				clipped_vertex_count, 0, display_list_vertices);
+			c_brush_draws++;
 		}
 	}
 	else
@@ -428,6 +1225,7 @@ static inline void DrawGLPolyLM (glpoly_t *p)
 			GU_TRIANGLE_FAN,
 			GU_TEXTURE_32BITF | GU_VERTEX_32BITF ,
 			unclipped_vertex_count, 0, unclipped_vertices);
+		c_brush_draws++;
 	}
 }
 
@@ -436,9 +1234,7 @@ static inline void DrawGLPoly (glpoly_t *p)
 	// Does this poly need clipped?
 	const int				unclipped_vertex_count	= p->numverts;
 	const glvert_t* const	unclipped_vertices		= p->verts;
-	if (clipping::is_clipping_required(
-		unclipped_vertices,
-		unclipped_vertex_count))
+	if (R_PolyNeedsClipping (p, unclipped_vertices))
 	{
 		// Clip the polygon.
 		const glvert_t*	clipped_vertices;
@@ -462,6 +1258,7 @@ static inline void DrawGLPoly (glpoly_t *p)
 				GU_TRIANGLE_FAN,
 				GU_TEXTURE_32BITF | GU_VERTEX_32BITF,
 				clipped_vertex_count, 0, display_list_vertices);
+			c_brush_draws++;
 		}
 	}
 	else
@@ -471,18 +1268,45 @@ static inline void DrawGLPoly (glpoly_t *p)
 			GU_TRIANGLE_FAN,
 			GU_TEXTURE_32BITF | GU_VERTEX_32BITF,
 			unclipped_vertex_count, 0, unclipped_vertices);
+		c_brush_draws++;
 	}
 }
 
+/*
+================
+R_DrawWorldPoly
+
+Batches p when it can be, else draws it
+================
+*/
+static inline void R_DrawWorldPoly (glpoly_t *p)
+{
+	if (batching && p->vertbase && !R_PolyNeedsClipping (p, p->verts))
+		R_BatchPoly (p, 0);
+	else
+		DrawGLPoly (p);
+}
+
+/*
+================
+R_DrawWorldPolyLM
+================
+*/
+static inline void R_DrawWorldPolyLM (glpoly_t *p)
+{
+	if (batching && p->vertbase && !R_PolyNeedsClipping (p, &p->verts[p->numverts]))
+		R_BatchPoly (p, p->numverts);
+	else
+		DrawGLPolyLM (p);
+}
+
 static inline void DrawTrisPoly (glpoly_t *p) //Crow_bar
 {
     sceGuDisable(GU_TEXTURE_2D);
 	// Does this poly need clipped?
 	const int				unclipped_vertex_count	= p->numverts;
 	const glvert_t* const	unclipped_vertices		= p->verts;
-	if (clipping::is_clipping_required(
-		unclipped_vertices,
-		unclipped_vertex_count))
+	if (R_PolyNeedsClipping (p, unclipped_vertices))
 	{
 		// Clip the polygon.
 		const glvert_t*	clipped_vertices;
@@ -581,6 +1405,7 @@ static void R_BlendLightmaps (void)
 {
 	int			 i;
 	glpoly_t	*p;
+	glRect_t	*theRect;
 
 	if (r_fullbright.value)
 		return;
@@ -605,30 +1430,35 @@ static void R_BlendLightmaps (void)
 		if (!p)
 			continue;
 		
-		char lm_name[16];
 		if (lightmap_modified[i])
 		{
+			// every surface rebuilt in this texture this frame goes up at once,
+			// and only the rows and columns they cover
+			theRect = &lightmap_rectchange[i];
+			c_lightmap_bytes += theRect->w * theRect->h * LIGHTMAP_BYTES;
+			GL_UpdateTextureLM (lightmap_index[i], lightmaps+(i*BLOCK_WIDTH*BLOCK_HEIGHT*LIGHTMAP_BYTES),
+				theRect->l, theRect->t, theRect->w, theRect->h, LIGHTMAP_BYTES);
+
 			lightmap_modified[i] = qfalse;
-			lightmap_rectchange[i].l = BLOCK_WIDTH;
-			lightmap_rectchange[i].t = BLOCK_HEIGHT;
-			lightmap_rectchange[i].w = 0;
-			lightmap_rectchange[i].h = 0;
-			
-			sprintf(lm_name,"lightmap%d",i);
-			lightmap_index[i] = GL_LoadTextureLM (lm_name, BLOCK_WIDTH, BLOCK_HEIGHT, lightmaps+(i*BLOCK_WIDTH*BLOCK_HEIGHT*LIGHTMAP_BYTES), LIGHTMAP_BYTES, GU_LINEAR, qtrue);
+			theRect->l = BLOCK_WIDTH;
+			theRect->t = BLOCK_HEIGHT;
+			theRect->w = 0;
+			theRect->h = 0;
 		}
 		GL_BindLM (lightmap_index[i]);
+		R_BeginBatch ();
 		for ( ; p ; p=p->chain)
 		{
 			if (p->flags & SURF_UNDERWATER) {
-				DrawGLPolyLM(p);
+				R_DrawWorldPolyLM(p);
 				//DrawGLWaterPolyLightmap (p);
 			}
 			else 
 			{
-				DrawGLPolyLM(p);
+				R_DrawWorldPolyLM(p);
 			}
 		}
+		R_EndBatch ();
 	}
 	
 	if (LIGHTMAP_BYTES == 1)	
@@ -650,10 +1480,6 @@ R_RenderBrushPoly
 void R_RenderBrushPoly (msurface_t *fa)
 {
 	texture_t	*t;
-	byte		*base;
-	int			maps;
-	glRect_t    *theRect;
-	int smax, tmax;
 
 	c_brush_polys++;
 	
@@ -668,11 +1494,14 @@ void R_RenderBrushPoly (msurface_t *fa)
 
 	if (fa->flags & SURF_DRAWSKY)
 	{	// warp texture, no lightmaps
+		R_FlushBatch ();
 		EmitBothSkyLayers (fa);
 		return;
 	}
 		
 	t = R_TextureAnimation (fa->texinfo->texture);
+	if (t->gl_texturenum != currenttexture)
+		R_FlushBatch ();	// drawn with the texture it was batched for
 	GL_Bind (t->gl_texturenum);
 
 	if (fa->flags & SURF_DRAWTURB)
@@ -688,7 +1517,7 @@ void R_RenderBrushPoly (msurface_t *fa)
 		if (fa->flags & SURF_UNDERWATER)
 			DrawGLWaterPoly (fa->polys);
 		else
-			DrawGLPoly (fa->polys);
+			R_DrawWorldPoly (fa->polys);
     }
 //Crow_bar Decals
 	//DrawSurfaceDecals(fa);
@@ -701,41 +1530,7 @@ void R_RenderBrushPoly (msurface_t *fa)
 	fa->polys->chain = lightmap_polys[fa->lightmaptexturenum];
 	lightmap_polys[fa->lightmaptexturenum] = fa->polys;
 
-	// check for lightmap modification
-	for (maps = 0 ; maps < MAXLIGHTMAPS && fa->styles[maps] != 255 ;
-		 maps++)
-		if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
-			goto dynamic;
-
-	if (fa->dlightframe == r_framecount	// dynamic this frame
-		|| fa->cached_dlight)			// dynamic previously
-	{
-dynamic:
-		if (r_dynamic.value)
-		{
-			lightmap_modified[fa->lightmaptexturenum] = qtrue;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t) {
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l) {
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
-			smax = (fa->extents[0]>>4)+1;
-			tmax = (fa->extents[1]>>4)+1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s-theRect->l)+smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t-theRect->t)+tmax;
-			base = lightmaps + fa->lightmaptexturenum*LIGHTMAP_BYTES*BLOCK_WIDTH*BLOCK_HEIGHT;
-			base += fa->light_t * BLOCK_WIDTH * LIGHTMAP_BYTES + fa->light_s * LIGHTMAP_BYTES;
-			R_BuildLightMap (fa, base, BLOCK_WIDTH*LIGHTMAP_BYTES);
-		}
-	}
+	R_UpdateLightmap (fa);
 }
 
 /*
@@ -746,11 +1541,6 @@ Multitexture
 */
 void R_RenderDynamicLightmaps (msurface_t *fa)
 {
-	byte		*base;
-	int			maps;
-	glRect_t    *theRect;
-	int smax, tmax;
-
 	c_brush_polys++;
 
 	if(r_showtris.value) //Crow_bar
@@ -768,41 +1558,7 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 	fa->polys->chain = lightmap_polys[fa->lightmaptexturenum];
 	lightmap_polys[fa->lightmaptexturenum] = fa->polys;
 
-	// check for lightmap modification
-	for (maps = 0 ; maps < MAXLIGHTMAPS && fa->styles[maps] != 255 ;
-		 maps++)
-		if (d_lightstylevalue[fa->styles[maps]] != fa->cached_light[maps])
-			goto dynamic;
-
-	if (fa->dlightframe == r_framecount	// dynamic this frame
-		|| fa->cached_dlight)			// dynamic previously
-	{
-dynamic:
-		if (r_dynamic.value)
-		{
-			lightmap_modified[fa->lightmaptexturenum] = qtrue;
-			theRect = &lightmap_rectchange[fa->lightmaptexturenum];
-			if (fa->light_t < theRect->t) {
-				if (theRect->h)
-					theRect->h += theRect->t - fa->light_t;
-				theRect->t = fa->light_t;
-			}
-			if (fa->light_s < theRect->l) {
-				if (theRect->w)
-					theRect->w += theRect->l - fa->light_s;
-				theRect->l = fa->light_s;
-			}
-			smax = (fa->extents[0]>>4)+1;
-			tmax = (fa->extents[1]>>4)+1;
-			if ((theRect->w + theRect->l) < (fa->light_s + smax))
-				theRect->w = (fa->light_s-theRect->l)+smax;
-			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
-				theRect->h = (fa->light_t-theRect->t)+tmax;
-			base = lightmaps + fa->lightmaptexturenum*LIGHTMAP_BYTES*BLOCK_WIDTH*BLOCK_HEIGHT;
-			base += fa->light_t * BLOCK_WIDTH * LIGHTMAP_BYTES + fa->light_s * LIGHTMAP_BYTES;
-			R_BuildLightMap (fa, base, BLOCK_WIDTH*LIGHTMAP_BYTES);
-		}
-	}
+	R_UpdateLightmap (fa);
 }
 
 /*
@@ -948,8 +1704,10 @@ static void DrawTextureChains (void)
 		{
 			if ((s->flags & SURF_DRAWTURB) && r_wateralpha.value != 1.0)
 				continue;	// draw translucent water later
+			R_BeginBatch ();
 			for ( ; s ; s=s->texturechain)
 				R_RenderBrushPoly (s);
+			R_EndBatch ();
 		}
 
 		t->texturechain = NULL;
@@ -969,10 +1727,9 @@ void R_DrawBrushModel (entity_t *e)
 	float		dot;
 	mplane_t	*pplane;
 	model_t		*clmodel;
-	qboolean	rotated;
+	qboolean	rotated, inside;
 	
 	currententity = e;
-	currenttexture = -1;
 
 	clmodel = e->model;
 	VectorAdd (e->origin, clmodel->mins, mins);
@@ -994,6 +1751,19 @@ void R_DrawBrushModel (entity_t *e)
 	if (R_CullBox (mins, maxs) == 2)
 		return;
 
+	// a model well inside the frustum needs none of its polys clipped, the
+	// margin covers the lerped origin it is drawn at
+	inside = qfalse;
+	if (!rotated)
+	{
+		for (k=0 ; k<3 ; k++)
+		{
+			mins[k] -= 16;
+			maxs[k] += 16;
+		}
+		inside = (R_CullBox (mins, maxs) == 1) ? qtrue : qfalse;
+	}
+
 	memset (lightmap_polys, 0, sizeof(lightmap_polys));
 
 	VectorSubtract (r_refdef.vieworg, e->origin, modelorg);
@@ -1078,6 +1848,9 @@ void R_DrawBrushModel (entity_t *e)
 	// draw texture
 	//
 
+	// blended models keep drawing their polys in order
+	if (!ISADDITIVE(e) && !ISGLOW(e) && !ISTEXTURE(e))
+		R_BeginBatch ();
 	for (i=0 ; i<clmodel->nummodelsurfaces ; i++, psurf++)
 	{
 	// find which side of the node we are on
@@ -1089,9 +1862,12 @@ void R_DrawBrushModel (entity_t *e)
 		if (((psurf->flags & SURF_PLANEBACK) && (dot < -BACKFACE_EPSILON)) ||
 			(!(psurf->flags & SURF_PLANEBACK) && (dot > BACKFACE_EPSILON)))
 		{
+				if (inside)
+					R_PolyInsideFrustum (psurf->polys);
 				R_RenderBrushPoly (psurf);
 		}
 	}
+	R_EndBatch ();
 
     if (!ISADDITIVE(e))
     {
@@ -1255,6 +2031,10 @@ void R_RecursiveWorldNode (mnode_t *node, int cull)
 				if ( !(surf->flags & SURF_UNDERWATER) && ( (dot < 0) ^ !!(surf->flags & SURF_PLANEBACK)) )
 					continue;		// wrong side
 
+				// the node is inside the frustum, so no vertex can be outside
+				if (cull == 1)
+					R_PolyInsideFrustum (surf->polys);
+
 				// if sorting by texture, just store it out
 				/*if (gl_texsort.value)*/
 				{
@@ -1430,13 +2210,16 @@ void R_DrawWorld (void)
 	VectorCopy (r_refdef.vieworg, modelorg);
 
 	currententity = &ent;
-	currenttexture = -1;
+	GL_InvalidateTextureState ();
 
 	memset (lightmap_polys, 0, sizeof(lightmap_polys));
+	R_StartLightmaps ();
+	c_clip_tested = c_clip_kept = 0;
 
 	R_ClearSkyBox ();
 	R_RecursiveWorldNode (cl.worldmodel->nodes,3);
 	DrawTextureChains ();
+	R_RefreshLightstyles ();
 	R_BlendLightmaps ();
     if (skybox_name[0])
         R_DrawSkyBox ();
@@ -1595,6 +2378,40 @@ model_t		*currentmodel;
 
 int	nColinElim;
 
+static glvert_t	*chunk_base;
+static int		chunk_used, chunk_size;
+static int		chunk_left;		// verts the model still needs
+
+/*
+================
+R_ChunkVerts
+
+Where the next count verts of the model go, starting a new chunk when
+they wouldn't all be in reach of its first.  Taken by R_ChunkUsed.
+================
+*/
+static glvert_t *R_ChunkVerts (int count)
+{
+	if (!chunk_base || chunk_used + count > chunk_size)
+	{
+		chunk_size = chunk_left < CHUNK_VERTS ? chunk_left : CHUNK_VERTS;
+		chunk_base = static_cast<glvert_t*>(Hunk_AllocName (chunk_size * sizeof(glvert_t), "worldvrt"));
+		chunk_used = 0;
+	}
+	return chunk_base + chunk_used;
+}
+
+/*
+================
+R_ChunkUsed
+================
+*/
+static void R_ChunkUsed (int reserved, int count)
+{
+	chunk_used += count;
+	chunk_left -= reserved;
+}
+
 /*
 ================
 BuildSurfaceDisplayList
@@ -1617,7 +2434,9 @@ static void BuildSurfaceDisplayList (msurface_t *fa)
 	//
 	// draw texture
 	//
-	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t) + (lnumverts * 2 - 1) * sizeof(glvert_t)));
+	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t)));
+	poly->verts = R_ChunkVerts (lnumverts * 2);
+	poly->vertbase = chunk_base;
 	poly->next = fa->polys;
 	poly->flags = fa->flags;
 	fa->polys = poly;
@@ -1729,6 +2548,7 @@ static void BuildSurfaceDisplayList (msurface_t *fa)
 	}
 	
 	// Colinear point removal-end
+	R_ChunkUsed (fa->numedges * 2, lnumverts * 2);
 	poly->numverts = lnumverts;
 
 }
@@ -1767,8 +2587,9 @@ with all the surfaces from all brush models
 */
 void GL_BuildLightmaps (void)
 {
-	int		i, j;
-	model_t	*m;
+	int			i, j, k;
+	model_t		*m;
+	msurface_t	*surf;
 
 	memset (allocated, 0, sizeof(allocated));
 	
@@ -1788,6 +2609,8 @@ void GL_BuildLightmaps (void)
 			continue;
 		r_pcurrentvertbase = m->vertexes;
 		currentmodel = m;
+		chunk_base = NULL;
+		chunk_left = 0;
 		for (i=0 ; i<m->numsurfaces ; i++)
 		{
 //Crow_bar decals
@@ -1796,11 +2619,25 @@ void GL_BuildLightmaps (void)
 			m->surfaces[i].visframe = 0;
 
 			GL_CreateSurfaceLightmap (m->surfaces + i);
-			if ( m->surfaces[i].flags & SURF_DRAWTURB )
+			if ( m->surfaces[i].flags & (SURF_DRAWTURB | SURF_DRAWSKY) )
 				continue;
-			if ( m->surfaces[i].flags & SURF_DRAWSKY )
-				continue;
-			BuildSurfaceDisplayList (m->surfaces + i);
+			chunk_left += m->surfaces[i].numedges * 2;
+		}
+
+		// texture by texture, so a chain's verts are together, then
+		// the surfaces with a texture the model doesn't list
+		for (k=0 ; k<=m->numtextures ; k++)
+		{
+			for (i=0, surf=m->surfaces ; i<m->numsurfaces ; i++, surf++)
+			{
+				if (surf->flags & (SURF_DRAWTURB | SURF_DRAWSKY))
+					continue;
+				if (surf->polys)
+					continue;		// built
+				if (k < m->numtextures && surf->texinfo->texture != m->textures[k])
+					continue;
+				BuildSurfaceDisplayList (surf);
+			}
 		}
 	}
 
@@ -1822,5 +2659,7 @@ void GL_BuildLightmaps (void)
 		lightmap_index[i] = GL_LoadTextureLM (lm_name, BLOCK_WIDTH, BLOCK_HEIGHT, lightmaps+(i*BLOCK_WIDTH*BLOCK_HEIGHT*LIGHTMAP_BYTES), LIGHTMAP_BYTES, GU_LINEAR, qtrue);
 		
 	}
+
+	R_BuildLightstyleLists ();
 }
 
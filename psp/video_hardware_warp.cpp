@@ -135,7 +135,8 @@ static void SubdividePolygon (int numverts, float *verts)
 		return;
 	}
 
-	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t) + (numverts - 1) * sizeof(glvert_t)));
+	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t) + numverts * sizeof(glvert_t)));
+	poly->verts = reinterpret_cast<glvert_t*>(poly + 1);
 	poly->next = warpface->polys;
 	warpface->polys = poly;
 	poly->numverts = numverts;
@@ -222,7 +223,8 @@ void GL_Surface (msurface_t *fa)
 	}
 
 	//create the poly
-	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t) + (numverts - 1) * sizeof(glvert_t)));
+	poly = static_cast<glpoly_t*>(Hunk_Alloc (sizeof(glpoly_t) + numverts * sizeof(glvert_t)));
+	poly->verts = reinterpret_cast<glvert_t*>(poly + 1);
 	poly->next = NULL;
 	fa->polys = poly;
 	poly->numverts = numverts;
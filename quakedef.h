@@ -264,6 +264,7 @@ typedef struct
 
 #include "input.h"
 #include "world.h"
+#include "pmove.h"
 #include "keys.h"
 #include "console.h"
 #include "view.h"
@@ -29,13 +29,37 @@ int		ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int		ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int		ramp3[8] = {0x6d, 0x6b, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01};
 
-particle_t	*active_particles, *free_particles;
+/*
+Particles are kept by type, each type in its own bucket of parallel
+arrays, so the update runs one short branchless loop per field and type
+instead of a switch per particle.  Dead particles are removed by moving
+the bucket's last one into their place.  Buckets start small and double
+as effects need them, up to r_maxparticles live particles in all, which
+can be raised at any time.
+*/
+#define	PT_NUMTYPES			(pt_blob2+1)
+#define	PART_BUCKETSTART	256
+#define	PART_FLOATS			8			// x y z vx vy vz ramp die
+
+typedef struct
+{
+	float	*x, *y, *z;
+	float	*vx, *vy, *vz;
+	float	*ramp;
+	float	*die;
+	byte	*color;
+	int		count;
+	int		max;
+} partbucket_t;
 
-particle_t	*particles;
-int			r_numparticles;
+static partbucket_t	r_partbuckets[PT_NUMTYPES];
+int			r_numparticles;			// live, in all buckets
+
+cvar_t		r_maxparticles = {"r_maxparticles", "2048"};
 
 vec3_t		r_pright, r_pup, r_ppn;
 
+void R_ParticleBench_f (void);
 
 /*
 ===============
@@ -46,31 +70,106 @@ void R_InitParticles (void)
 {
 	int		i;
 
+	Cvar_RegisterVariable (&r_maxparticles);
+	Cmd_AddCommand ("r_partbench", R_ParticleBench_f);
+
 	i = COM_CheckParm ("-particles");
 
 	if (i)
 	{
-		r_numparticles = (int)(Q_atoi(com_argv[i+1]));
-		if (r_numparticles < ABSOLUTE_MIN_PARTICLES)
-			r_numparticles = ABSOLUTE_MIN_PARTICLES;
+		i = (int)(Q_atoi(com_argv[i+1]));
+		if (i < ABSOLUTE_MIN_PARTICLES)
+			i = ABSOLUTE_MIN_PARTICLES;
 	}
 	else
 	{
-		r_numparticles = MAX_PARTICLES;
+		i = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)
-			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	Cvar_SetValue ("r_maxparticles", i);
+}
+
+/*
+===============
+R_GrowBucket
+
+Doubles the room in b, all of its arrays live in one allocation
+===============
+*/
+static qboolean R_GrowBucket (partbucket_t *b)
+{
+	float	*block;
+	int		max;
+
+	max = b->max ? b->max * 2 : PART_BUCKETSTART;
+	block = malloc (max * (PART_FLOATS * sizeof(float) + 1));
+	if (!block)
+		return false;
+
+	memcpy (block, b->x, b->count * sizeof(float));
+	memcpy (block + max, b->y, b->count * sizeof(float));
+	memcpy (block + max*2, b->z, b->count * sizeof(float));
+	memcpy (block + max*3, b->vx, b->count * sizeof(float));
+	memcpy (block + max*4, b->vy, b->count * sizeof(float));
+	memcpy (block + max*5, b->vz, b->count * sizeof(float));
+	memcpy (block + max*6, b->ramp, b->count * sizeof(float));
+	memcpy (block + max*7, b->die, b->count * sizeof(float));
+	memcpy (block + max*8, b->color, b->count);
+	free (b->x);
+
+	b->x = block;
+	b->y = block + max;
+	b->z = block + max*2;
+	b->vx = block + max*3;
+	b->vy = block + max*4;
+	b->vz = block + max*5;
+	b->ramp = block + max*6;
+	b->die = block + max*7;
+	b->color = (byte *)(block + max*8);
+	b->max = max;
+	return true;
+}
+
+/*
+===============
+R_NewParticle
+
+Returns false when there is no room for another
+===============
+*/
+static qboolean R_NewParticle (ptype_t type, vec3_t org, vec3_t vel, float die, int color, float ramp)
+{
+	partbucket_t	*b;
+	int				i;
+
+	if (r_numparticles >= r_maxparticles.value)
+		return false;
+
+	b = &r_partbuckets[type];
+	if (b->count == b->max && !R_GrowBucket (b))
+		return false;
+
+	i = b->count++;
+	r_numparticles++;
+	b->x[i] = org[0];
+	b->y[i] = org[1];
+	b->z[i] = org[2];
+	b->vx[i] = vel[0];
+	b->vy[i] = vel[1];
+	b->vz[i] = vel[2];
+	b->ramp[i] = ramp;
+	b->die[i] = die;
+	b->color[i] = color;
+	return true;
 }
 
 #ifdef QUAKE2
 void R_DarkFieldParticles (entity_t *ent)
 {
 	int			i, j, k;
-	particle_t	*p;
 	float		vel;
 	vec3_t		dir;
-	vec3_t		org;
+	vec3_t		org, porg, pvel;
 
 	org[0] = ent->origin[0];
 	org[1] = ent->origin[1];
@@ -79,28 +178,20 @@ void R_DarkFieldParticles (entity_t *ent)
 		for (j=-16 ; j<16 ; j+=8)
 			for (k=0 ; k<32 ; k+=8)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-		
-				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
-				p->color = 150 + rand()%6;
-				p->type = pt_slowgrav;
-				
 				dir[0] = j*8;
 				dir[1] = i*8;
 				dir[2] = k*8;
 	
-				p->org[0] = org[0] + i + (rand()&3);
-				p->org[1] = org[1] + j + (rand()&3);
-				p->org[2] = org[2] + k + (rand()&3);
+				porg[0] = org[0] + i + (rand()&3);
+				porg[1] = org[1] + j + (rand()&3);
+				porg[2] = org[2] + k + (rand()&3);
 	
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, pvel);
+
+				if (!R_NewParticle (pt_slowgrav, porg, pvel, cl.time + 0.2 + (rand()&7) * 0.02, 150 + rand()%6, 0))
+					return;
 			}
 }
 #endif
@@ -124,10 +215,9 @@ void R_EntityParticles (entity_t *ent)
 {
 	int			count;
 	int			i;
-	particle_t	*p;
 	float		angle;
 	float		sr, sp, sy, cr, cp, cy;
-	vec3_t		forward;
+	vec3_t		forward, org;
 	float		dist;
 	
 	dist = 64;
@@ -156,20 +246,12 @@ avelocities[0][i] = (rand()&255) * 0.01;
 		forward[1] = cp*sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;			
+		org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;			
+		org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;			
+
+		if (!R_NewParticle (pt_explode, org, vec3_origin, cl.time + 0.01, 0x6f, 0))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
-		
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;			
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;			
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;			
 	}
 }
 
@@ -183,12 +265,9 @@ void R_ClearParticles (void)
 {
 	int		i;
 	
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i=0 ;i<r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	for (i=0 ; i<PT_NUMTYPES ; i++)
+		r_partbuckets[i].count = 0;
+	r_numparticles = 0;
 }
 
 
@@ -198,7 +277,6 @@ void R_ReadPointFile_f (void)
 	vec3_t	org;
 	int		r;
 	int		c;
-	particle_t	*p;
 	char	name[MAX_OSPATH];
 	
 	sprintf (name,"maps/%s.pts", sv.name);
@@ -237,21 +315,11 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 		
-		if (!free_particles)
+		if (!R_NewParticle (pt_static, org, vec3_origin, 99999, (-c)&15, 0))
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-		
-		p->die = 99999;
-		p->color = (-c)&15;
-		p->type = pt_static;
-		VectorCopy (vec3_origin, p->vel);
-		VectorCopy (org, p->org);
 	}
 
 	Sys_FileClose(f);
@@ -271,7 +339,7 @@ void R_ParseParticleEffect (void)
 	int			i, count, msgcount, color;
 	
 	for (i=0 ; i<3 ; i++)
-		org[i] = MSG_ReadCoord ();
+		org[i] = CL_ReadCoord ();
 	for (i=0 ; i<3 ; i++)
 		dir[i] = MSG_ReadChar () * (1.0/16);
 	msgcount = MSG_ReadByte ();
@@ -294,38 +362,19 @@ R_ParticleExplosion
 void R_ParticleExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	float		ramp;
+	vec3_t		porg, pvel;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = rand()&3;
-		if (i & 1)
-		{
-			p->type = pt_explode;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
-		}
-		else
+		ramp = rand()&3;
+		for (j=0 ; j<3 ; j++)
 		{
-			p->type = pt_explode2;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			porg[j] = org[j] + ((rand()%32)-16);
+			pvel[j] = (rand()%512)-256;
 		}
+		if (!R_NewParticle ((i & 1) ? pt_explode : pt_explode2, porg, pvel, cl.time + 5, ramp1[0], ramp))
+			return;
 	}
 }
 
@@ -338,28 +387,19 @@ R_ParticleExplosion2
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
 	int			i, j;
-	particle_t	*p;
 	int			colorMod = 0;
+	vec3_t		porg, pvel;
 
 	for (i=0; i<512; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
-		colorMod++;
-
-		p->type = pt_blob;
 		for (j=0 ; j<3 ; j++)
 		{
-			p->org[j] = org[j] + ((rand()%32)-16);
-			p->vel[j] = (rand()%512)-256;
+			porg[j] = org[j] + ((rand()%32)-16);
+			pvel[j] = (rand()%512)-256;
 		}
+		if (!R_NewParticle (pt_blob, porg, pvel, cl.time + 0.3, colorStart + (colorMod % colorLength), 0))
+			return;
+		colorMod++;
 	}
 }
 
@@ -372,38 +412,27 @@ R_BlobExplosion
 void R_BlobExplosion (vec3_t org)
 {
 	int			i, j;
-	particle_t	*p;
+	float		die;
+	vec3_t		porg, pvel;
 	
 	for (i=0 ; i<1024 ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 1 + (rand()&8)*0.05;
+		die = cl.time + 1 + (rand()&8)*0.05;
 
+		for (j=0 ; j<3 ; j++)
+		{
+			porg[j] = org[j] + ((rand()%32)-16);
+			pvel[j] = (rand()%512)-256;
+		}
 		if (i & 1)
 		{
-			p->type = pt_blob;
-			p->color = 66 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			if (!R_NewParticle (pt_blob, porg, pvel, die, 66 + rand()%6, 0))
+				return;
 		}
 		else
 		{
-			p->type = pt_blob2;
-			p->color = 150 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			if (!R_NewParticle (pt_blob2, porg, pvel, die, 150 + rand()%6, 0))
+				return;
 		}
 	}
 }
@@ -417,52 +446,23 @@ R_RunParticleEffect
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
 	int			i, j;
-	particle_t	*p;
+	vec3_t		porg, pvel;
 	
+	if (count == 1024)
+	{	// rocket explosion
+		R_ParticleExplosion (org);
+		return;
+	}
+
 	for (i=0 ; i<count ; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		if (count == 1024)
-		{	// rocket explosion
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = rand()&3;
-			if (i & 1)
-			{
-				p->type = pt_explode;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-			else
-			{
-				p->type = pt_explode2;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-		}
-		else
+		for (j=0 ; j<3 ; j++)
 		{
-			p->die = cl.time + 0.1*(rand()%5);
-			p->color = (color&~7) + (rand()&7);
-			p->type = pt_slowgrav;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()&15)-8);
-				p->vel[j] = dir[j]*15;// + (rand()%300)-150;
-			}
+			porg[j] = org[j] + ((rand()&15)-8);
+			pvel[j] = dir[j]*15;// + (rand()%300)-150;
 		}
+		if (!R_NewParticle (pt_slowgrav, porg, pvel, cl.time + 0.1*(rand()%5), (color&~7) + (rand()&7), 0))
+			return;
 	}
 }
 
@@ -476,36 +476,27 @@ R_LavaSplash
 void R_LavaSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
 	float		vel;
-	vec3_t		dir;
+	vec3_t		dir, porg, pvel;
 
 	for (i=-16 ; i<16 ; i++)
 		for (j=-16 ; j<16 ; j++)
 			for (k=0 ; k<1 ; k++)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-		
-				p->die = cl.time + 2 + (rand()&31) * 0.02;
-				p->color = 224 + (rand()&7);
-				p->type = pt_slowgrav;
-				
 				dir[0] = j*8 + (rand()&7);
 				dir[1] = i*8 + (rand()&7);
 				dir[2] = 256;
 	
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (rand()&63);
+				porg[0] = org[0] + dir[0];
+				porg[1] = org[1] + dir[1];
+				porg[2] = org[2] + (rand()&63);
 	
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, pvel);
+
+				if (!R_NewParticle (pt_slowgrav, porg, pvel, cl.time + 2 + (rand()&31) * 0.02, 224 + (rand()&7), 0))
+					return;
 			}
 }
 
@@ -518,45 +509,35 @@ R_TeleportSplash
 void R_TeleportSplash (vec3_t org)
 {
 	int			i, j, k;
-	particle_t	*p;
 	float		vel;
-	vec3_t		dir;
+	vec3_t		dir, porg, pvel;
 
 	for (i=-16 ; i<16 ; i+=4)
 		for (j=-16 ; j<16 ; j+=4)
 			for (k=-24 ; k<32 ; k+=4)
 			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-		
-				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
-				p->color = 7 + (rand()&7);
-				p->type = pt_slowgrav;
-				
 				dir[0] = j*8;
 				dir[1] = i*8;
 				dir[2] = k*8;
 	
-				p->org[0] = org[0] + i + (rand()&3);
-				p->org[1] = org[1] + j + (rand()&3);
-				p->org[2] = org[2] + k + (rand()&3);
+				porg[0] = org[0] + i + (rand()&3);
+				porg[1] = org[1] + j + (rand()&3);
+				porg[2] = org[2] + k + (rand()&3);
 	
 				VectorNormalize (dir);						
 				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
+				VectorScale (dir, vel, pvel);
+
+				if (!R_NewParticle (pt_slowgrav, porg, pvel, cl.time + 0.2 + (rand()&7) * 0.02, 7 + (rand()&7), 0))
+					return;
 			}
 }
 
 void R_RocketTrail (vec3_t start, vec3_t end, int type)
 {
-	vec3_t		vec;
-	float		len;
+	vec3_t		vec, porg, pvel;
+	float		len, ramp;
 	int			j;
-	particle_t	*p;
 	int			dec;
 	static int	tracercount;
 
@@ -574,79 +555,57 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-		
-		VectorCopy (vec3_origin, p->vel);
-		p->die = cl.time + 2;
+		VectorCopy (vec3_origin, pvel);
 
 		switch (type)
 		{
 			case 0:	// rocket trail
-				p->ramp = (rand()&3);
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
-				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
-				break;
-
 			case 1:	// smoke smoke
-				p->ramp = (rand()&3) + 2;
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				ramp = (rand()&3) + (type ? 2 : 0);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					porg[j] = start[j] + ((rand()%6)-3);
+				if (!R_NewParticle (pt_fire, porg, pvel, cl.time + 2, ramp3[(int)ramp], ramp))
+					return;
 				break;
 
 			case 2:	// blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
-				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+			case 4:	// slight blood
+				j = 67 + (rand()&3);
+				porg[0] = start[0] + ((rand()%6)-3);
+				porg[1] = start[1] + ((rand()%6)-3);
+				porg[2] = start[2] + ((rand()%6)-3);
+				if (!R_NewParticle (pt_grav, porg, pvel, cl.time + 2, j, 0))
+					return;
+				if (type == 4)
+					len -= 3;
 				break;
 
 			case 3:
 			case 5:	// tracer
-				p->die = cl.time + 0.5;
-				p->type = pt_static;
-				if (type == 3)
-					p->color = 52 + ((tracercount&4)<<1);
-				else
-					p->color = 230 + ((tracercount&4)<<1);
-			
 				tracercount++;
 
-				VectorCopy (start, p->org);
 				if (tracercount & 1)
 				{
-					p->vel[0] = 30*vec[1];
-					p->vel[1] = 30*-vec[0];
+					pvel[0] = 30*vec[1];
+					pvel[1] = 30*-vec[0];
 				}
 				else
 				{
-					p->vel[0] = 30*-vec[1];
-					p->vel[1] = 30*vec[0];
+					pvel[0] = 30*-vec[1];
+					pvel[1] = 30*vec[0];
 				}
-				break;
-
-			case 4:	// slight blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
-				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
-				len -= 3;
+				if (!R_NewParticle (pt_static, start, pvel, cl.time + 0.5,
+					(type == 3 ? 52 : 230) + (((tracercount-1)&4)<<1), 0))
+					return;
 				break;
 
 			case 6:	// voor trail
-				p->color = 9*16 + 8 + (rand()&3);
-				p->type = pt_static;
-				p->die = cl.time + 0.3;
-				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()&15)-8);
+				j = 9*16 + 8 + (rand()&3);
+				porg[0] = start[0] + ((rand()&15)-8);
+				porg[1] = start[1] + ((rand()&15)-8);
+				porg[2] = start[2] + ((rand()&15)-8);
+				if (!R_NewParticle (pt_static, porg, pvel, cl.time + 0.3, j, 0))
+					return;
 				break;
 		}
 		
@@ -656,6 +615,139 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 }
 
 
+/*
+==============================================================================
+
+PARTICLE UPDATE
+
+The kernels never look at cl or the renderer, so r_partbench can run
+them on a made up set of particles.  The arrays of a bucket never
+overlap, __restrict lets the compiler keep them in flight together.
+
+==============================================================================
+*/
+
+/*
+===============
+R_KillParticles
+
+Removes the particles of b that died before time
+===============
+*/
+static void R_KillParticles (partbucket_t *b, float time)
+{
+	int		i, last;
+
+	for (i=0 ; i<b->count ; )
+	{
+		if (b->die[i] >= time)
+		{
+			i++;
+			continue;
+		}
+		last = --b->count;
+		b->x[i] = b->x[last];
+		b->y[i] = b->y[last];
+		b->z[i] = b->z[last];
+		b->vx[i] = b->vx[last];
+		b->vy[i] = b->vy[last];
+		b->vz[i] = b->vz[last];
+		b->ramp[i] = b->ramp[last];
+		b->die[i] = b->die[last];
+		b->color[i] = b->color[last];
+		r_numparticles--;
+	}
+}
+
+/*
+===============
+R_MoveParticles
+
+Moves b by its velocity, then adds drag times the velocity to it and
+gravity to its z
+===============
+*/
+static void R_MoveParticles (partbucket_t *b, float frametime, float dragxy, float dragz, float grav)
+{
+	float	*__restrict x = b->x, *__restrict y = b->y, *__restrict z = b->z;
+	float	*__restrict vx = b->vx, *__restrict vy = b->vy, *__restrict vz = b->vz;
+	int		i, n = b->count;
+
+	for (i=0 ; i<n ; i++)
+	{
+		x[i] += vx[i]*frametime;
+		y[i] += vy[i]*frametime;
+		z[i] += vz[i]*frametime;
+		vx[i] += vx[i]*dragxy;
+		vy[i] += vy[i]*dragxy;
+		vz[i] += vz[i]*dragz;
+		vz[i] += grav;
+	}
+}
+
+/*
+===============
+R_MoveRampParticles
+
+R_MoveParticles and steps the colour ramp, a particle at the end of it
+dies next frame
+===============
+*/
+static void R_MoveRampParticles (partbucket_t *b, float frametime, float drag, float grav, float step, float end, int *ramp)
+{
+	float	*__restrict x = b->x, *__restrict y = b->y, *__restrict z = b->z;
+	float	*__restrict vx = b->vx, *__restrict vy = b->vy, *__restrict vz = b->vz;
+	float	*__restrict r = b->ramp, *__restrict die = b->die;
+	byte	*__restrict color = b->color;
+	int		i, n = b->count;
+
+	for (i=0 ; i<n ; i++)
+	{
+		x[i] += vx[i]*frametime;
+		y[i] += vy[i]*frametime;
+		z[i] += vz[i]*frametime;
+		vx[i] += vx[i]*drag;
+		vy[i] += vy[i]*drag;
+		vz[i] += vz[i]*drag;
+		vz[i] += grav;
+
+		r[i] += step;
+		if (r[i] >= end)
+			die[i] = -1;
+		color[i] = ramp[(int)r[i] & 7];
+	}
+}
+
+/*
+===============
+R_UpdateParticles
+
+Moves every particle on by frametime, same as the old per particle
+switch on type
+===============
+*/
+void R_UpdateParticles (float frametime, float gravity)
+{
+	float	grav, dvel;
+
+	grav = frametime * gravity * 0.05;
+	dvel = 4*frametime;
+
+	R_MoveParticles (&r_partbuckets[pt_static], frametime, 0, 0, 0);
+	R_MoveRampParticles (&r_partbuckets[pt_fire], frametime, 0, grav, frametime * 5, 6, ramp3);
+	R_MoveRampParticles (&r_partbuckets[pt_explode], frametime, dvel, -grav, frametime * 10, 8, ramp1);
+	R_MoveRampParticles (&r_partbuckets[pt_explode2], frametime, -frametime, -grav, frametime * 15, 8, ramp2);
+	R_MoveParticles (&r_partbuckets[pt_blob], frametime, dvel, dvel, -grav);
+	R_MoveParticles (&r_partbuckets[pt_blob2], frametime, -dvel, 0, -grav);
+#ifdef QUAKE2
+	R_MoveParticles (&r_partbuckets[pt_grav], frametime, 0, 0, -grav * 20);
+#else
+	R_MoveParticles (&r_partbuckets[pt_grav], frametime, 0, 0, -grav);
+#endif
+	R_MoveParticles (&r_partbuckets[pt_slowgrav], frametime, 0, 0, -grav);
+}
+
+
 /*
 ===============
 R_DrawParticles
@@ -667,154 +759,207 @@ extern	cvar_t	sv_gravity;
 
 void R_DrawParticles (void)
 {
-	particle_t		*p, *kill;
-	float			grav;
-	int				i;
-	float			time2, time3;
-	float			time1;
-	float			dvel;
-	float			frametime;
-	vec3_t			up, right;
+	partbucket_t	*b;
+	int				i, t;
+	vec3_t			up, right, org;
 	float			scale;
 
-#ifdef PSP_HARDWARE_VIDEO
-
 	int 			part_buffer_size = PART_BUFFER_SIZE;
 	psp_particle* 	part_buffer = NULL;
 	part_buffer 	= D_CreateBuffer(part_buffer_size);
 
 	VectorScale (vup, 1.25, up);
 	VectorScale (vright, 1.25, right);
-#endif
 	D_StartParticles ();
 
- #ifdef PSP_HARDWARE_VIDEO
-	//VectorScale (vright, xscaleshrink, r_pright);
-	//VectorScale (vup, yscaleshrink, r_pup);
-	//VectorCopy (vright, r_pright);
-	//VectorCopy (vup, r_pup);
- #else
-	VectorScale (vright, xscaleshrink, r_pright);
-	VectorScale (vup, yscaleshrink, r_pup);
- #endif
 	VectorCopy (vpn, r_ppn);
 
-	frametime = cl.time - cl.oldtime;
-	time3 = frametime * 15;
-	time2 = frametime * 10; // 15;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	dvel = 4*frametime;
-	
-	for ( ;; ) 
+	for (t=0, b=r_partbuckets ; t<PT_NUMTYPES ; t++, b++)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
+		R_KillParticles (b, cl.time);
+
+		for (i=0 ; i<b->count ; i++)
 		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
+			org[0] = b->x[i];
+			org[1] = b->y[i];
+			org[2] = b->z[i];
+
+			// hack a scale up to keep particles from disapearing
+			scale = (org[0] - r_origin[0])*vpn[0] + (org[1] - r_origin[1])*vpn[1]
+				+ (org[2] - r_origin[2])*vpn[2];
+			if (scale < 20)
+				scale = 1;
+			else
+				scale = 1 + scale * 0.004;
+		
+			int rv = D_DrawParticleBuffered(part_buffer, org, b->color[i], up, right, scale);
+			if (rv == -1)
+				part_buffer = D_CreateBuffer(part_buffer_size);
 		}
-		break;
 	}
 
-	for (p=active_particles ; p ; p=p->next)
-	{
-		for ( ;; )
-		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
-		}
+	D_DeleteBuffer(part_buffer);
+	D_EndParticles ();
 
-#ifdef PSP_HARDWARE_VIDEO
-		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0])*vpn[0] + (p->org[1] - r_origin[1])*vpn[1]
-			+ (p->org[2] - r_origin[2])*vpn[2];
-		if (scale < 20)
-			scale = 1;
-		else
-			scale = 1 + scale * 0.004;
-		
-		// D_DrawParticle (p, up, right, scale);
-		int rv = D_DrawParticleBuffered(part_buffer,p, up, right, scale);
-		if (rv == -1)
-			part_buffer = D_CreateBuffer(part_buffer_size);
-			
-#else
-		D_DrawParticle (p);
-#endif		
-		p->org[0] += p->vel[0]*frametime;
-		p->org[1] += p->vel[1]*frametime;
-		p->org[2] += p->vel[2]*frametime;
-		
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+	R_UpdateParticles (cl.time - cl.oldtime, sv_gravity.value);
+}
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] -= p->vel[i]*frametime;
-			p->vel[2] -= grav;
-			break;
+/*
+===============
+R_ParticleBench_f
 
-		case pt_blob:
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+r_partbench [particles] [frames] : fills every bucket with made up
+particles and times R_UpdateParticles against the old list of
+particle_t with its switch on type, then checks they moved the same.
+Particles in flight are cleared.
+===============
+*/
+void R_ParticleBench_f (void)
+{
+	particle_t	*ref, *p;
+	partbucket_t	*b;
+	float		frametime, grav, dvel, maxparticles;
+	double		start, time[2];
+	int			count, frames, i, j, f, t, mismatches;
+	int			index[PT_NUMTYPES];
+	vec3_t		org, vel;
+
+	count = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 50000;
+	frames = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 100;
+	if (count < 1)
+		count = 1;
+	if (frames < 1)
+		frames = 1;
+
+	ref = malloc (count * sizeof(particle_t));
+	if (!ref)
+	{
+		Con_Printf ("couldn't allocate %i particles\n", count);
+		return;
+	}
+
+	maxparticles = r_maxparticles.value;
+	r_maxparticles.value = count;
+	R_ClearParticles ();
 
-		case pt_blob2:
-			for (i=0 ; i<2 ; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
+	srand (1);
+	for (i=0, p=ref ; i<count ; i++, p++)
+	{
+		p->type = rand() % PT_NUMTYPES;		// effects interleave in the list
+		for (j=0 ; j<3 ; j++)
+		{
+			p->org[j] = (rand()%4096) - 2048;
+			p->vel[j] = (rand()%512) - 256;
+		}
+		p->ramp = rand()&3;
+		p->die = 99999;
+		p->color = 0;
+		if (!R_NewParticle (p->type, p->org, p->vel, p->die, 0, p->ramp))
 			break;
+	}
+	count = i;
 
-		case pt_grav:
+	frametime = 1.0 / 72;
+	grav = frametime * 800 * 0.05;
+	dvel = 4*frametime;
+
+	start = Sys_FloatTime ();
+	for (f=0 ; f<frames ; f++)
+	{
+		for (i=0, p=ref ; i<count ; i++, p++)
+		{
+			p->org[0] += p->vel[0]*frametime;
+			p->org[1] += p->vel[1]*frametime;
+			p->org[2] += p->vel[2]*frametime;
+
+			switch (p->type)
+			{
+			case pt_static:
+				break;
+			case pt_fire:
+				p->ramp += frametime * 5;
+				if (p->ramp >= 6)
+					p->die = -1;
+				else
+					p->color = ramp3[(int)p->ramp];
+				p->vel[2] += grav;
+				break;
+			case pt_explode:
+				p->ramp += frametime * 10;
+				if (p->ramp >=8)
+					p->die = -1;
+				else
+					p->color = ramp1[(int)p->ramp];
+				for (j=0 ; j<3 ; j++)
+					p->vel[j] += p->vel[j]*dvel;
+				p->vel[2] -= grav;
+				break;
+			case pt_explode2:
+				p->ramp += frametime * 15;
+				if (p->ramp >=8)
+					p->die = -1;
+				else
+					p->color = ramp2[(int)p->ramp];
+				for (j=0 ; j<3 ; j++)
+					p->vel[j] -= p->vel[j]*frametime;
+				p->vel[2] -= grav;
+				break;
+			case pt_blob:
+				for (j=0 ; j<3 ; j++)
+					p->vel[j] += p->vel[j]*dvel;
+				p->vel[2] -= grav;
+				break;
+			case pt_blob2:
+				for (j=0 ; j<2 ; j++)
+					p->vel[j] -= p->vel[j]*dvel;
+				p->vel[2] -= grav;
+				break;
+			case pt_grav:
 #ifdef QUAKE2
-			p->vel[2] -= grav * 20;
-			break;
+				p->vel[2] -= grav * 20;
+				break;
 #endif
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
+			case pt_slowgrav:
+				p->vel[2] -= grav;
+				break;
+			}
 		}
 	}
-#ifdef PSP_HARDWARE_VIDEO
-	D_DeleteBuffer(part_buffer);
-#endif
-	D_EndParticles ();
-}
+	time[0] = Sys_FloatTime () - start;
 
+	start = Sys_FloatTime ();
+	for (f=0 ; f<frames ; f++)
+		R_UpdateParticles (frametime, 800);
+	time[1] = Sys_FloatTime () - start;
+
+// the buckets are in spawn order, nothing was killed
+	memset (index, 0, sizeof(index));
+	mismatches = 0;
+	for (i=0, p=ref ; i<count ; i++, p++)
+	{
+		t = p->type;
+		b = &r_partbuckets[t];
+		j = index[t]++;
+		org[0] = b->x[j];
+		org[1] = b->y[j];
+		org[2] = b->z[j];
+		vel[0] = b->vx[j];
+		vel[1] = b->vy[j];
+		vel[2] = b->vz[j];
+		if (!VectorCompare (org, p->org) || !VectorCompare (vel, p->vel) || (b->die[j] < 0) != (p->die < 0))
+			mismatches++;
+	}
+
+	Con_Printf ("%i particles, %i frames\n", count, frames);
+	Con_Printf ("list:    %.3f ms per frame\n", time[0] * 1000 / frames);
+	Con_Printf ("buckets: %.3f ms per frame\n", time[1] * 1000 / frames);
+	if (mismatches)
+		Con_Printf ("MISMATCH: %i particles moved differently\n", mismatches);
+	else
+		Con_Printf ("all particles match\n");
+
+	free (ref);
+	R_ClearParticles ();
+	r_maxparticles.value = maxparticles;
+}
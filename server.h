@@ -40,6 +40,8 @@ typedef struct
 	qboolean	loadgame;			// handle connections specially
 
 	double		time;
+
+	int			protocol;			// PROTOCOL_VERSION or PROTOCOL_COMPACT
 	
 	int			lastcheck;			// used by PF_checkclient
 	double		lastchecktime;
@@ -89,6 +91,7 @@ typedef struct client_s
 	struct qsocket_s *netconnection;	// communications handle
 
 	usercmd_t		cmd;				// movement
+	int				movesequence;		// of cmd, echoed for client prediction
 	vec3_t			wishdir;			// intended motion calced from cmd
 
 	sizebuf_t		message;			// can be added to at any time,
@@ -251,6 +254,7 @@ qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
 void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
+void SV_WriteCoord (sizebuf_t *sb, float f);
 
 void SV_MoveToGoal (void);
 
@@ -31,6 +31,14 @@ void S_SoundList(void);
 void S_Update_();
 void S_StopAllSounds(qboolean clear);
 void S_StopAllSoundsC(void);
+void S_VoiceBench_f(void);
+void S_StaticBench_f(void);
+static void SND_StartThread (void);
+void SND_StartSound (int entnum, int entchannel, sfx_t *sfx, sfxcache_t *sc, vec3_t origin, float fvol, float attenuation, int file, int filestart);
+void SND_StaticSound (sfx_t *sfx, sfxcache_t *sc, vec3_t origin, float vol, float attenuation, int leafnum, int file, int filestart);
+void SND_StopSound (int entnum, int entchannel);
+void SND_StopAllSounds (qboolean clear);
+static void SND_StopThread (void);
 
 // =======================================================================
 // Internal sound data & structures
@@ -51,6 +59,7 @@ vec3_t		listener_origin;
 vec3_t		listener_forward;
 vec3_t		listener_right;
 vec3_t		listener_up;
+static int	listener_entnum;	// cl.viewentity, passed along with the listener
 vec_t		sound_nominal_clip_dist=1000.0;
 
 int			soundtime;		// sample PAIRS
@@ -74,12 +83,21 @@ cvar_t volume = {"volume", "0.7", true};
 cvar_t nosound = {"nosound", "0"};
 cvar_t precache = {"precache", "1"};
 cvar_t loadas8bit = {"loadas8bit", "0"};
+cvar_t snd_resample = {"snd_resample", "1", true};		// 0 nearest, 1 polyphase sinc
+cvar_t snd_nativerate = {"snd_nativerate", "0", true};	// load at the wav rate, step in the mixer
+cvar_t snd_adpcm = {"snd_adpcm", "0", true};			// keep loaded sounds as 4 bit ADPCM
 cvar_t bgmbuffer = {"bgmbuffer", "4096"};
 cvar_t ambient_level = {"ambient_level", "0.3"};
 cvar_t ambient_fade = {"ambient_fade", "100"};
 cvar_t snd_noextraupdate = {"snd_noextraupdate", "0"};
 cvar_t snd_show = {"snd_show", "0"};
 cvar_t _snd_mixahead = {"_snd_mixahead", "0.1", true};
+cvar_t snd_maxvoices = {"snd_maxvoices", "32", true};	// loudest voices that get mixed
+cvar_t snd_voicecull = {"snd_voicecull", "8"};			// left+right volume below which a voice is virtual
+cvar_t snd_staticpvs = {"snd_staticpvs", "1"};			// silence static clusters outside the listener's PVS
+
+int			snd_realvoices;
+int			snd_virtualvoices;
 
 
 // ====================================================================
@@ -178,11 +196,24 @@ void S_Init (void)
 	Cmd_AddCommand("stopsound", S_StopAllSoundsC);
 	Cmd_AddCommand("soundlist", S_SoundList);
 	Cmd_AddCommand("soundinfo", S_SoundInfo_f);
+	Cmd_AddCommand("snd_mixbench", S_MixBench_f);
+	Cmd_AddCommand("snd_voicebench", S_VoiceBench_f);
+	Cmd_AddCommand("snd_staticbench", S_StaticBench_f);
+	Cmd_AddCommand("snd_resamplebench", S_ResampleBench_f);
+	Cmd_AddCommand("snd_adpcmbench", S_ADPCMBench_f);
+	Cmd_AddCommand("snd_streamtest", S_StreamTest_f);
+	Cmd_AddCommand("snd_threadstats", S_ThreadStats_f);
+	Cmd_AddCommand("snd_dsprender", S_DspRender_f);
+	S_StatsInit ();
 
 	Cvar_RegisterVariable(&nosound);
 	Cvar_RegisterVariable(&volume);
 	Cvar_RegisterVariable(&precache);
 	Cvar_RegisterVariable(&loadas8bit);
+	Cvar_RegisterVariable(&snd_resample);
+	Cvar_RegisterVariable(&snd_nativerate);
+	Cvar_RegisterVariable(&snd_adpcm);
+	Cvar_RegisterVariable(&snd_streamsize);
 	Cvar_RegisterVariable(&bgmvolume);
 	Cvar_RegisterVariable(&bgmbuffer);
 	Cvar_RegisterVariable(&bgmtype);
@@ -191,6 +222,9 @@ void S_Init (void)
 	Cvar_RegisterVariable(&snd_noextraupdate);
 	Cvar_RegisterVariable(&snd_show);
 	Cvar_RegisterVariable(&_snd_mixahead);
+	Cvar_RegisterVariable(&snd_maxvoices);
+	Cvar_RegisterVariable(&snd_voicecull);
+	Cvar_RegisterVariable(&snd_staticpvs);
 
 	if (host_parms.memsize < 0x800000)
 	{
@@ -237,6 +271,9 @@ void S_Init (void)
 #else
     SX_Init ();
 #endif
+
+	if (sound_started && COM_CheckParm("-sndthread"))
+		SND_StartThread ();
 }
 
 
@@ -250,6 +287,8 @@ void S_Shutdown(void)
 	if (!sound_started)
 		return;
 
+	SND_StopThread ();
+
 	if (shm)
 		shm->gamealive = 0;
 
@@ -375,7 +414,7 @@ channel_t *SND_PickChannel(int entnum, int entchannel)
 		}
 
 		// don't let monster sounds override player sounds
-		if (channels[ch_idx].entnum == cl.viewentity && entnum != cl.viewentity && channels[ch_idx].sfx)
+		if (channels[ch_idx].entnum == listener_entnum && entnum != listener_entnum && channels[ch_idx].sfx)
 			continue;
 
 		if (channels[ch_idx].end - paintedtime < life_left)
@@ -388,39 +427,28 @@ channel_t *SND_PickChannel(int entnum, int entchannel)
 	if (first_to_die == -1)
 		return NULL;
 
-	if (channels[first_to_die].sfx)
-		channels[first_to_die].sfx = NULL;
+	SND_ClearChannel (&channels[first_to_die]);
 
     return &channels[first_to_die];    
 }       
 
 /*
 =================
-SND_Spatialize
+SND_SpatializeEmitter
+
+Stereo seperation and distance attenuation of one sound at origin
 =================
 */
-void SND_Spatialize(channel_t *ch)
+static void SND_SpatializeEmitter (vec3_t origin, int master_vol, vec_t dist_mult, int *left, int *right)
 {
     vec_t dot;
     vec_t dist;
     vec_t lscale, rscale, scale;
     vec3_t source_vec;
-	sfx_t *snd;
-
-// anything coming from the view entity will allways be full volume
-	if (ch->entnum == cl.viewentity)
-	{
-		ch->leftvol = ch->master_vol;
-		ch->rightvol = ch->master_vol;
-		return;
-	}
-
-// calculate stereo seperation and distance attenuation
 
-	snd = ch->sfx;
-	VectorSubtract(ch->origin, listener_origin, source_vec);
+	VectorSubtract(origin, listener_origin, source_vec);
 	
-	dist = VectorNormalize(source_vec) * ch->dist_mult;
+	dist = VectorNormalize(source_vec) * dist_mult;
 	
 	dot = DotProduct(listener_right, source_vec);
 
@@ -437,230 +465,909 @@ void SND_Spatialize(channel_t *ch)
 
 // add in distance effect
 	scale = (1.0 - dist) * rscale;
-	ch->rightvol = (int) (ch->master_vol * scale);
-	if (ch->rightvol < 0)
-		ch->rightvol = 0;
+	*right = (int) (master_vol * scale);
+	if (*right < 0)
+		*right = 0;
 
 	scale = (1.0 - dist) * lscale;
-	ch->leftvol = (int) (ch->master_vol * scale);
-	if (ch->leftvol < 0)
-		ch->leftvol = 0;
+	*left = (int) (master_vol * scale);
+	if (*left < 0)
+		*left = 0;
+}
+
+/*
+=================
+SND_Spatialize
+=================
+*/
+void SND_Spatialize(channel_t *ch)
+{
+// anything coming from the view entity will allways be full volume
+	if (ch->entnum == listener_entnum)
+	{
+		ch->leftvol = ch->master_vol;
+		ch->rightvol = ch->master_vol;
+		return;
+	}
+
+	SND_SpatializeEmitter (ch->origin, ch->master_vol, ch->dist_mult, &ch->leftvol, &ch->rightvol);
 }           
 
 
 // =======================================================================
-// Start a sound effect
+// Static sound clusters
+//
+// Every ambient_sound in a map used to get a channel of its own, all of
+// them respatialized every frame and then summed into the first channel
+// playing the same sample.  Static sounds never move, so at map load the
+// ones playing the same sample in the same leaf are gathered into one
+// channel with a list of their emitters.  Only clusters in the listener's
+// PVS are spatialized, the sum of their emitters is mixed as one voice,
+// and nothing is redone while the listener stands still.
 // =======================================================================
 
-void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
-{
-	channel_t *target_chan, *check;
-	sfxcache_t	*sc;
-	int		vol;
-	int		ch_idx;
-	int		skip;
-
-	if (!sound_started)
-		return;
+#define	MAX_STATIC_EMITTERS	2048
 
-	if (!sfx)
-		return;
+typedef struct sndemitter_s
+{
+	vec3_t		origin;
+	int			master_vol;
+	vec_t		dist_mult;
+	struct sndemitter_s	*next;
+} sndemitter_t;
+
+static sndemitter_t	snd_emitters[MAX_STATIC_EMITTERS];
+static int			snd_numemitters;
+
+// The leaf lookups and the decompressed PVS are done by the game thread,
+// which owns the world model, and handed to the mixer with the listener.
+// The PVS alternates between two buffers, a new one is only filled once
+// the mixer has taken the last, so it never reads one being written.
+static byte			snd_pvsbufs[2][MAX_MAP_LEAFS/8];
+static int			snd_pvsbuf;				// the one filled last
+static int			snd_pvsbufleaf = -1;	// leaf it was filled for
+
+static byte * volatile	snd_pvs;			// what the mixer spatializes with
+static int			snd_pvsleaf = -1;		// listener leaf snd_pvs is for
+static int			snd_staticleaf = -1;	// listener leaf the clusters were last spatialized for
+
+static vec3_t		snd_staticorigin;		// listener the clusters were last spatialized for
+static vec3_t		snd_staticright;
+static float		snd_staticpvsvalue;
 
-	if (nosound.value)
-		return;
+/*
+=================
+SND_LeafNum
 
-	vol = fvol*255;
+Game thread only
+=================
+*/
+static int SND_LeafNum (vec3_t origin)
+{
+	if (!cl.worldmodel || !cl.worldmodel->nodes)
+		return 0;
+	return Mod_PointInLeaf (origin, cl.worldmodel) - cl.worldmodel->leafs;
+}
 
-// pick a channel to play on
-	target_chan = SND_PickChannel(entnum, entchannel);
-	if (!target_chan)
-		return;
-		
-// spatialize
-	memset (target_chan, 0, sizeof(*target_chan));
-	VectorCopy(origin, target_chan->origin);
-	target_chan->dist_mult = attenuation / sound_nominal_clip_dist;
-	target_chan->master_vol = vol;
-	target_chan->entnum = entnum;
-	target_chan->entchannel = entchannel;
-	SND_Spatialize(target_chan);
+/*
+=================
+SND_ListenerPVS
 
-	if (!target_chan->leftvol && !target_chan->rightvol)
-		return;		// not audible at all
+Game thread, decompresses the visibility of the listener's leaf into the
+free PVS buffer.  Returns NULL if the leaf didn't change, or the mixer
+still has the other buffer, so the next frame tries again.
+=================
+*/
+static byte *SND_ListenerPVS (int leafnum)
+{
+	byte	*in, *out, *end;
+	int		c;
 
-// new channel
-	sc = S_LoadSound (sfx);
-	if (!sc)
-	{
-		target_chan->sfx = NULL;
-		return;		// couldn't load the sound's data
+	if (leafnum == snd_pvsbufleaf || !cl.worldmodel)
+		return NULL;
+	if (snd_pvsbufleaf != -1 && snd_pvs != snd_pvsbufs[snd_pvsbuf])
+		return NULL;
+	snd_pvsbuf ^= 1;
+	snd_pvsbufleaf = leafnum;
+
+	out = snd_pvsbufs[snd_pvsbuf];
+	end = out + ((cl.worldmodel->numleafs+7)>>3);
+	in = leafnum ? cl.worldmodel->leafs[leafnum].compressed_vis : NULL;
+	if (!in)
+	{	// outside the world or no vis info, so all visible
+		memset (out, 0xff, end - out);
+		return snd_pvsbufs[snd_pvsbuf];
 	}
 
-	target_chan->sfx = sfx;
-	target_chan->pos = 0.0;
-    target_chan->end = paintedtime + sc->length;	
-
-// if an identical sound has also been started this frame, offset the pos
-// a bit to keep it from just making the first one louder
-	check = &channels[NUM_AMBIENTS];
-    for (ch_idx=NUM_AMBIENTS ; ch_idx < NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS ; ch_idx++, check++)
-    {
-		if (check == target_chan)
-			continue;
-		if (check->sfx == sfx && !check->pos)
+	while (out < end)
+	{
+		if (*in)
 		{
-			skip = rand () % (int)(0.1*shm->speed);
-			if (skip >= target_chan->end)
-				skip = target_chan->end - 1;
-			target_chan->pos += skip;
-			target_chan->end -= skip;
-			break;
+			*out++ = *in++;
+			continue;
 		}
-		
+		for (c = in[1], in += 2 ; c && out < end ; c--)
+			*out++ = 0;
 	}
+	return snd_pvsbufs[snd_pvsbuf];
 }
 
-void S_StopSound(int entnum, int entchannel)
+/*
+=================
+SND_SpatializeCluster
+=================
+*/
+static void SND_SpatializeCluster (channel_t *ch)
 {
-	int i;
+	sndemitter_t	*e;
+	int				left, right;
 
-	for (i=0 ; i<MAX_DYNAMIC_CHANNELS ; i++)
+	ch->leftvol = ch->rightvol = 0;
+
+	if (snd_staticpvs.value && ch->leafnum && snd_pvsleaf > 0 && snd_pvs)
 	{
-		if (channels[i].entnum == entnum
-			&& channels[i].entchannel == entchannel)
-		{
-			channels[i].end = 0;
-			channels[i].sfx = NULL;
+		if (!(snd_pvs[(ch->leafnum-1)>>3] & (1<<((ch->leafnum-1)&7))))
 			return;
-		}
 	}
+
+	for (e = ch->emitters ; e ; e = e->next)
+	{
+		SND_SpatializeEmitter (e->origin, e->master_vol, e->dist_mult, &left, &right);
+		ch->leftvol += left;
+		ch->rightvol += right;
+	}
+
+	if (ch->leftvol > 255)
+		ch->leftvol = 255;
+	if (ch->rightvol > 255)
+		ch->rightvol = 255;
 }
 
-void S_StopAllSounds(qboolean clear)
+/*
+=================
+SND_UpdateStaticClusters
+
+Respatializes the clusters if the listener moved, turned or changed leaf
+=================
+*/
+static void SND_UpdateStaticClusters (void)
 {
-	int		i;
+	channel_t	*ch;
+	int			i;
 
-	if (!sound_started)
+	if (snd_pvsleaf != snd_staticleaf)
+		snd_staticleaf = snd_pvsleaf;
+	else if (VectorCompare (listener_origin, snd_staticorigin)
+		&& VectorCompare (listener_right, snd_staticright)
+		&& snd_staticpvs.value == snd_staticpvsvalue)
 		return;
 
-	total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;	// no statics
+	VectorCopy (listener_origin, snd_staticorigin);
+	VectorCopy (listener_right, snd_staticright);
+	snd_staticpvsvalue = snd_staticpvs.value;
 
-	for (i=0 ; i<MAX_CHANNELS ; i++)
-		if (channels[i].sfx)
-			channels[i].sfx = NULL;
-#ifdef DSP2
-    DSP_ClearState();
+	ch = channels + MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;
+	for (i=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS ; i<total_channels ; i++, ch++)
+		if (ch->sfx)
+			SND_SpatializeCluster (ch);
+}
+
+// =======================================================================
+// Audio thread
+//
+// With -sndthread the mixer runs on its own thread, which owns channels[]
+// and the paint buffer.  The S_ functions the game calls only load the
+// sound (the cache is not thread safe) and queue a command, the audio
+// thread drains the queue before each mix.  One producer, one consumer,
+// so the queue needs no lock, only ordering between the command and the
+// index that publishes it.
+//
+// Every sound handed over is Cache_Locked, so it can't be thrown out
+// while queued or playing.  When a channel lets go of it the audio thread
+// sends it back on a second ring and S_Update unlocks it.  The cache can
+// still move locked data to grow the hunk, it holds the audio thread with
+// S_BlockSoundThread while it does, and the mixer always goes through
+// sfx->cache.data rather than keeping the pointer.
+// =======================================================================
+
+#define	MAX_SNDCMDS		256		// power of two
+#define	MAX_SNDRELEASES	1024	// power of two, see SND_AllocCommand
+
+#if MAX_SNDRELEASES <= MAX_SNDCMDS + MAX_CHANNELS
+#error MAX_SNDRELEASES must hold a lock for every queued command and channel
 #endif
-	Q_memset(channels, 0, MAX_CHANNELS * sizeof(channel_t));
+#define	SND_BARRIER()	__sync_synchronize ()
 
-	if (clear)
-		S_ClearBuffer ();
+static sndcmd_t		snd_cmds[MAX_SNDCMDS];
+static volatile int	snd_cmdhead;		// written by the game thread
+static volatile int	snd_cmdtail;		// written by the audio thread
+
+static sfx_t		*snd_releases[MAX_SNDRELEASES];
+static volatile int	snd_releasehead;	// written by the audio thread
+static volatile int	snd_releasetail;	// written by the game thread
+
+qboolean			snd_threaded;
+static volatile int	snd_threadstate;	// 1 running, 2 asked to quit, 0 stopped
+static volatile int	snd_threadhold;		// S_BlockSoundThread depth
+static volatile int	snd_threadparked;	// the audio thread is waiting out a hold
+
+int		snd_underruns;
+int		snd_cmdstalls;
+double	snd_maintime;
+int		snd_mainupdates;
+double	snd_threadtime;
+int		snd_threadupdates;
+
+static void SND_UnlockSounds (void);
+
+/*
+=================
+SND_AllocCommand
+
+Next free queue slot, waits for the audio thread if the queue is full.
+
+Unlocking whatever came back first bounds the release ring: every lock
+is taken just before a command is queued, so the ring never holds more
+than the locks in the queue and the channels, plus the one being taken.
+That keeps it from filling during a signon that starts thousands of
+static sounds without an S_Update in between.
+=================
+*/
+sndcmd_t *SND_AllocCommand (void)
+{
+	SND_UnlockSounds ();
+	while (((snd_cmdhead + 1) & (MAX_SNDCMDS-1)) == snd_cmdtail)
+	{
+		snd_cmdstalls++;
+		Sys_Delay (1);
+		SND_UnlockSounds ();
+	}
+	return &snd_cmds[snd_cmdhead];
 }
 
-void S_StopAllSoundsC (void)
+/*
+=================
+SND_PushCommand
+
+Hands the slot from SND_AllocCommand to the audio thread
+=================
+*/
+void SND_PushCommand (void)
 {
-	S_StopAllSounds (true);
+	SND_BARRIER ();
+	snd_cmdhead = (snd_cmdhead + 1) & (MAX_SNDCMDS-1);
 }
 
-void S_ClearBuffer (void)
+/*
+=================
+SND_ReleaseSound
+
+Gives back the lock S_StartSound or S_StaticSound took on sfx
+=================
+*/
+static void SND_ReleaseSound (sfx_t *sfx)
 {
-	int		clear;
-		
-	if (!sound_started || !shm || !shm->buffer)
+	if (!snd_threaded)
 		return;
 
-	if (shm->samplebits == 8)
-		clear = 0x80;
-	else
-		clear = 0;
+	if (((snd_releasehead + 1) & (MAX_SNDRELEASES-1)) == snd_releasetail)
+		Sys_Error ("SND_ReleaseSound: release ring full");
 
-	Q_memset(shm->buffer, clear, shm->samples * shm->samplebits/8);
+	snd_releases[snd_releasehead] = sfx;
+	SND_BARRIER ();
+	snd_releasehead = (snd_releasehead + 1) & (MAX_SNDRELEASES-1);
 }
 
-
 /*
 =================
-S_StaticSound
+SND_ClearChannel
 =================
 */
-void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
+void SND_ClearChannel (channel_t *ch)
 {
-	channel_t	*ss;
-	sfxcache_t		*sc;
+	if (ch->sfx)
+		SND_ReleaseSound (ch->sfx);
+	ch->sfx = NULL;
+}
 
-	if (!sfx)
-		return;
+/*
+=================
+SND_UnlockSounds
 
-	if (total_channels == MAX_CHANNELS)
+Game thread, unlocks the sounds the audio thread is done with
+=================
+*/
+static void SND_UnlockSounds (void)
+{
+	while (snd_releasetail != snd_releasehead)
 	{
-		Con_Printf ("total_channels == MAX_CHANNELS\n");
-		return;
+		SND_BARRIER ();
+		Cache_Unlock (&snd_releases[snd_releasetail]->cache);
+		snd_releasetail = (snd_releasetail + 1) & (MAX_SNDRELEASES-1);
 	}
+}
 
-	ss = &channels[total_channels];
-	total_channels++;
+/*
+=================
+S_BlockSoundThread
 
-	sc = S_LoadSound (sfx);
-	if (!sc)
+Waits until the audio thread is between mixes and keeps it there until
+S_UnblockSoundThread, for moving or freeing memory it reads
+=================
+*/
+void S_BlockSoundThread (void)
+{
+	if (!snd_threaded)
 		return;
 
-	if (sc->loopstart == -1)
-	{
-		Con_Printf ("Sound %s not looped\n", sfx->name);
-		return;
-	}
-	
-	ss->sfx = sfx;
-	VectorCopy (origin, ss->origin);
-	ss->master_vol = vol;
-	ss->dist_mult = (attenuation/64) / sound_nominal_clip_dist;
-    ss->end = paintedtime + sc->length;	
-	
-	SND_Spatialize (ss);
+	snd_threadhold++;
+	SND_BARRIER ();
+	while (!snd_threadparked)
+		Sys_Delay (1);
+	SND_BARRIER ();
 }
 
+void S_UnblockSoundThread (void)
+{
+	if (!snd_threaded)
+		return;
 
-//=============================================================================
+	SND_BARRIER ();
+	snd_threadhold--;
+}
 
 /*
-===================
-S_UpdateAmbientSounds
-===================
+=================
+SND_RunCommands
+=================
 */
-void S_UpdateAmbientSounds (void)
+static void SND_RunCommands (void)
 {
-	mleaf_t		*l;
-	float		vol;
-	int			ambient_channel;
-	channel_t	*chan;
-
-	if (!snd_ambient)
-		return;
-
-// calc ambient sound levels
-	if (!cl.worldmodel)
-		return;
+	sndcmd_t	*cmd;
 
-	l = Mod_PointInLeaf (listener_origin, cl.worldmodel);
-	if (!l || !ambient_level.value)
+	while (snd_cmdtail != snd_cmdhead)
 	{
-		for (ambient_channel = 0 ; ambient_channel< NUM_AMBIENTS ; ambient_channel++)
-			channels[ambient_channel].sfx = NULL;
-		return;
+		SND_BARRIER ();
+		cmd = &snd_cmds[snd_cmdtail];
+		switch (cmd->type)
+		{
+		case sndcmd_start:
+			SND_StartSound (cmd->entnum, cmd->entchannel, cmd->sfx, (sfxcache_t *)cmd->sfx->cache.data,
+				cmd->origin, cmd->fvol, cmd->attenuation, cmd->file, cmd->filestart);
+			break;
+		case sndcmd_static:
+			SND_StaticSound (cmd->sfx, (sfxcache_t *)cmd->sfx->cache.data, cmd->origin, cmd->fvol,
+				cmd->attenuation, cmd->leafnum, cmd->file, cmd->filestart);
+			break;
+		case sndcmd_stop:
+			SND_StopSound (cmd->entnum, cmd->entchannel);
+			break;
+		case sndcmd_stopall:
+			SND_StopAllSounds (cmd->clear);
+			break;
+		case sndcmd_listener:
+			VectorCopy (cmd->origin, listener_origin);
+			VectorCopy (cmd->forward, listener_forward);
+			VectorCopy (cmd->right, listener_right);
+			VectorCopy (cmd->up, listener_up);
+			listener_entnum = cmd->viewentity;
+			if (cmd->pvs)
+			{
+				snd_pvs = cmd->pvs;
+				snd_pvsleaf = cmd->leafnum;
+			}
+			break;
+		}
+		SND_BARRIER ();
+		snd_cmdtail = (snd_cmdtail + 1) & (MAX_SNDCMDS-1);
 	}
+}
 
-	for (ambient_channel = 0 ; ambient_channel< NUM_AMBIENTS ; ambient_channel++)
-	{
-		chan = &channels[ambient_channel];	
-		//chan->sfx = ambient_sfx[ambient_channel];
-	
-		vol = ambient_level.value * l->ambient_sound_level[ambient_channel];
-		if (vol < 8)
-			vol = 0;
+static void SND_UpdateChannels (void);
 
-	// don't adjust volume too fast
-		if (chan->master_vol < vol)
-		{
+/*
+=================
+SND_Thread
+=================
+*/
+static void SND_Thread (void *arg)
+{
+	double	start;
+
+	while (snd_threadstate == 1)
+	{
+		if (snd_threadhold)
+		{
+			snd_threadparked = 1;
+			while (snd_threadhold && snd_threadstate == 1)
+				Sys_Delay (1);
+			snd_threadparked = 0;
+			SND_BARRIER ();
+			continue;		// look at the hold again before mixing
+		}
+
+		start = Sys_FloatTime ();
+
+		SND_RunCommands ();
+		if (snd_blocked <= 0)
+		{
+			SND_UpdateChannels ();
+			S_Update_ ();
+		}
+
+		snd_threadtime += Sys_FloatTime () - start;
+		snd_threadupdates++;
+
+		Sys_Delay (5);
+	}
+
+	snd_threadstate = 0;
+}
+
+/*
+=================
+SND_StartThread
+=================
+*/
+static void SND_StartThread (void)
+{
+	snd_cmdhead = snd_cmdtail = 0;
+	snd_releasehead = snd_releasetail = 0;
+	snd_threadhold = snd_threadparked = 0;
+	snd_threadstate = 1;
+	if (!Sys_CreateThread ("sound_thread", SND_Thread, NULL))
+	{
+		Con_Printf ("couldn't start the sound thread\n");
+		snd_threadstate = 0;
+		return;
+	}
+	snd_threaded = true;
+	Con_Printf ("mixing on the sound thread\n");
+}
+
+/*
+=================
+SND_StopThread
+=================
+*/
+static void SND_StopThread (void)
+{
+	if (!snd_threaded)
+		return;
+
+	snd_threadstate = 2;
+	while (snd_threadstate)
+		Sys_Delay (1);
+
+// anything queued after the last mix, then give back every lock
+	SND_RunCommands ();
+	SND_StopAllSounds (false);
+	SND_UnlockSounds ();
+	snd_threaded = false;
+}
+
+/*
+=================
+S_ThreadStats_f
+
+snd_threadstats : main thread cost of S_Update, time the audio thread
+spends per mix, underruns and queue stalls since the last call
+=================
+*/
+void S_ThreadStats_f (void)
+{
+	Con_Printf ("%s\n", snd_threaded ? "mixing on the sound thread" : "mixing on the main thread");
+	if (snd_mainupdates)
+		Con_Printf ("S_Update: %.3f ms per call on the main thread\n", snd_maintime * 1000 / snd_mainupdates);
+	if (snd_threadupdates)
+		Con_Printf ("sound thread: %.3f ms per mix\n", snd_threadtime * 1000 / snd_threadupdates);
+	Con_Printf ("%i underruns, %i queue stalls\n", snd_underruns, snd_cmdstalls);
+
+	snd_maintime = snd_threadtime = 0;
+	snd_mainupdates = snd_threadupdates = 0;
+	snd_underruns = snd_cmdstalls = 0;
+}
+
+
+// =======================================================================
+// Start a sound effect
+// =======================================================================
+
+/*
+=================
+SND_StartSound
+
+Runs on the audio thread with -sndthread.  sc has been loaded and locked
+and any stream file opened by S_StartSound, file is closed and the lock
+given back if the sound isn't started.
+=================
+*/
+void SND_StartSound(int entnum, int entchannel, sfx_t *sfx, sfxcache_t *sc, vec3_t origin, float fvol, float attenuation, int file, int filestart)
+{
+	channel_t *target_chan, *check;
+	int		vol;
+	int		ch_idx;
+	int		skip;
+
+	vol = fvol*255;
+
+// pick a channel to play on
+	target_chan = SND_PickChannel(entnum, entchannel);
+	if (!target_chan)
+	{
+		if (file >= 0)
+			Sys_FileClose (file);
+		SND_ReleaseSound (sfx);
+		return;
+	}
+		
+// spatialize
+	memset (target_chan, 0, sizeof(*target_chan));
+	VectorCopy(origin, target_chan->origin);
+	target_chan->dist_mult = attenuation / sound_nominal_clip_dist;
+	target_chan->master_vol = vol;
+	target_chan->entnum = entnum;
+	target_chan->entchannel = entchannel;
+	SND_Spatialize(target_chan);
+
+	if (!target_chan->leftvol && !target_chan->rightvol)
+	{
+		if (file >= 0)
+			Sys_FileClose (file);
+		SND_ReleaseSound (sfx);
+		return;		// not audible at all
+	}
+
+// new channel
+	target_chan->sfx = sfx;
+	target_chan->pos = 0.0;
+	target_chan->loopstart = sc->loopstart;
+	target_chan->length = sc->length;
+	target_chan->step = SND_ChannelStep (sc);
+    target_chan->end = paintedtime + SND_PaintSamples (target_chan, sc->length);	
+	if (sc->streamofs && !SND_OpenStream (target_chan, sc, file, filestart))
+	{
+		SND_ClearChannel (target_chan);
+		return;		// out of streams
+	}
+
+// if an identical sound has also been started this frame, offset the pos
+// a bit to keep it from just making the first one louder
+	check = &channels[NUM_AMBIENTS];
+    for (ch_idx=NUM_AMBIENTS ; ch_idx < NUM_AMBIENTS + MAX_DYNAMIC_CHANNELS ; ch_idx++, check++)
+    {
+		if (check == target_chan)
+			continue;
+		if (check->sfx == sfx && !check->pos)
+		{
+			skip = rand () % (int)(0.1*shm->speed);
+			if (skip >= target_chan->end)
+				skip = target_chan->end - 1;
+			target_chan->pos += skip;
+			target_chan->end = paintedtime + SND_PaintSamples (target_chan, target_chan->length - target_chan->pos);
+			break;
+		}
+		
+	}
+}
+
+void S_StartSound(int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
+{
+	sfxcache_t	*sc;
+	sndcmd_t	*cmd;
+	int			file, filestart;
+
+	if (!sound_started)
+		return;
+
+	if (!sfx)
+		return;
+
+	if (nosound.value)
+		return;
+
+// the cache isn't thread safe, so the sound is always loaded here
+	sc = S_LoadSound (sfx);
+	if (!sc)
+		return;		// couldn't load the sound's data
+
+	file = filestart = -1;
+	if (sc->streamofs)
+	{
+		file = SND_OpenStreamFile (sfx, &filestart);
+		if (file < 0)
+			return;
+	}
+
+	if (!snd_threaded)
+	{
+		SND_StartSound (entnum, entchannel, sfx, sc, origin, fvol, attenuation, file, filestart);
+		return;
+	}
+
+	Cache_Lock (&sfx->cache);
+	cmd = SND_AllocCommand ();
+	cmd->type = sndcmd_start;
+	cmd->entnum = entnum;
+	cmd->entchannel = entchannel;
+	cmd->sfx = sfx;
+	VectorCopy (origin, cmd->origin);
+	cmd->fvol = fvol;
+	cmd->attenuation = attenuation;
+	cmd->file = file;
+	cmd->filestart = filestart;
+	SND_PushCommand ();
+}
+
+void SND_StopSound(int entnum, int entchannel)
+{
+	int i;
+
+	for (i=0 ; i<MAX_DYNAMIC_CHANNELS ; i++)
+	{
+		if (channels[i].entnum == entnum
+			&& channels[i].entchannel == entchannel)
+		{
+			channels[i].end = 0;
+			SND_ClearChannel (&channels[i]);
+			return;
+		}
+	}
+}
+
+void S_StopSound(int entnum, int entchannel)
+{
+	sndcmd_t	*cmd;
+
+	if (!snd_threaded)
+	{
+		SND_StopSound (entnum, entchannel);
+		return;
+	}
+
+	cmd = SND_AllocCommand ();
+	cmd->type = sndcmd_stop;
+	cmd->entnum = entnum;
+	cmd->entchannel = entchannel;
+	SND_PushCommand ();
+}
+
+void SND_StopAllSounds(qboolean clear)
+{
+	int		i;
+
+	total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;	// no statics
+
+	for (i=0 ; i<MAX_CHANNELS ; i++)
+		SND_ClearChannel (&channels[i]);
+#ifdef DSP2
+    DSP_ClearState();
+#endif
+	SND_StopStreams ();
+	Q_memset(channels, 0, MAX_CHANNELS * sizeof(channel_t));
+	snd_numemitters = 0;
+	snd_staticleaf = -1;
+
+	if (clear)
+		S_ClearBuffer ();
+}
+
+void S_StopAllSounds(qboolean clear)
+{
+	sndcmd_t	*cmd;
+
+	if (!sound_started)
+		return;
+
+	snd_pvsbufleaf = -1;		// the map may be changing, send the PVS again
+
+	if (!snd_threaded)
+	{
+		SND_StopAllSounds (clear);
+		return;
+	}
+
+	cmd = SND_AllocCommand ();
+	cmd->type = sndcmd_stopall;
+	cmd->clear = clear;
+	SND_PushCommand ();
+
+// the map may be freed right after this, so don't return while the sound
+// thread still has a channel, then unlock everything it had
+	while (snd_cmdtail != snd_cmdhead)
+		Sys_Delay (1);
+	SND_UnlockSounds ();
+}
+
+void S_StopAllSoundsC (void)
+{
+	S_StopAllSounds (true);
+}
+
+void S_ClearBuffer (void)
+{
+	int		clear;
+		
+	if (!sound_started || !shm || !shm->buffer)
+		return;
+
+	if (shm->samplebits == 8)
+		clear = 0x80;
+	else
+		clear = 0;
+
+	Q_memset(shm->buffer, clear, shm->samples * shm->samplebits/8);
+}
+
+
+/*
+=================
+SND_StaticSound
+=================
+*/
+void SND_StaticSound (sfx_t *sfx, sfxcache_t *sc, vec3_t origin, float vol, float attenuation, int leafnum, int file, int filestart)
+{
+	channel_t		*ss;
+	sndemitter_t	*e;
+	int				i;
+
+	if (snd_numemitters == MAX_STATIC_EMITTERS)
+	{
+		if (file >= 0)
+			Sys_FileClose (file);
+		SND_ReleaseSound (sfx);
+		return;
+	}
+
+	e = &snd_emitters[snd_numemitters];
+	VectorCopy (origin, e->origin);
+	e->master_vol = vol;
+	e->dist_mult = (attenuation/64) / sound_nominal_clip_dist;
+
+// join a cluster of the same sound in the same leaf, it has the lock
+	ss = channels + MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;
+	for (i=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS ; i<total_channels ; i++, ss++)
+	{
+		if (ss->sfx != sfx || ss->leafnum != leafnum || !ss->emitters)
+			continue;
+		if (file >= 0)
+			Sys_FileClose (file);
+		SND_ReleaseSound (sfx);
+		e->next = ss->emitters;
+		ss->emitters = e;
+		snd_numemitters++;
+		SND_SpatializeCluster (ss);
+		return;
+	}
+
+	if (total_channels == MAX_CHANNELS)
+	{
+		if (!snd_threaded)
+			Con_Printf ("total_channels == MAX_CHANNELS\n");
+		if (file >= 0)
+			Sys_FileClose (file);
+		SND_ReleaseSound (sfx);
+		return;
+	}
+
+	ss = &channels[total_channels];
+	total_channels++;
+
+	ss->sfx = sfx;
+	VectorCopy (origin, ss->origin);
+	ss->master_vol = vol;
+	ss->dist_mult = e->dist_mult;
+	ss->loopstart = sc->loopstart;
+	ss->length = sc->length;
+	ss->step = SND_ChannelStep (sc);
+    ss->end = paintedtime + SND_PaintSamples (ss, sc->length);	
+	if (sc->streamofs && !SND_OpenStream (ss, sc, file, filestart))
+	{
+		SND_ClearChannel (ss);
+		return;
+	}
+
+	e->next = NULL;
+	ss->emitters = e;
+	ss->leafnum = leafnum;
+	snd_numemitters++;
+	
+	SND_SpatializeCluster (ss);
+}
+
+/*
+=================
+S_StaticSound
+=================
+*/
+void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
+{
+	sfxcache_t	*sc;
+	sndcmd_t	*cmd;
+	int			file, filestart;
+
+	if (!sfx)
+		return;
+
+	sc = S_LoadSound (sfx);
+	if (!sc)
+		return;
+
+	if (sc->loopstart == -1)
+	{
+		Con_Printf ("Sound %s not looped\n", sfx->name);
+		return;
+	}
+
+	file = filestart = -1;
+	if (sc->streamofs)
+	{
+		file = SND_OpenStreamFile (sfx, &filestart);
+		if (file < 0)
+			return;
+	}
+
+	if (!snd_threaded)
+	{
+		SND_StaticSound (sfx, sc, origin, vol, attenuation, SND_LeafNum (origin), file, filestart);
+		return;
+	}
+
+	Cache_Lock (&sfx->cache);
+	cmd = SND_AllocCommand ();
+	cmd->type = sndcmd_static;
+	cmd->sfx = sfx;
+	VectorCopy (origin, cmd->origin);
+	cmd->leafnum = SND_LeafNum (origin);
+	cmd->fvol = vol;
+	cmd->attenuation = attenuation;
+	cmd->file = file;
+	cmd->filestart = filestart;
+	SND_PushCommand ();
+}
+
+
+//=============================================================================
+
+/*
+===================
+S_UpdateAmbientSounds
+===================
+*/
+void S_UpdateAmbientSounds (void)
+{
+	mleaf_t		*l;
+	float		vol;
+	int			ambient_channel;
+	channel_t	*chan;
+
+	if (!snd_ambient)
+		return;
+
+// calc ambient sound levels
+	if (!cl.worldmodel)
+		return;
+
+	l = Mod_PointInLeaf (listener_origin, cl.worldmodel);
+	if (!l || !ambient_level.value)
+	{
+		for (ambient_channel = 0 ; ambient_channel< NUM_AMBIENTS ; ambient_channel++)
+			channels[ambient_channel].sfx = NULL;
+		return;
+	}
+
+	for (ambient_channel = 0 ; ambient_channel< NUM_AMBIENTS ; ambient_channel++)
+	{
+		chan = &channels[ambient_channel];	
+		//chan->sfx = ambient_sfx[ambient_channel];
+	
+		vol = ambient_level.value * l->ambient_sound_level[ambient_channel];
+		if (vol < 8)
+			vol = 0;
+
+	// don't adjust volume too fast
+		if (chan->master_vol < vol)
+		{
 			chan->master_vol += host_frametime * ambient_fade.value;
 			if (chan->master_vol > vol)
 				chan->master_vol = vol;
@@ -678,83 +1385,103 @@ void S_UpdateAmbientSounds (void)
 
 /*
 ============
-S_Update
-
-Called once each time through the main loop
+SND_VoicePriority
 ============
 */
-void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+static int SND_VoicePriority (channel_t *ch)
 {
-	int			i, j;
-	int			total;
-	channel_t	*ch;
-	channel_t	*combine;
+	int		vol;
 
-	if (!sound_started || (snd_blocked > 0))
-		return;
+	vol = ch->leftvol + ch->rightvol;
+	if (ch->entnum == listener_entnum)
+		vol <<= 1;		// the player's own sounds win ties with monsters
+	return vol;
+}
 
-	VectorCopy(origin, listener_origin);
-	VectorCopy(forward, listener_forward);
-	VectorCopy(right, listener_right);
-	VectorCopy(up, listener_up);
+static int SND_CompareVoices (const void *a, const void *b)
+{
+	return SND_VoicePriority (*(channel_t **)b) - SND_VoicePriority (*(channel_t **)a);
+}
 
-// update general area ambient sound sources
-	//S_UpdateAmbientSounds ();
+/*
+============
+SND_CullVoices
 
-	combine = NULL;
+Keeps the maxvoices loudest channels real after spatialization and
+makes the rest virtual, so the mixer only advances their position
+============
+*/
+void SND_CullVoices (int maxvoices)
+{
+	static channel_t	*voices[MAX_CHANNELS];
+	channel_t			*ch;
+	int					i, numvoices;
 
-// update spatialization for static and dynamic sounds
-	ch = channels+NUM_AMBIENTS;
-	for (i=NUM_AMBIENTS ; i<total_channels; i++, ch++)
+	numvoices = 0;
+	snd_virtualvoices = 0;
+	for (i=0, ch=channels ; i<total_channels ; i++, ch++)
 	{
 		if (!ch->sfx)
 			continue;
-		SND_Spatialize(ch);         // respatialize channel
-		if (!ch->leftvol && !ch->rightvol)
-			continue;
-
-	// try to combine static sounds with a previous channel of the same
-	// sound effect so we don't mix five torches every frame
-
-		if (i >= MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS)
+		ch->isvirtual = false;
+		if (ch->leftvol + ch->rightvol < snd_voicecull.value)
 		{
-		// see if it can just use the last one
-			if (combine && combine->sfx == ch->sfx)
-			{
-				combine->leftvol += ch->leftvol;
-				combine->rightvol += ch->rightvol;
-				ch->leftvol = ch->rightvol = 0;
-				continue;
-			}
-		// search for one
-			combine = channels+MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;
-			for (j=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS ; j<i; j++, combine++)
-				if (combine->sfx == ch->sfx)
-					break;
-
-			if (j == total_channels)
-			{
-				combine = NULL;
-			}
-			else
+			if (ch->leftvol || ch->rightvol)
 			{
-				if (combine != ch)
-				{
-					combine->leftvol += ch->leftvol;
-					combine->rightvol += ch->rightvol;
-					ch->leftvol = ch->rightvol = 0;
-				}
-				continue;
+				ch->isvirtual = true;
+				snd_virtualvoices++;
 			}
+			continue;
 		}
+		voices[numvoices++] = ch;
+	}
 
+	if (maxvoices > 0 && numvoices > maxvoices)
+	{
+		qsort (voices, numvoices, sizeof(voices[0]), SND_CompareVoices);
+		for (i=maxvoices ; i<numvoices ; i++)
+			voices[i]->isvirtual = true;
+		snd_virtualvoices += numvoices - maxvoices;
+		numvoices = maxvoices;
+	}
+
+	snd_realvoices = numvoices;
+}
 
+/*
+============
+SND_UpdateChannels
+
+Respatializes and culls the channels for the current listener
+============
+*/
+static void SND_UpdateChannels (void)
+{
+	int			i;
+	int			total;
+	channel_t	*ch;
+
+// update general area ambient sound sources
+	//S_UpdateAmbientSounds ();
+
+// update spatialization for dynamic sounds
+	ch = channels+NUM_AMBIENTS;
+	for (i=NUM_AMBIENTS ; i<MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS; i++, ch++)
+	{
+		if (!ch->sfx)
+			continue;
+		SND_Spatialize(ch);         // respatialize channel
 	}
 
+// static sounds are already combined into clusters
+	SND_UpdateStaticClusters ();
+
+	SND_CullVoices (snd_maxvoices.value);
+
 //
 // debugging output
 //
-	if (snd_show.value)
+	if (snd_show.value && !snd_threaded)
 	{
 		total = 0;
 		ch = channels;
@@ -765,11 +1492,71 @@ void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 				total++;
 			}
 
-		Con_Printf ("----(%i)----\n", total);
+		Con_Printf ("----(%i)---- %i real %i virtual\n", total, snd_realvoices, snd_virtualvoices);
 	}
+}
 
-// mix some sound
-	S_Update_();
+/*
+============
+S_Update
+
+Called once each time through the main loop
+============
+*/
+void S_Update(vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+	sndcmd_t	*cmd;
+	double		start;
+	int			leafnum;
+	byte		*pvs;
+
+	if (!sound_started || (snd_blocked > 0))
+		return;
+
+	start = Sys_FloatTime ();
+
+// the world model belongs to this thread, look up the listener here
+	leafnum = SND_LeafNum (origin);
+	pvs = SND_ListenerPVS (leafnum);
+
+	if (snd_threaded)
+	{
+		SND_UnlockSounds ();
+
+		cmd = SND_AllocCommand ();
+		cmd->type = sndcmd_listener;
+		VectorCopy (origin, cmd->origin);
+		VectorCopy (forward, cmd->forward);
+		VectorCopy (right, cmd->right);
+		VectorCopy (up, cmd->up);
+		cmd->viewentity = cl.viewentity;
+		cmd->leafnum = leafnum;
+		cmd->pvs = pvs;
+		SND_PushCommand ();
+	}
+	else
+	{
+		VectorCopy(origin, listener_origin);
+		VectorCopy(forward, listener_forward);
+		VectorCopy(right, listener_right);
+		VectorCopy(up, listener_up);
+		listener_entnum = cl.viewentity;
+		if (pvs)
+		{
+			snd_pvs = pvs;
+			snd_pvsleaf = leafnum;
+		}
+
+		SND_UpdateChannels ();
+
+	// mix some sound
+		S_Update_();
+	}
+
+	snd_maintime += Sys_FloatTime () - start;
+	snd_mainupdates++;
+
+	S_StatsFrame ();
 }
 
 void GetSoundtime(void)
@@ -797,7 +1584,9 @@ void GetSoundtime(void)
 		{	// time to chop things off to avoid 32 bit limits
 			buffers = 0;
 			paintedtime = fullsamples;
-			S_StopAllSounds (true);
+		// this is the mixer, which may be the sound thread, so stop the
+		// channels directly rather than queueing it to itself
+			SND_StopAllSounds (true);
 		}
 	}
 	oldsamplepos = samplepos;
@@ -808,7 +1597,7 @@ void GetSoundtime(void)
 
 void S_ExtraUpdate (void)
 {
-	if (snd_noextraupdate.value)
+	if (snd_noextraupdate.value || snd_threaded)
 		return;		// don't pollute timings
 	S_Update_();
 }
@@ -819,6 +1608,7 @@ void S_Update_(void)
 {
 	unsigned        endtime;
 	int				samps;
+	double			start;
 	
 	if (!sound_started || (snd_blocked > 0))
 		return;
@@ -831,7 +1621,10 @@ void S_Update_(void)
 	{
 		//Con_Printf ("S_Update_ : overflow\n");
 		paintedtime = soundtime;
+		snd_underruns++;
+		snd_stats.underruns++;
 	}
+	snd_stats.lag = paintedtime - soundtime;
 
 // mix ahead of current position
 	endtime = soundtime + _snd_mixahead.value * shm->speed;
@@ -839,9 +1632,13 @@ void S_Update_(void)
 	if (endtime - soundtime > samps)
 		endtime = soundtime + samps;
 
+	SND_UpdateStreams ();
 	S_PaintChannels (endtime);
 
+	start = Sys_FloatTime ();
 	SNDDMA_Submit ();
+	snd_stats.stagetime[sst_transfer] += Sys_FloatTime () - start;
+	snd_stats.updates++;
 }
 
 /*
@@ -905,25 +1702,253 @@ void S_SoundList(void)
 	int		i;
 	sfx_t	*sfx;
 	sfxcache_t	*sc;
-	int		size, total;
+	int		size, total, resident, reloads;
 
-	total = 0;
+	total = resident = reloads = 0;
 	for (sfx=known_sfx, i=0 ; i<num_sfx ; i++, sfx++)
 	{
+		if (sfx->loads > 1)
+			reloads += sfx->loads - 1;
 		sc = Cache_Check (&sfx->cache);
 		if (!sc)
 			continue;
-		size = sc->length*sc->width*(sc->stereo+1);
+		resident++;
+		if (sc->adpcm)
+			size = S_ADPCMSize (sc->length + 1);
+		else if (sc->streamofs)
+			size = 0;
+		else
+			size = sc->length*sc->width*(sc->stereo+1);
 		total += size;
 		if (sc->loopstart >= 0)
 			Con_Printf ("L");
 		else
 			Con_Printf (" ");
-		Con_Printf("(%2db) %6i : %s\n",sc->width*8,  size, sfx->name);
+		Con_Printf("(%2db) %6i : %s\n", sc->adpcm ? 4 : sc->width*8,  size, sfx->name);
+	}
+	Con_Printf ("Total resident: %i in %i of %i sounds\n", total, resident, num_sfx);
+	Con_Printf ("%i loads, %i of them reloading evicted sounds\n", snd_loads, reloads);
+}
+
+
+/*
+=================
+S_VoiceBench_f
+
+snd_voicebench [emitters] [passes] : spatializes, culls and mixes that
+many looping emitters scattered around the listener, with snd_maxvoices
+and with every voice real.  Uses the first loaded sound.
+=================
+*/
+void S_VoiceBench_f (void)
+{
+	static channel_t	saved[MAX_CHANNELS];
+	static portable_samplepair_t	buf[512];
+	int			savedtotal, emitters, passes, i, j, pass;
+	sfx_t		*sfx;
+	sfxcache_t	*sc;
+	channel_t	*ch;
+	double		start, time[2];
+
+	if (!sound_started)
+		return;
+	if (snd_threaded)
+	{
+		Con_Printf ("the sound thread owns the channels, not with -sndthread\n");
+		return;
+	}
+
+	emitters = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 300;
+	passes = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 100;
+	if (emitters > MAX_CHANNELS - (MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS))
+		emitters = MAX_CHANNELS - (MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS);
+	if (passes < 1)
+		passes = 1;
+
+	sc = NULL;
+	for (i=0, sfx=known_sfx ; i<num_sfx ; i++, sfx++)
+		if ((sc = Cache_Check (&sfx->cache)) != NULL && !sc->streamofs)
+			break;
+	if (!sc)
+	{
+		Con_Printf ("no sounds loaded\n");
+		return;
+	}
+
+	memcpy (saved, channels, sizeof(saved));
+	savedtotal = total_channels;
+
+	for (pass=0 ; pass<2 ; pass++)
+	{
+		memset (channels, 0, sizeof(channels));
+		total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS + emitters;
+		for (i=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS, ch=&channels[i] ; i<total_channels ; i++, ch++)
+		{
+			ch->sfx = sfx;
+			for (j=0 ; j<3 ; j++)
+				ch->origin[j] = listener_origin[j] + (rand() % 3000) - 1500;
+			ch->master_vol = 255;
+			ch->dist_mult = 1.0 / sound_nominal_clip_dist;
+			ch->loopstart = 0;
+			ch->length = sc->length;
+			ch->step = SND_ChannelStep (sc);
+			ch->pos = rand() % sc->length;
+			ch->end = paintedtime + SND_PaintSamples (ch, sc->length - ch->pos);
+		}
+
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes ; i++)
+		{
+			for (j=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS, ch=&channels[j] ; j<total_channels ; j++, ch++)
+				SND_Spatialize (ch);
+			SND_CullVoices (pass ? 0 : snd_maxvoices.value);
+			memset (buf, 0, sizeof(buf));
+			MIX_MixChannelsToPaintbuffer (paintedtime + 512, buf);
+		}
+		time[pass] = (Sys_FloatTime () - start) * 1000000 / passes;
+
+		Con_Printf ("%s: %i real %i virtual, %.1f us per 512 samples\n", pass ? "unlimited" : "snd_maxvoices",
+			snd_realvoices, snd_virtualvoices, time[pass]);
 	}
-	Con_Printf ("Total resident: %i\n", total);
+
+	memcpy (channels, saved, sizeof(saved));
+	total_channels = savedtotal;
+	SND_CullVoices (snd_maxvoices.value);
 }
 
+/*
+================
+S_StaticBench_f
+
+snd_staticbench [emitters] [passes] : places that many looping static
+sounds around the listener, using the first few loaded sounds, and times
+a frame of spatializing, culling and mixing them one channel per emitter
+with the old per frame combining, then as clusters, moving and standing
+================
+*/
+void S_StaticBench_f (void)
+{
+	static channel_t	saved[MAX_CHANNELS];
+	static sndemitter_t	savedemitters[MAX_STATIC_EMITTERS];
+	static portable_samplepair_t	buf[512];
+	static vec3_t		origins[MAX_CHANNELS];
+	sfx_t		*sfxs[4], *sfx;
+	sfxcache_t	*sc;
+	channel_t	*ch, *combine;
+	int			savedtotal, savedemitted, emitters, passes, numsfx, i, j, k, pass, used;
+	double		start, time;
+
+	if (!sound_started)
+		return;
+	if (snd_threaded)
+	{
+		Con_Printf ("the sound thread owns the channels, not with -sndthread\n");
+		return;
+	}
+
+	emitters = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 500;
+	passes = Cmd_Argc() > 2 ? Q_atoi(Cmd_Argv(2)) : 100;
+	if (emitters > MAX_CHANNELS - (MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS))
+		emitters = MAX_CHANNELS - (MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS);
+	if (emitters < 1)
+		emitters = 1;
+	if (passes < 1)
+		passes = 1;
+
+	numsfx = 0;
+	for (i=0, sfx=known_sfx ; i<num_sfx && numsfx < 4 ; i++, sfx++)
+		if ((sc = Cache_Check (&sfx->cache)) != NULL && !sc->streamofs)
+			sfxs[numsfx++] = sfx;
+	if (!numsfx)
+	{
+		Con_Printf ("no sounds loaded\n");
+		return;
+	}
+
+	memcpy (saved, channels, sizeof(saved));
+	savedtotal = total_channels;
+	memcpy (savedemitters, snd_emitters, sizeof(savedemitters));
+	savedemitted = snd_numemitters;
+
+	for (i=0 ; i<emitters ; i++)
+		for (j=0 ; j<3 ; j++)
+			origins[i][j] = listener_origin[j] + (rand() % 3000) - 1500;
+
+	for (pass=0 ; pass<3 ; pass++)
+	{
+		memset (channels, 0, sizeof(channels));
+		total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS;
+		snd_numemitters = 0;
+		snd_staticleaf = -1;
+
+		for (i=0 ; i<emitters ; i++)
+		{
+			sfx = sfxs[i % numsfx];
+			sc = Cache_Check (&sfx->cache);
+			if (pass)
+			{
+				SND_StaticSound (sfx, sc, origins[i], 255, 1, SND_LeafNum (origins[i]), -1, -1);
+				continue;
+			}
+			ch = &channels[total_channels++];
+			ch->sfx = sfx;
+			VectorCopy (origins[i], ch->origin);
+			ch->master_vol = 255;
+			ch->dist_mult = (1.0/64) / sound_nominal_clip_dist;
+			ch->loopstart = sc->loopstart;
+			ch->length = sc->length;
+			ch->step = SND_ChannelStep (sc);
+			ch->end = paintedtime + SND_PaintSamples (ch, sc->length);
+		}
+		used = total_channels - (MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS);
+
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes ; i++)
+		{
+			if (!pass)
+			{
+			// what SND_UpdateChannels did before the clusters
+				for (j=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS, ch=&channels[j] ; j<total_channels ; j++, ch++)
+				{
+					SND_Spatialize (ch);
+					if (!ch->leftvol && !ch->rightvol)
+						continue;
+					for (k=MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS, combine=&channels[k] ; k<j ; k++, combine++)
+						if (combine->sfx == ch->sfx)
+							break;
+					if (combine != ch)
+					{
+						combine->leftvol += ch->leftvol;
+						combine->rightvol += ch->rightvol;
+						ch->leftvol = ch->rightvol = 0;
+					}
+				}
+			}
+			else
+			{
+				if (pass == 1)
+					snd_staticorigin[0] = listener_origin[0] + 1;	// as if the listener moved
+				SND_UpdateStaticClusters ();
+			}
+			SND_CullVoices (snd_maxvoices.value);
+			memset (buf, 0, sizeof(buf));
+			MIX_MixChannelsToPaintbuffer (paintedtime + 512, buf);
+		}
+		time = (Sys_FloatTime () - start) * 1000000 / passes;
+
+		Con_Printf ("%s: %i emitters on %i channels, %i real, %.1f us per frame\n",
+			pass == 0 ? "per emitter" : pass == 1 ? "clustered, moving" : "clustered, standing",
+			emitters, used, snd_realvoices, time);
+	}
+
+	memcpy (channels, saved, sizeof(saved));
+	total_channels = savedtotal;
+	memcpy (snd_emitters, savedemitters, sizeof(savedemitters));
+	snd_numemitters = savedemitted;
+	snd_staticleaf = -1;
+	SND_UpdateStaticClusters ();
+	SND_CullVoices (snd_maxvoices.value);
+}
 
 void S_LocalSound (char *sound)
 {
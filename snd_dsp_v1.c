@@ -1145,6 +1145,25 @@ void SX_ReloadRoomFX()
 }
 
 
+// drop the delay lines and filter memory so the next room starts from
+// silence, as it does after SX_Init.  Used by snd_dsprender.
+
+void SX_ResetState()
+{
+	SX_Free();
+
+	Q_memset(rgsxdly, 0, sizeof (dlyline_t) * CSXDLYMAX);
+	Q_memset(rgsxlp, 0, sizeof(int) * CSXLPMAX);
+
+	sxamodl = sxamodr = 255;
+	sxamodlt = sxamodrt = 255;
+	sxmod1cur = sxmod1;
+	sxmod2cur = sxmod2;
+
+	SX_ReloadRoomFX();
+}
+
+
 // main routine for processing room sound fx
 // if fFilter is TRUE, then run in-line filter (for underwater fx)
 // if fTimefx is TRUE, then run reverb and delay fx
@@ -1152,8 +1171,6 @@ void SX_ReloadRoomFX()
 
 void SX_RoomFX(int endtime, int fFilter, int fTimefx)
 {
-	int fReset;
-	int i;
 	int sampleCount;
 	float roomType;
 
@@ -1166,8 +1183,6 @@ void SX_RoomFX(int endtime, int fFilter, int fTimefx)
 	if (sampleCount < 0)
 		return;
 
-	fReset = 0;
-	
 	if (key_dest == key_menu)
 		roomType = 0;
 	else if (sv.active && sv_player->v.waterlevel > 2 )
@@ -1175,6 +1190,19 @@ void SX_RoomFX(int endtime, int fFilter, int fTimefx)
 	else 
 	    roomType = sxroom_type.value;
 
+	SX_ProcessRoom(roomType, sampleCount, fFilter, fTimefx);
+}
+
+// run the room fx for roomType over the first sampleCount samples of
+// the paintbuffer
+
+void SX_ProcessRoom(float roomType, int sampleCount, int fFilter, int fTimefx)
+{
+	int fReset;
+	int i;
+
+	fReset = 0;
+
 	// only process legacy roomtypes here
 	if ( (int)roomType >= CSXROOM )
 		return;
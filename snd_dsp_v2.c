@@ -281,7 +281,10 @@ GNU General Public License for more details.
 // t = 0...D
 int tap( int D, int *w, int *p, int t )
 {
-	return w[(p - w + t) % (D + 1)];
+	int	i = p - w + t;		// p - w and t are both 0...D
+
+	if( i > D ) i -= D + 1;
+	return w[i];
 }
 
 // tapi - interpolated tap output of a delay line
@@ -441,6 +444,159 @@ int dly_lowpass( int D, int t, int *w, int **p, int a, int b, int M, int *af, in
 	return (( y * b ) >> PBITS );
 }
 
+/////////////////////////////
+// block delay line helpers
+/////////////////////////////
+
+// The dly_xxx_n functions run the reverberators above over a block of
+// samples with exactly the same arithmetic.  Instead of taking tap()'s
+// modulo every sample they walk the write index ip and the tap index it
+// down the buffer, and only check for a wrap between runs.
+// in and out may be the same array.
+
+#define DSP_BLOCK		256		// max samples per call of a block processor
+
+// write and tap index of a delay line, as cdelay() and tap() see them
+static void dly_index( int D, int t, int *w, int *p, int *ip, int *it )
+{
+	*ip = p - w;
+	*it = *ip + t;
+	if( *it > D ) *it -= D + 1;
+}
+
+// samples until either index has to wrap to D
+static int dly_run( int ip, int it, int count )
+{
+	if( count > ip + 1 ) count = ip + 1;
+	if( count > it + 1 ) count = it + 1;
+	return count;
+}
+
+void dly_plain_n( int D, int t, int *w, int **p, int a, int b, int *in, int *out, int count )
+{
+	int	ip, it, n, y;
+
+	dly_index( D, t, w, *p, &ip, &it );
+
+	while( count )
+	{
+		n = dly_run( ip, it, count );
+		count -= n;
+		while( n-- )
+		{
+			y = *in++ + (( a * w[it--] ) >> PBITS );
+			w[ip--] = y;
+			*out++ = ( y * b ) >> PBITS;
+		}
+		if( ip < 0 ) ip = D;
+		if( it < 0 ) it = D;
+	}
+	*p = w + ip;
+}
+
+void dly_linear_n( int D, int t, int *w, int **p, int *in, int *out, int count )
+{
+	int	ip, it, n, y;
+
+	dly_index( D, t, w, *p, &ip, &it );
+
+	while( count )
+	{
+		n = dly_run( ip, it, count );
+		count -= n;
+		while( n-- )
+		{
+			y = w[it--];
+			w[ip--] = *in++;
+			*out++ = y;
+		}
+		if( ip < 0 ) ip = D;
+		if( it < 0 ) it = D;
+	}
+	*p = w + ip;
+}
+
+void dly_allpass_n( int D, int t, int *w, int **p, int a, int b, int *in, int *out, int count )
+{
+	int	ip, it, n, y, s0, sD;
+
+	dly_index( D, t, w, *p, &ip, &it );
+
+	while( count )
+	{
+		n = dly_run( ip, it, count );
+		count -= n;
+		while( n-- )
+		{
+			sD = w[it--];
+			s0 = *in++ + (( a * sD ) >> PBITS );
+			y = (( -a * s0 ) >> PBITS ) + sD;
+			w[ip--] = s0;
+			*out++ = ( y * b ) >> PBITS;
+		}
+		if( ip < 0 ) ip = D;
+		if( it < 0 ) it = D;
+	}
+	*p = w + ip;
+}
+
+// the 1st order filter FLT_Params designs for QUA_MED, which is what the
+// reverb presets end up with, is done in registers.  Other orders go
+// through iir_filter.
+void dly_lowpass_n( int D, int t, int *w, int **p, int a, int b, int M, int *af, int L, int *bf, int *vf, int *in, int *out, int count )
+{
+	int	ip, it, n, y, sD;
+	int	a1, b0, b1, w1, x0, f;
+
+	dly_index( D, t, w, *p, &ip, &it );
+
+	if( M == 1 && L == 1 )
+	{
+		a1 = af[1];
+		b0 = bf[0];
+		b1 = bf[1];
+		w1 = vf[1];
+
+		while( count )
+		{
+			n = dly_run( ip, it, count );
+			count -= n;
+			while( n-- )
+			{
+				sD = w[it--];
+				x0 = sD - (( a1 * w1 ) >> PBITS );
+				f = (( b1 * w1 ) >> PBITS ) + (( b0 * x0 ) >> PBITS );
+				w1 = x0;
+				y = *in++ + (( f * a ) >> PBITS );
+				w[ip--] = y;
+				*out++ = ( y * b ) >> PBITS;
+			}
+			if( ip < 0 ) ip = D;
+			if( it < 0 ) it = D;
+		}
+
+		vf[0] = vf[1] = w1;
+		*p = w + ip;
+		return;
+	}
+
+	while( count )
+	{
+		n = dly_run( ip, it, count );
+		count -= n;
+		while( n-- )
+		{
+			sD = w[it--];
+			y = *in++ + (( iir_filter( M, af, L, bf, vf, sD ) * a ) >> PBITS );
+			w[ip--] = y;
+			*out++ = ( y * b ) >> PBITS;
+		}
+		if( ip < 0 ) ip = D;
+		if( it < 0 ) it = D;
+	}
+	*p = w + ip;
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////////
 // fixed point math for real-time wave table traversing, pitch shifting, resampling
@@ -466,6 +622,7 @@ typedef int fix20int;
 typedef void * (*prc_Param_t)( void *pprc );			// individual processor allocation functions
 typedef int (*prc_GetNext_t)( void *pdata, int x );		// get next function for processor
 typedef int (*prc_GetNextN_t)( void *pdata,  portable_samplepair_t *pbuffer, int SampleCount, int op);	// batch version of getnext
+typedef void (*prc_GetNextBlock_t)( void *pdata, int *pbuffer, int SampleCount );	// in place on up to DSP_BLOCK samples of one channel
 typedef void (*prc_Free_t)( void *pdata );			// free function for processor
 typedef void (*prc_Mod_t)(void *pdata, float v);			// modulation function for processor	
 
@@ -506,6 +663,7 @@ typedef struct
 	prc_GetNextN_t	pfnGetNextN;	// batch version of get next
 	prc_Free_t	pfnFree;		// free function
 	prc_Mod_t		pfnMod;		// modulation function
+	prc_GetNextBlock_t	pfnGetNextBlock;	// block version of get next, NULL if per sample only
 
 	void		*pdata;		// processor state data - ie: pdly, pflt etc.
 } prc_t;
@@ -911,6 +1069,37 @@ flt_t * FLT_Params ( prc_t *pprc )
 	}
 }
 
+// block version, in place on one channel
+void FLT_GetNextBlock( flt_t *pf, int *pbuffer, int SampleCount )
+{
+	int	a1, b0, b1, w1, x0;
+
+	if( pf->M != 1 || pf->L != 1 )
+	{
+		while( SampleCount-- )
+		{
+			*pbuffer = iir_filter( pf->M, pf->a, pf->L, pf->b, pf->w, *pbuffer );
+			pbuffer++;
+		}
+		return;
+	}
+
+	// 1st order IIR, as iir_filter does it for M = L = 1
+	a1 = pf->a[1];
+	b0 = pf->b[0];
+	b1 = pf->b[1];
+	w1 = pf->w[1];
+
+	while( SampleCount-- )
+	{
+		x0 = *pbuffer - (( a1 * w1 ) >> PBITS );
+		*pbuffer++ = (( b1 * w1 ) >> PBITS ) + (( b0 * x0 ) >> PBITS );
+		w1 = x0;
+	}
+
+	pf->w[0] = pf->w[1] = w1;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Positional updaters for pitch shift etc
 ///////////////////////////////////////////////////////////////////////////
@@ -1350,6 +1539,32 @@ void DLY_GetNextN( dly_t *pdly, portable_samplepair_t *pbuffer, int SampleCount,
 	}
 }
 
+// block version, in == out is allowed
+void DLY_GetNextBlockIO( dly_t *pdly, int *in, int *out, int SampleCount )
+{
+	switch( pdly->type )
+	{
+	default:
+	case DLY_PLAIN:
+		dly_plain_n( pdly->D, pdly->t, pdly->w, &pdly->p, pdly->a, pdly->b, in, out, SampleCount );
+		break;
+	case DLY_ALLPASS:
+		dly_allpass_n( pdly->D, pdly->t, pdly->w, &pdly->p, pdly->a, pdly->b, in, out, SampleCount );
+		break;
+	case DLY_LOWPASS:
+		dly_lowpass_n( pdly->D, pdly->t, pdly->w, &pdly->p, pdly->a, pdly->b, pdly->pflt->M, pdly->pflt->a, pdly->pflt->L, pdly->pflt->b, pdly->pflt->w, in, out, SampleCount );
+		break;
+	case DLY_LINEAR:
+		dly_linear_n( pdly->D, pdly->t, pdly->w, &pdly->p, in, out, SampleCount );
+		break;
+	}
+}
+
+void DLY_GetNextBlock( dly_t *pdly, int *pbuffer, int SampleCount )
+{
+	DLY_GetNextBlockIO( pdly, pbuffer, pbuffer, SampleCount );
+}
+
 // get tap on t'th sample in delay - don't update buffer pointers, this is done via DLY_GetNext
  int DLY_GetTap( dly_t *pdly, int t )
 {
@@ -1592,6 +1807,33 @@ rva_t *RVA_Alloc( int *D, int *a, int *b, int m, flt_t *pflt, int fparallel )
 	}
 }
 
+// block version - each parallel delay runs over the whole block
+ void RVA_GetNextBlock( rva_t *prva, int *pbuffer, int SampleCount )
+{
+	int	sum[DSP_BLOCK];
+	int	y[DSP_BLOCK];
+	int	i, j, m = prva->m;
+
+	if( m )
+	{
+		DLY_GetNextBlockIO( prva->pdlys[0], pbuffer, sum, SampleCount );
+
+		for( i = 1; i < m; i++ )
+		{
+			DLY_GetNextBlockIO( prva->pdlys[i], pbuffer, y, SampleCount );
+			for( j = 0; j < SampleCount; j++ )
+				sum[j] += y[j];
+		}
+
+		for( j = 0; j < SampleCount; j++ )
+			pbuffer[j] = sum[j] / m;
+	}
+
+	// run series filter if present
+	if( prva->pflt && !prva->fparallel )
+		FLT_GetNextBlock( prva->pflt, pbuffer, SampleCount );
+}
+
 #define RVA_BASEM		3		// base number of parallel delays
 
 // nominal delay and feedback values
@@ -1858,6 +2100,15 @@ dfr_t *DFR_Alloc( int *D, int *a, int *b, int n )
 	}
 }
 
+// block version - the series delays run one after the other over the block
+ void DFR_GetNextBlock( dfr_t *pdfr, int *pbuffer, int SampleCount )
+{
+	int	i;
+
+	for( i = 0; i < pdfr->n; i++ )
+		DLY_GetNextBlock( pdfr->pdlys[i], pbuffer, SampleCount );
+}
+
 #define DFR_BASEN		2		// base number of series allpass delays
 
 // nominal diffusor delay and feedback values
@@ -3264,6 +3515,27 @@ int MDY_GetNext( mdy_t *pmdy, int x )
 	}
 }
 
+// block version - a delay that isn't moving its tap is a plain delay line,
+// ramping or self modulating ones change the tap every sample
+ void MDY_GetNextBlock( mdy_t *pmdy, int *pbuffer, int SampleCount )
+{
+	if( SampleCount <= 0 )
+		return;
+
+	if( pmdy->fchanging || pmdy->mtime )
+	{
+		while( SampleCount-- )
+		{
+			*pbuffer = MDY_GetNext( pmdy, *pbuffer );
+			pbuffer++;
+		}
+		return;
+	}
+
+	DLY_GetNextBlock( pmdy->pdly, pbuffer, SampleCount );
+	pmdy->xprev = pbuffer[SampleCount-1];
+}
+
 // parameter order
 typedef enum
 {
@@ -3681,6 +3953,49 @@ amp_t *AMP_Alloc( float gain, float vthresh, float distmix, float vfeed )
 	}
 }
 
+// block version - same float math as AMP_GetNext, with the parameters
+// loaded once while the gain isn't slewing
+ void AMP_GetNextBlock( amp_t *pamp, int *pbuffer, int SampleCount )
+{
+	float	y, yin, gain, fclip, distmix;
+
+	if( pamp->gain != pamp->gaintarget )
+	{
+		while( SampleCount-- )
+		{
+			*pbuffer = AMP_GetNext( pamp, *pbuffer );
+			pbuffer++;
+		}
+		return;
+	}
+
+	gain = pamp->gain;
+
+	if( pamp->vthresh >= 1.0 )
+	{
+		while( SampleCount-- )
+		{
+			y = (float)*pbuffer;
+			y *= gain;
+			*pbuffer++ = (int)y;
+		}
+		return;
+	}
+
+	fclip = pamp->vthresh * 32767.0;
+	distmix = pamp->distmix;
+
+	while( SampleCount-- )
+	{
+		y = yin = (float)*pbuffer;
+		y = ( y > fclip ? fclip : ( y < -fclip ? -fclip : y));
+		if( distmix > 0.0 )
+			y = y * distmix + yin * (1.0 - distmix);
+		y *= gain;
+		*pbuffer++ = (int)y;
+	}
+}
+
  void AMP_Mod( amp_t *pamp, float v )
 {
 	float	vmod = bound( v, 0.0, 1.0 );
@@ -3762,7 +4077,7 @@ nul_t *NULL_Alloc( ) { return &nuls[0]; }
 
 // note, this array must have CPRCPARMS entries
 #define PRMZERO	0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
-#define PFNZERO	NULL,NULL,NULL,NULL,NULL	// zero pointers for pfnparam...pdata within prc_t
+#define PFNZERO	NULL,NULL,NULL,NULL,NULL,NULL	// zero pointers for pfnparam...pdata within prc_t
 
 //////////////////
 // NULL processor
@@ -3998,12 +4313,15 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 	prc_GetNextN_t	pfnGetNextN;	// get next function, batch version
 	prc_Free_t	pfnFree;	
 	prc_Mod_t		pfnMod;	
+	prc_GetNextBlock_t	pfnGetNextBlock;	// in place block version, NULL if none
 	qboolean		fok = true;
 
 	// set up pointers to XXX_Free, XXX_GetNext and XXX_Params functions
 
 	for( i = 0; i < count; i++ )
 	{
+		pfnGetNextBlock = NULL;
+
 		switch (prcs[i].type)
 		{
 		default:
@@ -4018,6 +4336,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)DLY_Free;
 			pfnGetNext	= (prc_GetNext_t)DLY_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)DLY_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)DLY_GetNextBlock;
 			pfnParam		= DLY_VParams;
 			pfnMod		= (prc_Mod_t)DLY_Mod;
 			break;
@@ -4025,6 +4344,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)RVA_Free;
 			pfnGetNext	= (prc_GetNext_t)RVA_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)RVA_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)RVA_GetNextBlock;
 			pfnParam		= RVA_VParams;
 			pfnMod		= (prc_Mod_t)RVA_Mod;
 			break;
@@ -4032,6 +4352,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)FLT_Free;
 			pfnGetNext	= (prc_GetNext_t)FLT_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)FLT_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)FLT_GetNextBlock;
 			pfnParam		= FLT_VParams;
 			pfnMod		= (prc_Mod_t)FLT_Mod;
 			break;
@@ -4074,6 +4395,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)MDY_Free;
 			pfnGetNext	= (prc_GetNext_t)MDY_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)MDY_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)MDY_GetNextBlock;
 			pfnParam		= MDY_VParams;
 			pfnMod		= (prc_Mod_t)MDY_Mod;
 			break;
@@ -4081,6 +4403,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)DFR_Free;
 			pfnGetNext	= (prc_GetNext_t)DFR_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)DFR_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)DFR_GetNextBlock;
 			pfnParam		= DFR_VParams;
 			pfnMod		= (prc_Mod_t)DFR_Mod;
 			break;
@@ -4088,6 +4411,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 			pfnFree		= (prc_Free_t)AMP_Free;
 			pfnGetNext	= (prc_GetNext_t)AMP_GetNext;
 			pfnGetNextN	= (prc_GetNextN_t)AMP_GetNextN;
+			pfnGetNextBlock	= (prc_GetNextBlock_t)AMP_GetNextBlock;
 			pfnParam		= AMP_VParams;
 			pfnMod		= (prc_Mod_t)AMP_Mod;
 			break;
@@ -4097,6 +4421,7 @@ qboolean PRC_InitAll( prc_t *prcs, int count )
 		prcs[i].pfnParam	= pfnParam;
 		prcs[i].pfnGetNext	= pfnGetNext;
 		prcs[i].pfnGetNextN	= pfnGetNextN;
+		prcs[i].pfnGetNextBlock	= pfnGetNextBlock;
 		prcs[i].pfnFree	= pfnFree;
 
 		// call param function, store pdata for the processor type
@@ -4426,44 +4751,102 @@ pset_t *PSET_Alloc( int ipsettemplate )
 //	OP_RIGHT		- process right channel in place
 //	OP_LEFT_DUPLICATe	- process left channel, duplicate into right
 
+// copy one channel of a stereo buffer to a block and back
+ void PSET_ReadChannel( portable_samplepair_t *pbf, int *x, int n, int op )
+{
+	int	i;
+
+	if( op == OP_RIGHT )
+		for( i = 0; i < n; i++ ) x[i] = pbf[i].right;
+	else
+		for( i = 0; i < n; i++ ) x[i] = pbf[i].left;
+}
+
+ void PSET_WriteChannel( portable_samplepair_t *pbf, int *x, int n, int op )
+{
+	int	i;
+
+	switch( op )
+	{
+	default:
+	case OP_LEFT:
+		for( i = 0; i < n; i++ ) pbf[i].left = x[i];
+		break;
+	case OP_RIGHT:
+		for( i = 0; i < n; i++ ) pbf[i].right = x[i];
+		break;
+	case OP_LEFT_DUPLICATE:
+		for( i = 0; i < n; i++ ) pbf[i].left = pbf[i].right = x[i];
+		break;
+	}
+}
+
 void PSET_GetNextN( pset_t *ppset, portable_samplepair_t *pbf, int SampleCount, int op )
 {
+	int	x[DSP_BLOCK];
 	prc_t	*pprc;
-	int	i, count = ppset->cprcs;
-	
-	switch( ppset->type )
-	{
-		default:
-		case PSET_SIMPLE:
-		{
-			// x(n)--->P(0)--->y(n)
-			ppset->prcs[0].pfnGetNextN( ppset->prcs[0].pdata, pbf, SampleCount, op );
-			break;
-		}
-		case PSET_LINEAR:
-		{
+	int	i, n, count;
+	int	chan = op == OP_RIGHT ? OP_RIGHT : OP_LEFT;
 
-			//      w0     w1     w2 
-			// x(n)--->P(0)-->P(1)-->...P(count-1)--->y(n)
+	// x(n)--->P(0)--->y(n)
+	count = ppset->type == PSET_LINEAR ? ppset->cprcs : 1;
 
-			//      w0     w1     w2     w3     w4     w5
-			// x(n)--->P(0)-->P(1)-->P(2)-->P(3)-->P(4)-->y(n)
+	//      w0     w1     w2 
+	// x(n)--->P(0)-->P(1)-->...P(count-1)--->y(n)
+
+	// the channel is copied out of the stereo buffer for the first block
+	// processor and the chain runs on it in place.  It only goes back to
+	// the stereo buffer for processors without a block version.
+	while( SampleCount > 0 )
+	{
+		qboolean	inblock = false;
 
-			// call batch processors in sequence - no internal state for batch processing
-			// point to first processor
+		n = SampleCount > DSP_BLOCK ? DSP_BLOCK : SampleCount;
 
-			pprc = &ppset->prcs[0];
+		for( i = 0, pprc = ppset->prcs; i < count; i++, pprc++ )
+		{
+			if( pprc->type == PRC_NULL )
+				continue;
 
-			for( i = 0; i < count; i++ )
+			if( pprc->pfnGetNextBlock )
 			{
-				pprc->pfnGetNextN( pprc->pdata, pbf, SampleCount, op );
-				pprc++;
+				if( !inblock )
+					PSET_ReadChannel( pbf, x, n, chan );
+				inblock = true;
+				pprc->pfnGetNextBlock( pprc->pdata, x, n );
 			}
-			break;
-		}	
+			else
+			{
+				if( inblock )
+					PSET_WriteChannel( pbf, x, n, chan );
+				inblock = false;
+				pprc->pfnGetNextN( pprc->pdata, pbf, n, chan );
+			}
+		}
+
+		if( inblock )
+			PSET_WriteChannel( pbf, x, n, op );
+		else if( op == OP_LEFT_DUPLICATE )
+			for( i = 0; i < n; i++ ) pbf[i].right = pbf[i].left;
+
+		pbf += n;
+		SampleCount -= n;
 	}
 }
 
+// the batch path as it was before the block processors, one XXX_GetNextN
+// call per processor.  dsp_bench checks PSET_GetNextN against it.
+ void PSET_GetNextN_Ref( pset_t *ppset, portable_samplepair_t *pbf, int SampleCount, int op )
+{
+	prc_t	*pprc;
+	int	i, count;
+
+	count = ppset->type == PSET_LINEAR ? ppset->cprcs : 1;
+
+	for( i = 0, pprc = ppset->prcs; i < count; i++, pprc++ )
+		pprc->pfnGetNextN( pprc->pdata, pbf, SampleCount, op );
+}
+
 
 // Get next sample from this preset.  called once for every sample in buffer
 // ppset is pointer to preset
@@ -5333,6 +5716,109 @@ void DSP_Process( int idsp, portable_samplepair_t *pbfront, int sampleCount )
 	}
 }
 
+// dsp_bench [seconds]
+// runs every preset over the same noise through PSET_GetNextN and through
+// the per sample batch path it replaced, reports the samples where the two
+// differ and how many DSP_BLOCK sized preset runs each path does per ms.
+
+// one timed pass of a preset over buf.  Mod delays draw from RandomLong, so
+// both paths start from the same seed, and a block is run first so that
+// neither pays for the first touch of the delay lines.
+ double DSP_BenchRun( pset_t *ppset, portable_samplepair_t *buf, int samples, qboolean ref )
+{
+	portable_samplepair_t	warm[DSP_BLOCK];
+	double	t;
+	int	i, n;
+
+	SeedRandomNumberGenerator( 1 );
+
+	Q_memcpy( warm, buf, sizeof( warm ));
+	if( ref ) PSET_GetNextN_Ref( ppset, warm, DSP_BLOCK, OP_LEFT );
+	else PSET_GetNextN( ppset, warm, DSP_BLOCK, OP_LEFT );
+
+	t = Sys_FloatTime();
+	for( i = 0; i < samples; i += n )
+	{
+		n = fmin( DSP_BLOCK, samples - i );
+		if( ref ) PSET_GetNextN_Ref( ppset, buf + i, n, OP_LEFT );
+		else PSET_GetNextN( ppset, buf + i, n, OP_LEFT );
+	}
+	return Sys_FloatTime() - t;
+}
+
+void DSP_Bench_f( void )
+{
+	portable_samplepair_t	*in, *out, *ref;
+	pset_t	*pa, *pb;
+	double	tblock, tref, totblock, totref;
+	int	ipset, i, samples, diffs, totdiffs, runs;
+
+	if( snd_threaded )
+	{
+		Con_Printf( "the sound thread owns the presets, not with -sndthread\n" );
+		return;
+	}
+
+	samples = shm->speed * ( Cmd_Argc() > 1 ? bound( 1, Q_atoi( Cmd_Argv( 1 )), 60 ) : 1 );
+
+	in = malloc( samples * 3 * sizeof( portable_samplepair_t ));
+	if( !in )
+	{
+		Con_Printf( "dsp_bench: out of memory\n" );
+		return;
+	}
+	out = in + samples;
+	ref = out + samples;
+
+	for( i = 0; i < samples; i++ )
+	{
+		in[i].left = ( rand() & 0xffff ) - 0x8000;
+		in[i].right = ( rand() & 0xffff ) - 0x8000;
+	}
+
+	totblock = totref = 0;
+	totdiffs = runs = 0;
+
+	for( ipset = 1; ipset < CPSETTEMPLATES; ipset++ )
+	{
+		pa = PSET_Alloc( ipset );
+		pb = PSET_Alloc( ipset );
+		if( !pa || !pb )
+		{
+			PSET_Free( pa );
+			PSET_Free( pb );
+			continue;
+		}
+
+		Q_memcpy( out, in, samples * sizeof( portable_samplepair_t ));
+		Q_memcpy( ref, in, samples * sizeof( portable_samplepair_t ));
+
+		tblock = DSP_BenchRun( pa, out, samples, false );
+		tref = DSP_BenchRun( pb, ref, samples, true );
+
+		for( i = 0, diffs = 0; i < samples; i++ )
+			if( out[i].left != ref[i].left )
+				diffs++;
+
+		Con_Printf( "preset %2i: %7.3f ms block, %7.3f ms per sample, %i differ\n", ipset, tblock * 1000, tref * 1000, diffs );
+
+		totblock += tblock;
+		totref += tref;
+		totdiffs += diffs;
+		runs += ( samples + DSP_BLOCK - 1 ) / DSP_BLOCK;
+
+		PSET_Free( pa );
+		PSET_Free( pb );
+	}
+
+	SeedRandomNumberGenerator( 0 );
+	free( in );
+
+	if( totblock > 0 && totref > 0 )
+		Con_Printf( "%.1f presets/ms block, %.1f presets/ms per sample (%i samples each)\n", runs / ( totblock * 1000 ), runs / ( totref * 1000 ), DSP_BLOCK );
+	Con_Printf( "%s: %i samples differ\n", totdiffs ? "MISMATCH" : "bit exact", totdiffs );
+}
+
 // DSP helpers
 
 // free all dsp processors 
@@ -5359,6 +5845,8 @@ qboolean AllocDsps( void )
 	Cvar_RegisterVariable (&dsp_room_type);
 	Cvar_RegisterVariable (&dsp_stereo);   
 
+	Cmd_AddCommand ("dsp_bench", DSP_Bench_f);
+
 
 	// alloc dsp room channel (mono, stereo if dsp_stereo is 1)
 
@@ -22,9 +22,318 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 int			cache_full_cycle;
+int			snd_loads;		// S_LoadSound reads, sfx_t loads counts them per sound
 
 byte *S_Alloc (int size);
 
+/*
+===============================================================================
+
+RESAMPLING
+
+snd_resample 1 converts with a polyphase windowed sinc filter instead of
+picking the nearest source sample, the cutoff follows the output rate so
+downsampled sounds don't alias.  snd_nativerate 1 skips the conversion and
+leaves it to the mixer, which steps through the sample by a fraction.
+
+===============================================================================
+*/
+
+#define	RESAMPLE_TAPS		16
+#define	RESAMPLE_PHASEBITS	5
+#define	RESAMPLE_PHASES		(1<<RESAMPLE_PHASEBITS)
+#define	RESAMPLE_SHIFT		14			// filter coefficient precision
+
+static int		resample_filter[RESAMPLE_PHASES][RESAMPLE_TAPS];
+static float	resample_cutoff;
+
+/*
+================
+S_BuildResampleFilter
+
+Hann windowed sinc, each phase normalized to unity gain
+================
+*/
+static void S_BuildResampleFilter (float cutoff)
+{
+	int		phase, t, sum;
+	float	x, h, w, total;
+	float	taps[RESAMPLE_TAPS];
+
+	if (cutoff == resample_cutoff)
+		return;
+	resample_cutoff = cutoff;
+
+	for (phase=0 ; phase<RESAMPLE_PHASES ; phase++)
+	{
+		total = 0;
+		for (t=0 ; t<RESAMPLE_TAPS ; t++)
+		{
+			x = t - (RESAMPLE_TAPS/2 - 1) - (float)phase / RESAMPLE_PHASES;
+			if (x == 0)
+				h = cutoff;
+			else
+				h = sin (M_PI * cutoff * x) / (M_PI * x);
+			w = 0.5 + 0.5 * cos (M_PI * x / (RESAMPLE_TAPS/2));
+			taps[t] = h * w;
+			total += taps[t];
+		}
+
+		sum = 0;
+		for (t=0 ; t<RESAMPLE_TAPS ; t++)
+		{
+			resample_filter[phase][t] = taps[t] / total * (1<<RESAMPLE_SHIFT);
+			sum += resample_filter[phase][t];
+		}
+		resample_filter[phase][RESAMPLE_TAPS/2 - 1] += (1<<RESAMPLE_SHIFT) - sum;
+	}
+}
+
+/*
+================
+S_WavSample
+
+Source sample i scaled to 16 bit, clamped to the ends of the sound
+================
+*/
+static int S_WavSample (byte *data, int width, int count, int i)
+{
+	if (i < 0)
+		i = 0;
+	else if (i >= count)
+		i = count - 1;
+	if (width == 2)
+		return LittleShort (((short *)data)[i]);
+	return ((int)data[i] - 128) << 8;
+}
+
+/*
+================
+S_ResampleData
+
+Converts incount samples of in to outcount samples of out, 16 bit signed
+or 8 bit signed output
+================
+*/
+void S_ResampleData (byte *in, int inwidth, int incount, byte *out, int outwidth, int outcount, float stepscale, int quality)
+{
+	int		i, t, sample, pos, frac, fracstep, first;
+	int		*filter;
+	short	*in16;
+
+// pos is the source sample and frac its 16 bit fraction, kept apart so
+// sounds past 32767 samples don't overflow a 16.16 position
+	fracstep = stepscale * 65536;
+
+	if (quality <= 0 || fracstep == 65536)
+	{
+		for (i=0, pos=0, frac=0 ; i<outcount ; i++, frac+=fracstep, pos+=frac>>16, frac&=0xffff)
+		{
+			sample = S_WavSample (in, inwidth, incount, pos);
+			if (outwidth == 2)
+				((short *)out)[i] = sample;
+			else
+				((signed char *)out)[i] = sample >> 8;
+		}
+		return;
+	}
+
+	S_BuildResampleFilter (stepscale > 1 ? 1 / stepscale : 1);
+
+	in16 = (short *)in;
+	for (i=0, pos=0, frac=0 ; i<outcount ; i++, frac+=fracstep, pos+=frac>>16, frac&=0xffff)
+	{
+		filter = resample_filter[frac >> (16 - RESAMPLE_PHASEBITS)];
+		first = pos - (RESAMPLE_TAPS/2 - 1);
+		sample = 0;
+
+		if (inwidth == 2 && !bigendien && first >= 0 && first + RESAMPLE_TAPS <= incount)
+		{
+		// whole window inside the sound, read it directly
+			in16 = (short *)in + first;
+			for (t=0 ; t<RESAMPLE_TAPS ; t+=4)
+				sample += in16[t]*filter[t] + in16[t+1]*filter[t+1] + in16[t+2]*filter[t+2] + in16[t+3]*filter[t+3];
+		}
+		else
+		{
+			for (t=0 ; t<RESAMPLE_TAPS ; t++)
+				sample += S_WavSample (in, inwidth, incount, first + t) * filter[t];
+		}
+
+		sample >>= RESAMPLE_SHIFT;
+		if (sample > 32767)
+			sample = 32767;
+		else if (sample < -32768)
+			sample = -32768;
+
+		if (outwidth == 2)
+			((short *)out)[i] = sample;
+		else
+			((signed char *)out)[i] = sample >> 8;
+	}
+}
+
+/*
+===============================================================================
+
+ADPCM
+
+snd_adpcm 1 keeps newly loaded sounds as IMA ADPCM, 4 bits a sample
+instead of 8 or 16, so about four times as many stay in the cache.  The
+mixer decodes what it paints.  Every block starts with the decoder state
+so a sound can be started, looped or skipped to anywhere in it.
+
+===============================================================================
+*/
+
+const int adpcm_steps[89] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+	11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+	32767
+};
+
+const signed char adpcm_indexes[16] =
+{
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+/*
+================
+S_ADPCMSize
+
+Bytes needed for samples samples
+================
+*/
+int S_ADPCMSize (int samples)
+{
+	return ((samples + ADPCM_BLOCK - 1) >> ADPCM_BLOCKSHIFT) * ADPCM_BLOCKBYTES;
+}
+
+/*
+================
+S_EncodeADPCM
+================
+*/
+void S_EncodeADPCM (short *in, int count, byte *out)
+{
+	int		i, pred, index, step, diff, code, delta;
+
+	pred = index = 0;
+	for (i=0 ; i<count ; i++)
+	{
+		if (!(i & (ADPCM_BLOCK-1)))
+		{
+			out[0] = pred & 0xff;
+			out[1] = (pred >> 8) & 0xff;
+			out[2] = index;
+			out[3] = 0;
+			memset (out + 4, 0, ADPCM_BLOCK/2);
+			out += 4;
+		}
+
+		step = adpcm_steps[index];
+		diff = in[i] - pred;
+		code = 0;
+		if (diff < 0)
+		{
+			code = 8;
+			diff = -diff;
+		}
+		delta = step >> 3;
+		if (diff >= step)
+		{
+			code |= 4;
+			diff -= step;
+			delta += step;
+		}
+		if (diff >= step >> 1)
+		{
+			code |= 2;
+			diff -= step >> 1;
+			delta += step >> 1;
+		}
+		if (diff >= step >> 2)
+		{
+			code |= 1;
+			delta += step >> 2;
+		}
+
+	// track the decoder, not the input, so errors don't accumulate
+		if (code & 8)
+			pred -= delta;
+		else
+			pred += delta;
+		if (pred > 32767)
+			pred = 32767;
+		else if (pred < -32768)
+			pred = -32768;
+		index += adpcm_indexes[code];
+		if (index < 0)
+			index = 0;
+		else if (index > 88)
+			index = 88;
+
+		out[(i & (ADPCM_BLOCK-1)) >> 1] |= (i & 1) ? code << 4 : code;
+		if ((i & (ADPCM_BLOCK-1)) == ADPCM_BLOCK-1)
+			out += ADPCM_BLOCK/2;
+	}
+}
+
+/*
+================
+S_LoadSoundADPCM
+
+Resamples to 16 bit outside the cache and keeps the sound encoded,
+returns NULL if there is no memory for the 16 bit copy
+================
+*/
+static sfxcache_t *S_LoadSoundADPCM (sfx_t *s, wavinfo_t *info, byte *data)
+{
+	int		outrate, outcount, loopstart;
+	float	stepscale;
+	short	*pcm;
+	sfxcache_t	*sc;
+
+	outrate = snd_nativerate.value ? info->rate : shm->speed;
+	stepscale = (float)info->rate / outrate;
+	outcount = info->samples / stepscale;
+	loopstart = info->loopstart;
+	if (loopstart != -1)
+		loopstart = loopstart / stepscale;
+
+	pcm = malloc ((outcount + 1) * sizeof(short));
+	if (!pcm)
+		return NULL;
+
+	S_ResampleData (data, info->width, info->samples, (byte *)pcm, 2, outcount, stepscale, snd_resample.value);
+// guard sample for the mixer's interpolation, continues into the loop
+	pcm[outcount] = outcount > 0 ? pcm[loopstart >= 0 ? loopstart : outcount - 1] : 0;
+
+	sc = Cache_Alloc (&s->cache, S_ADPCMSize (outcount + 1) + sizeof(sfxcache_t), s->name);
+	if (sc)
+	{
+		sc->length = outcount;
+		sc->loopstart = loopstart;
+		sc->speed = outrate;
+		sc->width = 2;
+		sc->stereo = 0;
+		sc->streamofs = 0;
+		sc->adpcm = true;
+		S_EncodeADPCM (pcm, outcount + 1, sc->data);
+	}
+
+	free (pcm);
+	return sc;
+}
+
+//=============================================================================
+
 /*
 ================
 ResampleSfx
@@ -32,25 +341,26 @@ ResampleSfx
 */
 void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 {
-	int		outcount;
-	int		srcsample;
+	int		outcount, incount;
+	int		outrate;
 	float	stepscale;
 	int		i;
-	int		sample, samplefrac, fracstep;
 	sfxcache_t	*sc;
 	
 	sc = Cache_Check (&sfx->cache);
 	if (!sc)
 		return;
 
-	stepscale = (float)inrate / shm->speed;	// this is usually 0.5, 1, or 2
+	outrate = snd_nativerate.value ? inrate : shm->speed;
+	stepscale = (float)inrate / outrate;	// this is usually 0.5, 1, or 2
 
+	incount = sc->length;
 	outcount = sc->length / stepscale;
 	sc->length = outcount;
 	if (sc->loopstart != -1)
 		sc->loopstart = sc->loopstart / stepscale;
 
-	sc->speed = shm->speed;
+	sc->speed = outrate;
 	if (loadas8bit.value)
 		sc->width = 1;
 	else
@@ -69,21 +379,17 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	else
 	{
 // general case
-		samplefrac = 0;
-		fracstep = stepscale*256;
-		for (i=0 ; i<outcount ; i++)
-		{
-			srcsample = samplefrac >> 8;
-			samplefrac += fracstep;
-			if (inwidth == 2)
-				sample = LittleShort ( ((short *)data)[srcsample] );
-			else
-				sample = (int)( (unsigned char)(data[srcsample]) - 128) << 8;
-			if (sc->width == 2)
-				((short *)sc->data)[i] = sample;
-			else
-				((signed char *)sc->data)[i] = sample >> 8;
-		}
+		S_ResampleData (data, inwidth, incount, sc->data, sc->width, outcount, stepscale, snd_resample.value);
+	}
+
+// guard sample for the mixer's interpolation, continues into the loop
+	i = sc->loopstart >= 0 ? sc->loopstart : outcount - 1;
+	if (outcount > 0)
+	{
+		if (sc->width == 2)
+			((short *)sc->data)[outcount] = ((short *)sc->data)[i];
+		else
+			((signed char *)sc->data)[outcount] = ((signed char *)sc->data)[i];
 	}
 }
 
@@ -116,6 +422,10 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
+	sc = S_LoadStreamedSound (s, namebuffer);
+	if (sc)
+		return sc;
+
 	data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
 
 	if (!data)
@@ -131,8 +441,21 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		return NULL;
 	}
 
-	stepscale = (float)info.rate / shm->speed;	
-	len = info.samples / stepscale;
+	s->loads++;
+	snd_loads++;
+
+	if (snd_adpcm.value)
+	{
+		sc = S_LoadSoundADPCM (s, &info, data + info.dataofs);
+		if (sc)
+			return sc;
+	}
+
+	if (snd_nativerate.value)
+		stepscale = 1;
+	else
+		stepscale = (float)info.rate / shm->speed;	
+	len = info.samples / stepscale + 1;		// guard sample
 
 	len = len * info.width * info.channels;
 
@@ -145,6 +468,8 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	sc->speed = info.rate;
 	sc->width = info.width;
 	sc->stereo = info.channels;
+	sc->streamofs = 0;
+	sc->adpcm = false;
 
 	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
 
@@ -154,9 +154,9 @@ S_TransferPaintBuffer
 */
 void S_TransferPaintBuffer( int endtime )
 {
-	int	lpos, lpaintedtime, snd_vol;
+	int	lpos, lpaintedtime;
 	int	*snd_p, snd_linear_count;
-	int	i, val, sampleMask;
+	int	i, sampleMask;
 	short	*snd_out;
 	DWORD	*pbuf;
 
@@ -165,8 +165,6 @@ void S_TransferPaintBuffer( int endtime )
 	lpaintedtime = paintedtime;
 	sampleMask = ((shm->samples >> 1) - 1);
 
-	snd_vol = volume.value * 256;
-
 	while( lpaintedtime < endtime )
 	{
 		// handle recirculating buffer issues
@@ -180,21 +178,12 @@ void S_TransferPaintBuffer( int endtime )
 
 		snd_linear_count <<= 1;
 
-		// write a linear blast of samples
+		// write a linear blast of samples, MIX_CompressPaintbuffer
+		// has already scaled and clipped them
 		for( i = 0; i < snd_linear_count; i += 2 )
 		{
-			val = (snd_p[i+0] * snd_vol) >> 8;
-
-			if( val > 0x7fff ) snd_out[i+0] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+0] = (short)0x8000;
-			else snd_out[i+0] = val;
-
-			val = (snd_p[i+1] * snd_vol) >> 8;
-			if( val > 0x7fff ) snd_out[i+1] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+1] = (short)0x8000;
-			else snd_out[i+1] = val;
+			snd_out[i+0] = snd_p[i+0];
+			snd_out[i+1] = snd_p[i+1];
 		}
 
 		snd_p += snd_linear_count;
@@ -211,8 +200,407 @@ CHANNEL MIXING
 ===============================================================================
 */
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, portable_samplepair_t *buf);
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, portable_samplepair_t *buf);
+/*
+Channels are not painted one at a time.  MIX_MixChannelsToPaintbuffer
+first turns every active channel into one or more paint jobs (a channel
+that loops inside the span gives one job per pass over the loop), then
+MIX_PaintJobs mixes jobs that cover the whole span MIX_GANG at a time,
+so paintbuffer is read and written once per gang instead of once per
+channel.  Clipping is left to MIX_CompressPaintbuffer.  ADPCM sounds are
+decoded into mix_decoded when they are queued and painted as 16 bit.
+*/
+#define	MIX_GANG		4
+#define	MAX_MIXJOBS		256
+#define	MIX_DECODESIZE	8192		// samples
+
+typedef struct
+{
+	void	*data;			// first sample to paint
+	int		width;
+	int		*lscale;		// 8 bit
+	int		*rscale;
+	int		leftvol;		// 16 bit
+	int		rightvol;
+	int		offset;			// into the paint buffer
+	int		count;
+	int		step;			// 16.16 source samples per paint sample, 0 for 1
+	int		frac;			// 16.16 fraction of the first sample
+} mixjob_t;
+
+static mixjob_t	mix_jobs[MAX_MIXJOBS];
+static int		mix_numjobs;
+
+static short	mix_decoded[MIX_DECODESIZE];
+static int		mix_numdecoded;
+
+/*
+===================
+SND_ChannelStep
+
+16.16 step through sc for each paint sample, 0 when it plays at shm->speed
+===================
+*/
+int SND_ChannelStep (sfxcache_t *sc)
+{
+	if (sc->speed == shm->speed)
+		return 0;
+	return ((long long)sc->speed << 16) / shm->speed;
+}
+
+/*
+===================
+SND_PaintSamples
+
+Paint samples it takes ch to play srcsamples more source samples.  Clamped
+so paintedtime plus the result can't overflow before GetSoundtime wraps
+paintedtime, a looped stream's endless length upsampled would otherwise.
+===================
+*/
+#define	MAX_PAINTSAMPLES	0x3f000000
+
+int SND_PaintSamples (channel_t *ch, int srcsamples)
+{
+	long long	n;
+
+	if (!ch->step)
+		n = srcsamples;
+	else
+		n = (((long long)srcsamples << 16) - ch->posfrac + ch->step - 1) / ch->step;
+	return n > MAX_PAINTSAMPLES ? MAX_PAINTSAMPLES : (int)n;
+}
+
+/*
+===================
+SND_AdvanceChannel
+
+Moves ch forward by count paint samples
+===================
+*/
+void SND_AdvanceChannel (channel_t *ch, int count)
+{
+	long long	frac;
+
+	if (!ch->step)
+	{
+		ch->pos += count;
+		return;
+	}
+	frac = ch->posfrac + (long long)count * ch->step;
+	ch->pos += (int)(frac >> 16);
+	ch->posfrac = (int)(frac & 0xffff);
+}
+
+/*
+===================
+MIX_PaintJobFrac
+
+Linear interpolation between source samples for sounds that are not
+at shm->speed, ResampleSfx leaves a guard sample after the last one
+===================
+*/
+static void MIX_PaintJobFrac (mixjob_t *job, portable_samplepair_t *buf)
+{
+	signed short	*sfx16 = job->data;
+	signed char		*sfx8 = job->data;
+	int				leftvol = job->leftvol, rightvol = job->rightvol;
+	unsigned		pos;
+	int				i, a, b, data;
+
+	buf += job->offset;
+	pos = job->frac;
+	for (i=0 ; i<job->count ; i++, pos+=job->step)
+	{
+		if (job->width == 2)
+		{
+			a = sfx16[pos >> 16];
+			b = sfx16[(pos >> 16) + 1];
+		}
+		else
+		{
+			a = sfx8[pos >> 16] << 8;
+			b = sfx8[(pos >> 16) + 1] << 8;
+		}
+		data = a + (((b - a) * (int)((pos & 0xffff) >> 1)) >> 15);
+		buf[i].left += (data * leftvol) >> 8;
+		buf[i].right += (data * rightvol) >> 8;
+	}
+}
+
+static void MIX_PaintJob8 (mixjob_t *job, portable_samplepair_t *buf)
+{
+	unsigned char	*sfx = job->data;
+	int				*lscale = job->lscale, *rscale = job->rscale;
+	int				i, data;
+
+	buf += job->offset;
+	for (i=0 ; i<job->count ; i++)
+	{
+		data = sfx[i];
+		buf[i].left += lscale[data];
+		buf[i].right += rscale[data];
+	}
+}
+
+static void MIX_PaintJob16 (mixjob_t *job, portable_samplepair_t *buf)
+{
+	signed short	*sfx = job->data;
+	int				leftvol = job->leftvol, rightvol = job->rightvol;
+	int				i, data;
+
+	buf += job->offset;
+	for (i=0 ; i<job->count ; i++)
+	{
+		data = sfx[i];
+		buf[i].left += (data * leftvol) >> 8;
+		buf[i].right += (data * rightvol) >> 8;
+	}
+}
+
+static void MIX_PaintGang8 (mixjob_t **gang, portable_samplepair_t *buf, int count)
+{
+	unsigned char	*s0 = gang[0]->data, *s1 = gang[1]->data, *s2 = gang[2]->data, *s3 = gang[3]->data;
+	int				*l0 = gang[0]->lscale, *l1 = gang[1]->lscale, *l2 = gang[2]->lscale, *l3 = gang[3]->lscale;
+	int				*r0 = gang[0]->rscale, *r1 = gang[1]->rscale, *r2 = gang[2]->rscale, *r3 = gang[3]->rscale;
+	int				i;
+
+	for (i=0 ; i<count ; i++)
+	{
+		buf[i].left += l0[s0[i]] + l1[s1[i]] + l2[s2[i]] + l3[s3[i]];
+		buf[i].right += r0[s0[i]] + r1[s1[i]] + r2[s2[i]] + r3[s3[i]];
+	}
+}
+
+static void MIX_PaintGang16 (mixjob_t **gang, portable_samplepair_t *buf, int count)
+{
+	signed short	*s0 = gang[0]->data, *s1 = gang[1]->data, *s2 = gang[2]->data, *s3 = gang[3]->data;
+	int				l0 = gang[0]->leftvol, l1 = gang[1]->leftvol, l2 = gang[2]->leftvol, l3 = gang[3]->leftvol;
+	int				r0 = gang[0]->rightvol, r1 = gang[1]->rightvol, r2 = gang[2]->rightvol, r3 = gang[3]->rightvol;
+	int				i, d0, d1, d2, d3;
+
+	for (i=0 ; i<count ; i++)
+	{
+		d0 = s0[i];
+		d1 = s1[i];
+		d2 = s2[i];
+		d3 = s3[i];
+		buf[i].left += (d0*l0 + d1*l1 + d2*l2 + d3*l3) >> 8;
+		buf[i].right += (d0*r0 + d1*r1 + d2*r2 + d3*r3) >> 8;
+	}
+}
+
+/*
+===================
+MIX_PaintJobs
+
+Mixes jobs[0..numjobs) into buf, count is the length of the span
+===================
+*/
+static void MIX_PaintJobs (mixjob_t *jobs, int numjobs, portable_samplepair_t *buf, int count)
+{
+	mixjob_t	*gang8[MIX_GANG], *gang16[MIX_GANG];
+	int			n8, n16, i;
+
+	n8 = n16 = 0;
+	for (i=0 ; i<numjobs ; i++)
+	{
+		if (jobs[i].step)
+		{
+			MIX_PaintJobFrac (&jobs[i], buf);
+			continue;
+		}
+
+		if (jobs[i].offset || jobs[i].count != count)
+		{
+		// partial span, ends or loops inside this paint
+			if (jobs[i].width == 1)
+				MIX_PaintJob8 (&jobs[i], buf);
+			else
+				MIX_PaintJob16 (&jobs[i], buf);
+			continue;
+		}
+
+		if (jobs[i].width == 1)
+		{
+			gang8[n8++] = &jobs[i];
+			if (n8 == MIX_GANG)
+			{
+				MIX_PaintGang8 (gang8, buf, count);
+				n8 = 0;
+			}
+		}
+		else
+		{
+			gang16[n16++] = &jobs[i];
+			if (n16 == MIX_GANG)
+			{
+				MIX_PaintGang16 (gang16, buf, count);
+				n16 = 0;
+			}
+		}
+	}
+
+	for (i=0 ; i<n8 ; i++)
+		MIX_PaintJob8 (gang8[i], buf);
+	for (i=0 ; i<n16 ; i++)
+		MIX_PaintJob16 (gang16[i], buf);
+}
+
+/*
+===================
+MIX_DecodeADPCM
+
+Decodes count samples of sc from start into out.  The decoder state at
+resume, where the channel will be after this paint, is kept in ch so the
+next paint carries on instead of going back to the start of the block.
+===================
+*/
+static void MIX_DecodeADPCM (channel_t *ch, sfxcache_t *sc, int start, int count, int resume, short *out)
+{
+	byte	*block;
+	int		i, end, pred, index, step, delta, code;
+
+	if (start == ch->adpcmpos && (start & (ADPCM_BLOCK-1)))
+	{
+		i = start;
+		pred = ch->adpcmpred;
+		index = ch->adpcmindex;
+	}
+	else
+	{
+		i = start & ~(ADPCM_BLOCK-1);
+		pred = index = 0;		// from the block header
+	}
+
+	end = start + count;
+	if (end < resume)
+		end = resume;
+	if (end > sc->length + 1)
+		end = sc->length + 1;	// guard sample
+
+	block = sc->data + (i >> ADPCM_BLOCKSHIFT) * ADPCM_BLOCKBYTES;
+	for ( ; i<end ; i++)
+	{
+		if (!(i & (ADPCM_BLOCK-1)))
+		{
+			block = sc->data + (i >> ADPCM_BLOCKSHIFT) * ADPCM_BLOCKBYTES;
+			pred = (short)(block[0] | (block[1] << 8));
+			index = block[2];
+		}
+		if (i == resume)
+		{
+			ch->adpcmpos = i;
+			ch->adpcmpred = pred;
+			ch->adpcmindex = index;
+		}
+
+		code = block[4 + ((i & (ADPCM_BLOCK-1)) >> 1)];
+		if (i & 1)
+			code >>= 4;
+		code &= 15;
+
+		step = adpcm_steps[index];
+		delta = step >> 3;
+		if (code & 4)
+			delta += step;
+		if (code & 2)
+			delta += step >> 1;
+		if (code & 1)
+			delta += step >> 2;
+		if (code & 8)
+			pred -= delta;
+		else
+			pred += delta;
+		if (pred > 32767)
+			pred = 32767;
+		else if (pred < -32768)
+			pred = -32768;
+		index += adpcm_indexes[code];
+		if (index < 0)
+			index = 0;
+		else if (index > 88)
+			index = 88;
+
+		if (i >= start && i < start + count)
+			out[i - start] = pred;
+	}
+
+	if (i == resume)
+	{
+		ch->adpcmpos = i;
+		ch->adpcmpred = pred;
+		ch->adpcmindex = index;
+	}
+}
+
+/*
+===================
+MIX_AddJob
+
+Queues count samples of ch for painting at offset and advances it
+===================
+*/
+static void MIX_AddJob (channel_t *ch, sfxcache_t *sc, int offset, int count, portable_samplepair_t *buf, int span)
+{
+	mixjob_t	*job;
+	int			decode, resume;
+
+	decode = 0;
+	if (sc->adpcm)
+	{
+	// the samples painted, and the next one for interpolating
+		if (ch->step)
+			decode = ((ch->posfrac + (long long)(count - 1) * ch->step) >> 16) + 2;
+		else
+			decode = count;
+		if (decode > MIX_DECODESIZE)
+		{
+			SND_AdvanceChannel (ch, count);
+			return;
+		}
+	}
+
+	if (mix_numjobs == MAX_MIXJOBS || mix_numdecoded + decode > MIX_DECODESIZE)
+	{
+		MIX_PaintJobs (mix_jobs, mix_numjobs, buf, span);
+		mix_numjobs = 0;
+		mix_numdecoded = 0;
+	}
+
+	job = &mix_jobs[mix_numjobs++];
+	job->width = sc->width;
+	job->offset = offset;
+	job->count = count;
+	job->step = ch->step;
+	job->frac = ch->posfrac;
+	if (ch->stream)
+		job->data = SND_StreamData (ch);
+	else if (sc->adpcm)
+	{
+		if (ch->step)
+			resume = ch->pos + (int)((ch->posfrac + (long long)count * ch->step) >> 16);
+		else
+			resume = ch->pos + count;
+		job->data = mix_decoded + mix_numdecoded;
+		MIX_DecodeADPCM (ch, sc, ch->pos, decode, resume, job->data);
+		mix_numdecoded += decode;
+	}
+	else if (sc->width == 1)
+	{
+		if (ch->leftvol > 255)
+			ch->leftvol = 255;
+		if (ch->rightvol > 255)
+			ch->rightvol = 255;
+		job->data = sc->data + ch->pos;
+		job->lscale = snd_scaletable[ch->leftvol >> 3];
+		job->rscale = snd_scaletable[ch->rightvol >> 3];
+	}
+	else
+		job->data = (signed short *)sc->data + ch->pos;
+	job->leftvol = ch->leftvol;
+	job->rightvol = ch->rightvol;
+
+	SND_AdvanceChannel (ch, count);
+}
 
 void MIX_MixPaintbuffers( portable_samplepair_t *buf1, portable_samplepair_t *buf2, portable_samplepair_t *buf3, int count, float fgain )
 {
@@ -234,13 +622,67 @@ void MIX_MixPaintbuffers( portable_samplepair_t *buf1, portable_samplepair_t *bu
 	}
 }
 
+/*
+===================
+MIX_CompressPaintbuffer
+
+Applies the master volume and clips to 16 bit, so S_TransferPaintBuffer
+only has to store the samples
+===================
+*/
 void MIX_CompressPaintbuffer( portable_samplepair_t *buf, int count )
 {
-	int i;
+	int i, vol, l, r;
+
+	vol = volume.value * 256;
 	for( i = 0; i < count; i++, buf++ )
 	{
-		buf->left = CLIP( buf->left );
-		buf->right = CLIP( buf->right );
+		l = (buf->left * vol) >> 8;
+		r = (buf->right * vol) >> 8;
+		buf->left = CLIP( l );
+		buf->right = CLIP( r );
+	}
+}
+
+/*
+===================
+MIX_AdvanceVirtual
+
+Moves a virtual voice through the span without touching its samples
+===================
+*/
+static void MIX_AdvanceVirtual (channel_t *ch, int endtime)
+{
+	int		ltime, count;
+
+	ltime = paintedtime;
+	while (ltime < endtime)
+	{
+		if (ch->end < endtime)
+			count = ( ch->end - ltime );
+		else
+			count = ( endtime - ltime );
+
+		if (count > 0)
+		{
+			SND_AdvanceChannel (ch, count);
+			ltime += count;
+		}
+
+		if (ltime >= ch->end)
+		{
+			if (ch->loopstart >= 0)
+			{
+				ch->pos = ch->loopstart;
+				ch->posfrac = 0;
+				ch->end = ltime + SND_PaintSamples (ch, ch->length - ch->pos);
+			}
+			else
+			{
+				SND_ClearChannel (ch);
+				break;
+			}
+		}
 	}
 }
 
@@ -248,21 +690,49 @@ void MIX_MixChannelsToPaintbuffer( int endtime, portable_samplepair_t *buf )
 {
 	channel_t *ch;
 	sfxcache_t	*sc;
-	int		i, ltime, count;
+	int		i, ltime, count, n;
 	
-	// mix each channel into paintbuffer
+	// load every sound first, queued jobs point into the cache and a load
+	// while queueing could throw out one that is already queued
+	if (!snd_threaded)
+	{
+		ch = channels;
+		for (i=0; i<total_channels ; i++, ch++)
+			if (ch->sfx && (ch->leftvol || ch->rightvol) && !(ch->length && ch->isvirtual))
+				S_LoadSound (ch->sfx);
+	}
+
+	// queue each channel, then mix them all into paintbuffer
+	mix_numjobs = 0;
+	mix_numdecoded = 0;
 	ch = channels;
 	for (i=0; i<total_channels ; i++, ch++)
 	{
 		if (!ch->sfx)
 			continue;
 
+		if (ch->length && (ch->isvirtual || (!ch->leftvol && !ch->rightvol)))
+		{
+			MIX_AdvanceVirtual (ch, endtime);
+			continue;
+		}
+
 		if (!ch->leftvol && !ch->rightvol)
 			continue;
 
-		sc = S_LoadSound (ch->sfx);
+	// the sound thread can't touch the cache, it mixes what S_StartSound loaded
+	// and locked; a sound thrown out by a later load above is skipped this span
+		sc = (sfxcache_t *)(snd_threaded ? ch->sfx->cache.data : Cache_Check (&ch->sfx->cache));
 		if (!sc)
 			continue;
+		if (sc->streamofs && !ch->stream)
+			continue;		// header only, SND_OpenStream failed
+		if (!ch->length)
+		{
+			ch->loopstart = sc->loopstart;
+			ch->length = sc->length;
+			ch->step = SND_ChannelStep (sc);
+		}
 
 		ltime = paintedtime;
 		while (ltime < endtime)
@@ -273,37 +743,53 @@ void MIX_MixChannelsToPaintbuffer( int endtime, portable_samplepair_t *buf )
 			else
 				count = ( endtime - ltime );
 
-			if (count > 0)
+			if (count > 0 && ch->stream)
 			{
-				if (sc->width == 1)
-					SND_PaintChannelFrom8(ch, sc, count, buf);
-				else
-					SND_PaintChannelFrom16(ch, sc, count, buf);
+				n = SND_StreamPaintable (ch);
+				if (!n)
+				{
+				// underrun, skip ahead and let the stream catch up
+					SND_AdvanceChannel (ch, count);
+					ltime += count;
+					continue;
+				}
+				if (count > n)
+					count = n;
+			}
 
+			if (count > 0)
+			{
+				MIX_AddJob (ch, sc, ltime - paintedtime, count, buf, endtime - paintedtime);
 				ltime += count;
 			}
 
 		// if at end of loop, restart
 			if (ltime >= ch->end)
 			{
-				if (sc->loopstart >= 0)
+				if (ch->loopstart >= 0)
 				{
-					ch->pos = sc->loopstart;
-					ch->end = ltime + sc->length - ch->pos;
+					ch->pos = ch->loopstart;
+					ch->posfrac = 0;
+					ch->end = ltime + SND_PaintSamples (ch, ch->length - ch->pos);
 				}
 				else
 				{	// channel just stopped
-					ch->sfx = NULL;
+					SND_ClearChannel (ch);
 					break;
 				}
 			}
 		}
 	}
+
+	MIX_PaintJobs (mix_jobs, mix_numjobs, buf, endtime - paintedtime);
+	mix_numjobs = 0;
+	mix_numdecoded = 0;
 }
 
 void S_PaintChannels(int endtime)
 {
     int	end, count;
+	double	t0, t1, t2, t3;
 #ifdef DSP2
 	float	dsp_room_gain;
 
@@ -329,7 +815,9 @@ void S_PaintChannels(int endtime)
 	    // clear the room buffer
 		//Q_memset(roombuffer, 0, count * sizeof(portable_samplepair_t));
 
+		t0 = Sys_FloatTime ();
 	    MIX_MixChannelsToPaintbuffer( end, paintbuffer );
+		t1 = Sys_FloatTime ();
 
 #ifdef DSP2
 		// process all sounds with DSP
@@ -337,11 +825,19 @@ void S_PaintChannels(int endtime)
 #else
         SX_RoomFX(end, 0, 1);
 #endif
+		t2 = Sys_FloatTime ();
 		MIX_CompressPaintbuffer( paintbuffer, count );
+		t3 = Sys_FloatTime ();
 
 	    // transfer out according to DMA format
 		S_TransferPaintBuffer(end);
 		paintedtime = end;
+
+		snd_stats.stagetime[sst_mix] += t1 - t0;
+		snd_stats.stagetime[sst_fx] += t2 - t1;
+		snd_stats.stagetime[sst_compress] += t3 - t2;
+		snd_stats.stagetime[sst_transfer] += Sys_FloatTime () - t3;
+		snd_stats.painted += count;
 	}
 }
 
@@ -356,54 +852,225 @@ void SND_InitScaletable (void)
 }
 
 
-void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, portable_samplepair_t *buf)
-{
-	int 	data;
-	int		*lscale, *rscale;
-	unsigned char *sfx;
-	int		i;
+/*
+===================
+S_MixBench_f
 
-	if (ch->leftvol > 255)
-		ch->leftvol = 255;
-	if (ch->rightvol > 255)
-		ch->rightvol = 255;
-		
-	lscale = snd_scaletable[ch->leftvol >> 3];
-	rscale = snd_scaletable[ch->rightvol >> 3];
-	sfx = (unsigned char *) ((signed char *) sc->data + ch->pos);
+snd_mixbench [passes] : times the channel mixer with 32, 64 and 128
+channels of synthetic 8 and 16 bit samples, no sound device needed
+===================
+*/
+void S_MixBench_f (void)
+{
+	static const int	numchannels[] = {32, 64, 128};
+	static mixjob_t		jobs[128];
+	static byte			samples8[PAINTBUFFER_SIZE];
+	static short		samples16[PAINTBUFFER_SIZE];
+	static portable_samplepair_t	buf[PAINTBUFFER_SIZE];
+	double				start, time;
+	int					passes, i, j, n;
+
+	passes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 1000;
+	if (passes < 1)
+		passes = 1;
+
+	for (i=0 ; i<PAINTBUFFER_SIZE ; i++)
+	{
+		samples8[i] = rand() & 255;
+		samples16[i] = (rand() & 0xffff) - 0x8000;
+	}
 
-	for (i=0 ; i<count ; i++)
+	for (j=0 ; j<3 ; j++)
 	{
-		data = sfx[i];
-		buf[i].left += lscale[data];
-		buf[i].right += rscale[data];
+		n = numchannels[j];
+		for (i=0 ; i<n ; i++)
+		{
+			jobs[i].width = (i & 1) + 1;
+			jobs[i].data = jobs[i].width == 1 ? (void *)samples8 : (void *)samples16;
+			jobs[i].lscale = snd_scaletable[(i * 7) & 31];
+			jobs[i].rscale = snd_scaletable[(i * 13) & 31];
+			jobs[i].leftvol = (i * 57) & 255;
+			jobs[i].rightvol = (i * 105) & 255;
+			jobs[i].offset = 0;
+			jobs[i].count = PAINTBUFFER_SIZE;
+			jobs[i].step = 0;
+		}
+
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes ; i++)
+		{
+			Q_memset (buf, 0, sizeof(buf));
+			MIX_PaintJobs (jobs, n, buf, PAINTBUFFER_SIZE);
+			MIX_CompressPaintbuffer (buf, PAINTBUFFER_SIZE);
+		}
+		time = Sys_FloatTime () - start;
+
+		Con_Printf ("%3i channels: %7.1f us per %i samples\n", n, time * 1000000 / passes, PAINTBUFFER_SIZE);
 	}
-	
-	ch->pos += count;
 }
 
-void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, portable_samplepair_t *buf)
+/*
+===================
+S_ResampleBench_f
+
+snd_resamplebench [passes] : times loading a second of 22050Hz sound
+with nearest and polyphase resampling, and mixing 32 channels of it
+resampled against stepping through it at its native rate
+===================
+*/
+void S_ResampleBench_f (void)
 {
-	int data;
-	int left, right;
-	int leftvol, rightvol;
-	signed short *sfx;
-	int	i;
+	static mixjob_t	jobs[32];
+	static portable_samplepair_t	buf[PAINTBUFFER_SIZE];
+	short		*in, *out;
+	int			passes, i, j, outcount, step;
+	double		start, time;
 
-	leftvol = ch->leftvol;
-	rightvol = ch->rightvol;
-	sfx = (signed short *)sc->data + ch->pos;
+	if (!shm)
+		return;
 
-	for (i=0 ; i<count ; i++)
+	passes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10;
+	if (passes < 1)
+		passes = 1;
+
+	outcount = shm->speed;
+	in = Hunk_TempAlloc ((22050 + outcount + 1) * sizeof(short));
+	out = in + 22050;
+	for (i=0 ; i<22050 ; i++)
+		in[i] = sin (i * (i / 22050.0) * 0.5) * 16000;		// rising sweep
+	out[outcount] = 0;
+
+	for (j=0 ; j<2 ; j++)
 	{
-		data = sfx[i];
-		left = (data * leftvol) >> 8;
-		right = (data * rightvol) >> 8;
-		buf[i].left += left;
-		buf[i].right += right;
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes ; i++)
+			S_ResampleData ((byte *)in, 2, 22050, (byte *)out, 2, outcount, 22050.0 / outcount, j);
+		time = Sys_FloatTime () - start;
+		Con_Printf ("%s load: %.2f ms per second of sound\n", j ? "polyphase" : "nearest", time * 1000 / passes);
 	}
 
-	ch->pos += count;
+	step = ((long long)22050 << 16) / shm->speed;
+	for (j=0 ; j<2 ; j++)
+	{
+		for (i=0 ; i<32 ; i++)
+		{
+			jobs[i].width = 2;
+			jobs[i].data = j ? in : out;
+			jobs[i].leftvol = 200;
+			jobs[i].rightvol = 100;
+			jobs[i].offset = 0;
+			jobs[i].count = PAINTBUFFER_SIZE;
+			jobs[i].step = j ? step : 0;
+			jobs[i].frac = 0;
+		}
+
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes * 100 ; i++)
+		{
+			Q_memset (buf, 0, sizeof(buf));
+			MIX_PaintJobs (jobs, 32, buf, PAINTBUFFER_SIZE);
+		}
+		time = Sys_FloatTime () - start;
+		Con_Printf ("%s mix: %.1f us per %i samples\n", j ? "native rate" : "resampled", time * 1000000 / (passes * 100), PAINTBUFFER_SIZE);
+	}
 }
 
+/*
+===================
+S_ADPCMBench_f
+
+snd_adpcmbench [passes] : encodes a second of sound to ADPCM and mixes
+32 channels of it against the same sound kept as 16 bit
+===================
+*/
+void S_ADPCMBench_f (void)
+{
+	static channel_t	chans[32];
+	static portable_samplepair_t	buf[PAINTBUFFER_SIZE];
+	sfxcache_t	*sc[2];
+	short		*pcm;
+	int			passes, i, j, k, length;
+	double		start, time, signal, noise;
+
+	if (!shm)
+		return;
+	if (snd_threaded)
+	{
+		Con_Printf ("the sound thread owns the mixer, not with -sndthread\n");
+		return;
+	}
+
+	passes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10;
+	if (passes < 1)
+		passes = 1;
 
+	length = shm->speed;
+	sc[0] = Hunk_TempAlloc (2 * sizeof(sfxcache_t) + (length + 1) * sizeof(short) + S_ADPCMSize (length + 1) + 16);
+	sc[1] = (sfxcache_t *)((byte *)sc[0] + ((sizeof(sfxcache_t) + (length + 1) * sizeof(short) + 3) & ~3));
+	for (j=0 ; j<2 ; j++)
+	{
+		sc[j]->length = length;
+		sc[j]->loopstart = 0;
+		sc[j]->speed = shm->speed;
+		sc[j]->width = 2;
+		sc[j]->stereo = 0;
+		sc[j]->streamofs = 0;
+		sc[j]->adpcm = j;
+	}
+	pcm = (short *)sc[0]->data;
+	for (i=0 ; i<length ; i++)
+		pcm[i] = sin (i * (i / (float)length) * 0.5) * 16000;		// rising sweep
+	pcm[length] = pcm[0];
+
+	start = Sys_FloatTime ();
+	for (i=0 ; i<passes ; i++)
+		S_EncodeADPCM (pcm, length + 1, sc[1]->data);
+	time = Sys_FloatTime () - start;
+
+// decode it back the way the mixer does, in paintbuffer sized pieces
+	memset (&chans[0], 0, sizeof(chans[0]));
+	signal = noise = 0;
+	for (i=0 ; i<length ; i+=k)
+	{
+		k = length - i < PAINTBUFFER_SIZE ? length - i : PAINTBUFFER_SIZE;
+		MIX_DecodeADPCM (&chans[0], sc[1], i, k, i + k, mix_decoded);
+		for (j=0 ; j<k ; j++)
+		{
+			signal += (double)pcm[i+j] * pcm[i+j];
+			noise += (double)(pcm[i+j] - mix_decoded[j]) * (pcm[i+j] - mix_decoded[j]);
+		}
+	}
+	Con_Printf ("encode: %.2f ms per second of sound, %i bytes against %i, %.1f dB SNR\n",
+		time * 1000 / passes, S_ADPCMSize (length + 1), (length + 1) * 2,
+		noise > 0 ? 10 * log10 (signal / noise) : 99.0);
+
+	for (j=0 ; j<2 ; j++)
+	{
+		memset (chans, 0, sizeof(chans));
+		for (i=0 ; i<32 ; i++)
+		{
+			chans[i].leftvol = 200;
+			chans[i].rightvol = 100;
+			chans[i].pos = (i * 997) % (length - PAINTBUFFER_SIZE);
+		}
+
+		start = Sys_FloatTime ();
+		for (i=0 ; i<passes * 100 ; i++)
+		{
+			Q_memset (buf, 0, sizeof(buf));
+			mix_numjobs = 0;
+			mix_numdecoded = 0;
+			for (k=0 ; k<32 ; k++)
+			{
+				if (chans[k].pos + PAINTBUFFER_SIZE > length)
+					chans[k].pos = 0;
+				MIX_AddJob (&chans[k], sc[j], 0, PAINTBUFFER_SIZE, buf, PAINTBUFFER_SIZE);
+			}
+			MIX_PaintJobs (mix_jobs, mix_numjobs, buf, PAINTBUFFER_SIZE);
+		}
+		time = Sys_FloatTime () - start;
+		mix_numjobs = 0;
+		mix_numdecoded = 0;
+		Con_Printf ("%s mix: %.1f us per %i samples\n", j ? "adpcm" : "16 bit", time * 1000000 / (passes * 100), PAINTBUFFER_SIZE);
+	}
+}
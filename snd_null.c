@@ -79,6 +79,14 @@ void S_StopAllSounds (qboolean clear)
 {
 }
 
+void S_BlockSoundThread (void)
+{
+}
+
+void S_UnblockSoundThread (void)
+{
+}
+
 void S_BeginPrecaching (void)
 {
 }
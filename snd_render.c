@@ -0,0 +1,274 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_render.c -- renders the room fx over a wav, for checking dsp changes
+
+#include "quakedef.h"
+
+/*
+snd_dsprender <wav> [update]
+
+Runs a sound through every room type the way S_PaintChannels does, one
+paintbuffer at a time starting from empty delay lines, and writes each
+result to dsprender/roomNN.wav in the game directory.  The output of
+every room is hashed and checked against dsprender/golden.txt, so a
+change to the fx code can be verified to sound the same and timed on the
+device.  "update" rewrites golden.txt from this run.
+*/
+
+#define	RENDER_MAXSECONDS	30
+#define	RENDER_GOLDEN		"dsprender/golden.txt"
+
+extern portable_samplepair_t paintbuffer[];
+
+/*
+================
+S_RenderHash
+
+FNV-1a over the little endian 16 bit output
+================
+*/
+static unsigned S_RenderHash (short *data, int count)
+{
+	unsigned	hash;
+	int			i, v;
+
+	hash = 2166136261u;
+	for (i=0 ; i<count ; i++)
+	{
+		v = data[i];
+		hash = (hash ^ (v & 0xff)) * 16777619u;
+		hash = (hash ^ ((v >> 8) & 0xff)) * 16777619u;
+	}
+	return hash;
+}
+
+/*
+================
+S_RenderWriteWav
+
+16 bit stereo at the output rate
+================
+*/
+static void S_RenderWriteWav (char *name, short *data, int samples)
+{
+	char	path[MAX_OSPATH];
+	byte	header[44];
+	int		file, i;
+
+	sprintf (path, "%s/%s", com_gamedir, name);
+	COM_CreatePath (path);
+	file = Sys_FileOpenWrite (path);
+	if (file < 0)
+	{
+		Con_Printf ("couldn't write %s\n", path);
+		return;
+	}
+
+	memset (header, 0, sizeof(header));
+	memcpy (header, "RIFF", 4);
+	i = LittleLong (36 + samples * 4);
+	memcpy (header + 4, &i, 4);
+	memcpy (header + 8, "WAVEfmt ", 8);
+	header[16] = 16;
+	header[20] = 1;
+	header[22] = 2;
+	i = LittleLong (shm->speed);
+	memcpy (header + 24, &i, 4);
+	i = LittleLong (shm->speed * 4);
+	memcpy (header + 28, &i, 4);
+	header[32] = 4;
+	header[34] = 16;
+	memcpy (header + 36, "data", 4);
+	i = LittleLong (samples * 4);
+	memcpy (header + 40, &i, 4);
+	Sys_FileWrite (file, header, sizeof(header));
+
+	for (i=0 ; i<samples*2 ; i++)
+		data[i] = LittleShort (data[i]);
+	Sys_FileWrite (file, data, samples * 4);
+	for (i=0 ; i<samples*2 ; i++)
+		data[i] = LittleShort (data[i]);
+
+	Sys_FileClose (file);
+}
+
+/*
+================
+S_RenderRoom
+
+Returns the seconds spent in the fx code
+================
+*/
+static double S_RenderRoom (int room, short *in, short *out, int samples)
+{
+	double	start, time;
+	int		pos, count, i, l, r;
+
+	SX_ResetState ();
+
+	time = 0;
+	for (pos = 0 ; pos < samples ; pos += count)
+	{
+		count = samples - pos;
+		if (count > 512)
+			count = 512;		// PAINTBUFFER_SIZE
+
+		for (i=0 ; i<count ; i++)
+			paintbuffer[i].left = paintbuffer[i].right = in[pos + i];
+
+		start = Sys_FloatTime ();
+		SX_ProcessRoom (room, count, 0, 1);
+		time += Sys_FloatTime () - start;
+
+		for (i=0 ; i<count ; i++)
+		{
+			l = paintbuffer[i].left;
+			r = paintbuffer[i].right;
+			out[(pos + i)*2] = CLIP(l);
+			out[(pos + i)*2 + 1] = CLIP(r);
+		}
+	}
+
+	return time;
+}
+
+/*
+================
+S_DspRender_f
+================
+*/
+void S_DspRender_f (void)
+{
+#ifdef DSP2
+	Con_Printf ("snd_dsprender renders the room fx, dsp_bench checks the DSP2 presets\n");
+#else
+	char		name[MAX_QPATH];
+	char		*golden, *text;
+	byte		*data;
+	short		*in, *out;
+	wavinfo_t	info;
+	unsigned	hash, hashes[CSXROOM];
+	double		time, total;
+	int			mark, samples, room, groom, failed, checked, update;
+	unsigned	ghash;
+
+	if (!snd_initialized || !shm)
+		return;
+	if (snd_threaded)
+	{
+		Con_Printf ("the sound thread owns the paintbuffer, not with -sndthread\n");
+		return;
+	}
+	if (Cmd_Argc() < 2)
+	{
+		Con_Printf ("snd_dsprender <wav> [update] : renders every room type over sound/<wav>\n");
+		return;
+	}
+	update = Cmd_Argc() > 2 && !Q_strcmp (Cmd_Argv(2), "update");
+
+	mark = Hunk_LowMark ();
+
+	sprintf (name, "sound/%s", Cmd_Argv(1));
+	data = COM_LoadHunkFile (name);
+	if (!data)
+	{
+		Con_Printf ("Couldn't load %s\n", name);
+		return;
+	}
+	info = GetWavinfo (name, data, com_filesize);
+	if (info.channels != 1 || !info.rate || info.samples <= 0)
+	{
+		Con_Printf ("%s is not a mono wav\n", name);
+		Hunk_FreeToLowMark (mark);
+		return;
+	}
+
+// at the output rate, as the mixer would hand it to the fx
+	samples = (double)info.samples * shm->speed / info.rate;
+	if (samples > RENDER_MAXSECONDS * shm->speed)
+		samples = RENDER_MAXSECONDS * shm->speed;
+	in = Hunk_AllocName (samples * 2, "dsprender");
+	out = Hunk_AllocName (samples * 4, "dsprender");
+	S_ResampleData (data + info.dataofs, info.width, info.samples, (byte *)in, 2, samples,
+		(float)info.rate / shm->speed, snd_resample.value);
+
+	total = 0;
+	for (room = 0 ; room < CSXROOM ; room++)
+	{
+		time = S_RenderRoom (room, in, out, samples);
+		total += time;
+		hashes[room] = S_RenderHash (out, samples * 2);
+		S_RenderWriteWav (va("dsprender/room%02i.wav", room), out, samples);
+		Con_Printf ("room %2i: %08x %6.2f ms\n", room, hashes[room], time * 1000);
+	}
+
+// the live mixer picks up its own room again from empty lines
+	SX_ResetState ();
+
+	Con_Printf ("%i rooms, %.2f s of sound each, %.1f ms in the fx (%.0fx realtime)\n",
+		CSXROOM, (float)samples / shm->speed, total * 1000,
+		total > 0 ? CSXROOM * (float)samples / shm->speed / total : 0);
+
+	if (update)
+	{
+		text = Hunk_AllocName (CSXROOM * 16 + 1, "dsprender");
+		text[0] = 0;
+		for (room = 0 ; room < CSXROOM ; room++)
+			sprintf (text + Q_strlen(text), "%2i %08x\n", room, hashes[room]);
+		COM_WriteFile (RENDER_GOLDEN, text, Q_strlen(text));
+		Hunk_FreeToLowMark (mark);
+		return;
+	}
+
+	golden = (char *)COM_LoadHunkFile (RENDER_GOLDEN);
+	if (!golden)
+	{
+		Con_Printf ("no %s, \"snd_dsprender %s update\" to make one\n", RENDER_GOLDEN, Cmd_Argv(1));
+		Hunk_FreeToLowMark (mark);
+		return;
+	}
+
+	failed = checked = 0;
+	for (text = golden ; *text ; )
+	{
+		if (sscanf (text, "%i %x", &groom, &ghash) == 2 && groom >= 0 && groom < CSXROOM)
+		{
+			hash = hashes[groom];
+			checked++;
+			if (hash != ghash)
+			{
+				Con_Printf ("room %2i: %08x, golden %08x\n", groom, hash, ghash);
+				failed++;
+			}
+		}
+		while (*text && *text != '\n')
+			text++;
+		if (*text)
+			text++;
+	}
+
+	if (failed)
+		Con_Printf ("MISMATCH: %i of %i rooms differ from %s\n", failed, checked, RENDER_GOLDEN);
+	else
+		Con_Printf ("%i rooms match %s\n", checked, RENDER_GOLDEN);
+
+	Hunk_FreeToLowMark (mark);
+#endif
+}
@@ -0,0 +1,304 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_stats.c -- mixer cost, voice and dma counters for snd_stats and snd_graph
+
+#include "quakedef.h"
+#include <pspgu.h>
+
+/*
+The mixer adds to snd_stats as it goes, on whichever thread mixes.  Once
+a frame S_StatsFrame takes what was added since the last frame into a
+history for snd_stats and snd_graph, and while a timedemo runs into rows
+for snd_statscsv.  Nothing is locked, a frame read in the middle of a
+paint just gets some of its time counted in the next frame.
+*/
+
+#define	SNDSTAT_HISTORY		128		// frames, power of two
+#define	SNDSTAT_MAXROWS		4096	// timedemo frames kept for the csv
+
+typedef struct
+{
+	unsigned short	us[SST_NUMSTAGES];	// microseconds in each stage
+	unsigned short	painted;			// sample pairs
+	unsigned short	updates;			// S_Update_ calls that mixed
+	unsigned short	realvoices;
+	unsigned short	virtualvoices;
+	short			lag;				// samples mixed ahead of the dma position
+	unsigned short	underruns;
+	byte			demo;				// csv rows: index into snd_rowdemos
+} sndframe_t;
+
+sndstats_t	snd_stats;
+
+cvar_t	snd_graph = {"snd_graph", "0"};
+cvar_t	snd_graphscale = {"snd_graphscale", "50"};		// microseconds a pixel
+cvar_t	snd_statscsv = {"snd_statscsv", ""};			// timedemo per frame sound stats in the game dir, "" for none
+
+static char			*snd_stagenames[SST_NUMSTAGES] = {"mix", "fx", "compress", "transfer"};
+static int			snd_stagecolors[SST_NUMSTAGES];
+
+static sndstats_t	snd_lastframe;
+static sndframe_t	snd_history[SNDSTAT_HISTORY];
+static int			snd_historyframes;
+
+static sndframe_t	snd_rows[SNDSTAT_MAXROWS];
+static int			snd_numrows;
+static char			snd_rowdemos[MAX_DEMOS][MAX_DEMONAME];
+static int			snd_numrowdemos;
+
+/*
+================
+S_StatClamp
+================
+*/
+static int S_StatClamp (double value, int max)
+{
+	if (value < 0)
+		return 0;
+	if (value > max)
+		return max;
+	return (int)value;
+}
+
+/*
+================
+S_StatsFrame
+
+Called once a frame from S_Update
+================
+*/
+void S_StatsFrame (void)
+{
+	sndstats_t	now;
+	sndframe_t	*f;
+	int			i;
+
+	now = snd_stats;
+
+	f = &snd_history[snd_historyframes & (SNDSTAT_HISTORY-1)];
+	snd_historyframes++;
+	for (i=0 ; i<SST_NUMSTAGES ; i++)
+		f->us[i] = S_StatClamp ((now.stagetime[i] - snd_lastframe.stagetime[i]) * 1000000, 0xffff);
+	f->painted = S_StatClamp (now.painted - snd_lastframe.painted, 0xffff);
+	f->updates = S_StatClamp (now.updates - snd_lastframe.updates, 0xffff);
+	f->underruns = S_StatClamp (now.underruns - snd_lastframe.underruns, 0xffff);
+	f->realvoices = snd_realvoices;
+	f->virtualvoices = snd_virtualvoices;
+	f->lag = S_StatClamp (now.lag, 0x7fff);
+	f->demo = snd_numrowdemos - 1;
+	snd_lastframe = now;
+
+// the first frame of a timedemo has the loading in it
+	if (cls.timedemo && snd_statscsv.string[0] && snd_numrowdemos
+		&& host_framecount > cls.td_startframe + 1 && snd_numrows < SNDSTAT_MAXROWS)
+		snd_rows[snd_numrows++] = *f;
+}
+
+/*
+================
+S_StatsStartTimeDemo
+
+Starts the csv rows over unless this is the next demo of timedemos
+================
+*/
+void S_StatsStartTimeDemo (char *name)
+{
+	if (!cls.td_batch || snd_numrowdemos == MAX_DEMOS)
+	{
+		snd_numrows = 0;
+		snd_numrowdemos = 0;
+	}
+	Q_strncpyz (snd_rowdemos[snd_numrowdemos++], name, MAX_DEMONAME);
+}
+
+/*
+================
+S_StatsFinishTimeDemo
+
+Writes every row of this run to snd_statscsv
+================
+*/
+void S_StatsFinishTimeDemo (void)
+{
+	char		path[MAX_OSPATH], line[256];
+	sndframe_t	*f;
+	int			file, i, j, len;
+
+	if (!snd_statscsv.string[0] || !snd_numrowdemos)
+		return;
+
+	sprintf (path, "%s/%s", com_gamedir, snd_statscsv.string);
+	COM_CreatePath (path);
+	file = Sys_FileOpenWrite (path);
+	if (file < 0)
+	{
+		Con_Printf ("couldn't write %s\n", path);
+		return;
+	}
+
+	len = sprintf (line, "demo,frame");
+	for (j=0 ; j<SST_NUMSTAGES ; j++)
+		len += sprintf (line + len, ",%s_ms", snd_stagenames[j]);
+	len += sprintf (line + len, ",painted,updates,real,virtual,lag,underruns\n");
+	Sys_FileWrite (file, line, len);
+
+	for (i=0, f=snd_rows ; i<snd_numrows ; i++, f++)
+	{
+		len = sprintf (line, "%s,%i", snd_rowdemos[f->demo], i);
+		for (j=0 ; j<SST_NUMSTAGES ; j++)
+			len += sprintf (line + len, ",%.3f", f->us[j] / 1000.0);
+		len += sprintf (line + len, ",%i,%i,%i,%i,%i,%i\n", f->painted, f->updates,
+			f->realvoices, f->virtualvoices, f->lag, f->underruns);
+		Sys_FileWrite (file, line, len);
+	}
+
+	Sys_FileClose (file);
+	Con_Printf ("%i frames of sound stats written to %s\n", snd_numrows, snd_statscsv.string);
+}
+
+/*
+================
+S_Stats_f
+
+snd_stats : mix cost per stage, voices, dma lag and underruns over the
+last SNDSTAT_HISTORY frames
+================
+*/
+void S_Stats_f (void)
+{
+	sndframe_t	*f;
+	int			i, j, frames, total, maxtotal, lag, minlag, painted, updates, underruns;
+	int			sum[SST_NUMSTAGES], max[SST_NUMSTAGES];
+
+	frames = snd_historyframes < SNDSTAT_HISTORY ? snd_historyframes : SNDSTAT_HISTORY;
+	if (!frames || !shm)
+	{
+		Con_Printf ("no sound frames yet\n");
+		return;
+	}
+
+	memset (sum, 0, sizeof(sum));
+	memset (max, 0, sizeof(max));
+	maxtotal = lag = painted = updates = underruns = 0;
+	minlag = 0x7fff;
+	for (i=0, f=snd_history ; i<frames ; i++, f++)
+	{
+		total = 0;
+		for (j=0 ; j<SST_NUMSTAGES ; j++)
+		{
+			sum[j] += f->us[j];
+			if (f->us[j] > max[j])
+				max[j] = f->us[j];
+			total += f->us[j];
+		}
+		if (total > maxtotal)
+			maxtotal = total;
+		lag += f->lag;
+		if (f->lag < minlag)
+			minlag = f->lag;
+		painted += f->painted;
+		updates += f->updates;
+		underruns += f->underruns;
+	}
+
+	Con_Printf ("last %i frames, %s\n", frames, snd_threaded ? "mixing on the sound thread" : "mixing on the main thread");
+	total = 0;
+	for (j=0 ; j<SST_NUMSTAGES ; j++)
+	{
+		Con_Printf ("%-9s %6.3f ms, max %6.3f\n", snd_stagenames[j], sum[j] / 1000.0 / frames, max[j] / 1000.0);
+		total += sum[j];
+	}
+	Con_Printf ("%-9s %6.3f ms, max %6.3f\n", "total", total / 1000.0 / frames, maxtotal / 1000.0);
+	Con_Printf ("%i samples in %.1f updates a frame, %i real %i virtual voices\n",
+		painted / frames, (float)updates / frames, snd_realvoices, snd_virtualvoices);
+	Con_Printf ("dma lag %.1f ms, min %.1f ms\n", (float)lag / frames * 1000 / shm->speed, (float)minlag * 1000 / shm->speed);
+	Con_Printf ("%i underruns, %i since startup\n", underruns, snd_stats.underruns);
+}
+
+/*
+================
+S_StatsDraw
+
+snd_graph 1 draws the mix cost of the last frames, one bar a frame
+stacked by stage, frames that underran in red behind
+================
+*/
+void S_StatsDraw (void)
+{
+	sndframe_t	*f;
+	int			i, j, x, y, h, top, frame, scale;
+	char		st[80];
+
+	if (!snd_graph.value || !snd_historyframes || !shm)
+		return;
+
+	if (!snd_stagecolors[0])
+	{
+		snd_stagecolors[sst_mix] = GU_RGBA(0, 200, 0, 200);
+		snd_stagecolors[sst_fx] = GU_RGBA(0, 100, 255, 200);
+		snd_stagecolors[sst_compress] = GU_RGBA(255, 255, 0, 200);
+		snd_stagecolors[sst_transfer] = GU_RGBA(255, 0, 255, 200);
+	}
+
+	scale = snd_graphscale.value > 1 ? snd_graphscale.value : 1;
+	y = vid.height - 64;
+	Draw_Fill (8, y - 64, SNDSTAT_HISTORY * 2, 64, GU_RGBA(0, 0, 0, 128));
+
+	for (i=0 ; i<SNDSTAT_HISTORY ; i++)
+	{
+		frame = snd_historyframes - SNDSTAT_HISTORY + i;
+		if (frame < 0)
+			continue;
+		f = &snd_history[frame & (SNDSTAT_HISTORY-1)];
+		x = 8 + i * 2;
+		if (f->underruns)
+			Draw_Fill (x, y - 64, 2, 64, GU_RGBA(255, 0, 0, 160));
+
+		top = y;
+		for (j=0 ; j<SST_NUMSTAGES ; j++)
+		{
+			h = f->us[j] / scale;
+			if (h > top - (y - 64))
+				h = top - (y - 64);
+			if (h <= 0)
+				continue;
+			top -= h;
+			Draw_Fill (x, top, 2, h, snd_stagecolors[j]);
+		}
+	}
+
+	f = &snd_history[(snd_historyframes - 1) & (SNDSTAT_HISTORY-1)];
+	sprintf (st, "snd %.2fms %iv %.0fms lag", (f->us[0] + f->us[1] + f->us[2] + f->us[3]) / 1000.0,
+		f->realvoices, (float)f->lag * 1000 / shm->speed);
+	Draw_String (8, y - 72, st);
+}
+
+/*
+================
+S_StatsInit
+================
+*/
+void S_StatsInit (void)
+{
+	Cmd_AddCommand ("snd_stats", S_Stats_f);
+	Cvar_RegisterVariable (&snd_graph);
+	Cvar_RegisterVariable (&snd_graphscale);
+	Cvar_RegisterVariable (&snd_statscsv);
+}
@@ -0,0 +1,439 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_stream.c -- wavs too long for the cache, played through a small ring
+
+#include "quakedef.h"
+
+/*
+S_LoadSound leaves only a sfxcache_t header in the cache for wavs bigger
+than snd_streamsize kb, with streamofs set to where the samples start in
+the file.  Every channel playing one opens its own stream, which keeps the
+file open and a ring of 16 bit samples at the wav rate in front of the
+channel.  The mixer steps through the ring by ch->step, a looped sound is
+just a stream that never ends.  Rings are topped up from S_Update_ before
+mixing, so memory for a sound is bounded by STREAM_RING whatever its length.
+*/
+
+cvar_t	snd_streamsize = {"snd_streamsize", "256", true};	// kb, 0 never streams
+
+#define	MAX_STREAMS		4
+#define	STREAM_RING		16384		// samples, power of two
+#define	STREAM_CHUNK	4096		// samples per read
+
+typedef struct sndstream_s
+{
+	channel_t	*channel;		// NULL if free
+	sfx_t		*sfx;
+	int			file;
+	int			filestart;		// absolute offset of the first sample
+	int			width;			// bytes per sample in the file
+	int			samples;
+	int			loopstart;		// -1 if not looped
+	int			filled;			// stream position one past the last buffered sample
+	short		ring[STREAM_RING + 1];	// + guard copy of ring[0] for interpolation
+} sndstream_t;
+
+static sndstream_t	snd_streams[MAX_STREAMS];
+static byte			stream_readbuf[STREAM_CHUNK * 2];
+
+/*
+================
+S_StreamLoopInfo
+
+The cue and LIST chunks come after the samples, so GetWavinfo never sees
+them in the header.  Same parse, over whatever follows the data chunk.
+================
+*/
+static void S_StreamLoopInfo (byte *tail, int len, wavinfo_t *info)
+{
+	byte	*p, *end;
+	int		chunklen;
+
+	end = tail + len;
+	for (p = tail ; p + 8 <= end ; p += 8 + ((chunklen + 1) & ~1))
+	{
+		chunklen = p[4] + (p[5]<<8) + (p[6]<<16) + (p[7]<<24);
+		if (chunklen < 0)
+			return;
+		if (strncmp ((char *)p, "cue ", 4) || p + 36 > end)
+			continue;
+
+		info->loopstart = p[32] + (p[33]<<8) + (p[34]<<16) + (p[35]<<24);
+
+	// a LIST mark chunk right after gives the loop length
+		p += 8 + ((chunklen + 1) & ~1);
+		if (p + 36 <= end && !strncmp ((char *)p, "LIST", 4) && !strncmp ((char *)p + 28, "mark", 4))
+			info->samples = info->loopstart + (p[24] + (p[25]<<8) + (p[26]<<16) + (p[27]<<24));
+		return;
+	}
+}
+
+/*
+================
+S_LoadStreamedSound
+
+Returns NULL if the sound is small enough to cache whole
+================
+*/
+sfxcache_t *S_LoadStreamedSound (sfx_t *s, char *path)
+{
+	static byte	header[4096];
+	wavinfo_t	info;
+	sfxcache_t	*sc;
+	int			file, len, filestart, headerlen, tailstart, taillen, datasamples;
+
+	if (snd_streamsize.value <= 0)
+		return NULL;
+
+	len = COM_FOpenFile (path, &file);
+	if (file < 0)
+		return NULL;
+	filestart = com_filestart;
+	if (len <= snd_streamsize.value * 1024)
+	{
+		COM_CloseFile (file);
+		return NULL;
+	}
+
+	headerlen = len < (int)sizeof(header) ? len : (int)sizeof(header);
+	Sys_FileRead (file, header, headerlen);
+	info = GetWavinfo (s->name, header, headerlen);
+	if (info.channels != 1 || !info.width || !info.dataofs)
+	{
+		COM_CloseFile (file);
+		return NULL;		// let S_LoadSound complain
+	}
+
+	info.loopstart = -1;
+	datasamples = info.samples;
+	tailstart = info.dataofs + info.samples * info.width;
+	taillen = len - tailstart;
+	if (taillen > (int)sizeof(header))
+		taillen = sizeof(header);
+	if (taillen > 0)
+	{
+		Sys_FileSeek (file, filestart + tailstart);
+		Sys_FileRead (file, header, taillen);
+		S_StreamLoopInfo (header, taillen, &info);
+	}
+	COM_CloseFile (file);
+
+// SND_ReadStream wraps by samples - loopstart, so that has to be positive
+	if (info.samples > datasamples || info.samples <= 0)
+		info.samples = datasamples;
+	if (info.loopstart < -1 || info.loopstart >= info.samples)
+	{
+		Con_Printf ("Sound %s has a bad loop point\n", s->name);
+		info.loopstart = -1;
+	}
+
+	sc = Cache_Alloc (&s->cache, sizeof(sfxcache_t), s->name);
+	if (!sc)
+		return NULL;
+
+	sc->length = info.samples;
+	sc->loopstart = info.loopstart;
+	sc->speed = info.rate;
+	sc->width = 2;				// the ring is always 16 bit
+	sc->stereo = 0;
+	sc->streamofs = info.dataofs;
+	sc->streamwidth = info.width;
+	sc->adpcm = false;
+	return sc;
+}
+
+/*
+================
+SND_CloseStream
+================
+*/
+static void SND_CloseStream (sndstream_t *st)
+{
+	Sys_FileClose (st->file);
+	st->channel = NULL;
+	st->sfx = NULL;
+}
+
+/*
+================
+SND_ReadStream
+
+Appends up to count samples at st->filled to the ring, following the loop
+================
+*/
+static void SND_ReadStream (sndstream_t *st, int count)
+{
+	int		pos, run, i, idx;
+	byte	*in;
+
+	while (count > 0)
+	{
+		pos = st->filled;
+		if (pos >= st->samples)
+		{
+			if (st->loopstart < 0)
+				return;		// played out
+			pos = st->loopstart + (pos - st->loopstart) % (st->samples - st->loopstart);
+		}
+
+		run = st->samples - pos;
+		if (run > count)
+			run = count;
+
+		Sys_FileSeek (st->file, st->filestart + pos * st->width);
+		Sys_FileRead (st->file, stream_readbuf, run * st->width);
+
+		in = stream_readbuf;
+		for (i=0 ; i<run ; i++)
+		{
+			idx = (st->filled + i) & (STREAM_RING - 1);
+			if (st->width == 2)
+				st->ring[idx] = LittleShort (((short *)in)[i]);
+			else
+				st->ring[idx] = ((int)in[i] - 128) << 8;
+			if (!idx)
+				st->ring[STREAM_RING] = st->ring[0];
+		}
+
+		st->filled += run;
+		count -= run;
+	}
+}
+
+/*
+================
+SND_OpenStreamFile
+
+Opens the wav behind a streamed sfx and returns the handle, with the
+absolute offset of the file in *filestart.  Done by the caller of
+S_StartSound so the audio thread never searches the paks.
+
+The handle is the stream's own: COM_FOpenFile reopens a pak by name
+rather than returning pak->handle as COM_OpenFile does, so the audio
+thread can seek it while the game thread reads the same pak.  It is
+always closed with Sys_FileClose, COM_CloseFile would walk the search
+paths from the audio thread.
+================
+*/
+int SND_OpenStreamFile (sfx_t *sfx, int *filestart)
+{
+	char	path[MAX_QPATH + 8];
+	int		file;
+
+	sprintf (path, "sound/%s", sfx->name);
+	COM_FOpenFile (path, &file);
+	*filestart = com_filestart;
+	return file;
+}
+
+/*
+================
+SND_OpenStream
+
+Starts streaming ch->sfx for a channel set up from the header sc.  Takes
+over the handle from SND_OpenStreamFile, closing it if no stream is free.
+================
+*/
+qboolean SND_OpenStream (channel_t *ch, sfxcache_t *sc, int file, int filestart)
+{
+	sndstream_t	*st;
+	int			i;
+
+	for (i=0, st=snd_streams ; i<MAX_STREAMS ; i++, st++)
+		if (!st->channel)
+			break;
+	if (i == MAX_STREAMS)
+	{
+		Sys_FileClose (file);
+		return false;
+	}
+
+	st->channel = ch;
+	st->sfx = ch->sfx;
+	st->file = file;
+	st->filestart = filestart + sc->streamofs;
+	st->width = sc->streamwidth;
+	st->samples = sc->length;
+	st->loopstart = sc->loopstart;
+	st->filled = 0;
+	SND_ReadStream (st, STREAM_RING - STREAM_CHUNK);
+
+// the mixer only sees a sound that runs to the end of the stream
+	ch->stream = st;
+	ch->pos = 0;
+	ch->posfrac = 0;
+	ch->loopstart = -1;
+	ch->length = sc->loopstart >= 0 ? 0x3fffffff : sc->length;	// SND_PaintSamples clamps end
+	ch->step = SND_ChannelStep (sc);
+	ch->end = paintedtime + SND_PaintSamples (ch, ch->length);
+	return true;
+}
+
+/*
+================
+SND_UpdateStreams
+
+Closes streams whose channel moved on and tops up the rest
+================
+*/
+void SND_UpdateStreams (void)
+{
+	sndstream_t	*st;
+	channel_t	*ch;
+	int			i, pos;
+
+	for (i=0, st=snd_streams ; i<MAX_STREAMS ; i++, st++)
+	{
+		ch = st->channel;
+		if (!ch)
+			continue;
+		if (ch->stream != st || ch->sfx != st->sfx)
+		{
+			SND_CloseStream (st);
+			continue;
+		}
+
+	// virtual voices and underruns move the channel past the ring
+		pos = ch->pos;
+		if (pos > st->filled || st->filled - pos > STREAM_RING)
+			st->filled = pos;
+
+		while (st->filled - pos <= STREAM_RING - STREAM_CHUNK)
+		{
+			if (st->loopstart < 0 && st->filled >= st->samples)
+				break;
+			SND_ReadStream (st, STREAM_CHUNK);
+		}
+	}
+}
+
+/*
+================
+SND_StopStreams
+================
+*/
+void SND_StopStreams (void)
+{
+	int		i;
+
+	for (i=0 ; i<MAX_STREAMS ; i++)
+		if (snd_streams[i].channel)
+		{
+			snd_streams[i].channel->stream = NULL;
+			SND_CloseStream (&snd_streams[i]);
+		}
+}
+
+/*
+================
+SND_StreamPaintable
+
+Paint samples ch can mix from one contiguous run of its ring
+================
+*/
+int SND_StreamPaintable (channel_t *ch)
+{
+	sndstream_t	*st = ch->stream;
+	int			contig, buffered, n;
+
+	contig = STREAM_RING - (ch->pos & (STREAM_RING - 1));
+	buffered = st->filled - ch->pos - (ch->step ? 1 : 0);
+	if (buffered <= 0)
+		return 0;
+	if (contig > buffered)
+		contig = buffered;
+
+	n = SND_PaintSamples (ch, contig);
+	return n > 0 ? n : 0;
+}
+
+/*
+================
+SND_StreamData
+================
+*/
+void *SND_StreamData (channel_t *ch)
+{
+	return &ch->stream->ring[ch->pos & (STREAM_RING - 1)];
+}
+
+/*
+================
+S_StreamTest_f
+
+snd_streamtest [minutes] : writes a long sweep to sound/streamtest.wav
+and plays it, to check that a sound far bigger than the cache streams
+================
+*/
+void S_StreamTest_f (void)
+{
+	static short	chunk[STREAM_CHUNK];	// stream_readbuf belongs to the mixer
+	char	name[MAX_OSPATH];
+	int		file, minutes, samples, i, n, written;
+	byte	header[44];
+
+	minutes = Cmd_Argc() > 1 ? Q_atoi(Cmd_Argv(1)) : 10;
+	if (minutes < 1)
+		minutes = 1;
+	samples = minutes * 60 * 11025;
+
+	sprintf (name, "%s/sound/streamtest.wav", com_gamedir);
+	COM_CreatePath (name);
+	file = Sys_FileOpenWrite (name);
+	if (file < 0)
+	{
+		Con_Printf ("couldn't write %s\n", name);
+		return;
+	}
+
+// 11025Hz 16 bit mono PCM
+	memset (header, 0, sizeof(header));
+	memcpy (header, "RIFF", 4);
+	i = LittleLong (36 + samples * 2);
+	memcpy (header + 4, &i, 4);
+	memcpy (header + 8, "WAVEfmt ", 8);
+	header[16] = 16;
+	header[20] = 1;
+	header[22] = 1;
+	i = LittleLong (11025);
+	memcpy (header + 24, &i, 4);
+	i = LittleLong (22050);
+	memcpy (header + 28, &i, 4);
+	header[32] = 2;
+	header[34] = 16;
+	memcpy (header + 36, "data", 4);
+	i = LittleLong (samples * 2);
+	memcpy (header + 40, &i, 4);
+	Sys_FileWrite (file, header, sizeof(header));
+
+	for (written = 0 ; written < samples ; written += n)
+	{
+		n = samples - written;
+		if (n > STREAM_CHUNK)
+			n = STREAM_CHUNK;
+		for (i=0 ; i<n ; i++)
+			chunk[i] = LittleShort ((short)(sin ((written + i) * (0.05 + 0.2 * (written % 441000) / 441000.0)) * 8000));
+		Sys_FileWrite (file, chunk, n * 2);
+	}
+	Sys_FileClose (file);
+
+	Con_Printf ("%i kb of sound, %i kb of stream ring\n", samples * 2 / 1024, (int)sizeof(snd_streams[0].ring) / 1024);
+	S_LocalSound ("streamtest.wav");
+}
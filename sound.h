@@ -38,6 +38,7 @@ typedef struct sfx_s
 {
 	char 	name[MAX_QPATH];
 	cache_user_t	cache;
+	int		loads;			// times S_LoadSound had to read it, more than 1 if evicted
 } sfx_t;
 
 // !!! if this is changed, it much be changed in asm_i386.h too !!!
@@ -48,9 +49,18 @@ typedef struct
 	int 	speed;
 	int 	width;
 	int 	stereo;
+	int		streamofs;		// file offset of the samples if streamed, 0 if in data
+	int		streamwidth;	// bytes per sample in the file if streamed
+	qboolean	adpcm;		// data is IMA ADPCM blocks, width is what it decodes to
 	byte	data[1];		// variable sized
 } sfxcache_t;
 
+// IMA ADPCM cache blocks: a 4 byte header with the decoder state for the
+// first sample, then two samples a byte
+#define	ADPCM_BLOCKSHIFT	8
+#define	ADPCM_BLOCK			(1<<ADPCM_BLOCKSHIFT)		// samples
+#define	ADPCM_BLOCKBYTES	(4 + ADPCM_BLOCK/2)
+
 typedef struct
 {
 	qboolean		gamealive;
@@ -79,8 +89,47 @@ typedef struct
 	vec3_t	origin;			// origin of sound effect
 	vec_t	dist_mult;		// distance multiplier (attenuation/clipK)
 	int		master_vol;		// 0-255 master volume
+	int		loopstart;		// copied from the sfxcache_t so virtual voices
+	int		length;			// can advance without loading it
+	qboolean	isvirtual;	// culled by SND_CullVoices, advanced but not mixed
+	int		step;			// 16.16 source samples per paint sample, 0 for 1
+	int		posfrac;		// 16.16 fraction of pos
+	struct sndstream_s	*stream;	// ring the samples come from, NULL if cached
+	int		leafnum;		// static clusters: world leaf the emitters are in
+	struct sndemitter_s	*emitters;	// static clusters: the sounds mixed as this voice
+	int		adpcmpos;		// sample the ADPCM decoder state is for
+	int		adpcmpred;
+	int		adpcmindex;
 } channel_t;
 
+// requests queued for the sound thread by the S_ functions
+typedef enum
+{
+	sndcmd_start,
+	sndcmd_static,
+	sndcmd_stop,
+	sndcmd_stopall,
+	sndcmd_listener
+} sndcmdtype_t;
+
+typedef struct
+{
+	sndcmdtype_t	type;
+	int			entnum;
+	int			entchannel;
+	sfx_t		*sfx;			// cache locked by the game thread
+	vec3_t		origin;
+	vec3_t		forward, right, up;		// sndcmd_listener
+	int			viewentity;		// sndcmd_listener
+	int			leafnum;		// sndcmd_static, sndcmd_listener
+	byte		*pvs;			// sndcmd_listener, NULL if unchanged
+	float		fvol;
+	float		attenuation;
+	int			file;			// stream handle, -1 if not streamed
+	int			filestart;
+	qboolean	clear;			// sndcmd_stopall
+} sndcmd_t;
+
 typedef struct
 {
 	int		rate;
@@ -98,6 +147,8 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation);
 void S_StopSound (int entnum, int entchannel);
 void S_StopAllSounds(qboolean clear);
+void S_BlockSoundThread (void);
+void S_UnblockSoundThread (void);
 void S_ClearBuffer (void);
 void S_Update (vec3_t origin, vec3_t v_forward, vec3_t v_right, vec3_t v_up);
 void S_ExtraUpdate (void);
@@ -108,6 +159,62 @@ void S_ClearPrecache (void);
 void S_BeginPrecaching (void);
 void S_EndPrecaching (void);
 void S_PaintChannels(int endtime);
+void S_MixBench_f (void);
+void MIX_MixChannelsToPaintbuffer (int endtime, portable_samplepair_t *buf);
+void S_ResampleBench_f (void);
+void S_ResampleData (byte *in, int inwidth, int incount, byte *out, int outwidth, int outcount, float stepscale, int quality);
+int SND_ChannelStep (sfxcache_t *sc);
+int SND_PaintSamples (channel_t *ch, int srcsamples);
+void SND_AdvanceChannel (channel_t *ch, int count);
+void S_ADPCMBench_f (void);
+
+// snd_mem.c
+extern const int			adpcm_steps[89];
+extern const signed char	adpcm_indexes[16];
+extern int		snd_loads;
+int S_ADPCMSize (int samples);
+void S_EncodeADPCM (short *in, int count, byte *out);
+
+// snd_stream.c
+sfxcache_t *S_LoadStreamedSound (sfx_t *s, char *path);
+int SND_OpenStreamFile (sfx_t *sfx, int *filestart);
+qboolean SND_OpenStream (channel_t *ch, sfxcache_t *sc, int file, int filestart);
+void SND_UpdateStreams (void);
+void SND_StopStreams (void);
+int SND_StreamPaintable (channel_t *ch);
+void *SND_StreamData (channel_t *ch);
+void S_StreamTest_f (void);
+
+// snd_render.c
+void S_DspRender_f (void);
+
+// snd_stats.c
+typedef enum
+{
+	sst_mix,			// MIX_MixChannelsToPaintbuffer
+	sst_fx,				// SX_RoomFX or DSP_Process
+	sst_compress,		// MIX_CompressPaintbuffer
+	sst_transfer,		// S_TransferPaintBuffer and SNDDMA_Submit
+	SST_NUMSTAGES
+} sndstage_t;
+
+// running totals, added to by whichever thread mixes
+typedef struct
+{
+	double	stagetime[SST_NUMSTAGES];	// seconds
+	int		painted;		// sample pairs
+	int		updates;		// S_Update_ calls that mixed
+	int		underruns;		// times the dma caught up with paintedtime
+	int		lag;			// samples mixed ahead of the dma at the last update
+} sndstats_t;
+
+extern sndstats_t	snd_stats;
+
+void S_StatsInit (void);
+void S_StatsFrame (void);
+void S_StatsDraw (void);
+void S_StatsStartTimeDemo (char *name);
+void S_StatsFinishTimeDemo (void);
 void S_InitPaintChannels (void);
 
 // picks a channel based on priorities, empty slots, number of channels
@@ -115,6 +222,15 @@ channel_t *SND_PickChannel(int entnum, int entchannel);
 
 // spatializes a channel
 void SND_Spatialize(channel_t *ch);
+void SND_CullVoices (int maxvoices);
+
+// stops a channel, giving back the cache lock its sound holds
+void SND_ClearChannel (channel_t *ch);
+
+// snd_dma.c sound thread
+sndcmd_t *SND_AllocCommand (void);
+void SND_PushCommand (void);
+void S_ThreadStats_f (void);
 
 // initializes cycling through a DMA buffer and returns information on it
 qboolean SNDDMA_Init(void);
@@ -140,6 +256,8 @@ void SX_Init (void);
 void SX_Free (void);
 void SX_ReloadRoomFX();
 void SX_RoomFX(int endtime, int fFilter, int fTimefx);
+void SX_ProcessRoom(float roomType, int sampleCount, int fFilter, int fTimefx);
+void SX_ResetState();
 
 //=====================================================================
 // FX presets
@@ -193,7 +311,7 @@ void SX_RoomFX(int endtime, int fFilter, int fTimefx);
 // User-setable variables
 // ====================================================================
 
-#define	MAX_CHANNELS			128
+#define	MAX_CHANNELS			512
 #define	MAX_DYNAMIC_CHANNELS	8
 
 
@@ -204,6 +322,13 @@ extern	channel_t   channels[MAX_CHANNELS];
 
 extern	int			total_channels;
 
+// voices mixed and virtualised by the last SND_CullVoices
+extern	int			snd_realvoices;
+extern	int			snd_virtualvoices;
+
+// set when -sndthread mixes on its own thread
+extern	qboolean	snd_threaded;
+
 //
 // Fake dma is a synchronous faking of the DMA progress used for
 // isolating performance in the renderer.  The fakedma_updates is
@@ -222,6 +347,10 @@ extern volatile dma_t sn;
 extern vec_t sound_nominal_clip_dist;
 
 extern	cvar_t loadas8bit;
+extern	cvar_t snd_resample;
+extern	cvar_t snd_adpcm;
+extern	cvar_t snd_nativerate;
+extern	cvar_t snd_streamsize;
 extern	cvar_t bgmvolume;
 extern	cvar_t bgmtype; 
 extern	cvar_t volume;
@@ -26,6 +26,8 @@ server_static_t	svs;
 
 char	localmodels[MAX_MODELS][5];			// inline model names for precache
 
+cvar_t	sv_protocol = {"sv_protocol", "15"};	// 16 = PROTOCOL_COMPACT, latched at map load
+
 //============================================================================
 
 /*
@@ -57,6 +59,7 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
+	Cvar_RegisterVariable (&sv_protocol);
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -70,6 +73,22 @@ EVENT MESSAGES
 =============================================================================
 */
 
+/*
+==================
+SV_WriteCoord
+
+Positions outside the entity updates, 24 bits under PROTOCOL_COMPACT so
+they have the same range as the bit-packed origins
+==================
+*/
+void SV_WriteCoord (sizebuf_t *sb, float f)
+{
+	if (sv.protocol == PROTOCOL_COMPACT)
+		MSG_WriteLongCoord (sb, f);
+	else
+		MSG_WriteCoord (sb, f);
+}
+
 /*  
 ==================
 SV_StartParticle
@@ -84,9 +103,9 @@ void SV_StartParticle (vec3_t org, vec3_t dir, int color, int count)
 	if (sv.datagram.cursize > MAX_DATAGRAM-16)
 		return;	
 	MSG_WriteByte (&sv.datagram, svc_particle);
-	MSG_WriteCoord (&sv.datagram, org[0]);
-	MSG_WriteCoord (&sv.datagram, org[1]);
-	MSG_WriteCoord (&sv.datagram, org[2]);
+	SV_WriteCoord (&sv.datagram, org[0]);
+	SV_WriteCoord (&sv.datagram, org[1]);
+	SV_WriteCoord (&sv.datagram, org[2]);
 	for (i=0 ; i<3 ; i++)
 	{
 		v = dir[i]*16;
@@ -167,7 +186,7 @@ void SV_StartSound (edict_t *entity, int channel, char *sample, int volume,
 	MSG_WriteShort (&sv.datagram, channel);
 	MSG_WriteByte (&sv.datagram, sound_num);
 	for (i=0 ; i<3 ; i++)
-		MSG_WriteCoord (&sv.datagram, entity->v.origin[i]+0.5*(entity->v.mins[i]+entity->v.maxs[i]));
+		SV_WriteCoord (&sv.datagram, entity->v.origin[i]+0.5*(entity->v.mins[i]+entity->v.maxs[i]));
 }           
 
 /*
@@ -196,7 +215,7 @@ void SV_SendServerinfo (client_t *client)
 	MSG_WriteString (&client->message,message);
 
 	MSG_WriteByte (&client->message, svc_serverinfo);
-	MSG_WriteLong (&client->message, PROTOCOL_VERSION);
+	MSG_WriteLong (&client->message, sv.protocol);
 	MSG_WriteByte (&client->message, svs.maxclients);
 
 	if (!coop.value && deathmatch.value)
@@ -426,6 +445,67 @@ byte *SV_FatPVS (vec3_t org)
 //=============================================================================
 
 
+/*
+=============
+SV_WriteUpdateField
+
+Writes one entity field either byte aligned or into the PROTOCOL_COMPACT
+bit stream when bw is set
+=============
+*/
+void SV_WriteUpdateField (sizebuf_t *msg, bitwriter_t *bw, int field, float value)
+{
+	if (bw)
+	{
+		MSG_WriteQuant (bw, field, value);
+		return;
+	}
+
+	switch (field)
+	{
+	case NQ_RENDERCOLOR:
+		MSG_WriteCoord (msg, value);
+		break;
+	case NQ_ANGLE:
+		MSG_WriteAngle (msg, value);
+		break;
+	default:
+		MSG_WriteByte (msg, value);
+		break;
+	}
+}
+
+/*
+=============
+SV_WriteUpdateOrigin
+
+PROTOCOL_COMPACT origins are a delta from the baseline in the units the
+client stored it with, so only moving entities pay for the long form
+=============
+*/
+void SV_WriteUpdateOrigin (sizebuf_t *msg, bitwriter_t *bw, float value, float base)
+{
+	int		delta;
+
+	if (!bw)
+	{
+		MSG_WriteCoord (msg, value);
+		return;
+	}
+
+	delta = (int)(value*8) - (((int)(base*8) << 8) >> 8);	// as the 24 bit baseline arrived
+	if (delta >= -(1<<(net_quant[NQ_ORIGIN].bits-1)) && delta < (1<<(net_quant[NQ_ORIGIN].bits-1)))
+	{
+		MSG_WriteBits (bw, 0, 1);
+		MSG_WriteSignedBits (bw, delta, net_quant[NQ_ORIGIN].bits);
+	}
+	else
+	{
+		MSG_WriteBits (bw, 1, 1);
+		MSG_WriteSignedBits (bw, delta, net_quant[NQ_ORIGIN_LONG].bits);
+	}
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
@@ -440,12 +520,15 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 	vec3_t	org;
 	float	miss;
 	edict_t	*ent;
+	int		lastnum;
+	bitwriter_t	bits_w, *bw;
 
 // find the client's PVS
 	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
 	pvs = SV_FatPVS (org);
 
 // send over all entities (excpet the client) that touch the pvs
+	lastnum = 0;
 	ent = NEXT_EDICT(sv.edicts);
 	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
 	{
@@ -542,70 +625,94 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 		if (ent->baseline.modelindex != ent->v.modelindex)
 			bits |= U_MODEL;
 
-		if (e >= 256)
-			bits |= U_LONGENTITY;
-			
-		if (bits >= 256)
-			bits |= U_MOREBITS;
+		if (sv.protocol == PROTOCOL_COMPACT)
+		{
+			if (bits >= 256)
+				bits |= U_MOREBITS;
+		}
+		else
+		{
+			if (e >= 256)
+				bits |= U_LONGENTITY;
+
+			if (bits >= 256)
+				bits |= U_MOREBITS;
 // Tomaz
-        if (bits >= 65536)
-	        bits |= U_EXTEND1;
+			if (bits >= 65536)
+				bits |= U_EXTEND1;
+		}
 
 	//
 	// write the message
 	//
 		MSG_WriteByte (msg,bits | U_SIGNAL);
-		
-		if (bits & U_MOREBITS)
-			MSG_WriteByte (msg, bits>>8);
-// Tomaz
-        if (bits & U_EXTEND1)
-	        MSG_WriteByte (msg, bits>>16);
-		if (bits & U_LONGENTITY)
-			MSG_WriteShort (msg,e);
+
+		if (sv.protocol == PROTOCOL_COMPACT)
+		{
+			bw = &bits_w;
+			MSG_BeginBits (bw, msg);
+			if (bits & U_MOREBITS)
+				MSG_WriteBits (bw, bits>>8, U_COMPACT_MOREBITS);
+			MSG_WriteVarBits (bw, e - lastnum);
+			lastnum = e;
+		}
 		else
-			MSG_WriteByte (msg,e);
+		{
+			bw = NULL;
+			if (bits & U_MOREBITS)
+				MSG_WriteByte (msg, bits>>8);
+// Tomaz
+			if (bits & U_EXTEND1)
+				MSG_WriteByte (msg, bits>>16);
+			if (bits & U_LONGENTITY)
+				MSG_WriteShort (msg,e);
+			else
+				MSG_WriteByte (msg,e);
+		}
 
 		if (bits & U_MODEL)
-			MSG_WriteByte (msg,	ent->v.modelindex);
+			SV_WriteUpdateField (msg, bw, NQ_MODEL, ent->v.modelindex);
 		if (bits & U_FRAME)
-			MSG_WriteByte (msg, ent->v.frame);
+			SV_WriteUpdateField (msg, bw, NQ_FRAME, ent->v.frame);
 		if (bits & U_COLORMAP)
-			MSG_WriteByte (msg, ent->v.colormap);
+			SV_WriteUpdateField (msg, bw, NQ_COLORMAP, ent->v.colormap);
 		if (bits & U_SKIN)
-			MSG_WriteByte (msg, ent->v.skin);
+			SV_WriteUpdateField (msg, bw, NQ_SKIN, ent->v.skin);
 		if (bits & U_EFFECTS)
-			MSG_WriteByte (msg, ent->v.effects);
+			SV_WriteUpdateField (msg, bw, NQ_EFFECTS, ent->v.effects);
 #ifdef ADQ_CUSTOM
 //New vars
 		if (bits & U_RENDERAMT)
-			MSG_WriteByte (msg, ent->v.renderamt);
+			SV_WriteUpdateField (msg, bw, NQ_RENDERAMT, ent->v.renderamt);
 		if (bits & U_RENDERMODE)
-			MSG_WriteByte (msg, ent->v.rendermode);
+			SV_WriteUpdateField (msg, bw, NQ_RENDERMODE, ent->v.rendermode);
 		if (bits & U_RENDERCOLOR1)
-			MSG_WriteCoord (msg, ent->v.rendercolor[0]);
+			SV_WriteUpdateField (msg, bw, NQ_RENDERCOLOR, ent->v.rendercolor[0]);
 		if (bits & U_RENDERCOLOR2)
-			MSG_WriteCoord (msg, ent->v.rendercolor[1]);
+			SV_WriteUpdateField (msg, bw, NQ_RENDERCOLOR, ent->v.rendercolor[1]);
 		if (bits & U_RENDERCOLOR3)
-			MSG_WriteCoord (msg, ent->v.rendercolor[2]);
+			SV_WriteUpdateField (msg, bw, NQ_RENDERCOLOR, ent->v.rendercolor[2]);
 //New vars
 		if (bits & U_SEQUENCE)
-			MSG_WriteByte (msg, ent->v.sequence);
+			SV_WriteUpdateField (msg, bw, NQ_SEQUENCE, ent->v.sequence);
 		if (bits & U_BODYGROUP)
-			MSG_WriteByte (msg, ent->v.bodygroup);
+			SV_WriteUpdateField (msg, bw, NQ_BODYGROUP, ent->v.bodygroup);
 #endif
 		if (bits & U_ORIGIN1)
-			MSG_WriteCoord (msg, ent->v.origin[0]);		
+			SV_WriteUpdateOrigin (msg, bw, ent->v.origin[0], ent->baseline.origin[0]);
 		if (bits & U_ANGLE1)
-			MSG_WriteAngle(msg, ent->v.angles[0]);
+			SV_WriteUpdateField (msg, bw, NQ_ANGLE, ent->v.angles[0]);
 		if (bits & U_ORIGIN2)
-			MSG_WriteCoord (msg, ent->v.origin[1]);
+			SV_WriteUpdateOrigin (msg, bw, ent->v.origin[1], ent->baseline.origin[1]);
 		if (bits & U_ANGLE2)
-			MSG_WriteAngle(msg, ent->v.angles[1]);
+			SV_WriteUpdateField (msg, bw, NQ_ANGLE, ent->v.angles[1]);
 		if (bits & U_ORIGIN3)
-			MSG_WriteCoord (msg, ent->v.origin[2]);
+			SV_WriteUpdateOrigin (msg, bw, ent->v.origin[2], ent->baseline.origin[2]);
 		if (bits & U_ANGLE3)
-			MSG_WriteAngle(msg, ent->v.angles[2]);
+			SV_WriteUpdateField (msg, bw, NQ_ANGLE, ent->v.angles[2]);
+
+		if (bw)
+			MSG_EndBits (bw);
 	}
 }
 
@@ -652,7 +759,7 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 		MSG_WriteByte (msg, ent->v.dmg_save);
 		MSG_WriteByte (msg, ent->v.dmg_take);
 		for (i=0 ; i<3 ; i++)
-			MSG_WriteCoord (msg, other->v.origin[i] + 0.5*(other->v.mins[i] + other->v.maxs[i]));
+			SV_WriteCoord (msg, other->v.origin[i] + 0.5*(other->v.mins[i] + other->v.maxs[i]));
 	
 		ent->v.dmg_take = 0;
 		ent->v.dmg_save = 0;
@@ -739,6 +846,9 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 #endif
 // send the data
 
+	if (sv.protocol == PROTOCOL_COMPACT)
+		bits |= SU_MOVESEQUENCE;
+
 	MSG_WriteByte (msg, svc_clientdata);
 	MSG_WriteShort (msg, bits);
 
@@ -753,7 +863,12 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 		if (bits & (SU_PUNCH1<<i))
 			MSG_WriteChar (msg, ent->v.punchangle[i]);
 		if (bits & (SU_VELOCITY1<<i))
-			MSG_WriteChar (msg, ent->v.velocity[i]/16);
+		{	// prediction needs more than 16 unit steps
+			if (sv.protocol == PROTOCOL_COMPACT)
+				MSG_WriteShort (msg, ent->v.velocity[i]);
+			else
+				MSG_WriteChar (msg, ent->v.velocity[i]/16);
+		}
 	}
 
 // [always sent]	if (bits & SU_ITEMS)
@@ -777,6 +892,9 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 	if (bits & SU_SEQUENCE)
 		MSG_WriteByte (msg, ent->v.wepsequence);
 #endif
+
+	if (bits & SU_MOVESEQUENCE)
+		MSG_WriteByte (msg, svs.clients[NUM_FOR_EDICT(ent)-1].movesequence);
 	MSG_WriteShort (msg, ent->v.health);
 	MSG_WriteByte (msg, ent->v.currentammo);
 	MSG_WriteByte (msg, ent->v.ammo_shells);
@@ -1082,7 +1200,7 @@ void SV_CreateBaseline (void)
            MSG_WriteCoord(&sv.signon, svent->baseline.rendercolor[i]);
 //New vars
 #endif
-			MSG_WriteCoord(&sv.signon, svent->baseline.origin[i]);
+			SV_WriteCoord(&sv.signon, svent->baseline.origin[i]);
 			MSG_WriteAngle(&sv.signon, svent->baseline.angles[i]);
 		}
 	}
@@ -1218,6 +1336,11 @@ void SV_SpawnServer (char *server)
 	memset (&sv, 0, sizeof(sv));
 
 	strcpy (sv.name, server);
+
+	if ((int)sv_protocol.value == PROTOCOL_COMPACT)
+		sv.protocol = PROTOCOL_COMPACT;
+	else
+		sv.protocol = PROTOCOL_VERSION;
 #ifdef QUAKE2
 	if (startspot)
 		strcpy(sv.startspot, startspot);
@@ -52,6 +52,7 @@ static	vec3_t	vec_origin = {0.0, 0.0, 0.0};
 #define	MOVE_EPSILON	0.01
 
 void SV_Physics_Toss (edict_t *ent);
+trace_t SV_PushEntity (edict_t *ent, vec3_t push, vec3_t apush);
 
 /*
 ================
@@ -295,149 +296,102 @@ int ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce)
 
 /*
 ============
-SV_FlyMove
+SV_PmoveTrace, SV_PmovePush, SV_PmoveImpact
 
-The basic solid body movement clip that slides along multiple planes
-Returns the clipflags if the velocity was modified (hit something solid)
-1 = floor
-2 = wall / step
-4 = dead stop
-If steptrace is not NULL, the trace of any vertical wall hit will be stored
+pmove_t callbacks that move the edict in pm->mover.  The edict is kept in
+step with pm around anything that runs QuakeC.
 ============
 */
-#define	MAX_CLIP_PLANES	5
-int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
+static trace_t SV_PmoveTrace (pmove_t *pm, vec3_t start, vec3_t end)
 {
-	int			bumpcount, numbumps;
-	vec3_t		dir;
-	float		d;
-	int			numplanes;
-	vec3_t		planes[MAX_CLIP_PLANES];
-	vec3_t		primal_velocity, original_velocity, new_velocity;
-	int			i, j;
-	trace_t		trace;
-	vec3_t		end;
-	float		time_left;
-	int			blocked;
-	
-	numbumps = 4;
-	
-	blocked = 0;
-	VectorCopy (ent->v.velocity, original_velocity);
-	VectorCopy (ent->v.velocity, primal_velocity);
-	numplanes = 0;
-	
-	time_left = time;
-
-	for (bumpcount=0 ; bumpcount<numbumps ; bumpcount++)
-	{
-		if (!ent->v.velocity[0] && !ent->v.velocity[1] && !ent->v.velocity[2])
-			break;
-
-		for (i=0 ; i<3 ; i++)
-			end[i] = ent->v.origin[i] + time_left * ent->v.velocity[i];
+	return SV_Move (start, pm->mins, pm->maxs, end, false, (edict_t *)pm->mover);
+}
 
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, false, ent);
+static trace_t SV_PmovePush (pmove_t *pm, vec3_t push)
+{
+	edict_t	*ent = (edict_t *)pm->mover;
+	trace_t	trace;
 
-		if (trace.allsolid)
-		{	// entity is trapped in another solid
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return 3;
-		}
+	VectorCopy (pm->origin, ent->v.origin);
+	VectorCopy (pm->velocity, ent->v.velocity);
+	trace = SV_PushEntity (ent, push, vec3_origin);
+	VectorCopy (ent->v.origin, pm->origin);
+	VectorCopy (ent->v.velocity, pm->velocity);
+	pm->movetype = (int)ent->v.movetype;
+	return trace;
+}
 
-		if (trace.fraction > 0)
-		{	// actually covered some distance
-			VectorCopy (trace.endpos, ent->v.origin);
-			VectorCopy (ent->v.velocity, original_velocity);
-			numplanes = 0;
-		}
+static qboolean SV_PmoveImpact (pmove_t *pm, trace_t *trace)
+{
+	edict_t	*ent = (edict_t *)pm->mover;
 
-		if (trace.fraction == 1)
-			 break;		// moved the entire distance
+	if (!trace->ent)
+		Sys_Error ("SV_FlyMove: !trace.ent");
 
-		if (!trace.ent)
-			Sys_Error ("SV_FlyMove: !trace.ent");
+	if (trace->plane.normal[2] > 0.7 && trace->ent->v.solid == SOLID_BSP)
+	{
+		ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
+		ent->v.groundentity = EDICT_TO_PROG(trace->ent);
+	}
 
-		if (trace.plane.normal[2] > 0.7)
-		{
-			blocked |= 1;		// floor
-			if (trace.ent->v.solid == SOLID_BSP)
-			{
-				ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
-				ent->v.groundentity = EDICT_TO_PROG(trace.ent);
-			}
-		}
-		if (!trace.plane.normal[2])
-		{
-			blocked |= 2;		// step
-			if (steptrace)
-				*steptrace = trace;	// save for player extrafriction
-		}
+	VectorCopy (pm->origin, ent->v.origin);
+	VectorCopy (pm->velocity, ent->v.velocity);
+	SV_Impact (ent, trace->ent);
+	if (ent->free)
+		return false;
+	VectorCopy (ent->v.origin, pm->origin);
+	VectorCopy (ent->v.velocity, pm->velocity);
+	pm->movetype = (int)ent->v.movetype;
+	return true;
+}
 
-//
-// run the impact function
-//
-		SV_Impact (ent, trace.ent);
-		if (ent->free)
-			break;		// removed by the impact function
+/*
+============
+SV_SetupEdictMove
 
-		
-		time_left -= time_left * trace.fraction;
-		
-	// cliped to another plane
-		if (numplanes >= MAX_CLIP_PLANES)
-		{	// this shouldn't really happen
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return 3;
-		}
+Loads ent into the shared movement state for PM_FlyMove and PM_WalkMove
+============
+*/
+static void SV_SetupEdictMove (edict_t *ent, pmove_t *pm)
+{
+	memset (pm, 0, sizeof(*pm));
+	VectorCopy (ent->v.origin, pm->origin);
+	VectorCopy (ent->v.velocity, pm->velocity);
+	VectorCopy (ent->v.v_angle, pm->v_angle);
+	VectorCopy (ent->v.mins, pm->mins);
+	VectorCopy (ent->v.maxs, pm->maxs);
+	pm->frametime = host_frametime;
+	pm->movetype = (int)ent->v.movetype;
+	pm->waterlevel = (int)ent->v.waterlevel;
+	pm->onground = ((int)ent->v.flags & FL_ONGROUND) != 0;
+	pm->waterjump = ((int)ent->v.flags & FL_WATERJUMP) != 0;
+	pm->trace = SV_PmoveTrace;
+	pm->push = SV_PmovePush;
+	pm->impact = SV_PmoveImpact;
+	pm->mover = ent;
+}
 
-		VectorCopy (trace.plane.normal, planes[numplanes]);
-		numplanes++;
+/*
+============
+SV_FlyMove
 
-//
-// modify original_velocity so it parallels all of the clip planes
-//
-		for (i=0 ; i<numplanes ; i++)
-		{
-			ClipVelocity (original_velocity, planes[i], new_velocity, 1);
-			for (j=0 ; j<numplanes ; j++)
-				if (j != i)
-				{
-					if (DotProduct (new_velocity, planes[j]) < 0)
-						break;	// not ok
-				}
-			if (j == numplanes)
-				break;
-		}
-		
-		if (i != numplanes)
-		{	// go along this plane
-			VectorCopy (new_velocity, ent->v.velocity);
-		}
-		else
-		{	// go along the crease
-			if (numplanes != 2)
-			{
-//				Con_Printf ("clip velocity, numplanes == %i\n",numplanes);
-				VectorCopy (vec3_origin, ent->v.velocity);
-				return 7;
-			}
-			CrossProduct (planes[0], planes[1], dir);
-			d = DotProduct (dir, ent->v.velocity);
-			VectorScale (dir, d, ent->v.velocity);
-		}
+The basic solid body movement clip that slides along multiple planes,
+see PM_FlyMove.  Impacts run as it goes and floors that are SOLID_BSP
+become the groundentity.
+============
+*/
+int SV_FlyMove (edict_t *ent, float time, trace_t *steptrace)
+{
+	pmove_t	pm;
+	int		blocked;
 
-//
-// if original velocity is against the original velocity, stop dead
-// to avoid tiny occilations in sloping corners
-//
-		if (DotProduct (ent->v.velocity, primal_velocity) <= 0)
-		{
-			VectorCopy (vec3_origin, ent->v.velocity);
-			return blocked;
-		}
+	SV_SetupEdictMove (ent, &pm);
+	blocked = PM_FlyMove (&pm, time, steptrace);
+	if (!ent->free)
+	{
+		VectorCopy (pm.origin, ent->v.origin);
+		VectorCopy (pm.velocity, ent->v.velocity);
 	}
-
 	return blocked;
 }
 
@@ -1112,193 +1066,24 @@ qboolean SV_CheckWater (edict_t *ent)
 	return ent->v.waterlevel > 1;
 }
 
-/*
-============
-SV_WallFriction
-
-============
-*/
-void SV_WallFriction (edict_t *ent, trace_t *trace)
-{
-	vec3_t		forward, right, up;
-	float		d, i;
-	vec3_t		into, side;
-	
-	AngleVectors (ent->v.v_angle, forward, right, up);
-	d = DotProduct (trace->plane.normal, forward);
-	
-	d += 0.5;
-	if (d >= 0)
-		return;
-		
-// cut the tangential velocity
-	i = DotProduct (trace->plane.normal, ent->v.velocity);
-	VectorScale (trace->plane.normal, i, into);
-	VectorSubtract (ent->v.velocity, into, side);
-	
-	ent->v.velocity[0] = side[0] * (1 + d);
-	ent->v.velocity[1] = side[1] * (1 + d);
-}
-
-/*
-=====================
-SV_TryUnstick
-
-Player has come to a dead stop, possibly due to the problem with limited
-float precision at some angle joins in the BSP hull.
-
-Try fixing by pushing one pixel in each direction.
-
-This is a hack, but in the interest of good gameplay...
-======================
-*/
-int SV_TryUnstick (edict_t *ent, vec3_t oldvel)
-{
-	int		i;
-	vec3_t	oldorg;
-	vec3_t	dir;
-	int		clip;
-	trace_t	steptrace;
-	
-	VectorCopy (ent->v.origin, oldorg);
-	VectorCopy (vec3_origin, dir);
-
-	for (i=0 ; i<8 ; i++)
-	{
-// try pushing a little in an axial direction
-		switch (i)
-		{
-			case 0:	dir[0] = 2; dir[1] = 0; break;
-			case 1:	dir[0] = 0; dir[1] = 2; break;
-			case 2:	dir[0] = -2; dir[1] = 0; break;
-			case 3:	dir[0] = 0; dir[1] = -2; break;
-			case 4:	dir[0] = 2; dir[1] = 2; break;
-			case 5:	dir[0] = -2; dir[1] = 2; break;
-			case 6:	dir[0] = 2; dir[1] = -2; break;
-			case 7:	dir[0] = -2; dir[1] = -2; break;
-		}
-		
-		SV_PushEntity (ent, dir, vec3_origin);
-
-// retry the original move
-		ent->v.velocity[0] = oldvel[0];
-		ent->v. velocity[1] = oldvel[1];
-		ent->v. velocity[2] = 0;
-		clip = SV_FlyMove (ent, 0.1, &steptrace);
-
-		if ( fabsf(oldorg[1] - ent->v.origin[1]) > 4
-		|| fabsf(oldorg[0] - ent->v.origin[0]) > 4 )
-		{
-//Con_DPrintf ("unstuck!\n");
-			return clip;
-		}
-			
-// go back to the original pos and try again
-		VectorCopy (oldorg, ent->v.origin);
-	}
-	
-	VectorCopy (vec3_origin, ent->v.velocity);
-	return 7;		// still not moving
-}
-
 /*
 =====================
 SV_WalkMove
 
-Only used by players
+Only used by players, see PM_WalkMove
 ======================
 */
-#define	STEPSIZE	18
 void SV_WalkMove (edict_t *ent)
 {
-	vec3_t		upmove, downmove;
-	vec3_t		oldorg, oldvel;
-	vec3_t		nosteporg, nostepvel;
-	int			clip;
-	int			oldonground;
-	trace_t		steptrace, downtrace;
-	
-//
-// do a regular slide move unless it looks like you ran into a step
-//
-	oldonground = (int)ent->v.flags & FL_ONGROUND;
-	ent->v.flags = (int)ent->v.flags & ~FL_ONGROUND;
-	
-	VectorCopy (ent->v.origin, oldorg);
-	VectorCopy (ent->v.velocity, oldvel);
-	
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
-
-	if ( !(clip & 2) )
-		return;		// move didn't block on a step
-
-	if (!oldonground && ent->v.waterlevel == 0)
-		return;		// don't stair up while jumping
-	
-	if (ent->v.movetype != MOVETYPE_WALK)
-		return;		// gibbed by a trigger
-	
-	if (sv_nostep.value)
-		return;
-	
-	if ( (int)sv_player->v.flags & FL_WATERJUMP )
-		return;
-
-	VectorCopy (ent->v.origin, nosteporg);
-	VectorCopy (ent->v.velocity, nostepvel);
-
-//
-// try moving up and forward to go up a step
-//
-	VectorCopy (oldorg, ent->v.origin);	// back to start pos
-
-	VectorCopy (vec3_origin, upmove);
-	VectorCopy (vec3_origin, downmove);
-	upmove[2] = STEPSIZE;
-	downmove[2] = -STEPSIZE + oldvel[2]*host_frametime;
-
-// move up
-	SV_PushEntity (ent, upmove, vec3_origin);	// FIXME: don't link?
-
-// move forward
-	ent->v.velocity[0] = oldvel[0];
-	ent->v. velocity[1] = oldvel[1];
-	ent->v. velocity[2] = 0;
-	clip = SV_FlyMove (ent, host_frametime, &steptrace);
+	pmove_t	pm;
 
-// check for stuckness, possibly due to the limited precision of floats
-// in the clipping hulls
-	if (clip)
-	{
-		if ( fabsf(oldorg[1] - ent->v.origin[1]) < 0.03125
-		&& fabsf(oldorg[0] - ent->v.origin[0]) < 0.03125 )
-		{	// stepping up didn't make any progress
-			clip = SV_TryUnstick (ent, oldvel);
-		}
-	}
-	
-// extra friction based on view angle
-	if ( clip & 2 )
-		SV_WallFriction (ent, &steptrace);
-
-// move down
-	downtrace = SV_PushEntity (ent, downmove, vec3_origin);	// FIXME: don't link?
-
-	if (downtrace.plane.normal[2] > 0.7)
-	{
-		if (ent->v.solid == SOLID_BSP)
-		{
-			ent->v.flags =	(int)ent->v.flags | FL_ONGROUND;
-			ent->v.groundentity = EDICT_TO_PROG(downtrace.ent);
-		}
-	}
-	else
+	SV_SetupEdictMove (ent, &pm);
+	ent->v.flags = (int)ent->v.flags & ~FL_ONGROUND;
+	PM_WalkMove (&pm);
+	if (!ent->free)
 	{
-// if the push down didn't end up on good ground, use the move without
-// the step up.  This happens near wall / slope combinations, and can
-// cause the player to hop up higher on a slope too steep to climb	
-		VectorCopy (nosteporg, ent->v.origin);
-		VectorCopy (nostepvel, ent->v.velocity);
+		VectorCopy (pm.origin, ent->v.origin);
+		VectorCopy (pm.velocity, ent->v.velocity);
 	}
 }
 
@@ -27,11 +27,6 @@ extern	cvar_t	sv_friction;
 cvar_t	sv_edgefriction = {"edgefriction", "2"};
 extern	cvar_t	sv_stopspeed;
 
-static	vec3_t		forward, right, up;
-
-vec3_t	wishdir;
-float	wishspeed;
-
 // world
 float	*angles;
 float	*origin;
@@ -122,32 +117,21 @@ void SV_SetIdealPitch (void)
 }
 
 
+cvar_t	sv_maxspeed = {"sv_maxspeed", "320", false, true};
+cvar_t	sv_accelerate = {"sv_accelerate", "10"};
+
 /*
 ==================
-SV_UserFriction
+SV_DropoffCheck
 
+pmove_t callback for the edge friction test
 ==================
 */
-void SV_UserFriction (void)
+qboolean SV_DropoffCheck (vec3_t start, vec3_t stop)
 {
-	float	*vel;
-	float	speed, newspeed, control;
-	vec3_t	start, stop;
-	float	friction;
 	trace_t	trace;
 	float	save_hull;
-	
-	vel = velocity;
-	
-	speed = sqrtf(vel[0]*vel[0] +vel[1]*vel[1]);
-	if (!speed)
-		return;
 
-// if the leading edge is over a dropoff, increase friction
-	start[0] = stop[0] = origin[0] + vel[0]/speed*16;
-	start[1] = stop[1] = origin[1] + vel[1]/speed*16;
-	start[2] = origin[2] + sv_player->v.mins[2];
-	stop[2] = start[2] - 34;
 #ifdef ADQ_CUSTOM
 	save_hull = sv_player->v.hull;
 	sv_player->v.hull = 0;
@@ -156,91 +140,38 @@ void SV_UserFriction (void)
 #ifdef ADQ_CUSTOM
 	sv_player->v.hull = save_hull;
 #endif
-	if (trace.fraction == 1.0)
-		friction = sv_friction.value*sv_edgefriction.value;
-	else
-		friction = sv_friction.value;
-
-// apply friction	
-	control = speed < sv_stopspeed.value ? sv_stopspeed.value : speed;
-	newspeed = speed - host_frametime*control*friction;
-	
-	if (newspeed < 0)
-		newspeed = 0;
-	newspeed /= speed;
-
-	vel[0] = vel[0] * newspeed;
-	vel[1] = vel[1] * newspeed;
-	vel[2] = vel[2] * newspeed;
+	return trace.fraction == 1.0;
 }
 
 /*
-==============
-SV_Accelerate
-==============
-*/
-cvar_t	sv_maxspeed = {"sv_maxspeed", "320", false, true};
-cvar_t	sv_accelerate = {"sv_accelerate", "10"};
-#if 0
-void SV_Accelerate (vec3_t wishvel)
-{
-	int			i;
-	float		addspeed, accelspeed;
-	vec3_t		pushvec;
-
-	if (wishspeed == 0)
-		return;
-
-	VectorSubtract (wishvel, velocity, pushvec);
-	addspeed = VectorNormalize (pushvec);
-
-	accelspeed = sv_accelerate.value*host_frametime*addspeed;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-	
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed*pushvec[i];	
-}
-#endif
-void SV_Accelerate (void)
-{
-	int			i;
-	float		addspeed, accelspeed, currentspeed;
-
-	currentspeed = DotProduct (velocity, wishdir);
-	addspeed = wishspeed - currentspeed;
-	if (addspeed <= 0)
-		return;
-	accelspeed = sv_accelerate.value*host_frametime*wishspeed;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-	
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed*wishdir[i];	
-}
+==================
+SV_SetupPlayerMove
 
-void SV_AirAccelerate (vec3_t wishveloc)
+Loads sv_player and the current command into the shared movement state
+==================
+*/
+void SV_SetupPlayerMove (pmove_t *pm)
 {
-	int			i;
-	float		addspeed, wishspd, accelspeed, currentspeed;
-		
-	wishspd = VectorNormalize (wishveloc);
-	if (wishspd > 30)
-		wishspd = 30;
-	currentspeed = DotProduct (velocity, wishveloc);
-	addspeed = wishspd - currentspeed;
-	if (addspeed <= 0)
-		return;
-//	accelspeed = sv_accelerate.value * host_frametime;
-	accelspeed = sv_accelerate.value*wishspeed * host_frametime;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-	
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed*wishveloc[i];	
+	VectorCopy (origin, pm->origin);
+	VectorCopy (velocity, pm->velocity);
+	VectorCopy (sv_player->v.angles, pm->angles);
+	VectorCopy (sv_player->v.v_angle, pm->v_angle);
+	VectorCopy (sv_player->v.mins, pm->mins);
+	VectorCopy (sv_player->v.maxs, pm->maxs);
+	pm->cmd = cmd;
+	pm->frametime = host_frametime;
+	pm->movetype = (int)sv_player->v.movetype;
+	pm->waterlevel = (int)sv_player->v.waterlevel;
+	pm->onground = onground;
+	pm->noback = sv.time < sv_player->v.teleport_time;
+	pm->waterjump = false;		// SV_ClientThink doesn't get here during one
+	pm->dropoff = SV_DropoffCheck;
+	pm->trace = NULL;
+	pm->push = NULL;
+	pm->impact = NULL;
+	pm->mover = sv_player;
 }
 
-
 void DropPunchAngle (void)
 {
 	float	len;
@@ -253,72 +184,6 @@ void DropPunchAngle (void)
 	VectorScale (sv_player->v.punchangle, len, sv_player->v.punchangle);
 }
 
-/*
-===================
-SV_WaterMove
-
-===================
-*/
-void SV_WaterMove (void)
-{
-	int		i;
-	vec3_t	wishvel;
-	float	speed, newspeed, wishspeed, addspeed, accelspeed;
-
-//
-// user intentions
-//
-	AngleVectors (sv_player->v.v_angle, forward, right, up);
-
-	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*cmd.forwardmove + right[i]*cmd.sidemove;
-
-	if (!cmd.forwardmove && !cmd.sidemove && !cmd.upmove)
-		wishvel[2] -= 60;		// drift towards bottom
-	else
-		wishvel[2] += cmd.upmove;
-
-	wishspeed = Length(wishvel);
-	if (wishspeed > sv_maxspeed.value)
-	{
-		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
-		wishspeed = sv_maxspeed.value;
-	}
-	wishspeed *= 0.7;
-
-//
-// water friction
-//
-	speed = Length (velocity);
-	if (speed)
-	{
-		newspeed = speed - host_frametime * speed * sv_friction.value;
-		if (newspeed < 0)
-			newspeed = 0;	
-		VectorScale (velocity, newspeed/speed, velocity);
-	}
-	else
-		newspeed = 0;
-	
-//
-// water acceleration
-//
-	if (!wishspeed)
-		return;
-
-	addspeed = wishspeed - newspeed;
-	if (addspeed <= 0)
-		return;
-
-	VectorNormalize (wishvel);
-	accelspeed = sv_accelerate.value * wishspeed * host_frametime;
-	if (accelspeed > addspeed)
-		accelspeed = addspeed;
-
-	for (i=0 ; i<3 ; i++)
-		velocity[i] += accelspeed * wishvel[i];
-}
-
 void SV_WaterJump (void)
 {
 	if (sv.time > sv_player->v.teleport_time
@@ -332,58 +197,6 @@ void SV_WaterJump (void)
 }
 
 
-/*
-===================
-SV_AirMove
-
-===================
-*/
-void SV_AirMove (void)
-{
-	int			i;
-	vec3_t		wishvel;
-	float		fmove, smove;
-
-	AngleVectors (sv_player->v.angles, forward, right, up);
-
-	fmove = cmd.forwardmove;
-	smove = cmd.sidemove;
-	
-// hack to not let you back into teleporter
-	if (sv.time < sv_player->v.teleport_time && fmove < 0)
-		fmove = 0;
-		
-	for (i=0 ; i<3 ; i++)
-		wishvel[i] = forward[i]*fmove + right[i]*smove;
-
-	if ( (int)sv_player->v.movetype != MOVETYPE_WALK)
-		wishvel[2] = cmd.upmove;
-	else
-		wishvel[2] = 0;
-
-	VectorCopy (wishvel, wishdir);
-	wishspeed = VectorNormalize(wishdir);
-	if (wishspeed > sv_maxspeed.value)
-	{
-		VectorScale (wishvel, sv_maxspeed.value/wishspeed, wishvel);
-		wishspeed = sv_maxspeed.value;
-	}
-	
-	if ( sv_player->v.movetype == MOVETYPE_NOCLIP)
-	{	// noclip
-		VectorCopy (wishvel, velocity);
-	}
-	else if ( onground )
-	{
-		SV_UserFriction ();
-		SV_Accelerate ();
-	}
-	else
-	{	// not on ground, so little effect on velocity
-		SV_AirAccelerate (wishvel);
-	}		
-}
-
 /*
 ===================
 SV_ClientThink
@@ -395,6 +208,7 @@ the angle fields specify an exact angular motion in degrees
 void SV_ClientThink (void)
 {
 	vec3_t		v_angle;
+	pmove_t		pm;
 
 	if (sv_player->v.movetype == MOVETYPE_NONE)
 		return;
@@ -436,14 +250,9 @@ void SV_ClientThink (void)
 //
 // walk
 //
-	if ( (sv_player->v.waterlevel >= 2)
-	&& (sv_player->v.movetype != MOVETYPE_NOCLIP) )
-	{
-		SV_WaterMove ();
-		return;
-	}
-
-	SV_AirMove ();	
+	SV_SetupPlayerMove (&pm);
+	PM_PlayerMove (&pm);
+	VectorCopy (pm.velocity, velocity);
 }
 
 
@@ -492,6 +301,9 @@ void SV_ReadClientMove (usercmd_t *move)
 	if (i)
 		host_client->edict->v.impulse = i;
 
+	if (sv.protocol == PROTOCOL_COMPACT)
+		host_client->movesequence = MSG_ReadByte ();
+
 #ifdef QUAKE2
 // read light level
 	host_client->edict->v.light_level = MSG_ReadByte ();
@@ -65,6 +65,16 @@ void Sys_Sleep (void);
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
+//
+// threads
+//
+int Sys_CreateThread (char *name, void (*func) (void *), void *arg);
+// runs func (arg) on a new thread at a higher priority than the game,
+// returns 0 if it could not be created
+
+void Sys_Delay (int msec);
+// blocks the calling thread
+
 void Sys_LowFPPrecision (void);
 void Sys_HighFPPrecision (void);
 void Sys_SetFPCW (void);
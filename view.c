@@ -367,7 +367,7 @@ void V_ParseDamage (void)
 	armor = MSG_ReadByte ();
 	blood = MSG_ReadByte ();
 	for (i=0 ; i<3 ; i++)
-		from[i] = MSG_ReadCoord ();
+		from[i] = CL_ReadCoord ();
 
 	count = blood*0.5 + armor*0.5;
 	if (count < 10)
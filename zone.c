@@ -889,6 +889,7 @@ CACHE MEMORY
 typedef struct cache_system_s
 {
 	int						size;		// including this header
+	int						locks;		// Cache_Lock count, never thrown out while set
 	cache_user_t			*user;
 	char					name[16];
 	struct cache_system_s	*prev, *next;
@@ -906,19 +907,37 @@ Cache_Move
 */
 void Cache_Move ( cache_system_t *c)
 {
-	cache_system_t		*new;
+	cache_system_t		*new, *cs;
 
 // we are clearing up space at the bottom, so only allocate it late
 	new = Cache_TryAlloc (c->size, true);
+
+// locked data can't be thrown out, so make room for it
+	while (!new && c->locks)
+	{
+		for (cs = cache_head.lru_prev ; cs != &cache_head && (cs->locks || cs == c) ; cs = cs->lru_prev)
+			;
+		if (cs == &cache_head)
+			Sys_Error ("Cache_Move: no room for locked %s", c->name);
+		Cache_Free (cs->user);
+		new = Cache_TryAlloc (c->size, true);
+	}
+
 	if (new)
 	{
 //		Con_Printf ("cache_move ok\n");
 
+	// locked data is only read by the sound thread, keep it off it
+		if (c->locks)
+			S_BlockSoundThread ();
 		Q_memcpy ( new+1, c+1, c->size - sizeof(cache_system_t) );
 		new->user = c->user;
+		new->locks = c->locks;
 		Q_memcpy (new->name, c->name, sizeof(new->name));
 		Cache_Free (c->user);
 		new->user->data = (void *)(new+1);
+		if (new->locks)
+			S_UnblockSoundThread ();
 	}
 	else
 	{
@@ -970,7 +989,11 @@ void Cache_FreeHigh (int new_high_hunk)
 		if ( (byte *)c + c->size <= hunk_base + hunk_size - new_high_hunk)
 			return;		// there is space to grow the hunk
 		if (c == prev)
+		{
+			if (c->locks)
+				Sys_Error ("Cache_FreeHigh: locked %s in the way", c->name);
 			Cache_Free (c->user);	// didn't move out of the way
+		}
 		else
 		{
 			Cache_Move (c);	// try to move it
@@ -1085,13 +1108,20 @@ cache_system_t *Cache_TryAlloc (int size, qboolean nobottom)
 ============
 Cache_Flush
 
-Throw everything out, so new data will be demand cached
+Throw everything out, so new data will be demand cached.  Locked data
+is in use and stays.
 ============
 */
 void Cache_Flush (void)
 {
-	while (cache_head.next != &cache_head)
-		Cache_Free ( cache_head.next->user );	// reclaim the space
+	cache_system_t	*c, *next;
+
+	for (c = cache_head.next ; c != &cache_head ; c = next)
+	{
+		next = c->next;
+		if (!c->locks)
+			Cache_Free ( c->user );	// reclaim the space
+	}
 }
 
 
@@ -1171,6 +1201,61 @@ void Cache_Free (cache_user_t *c)
 	Cache_UnlinkLRU (cs);
 }
 
+/*
+==============
+Cache_Lock
+
+Keeps c from being thrown out until Cache_Unlock.  It can still be moved
+by Cache_FreeLow/High, with the sound thread held.
+==============
+*/
+void Cache_Lock (cache_user_t *c)
+{
+	if (!c->data)
+		Sys_Error ("Cache_Lock: not allocated");
+
+	(((cache_system_t *)c->data) - 1)->locks++;
+}
+
+/*
+==============
+Cache_Unlock
+==============
+*/
+void Cache_Unlock (cache_user_t *c)
+{
+	cache_system_t	*cs;
+
+	if (!c->data)
+		Sys_Error ("Cache_Unlock: not allocated");
+
+	cs = ((cache_system_t *)c->data) - 1;
+	if (!cs->locks)
+		Sys_Error ("Cache_Unlock: not locked");
+	cs->locks--;
+}
+
+/*
+==============
+Cache_Reassign
+
+Hands an allocation over to another cache_user_t, for callers that keep
+their users in an array they compact
+==============
+*/
+void Cache_Reassign (cache_user_t *from, cache_user_t *to)
+{
+	cache_system_t	*cs;
+
+	if (!from->data)
+		Sys_Error ("Cache_Reassign: not allocated");
+
+	cs = ((cache_system_t *)from->data) - 1;
+	cs->user = to;
+	to->data = from->data;
+	from->data = NULL;
+}
+
 
 
 /*
@@ -1224,11 +1309,13 @@ void *Cache_Alloc (cache_user_t *c, int size, char *name)
 			break;
 		}
 	
-	// free the least recently used cahedat
-		if (cache_head.lru_prev == &cache_head)
+	// free the least recently used cahedat that isn't locked
+		for (cs = cache_head.lru_prev ; cs != &cache_head && cs->locks ; cs = cs->lru_prev)
+			;
+		if (cs == &cache_head)
 			Sys_Error ("Cache_Alloc: out of memory");
 													// not enough memory at all
-		Cache_Free ( cache_head.lru_prev->user );
+		Cache_Free ( cs->user );
 	} 
 	
 	return Cache_Check (c);
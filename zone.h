@@ -121,6 +121,13 @@ void *Cache_Check (cache_user_t *c);
 
 void Cache_Free (cache_user_t *c);
 
+void Cache_Lock (cache_user_t *c);
+void Cache_Unlock (cache_user_t *c);
+// locked data is never thrown out, for the sound thread which can't reload it
+
+void Cache_Reassign (cache_user_t *from, cache_user_t *to);
+// moves an allocation to another user, freeing the old one for reuse
+
 void *Cache_Alloc (cache_user_t *c, int size, char *name);
 // Returns NULL if all purgable data was tossed and there still
 // wasn't enough room.